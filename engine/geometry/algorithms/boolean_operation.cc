@@ -16,8 +16,11 @@
 
 #include <algorithm>
 #include <array>
+#include <cstddef>
 #include <iterator>
+#include <utility>
 
+#include "third_party/absl/memory/memory.h"
 #include "third_party/absl/strings/str_join.h"
 #include "third_party/absl/types/optional.h"
 #include "ink/engine/geometry/algorithms/intersect.h"
@@ -295,6 +298,135 @@ bool IsUnexpectedTraversalType(IntersectionType type) {
          type == IntersectionType::kOutsideToSpikeOverlap;
 }
 
+// A doubly-linked list whose nodes are stored contiguously and linked by index,
+// used in place of std::list for the traversals. As with std::list, erasing an
+// element only invalidates iterators to that element. Unlike std::list, erased
+// nodes are not freed individually, and clear() retains the storage, so a list
+// that is reused does not allocate once it has grown to its largest size.
+// Iterators refer to the list and the index of the node, so they also remain
+// valid when the storage grows.
+template <typename T>
+class ArenaList {
+ public:
+  template <typename List, typename Value>
+  class Iterator {
+   public:
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using reference = Value &;
+    using pointer = Value *;
+    using iterator_category = std::bidirectional_iterator_tag;
+
+    Iterator() {}
+    // Allows conversion from iterator to const_iterator.
+    template <typename OtherList, typename OtherValue>
+    Iterator(const Iterator<OtherList, OtherValue> &other)  // NOLINT
+        : list_(other.list_), node_(other.node_) {}
+
+    reference operator*() const { return list_->nodes_[node_].value; }
+    pointer operator->() const { return &list_->nodes_[node_].value; }
+
+    Iterator &operator++() {
+      node_ = list_->nodes_[node_].next;
+      return *this;
+    }
+    Iterator operator++(int) {
+      auto retval = *this;
+      ++*this;
+      return retval;
+    }
+    Iterator &operator--() {
+      node_ = node_ == kEnd ? list_->tail_ : list_->nodes_[node_].prev;
+      return *this;
+    }
+    Iterator operator--(int) {
+      auto retval = *this;
+      --*this;
+      return retval;
+    }
+
+    bool operator==(const Iterator &other) const {
+      return list_ == other.list_ && node_ == other.node_;
+    }
+    bool operator!=(const Iterator &other) const { return !(*this == other); }
+
+   private:
+    Iterator(List *list, int node) : list_(list), node_(node) {}
+
+    List *list_ = nullptr;
+    int node_ = kEnd;
+
+    friend class ArenaList;
+    template <typename OtherList, typename OtherValue>
+    friend class Iterator;
+  };
+  using iterator = Iterator<ArenaList, T>;
+  using const_iterator = Iterator<const ArenaList, const T>;
+
+  iterator begin() { return iterator(this, head_); }
+  iterator end() { return iterator(this, kEnd); }
+  const_iterator begin() const { return const_iterator(this, head_); }
+  const_iterator end() const { return const_iterator(this, kEnd); }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  template <typename... Args>
+  void emplace_back(Args &&... args) {
+    int node = nodes_.size();
+    nodes_.push_back({T(std::forward<Args>(args)...), tail_, kEnd});
+    if (tail_ == kEnd) {
+      head_ = node;
+    } else {
+      nodes_[tail_].next = node;
+    }
+    tail_ = node;
+    ++size_;
+  }
+
+  // Unlinks the element, and returns an iterator to the element after it.
+  iterator erase(iterator it) {
+    ASSERT(it.list_ == this && it.node_ != kEnd);
+    const Node &node = nodes_[it.node_];
+    if (node.prev == kEnd) {
+      head_ = node.next;
+    } else {
+      nodes_[node.prev].next = node.next;
+    }
+    if (node.next == kEnd) {
+      tail_ = node.prev;
+    } else {
+      nodes_[node.next].prev = node.prev;
+    }
+    --size_;
+    return iterator(this, node.next);
+  }
+
+  void clear() {
+    nodes_.clear();
+    head_ = kEnd;
+    tail_ = kEnd;
+    size_ = 0;
+  }
+
+ private:
+  static constexpr int kEnd = -1;
+
+  struct Node {
+    T value;
+    int prev;
+    int next;
+  };
+
+  std::vector<Node> nodes_;
+  int head_ = kEnd;
+  int tail_ = kEnd;
+  size_t size_ = 0;
+};
+
+template <typename T>
+constexpr int ArenaList<T>::kEnd;
+
 // A vertex in the traversal, which may be the a vertex from the original
 // polygon, or an intersection.
 struct TraversalVertex {
@@ -319,9 +451,9 @@ struct TraversalVertex {
   // intersection in the other polygon list. For non-intersection vertices, this
   // will be default-constructed, and as such, it will not be dereferencable.
   //
-  // We use std::list instead of std::vector because we need the iterators to
-  // remain valid after removing elements.
-  using Iterator = CyclicIterator<std::list<TraversalVertex>::iterator>;
+  // We use a linked list instead of std::vector because we need the iterators
+  // to remain valid after removing elements.
+  using Iterator = CyclicIterator<ArenaList<TraversalVertex>::iterator>;
   Iterator twin;
 
   TraversalVertex(glm::vec2 position_in, VertexType type_in)
@@ -333,8 +465,8 @@ struct TraversalVertex {
   }
 };
 
-std::string TraversalString(const std::list<TraversalVertex> &vertices,
-                            const std::list<TraversalVertex> &other_vertices) {
+std::string TraversalString(const ArenaList<TraversalVertex> &vertices,
+                            const ArenaList<TraversalVertex> &other_vertices) {
   std::vector<std::string> strings;
   strings.reserve(vertices.size());
   int i = 0;
@@ -342,9 +474,10 @@ std::string TraversalString(const std::list<TraversalVertex> &vertices,
     if (vertex.type == VertexType::kNonIntersection) {
       strings.push_back(Substitute("\n  [$0] $1", i, vertex));
     } else {
-      int twin_index = std::distance(other_vertices.begin(),
-                                     std::list<TraversalVertex>::const_iterator(
-                                         vertex.twin.BaseCurrent()));
+      int twin_index =
+          std::distance(other_vertices.begin(),
+                        ArenaList<TraversalVertex>::const_iterator(
+                            vertex.twin.BaseCurrent()));
 
       strings.push_back(Substitute("\n  [$0] $1 -> [$2] $3", i, vertex,
                                    twin_index, *vertex.twin));
@@ -367,7 +500,7 @@ struct IndexedIntersection {
   glm::vec2 position{0, 0};
 
   // The positions of the intersection in the respective traversal polygons.
-  std::array<std::list<TraversalVertex>::iterator, 2> traversal_it;
+  std::array<ArenaList<TraversalVertex>::iterator, 2> traversal_it;
 
   IndexedIntersection(std::array<int, 2> segment_idx_in,
                       std::array<float, 2> segment_params_in,
@@ -638,14 +771,15 @@ void PopulateIntersectionType(const TraversalVertex::Iterator &it) {
   it->twin->original_intx_type = it->twin->intx_type;
 }
 
-// Constructs one of the traversal polygons, by sorting the intersections w.r.t.
-// that polygon, and merging the lists, populating the traversal indices in the
-// IndexedIntersections.
+// Constructs one of the traversal polygons in *vertices, by sorting the
+// intersections w.r.t. that polygon, and merging the lists, populating the
+// traversal indices in the IndexedIntersections.
 // Parameter sort_idx must be 0 or 1, and indicates whether to use the first or
 // second element of the index and parameter pairs.
-std::list<TraversalVertex> MergeVerticesAndIntersections(
+void MergeVerticesAndIntersections(
     int sort_idx, const Polygon &sort_polygon, const Polygon &other_polygon,
-    std::vector<IndexedIntersection> *intersections) {
+    std::vector<IndexedIntersection> *intersections,
+    ArenaList<TraversalVertex> *vertices) {
   std::sort(
       intersections->begin(), intersections->end(),
       [sort_idx, &sort_polygon, &other_polygon](
@@ -670,7 +804,7 @@ std::list<TraversalVertex> MergeVerticesAndIntersections(
 
   // Note that we can't use std::merge() to perform the merge, because it
   // wouldn't allow us to maintain the intersection traversal indices.
-  std::list<TraversalVertex> vertices;
+  vertices->clear();
   int polygon_idx = 0;
   int intx_idx = 0;
   while (polygon_idx < sort_polygon.Size() ||
@@ -696,22 +830,21 @@ std::list<TraversalVertex> MergeVerticesAndIntersections(
                               sort_polygon.Size());
       }
       if (!is_previous_intx_at_vertex) {
-        vertices.emplace_back(sort_polygon[polygon_idx],
-                              VertexType::kNonIntersection);
+        vertices->emplace_back(sort_polygon[polygon_idx],
+                               VertexType::kNonIntersection);
       }
       ++polygon_idx;
     } else {
       bool is_at_vertex =
           coincident_vertex(intx_segment, intx_param, sort_polygon.Size()) ==
           polygon_idx % sort_polygon.Size();
-      vertices.emplace_back((*intersections)[intx_idx].position,
-                            is_at_vertex ? VertexType::kIntersectionAtVertex
-                                         : VertexType::kIntersection);
-      (*intersections)[intx_idx].traversal_it[sort_idx] = --vertices.end();
+      vertices->emplace_back((*intersections)[intx_idx].position,
+                             is_at_vertex ? VertexType::kIntersectionAtVertex
+                                          : VertexType::kIntersection);
+      (*intersections)[intx_idx].traversal_it[sort_idx] = --vertices->end();
       ++intx_idx;
     }
   }
-  return vertices;
 }
 
 void SnapIntersectionsToVertices(
@@ -760,26 +893,28 @@ void SnapMidSegmentIntersections(
 }
 
 // Gets the intersections of the two polygons and pre-processes them so that
-// they may be merged into the traversal. Note that the IndexedIntersections'
-// traversal iterators will not yet be populated.
-std::vector<IndexedIntersection> GetIntersections(const Polygon &lhs_polygon,
-                                                  const Polygon &rhs_polygon) {
-  std::vector<PolygonIntersection> raw_intersections;
-  Intersection(lhs_polygon, rhs_polygon, &raw_intersections);
-
-  SLOG(SLOG_BOOLEAN_OPERATION, "Raw Intx: $0", raw_intersections);
-
-  std::vector<IndexedIntersection> intersections;
-  intersections.reserve(raw_intersections.size());
-  for (const auto &intx : raw_intersections) {
-    intersections.emplace_back(
+// they may be merged into the traversal, storing them in *intersections. Note
+// that the IndexedIntersections' traversal iterators will not yet be populated.
+// raw_intersections is used as scratch space.
+void GetIntersections(const Polygon &lhs_polygon, const Polygon &rhs_polygon,
+                      std::vector<PolygonIntersection> *raw_intersections,
+                      std::vector<IndexedIntersection> *intersections) {
+  raw_intersections->clear();
+  Intersection(lhs_polygon, rhs_polygon, raw_intersections);
+
+  SLOG(SLOG_BOOLEAN_OPERATION, "Raw Intx: $0", *raw_intersections);
+
+  intersections->clear();
+  intersections->reserve(raw_intersections->size());
+  for (const auto &intx : *raw_intersections) {
+    intersections->emplace_back(
         intx.indices,
         std::array<float, 2>{{intx.intersection.segment1_interval[0],
                               intx.intersection.segment2_interval[0]}},
         intx.intersection.intx.from);
     if (intx.intersection.segment1_interval[0] !=
         intx.intersection.segment1_interval[1]) {
-      intersections.emplace_back(
+      intersections->emplace_back(
           intx.indices,
           std::array<float, 2>{{intx.intersection.segment1_interval[1],
                                 intx.intersection.segment2_interval[1]}},
@@ -787,21 +922,19 @@ std::vector<IndexedIntersection> GetIntersections(const Polygon &lhs_polygon,
     }
   }
 
-  SnapMidSegmentIntersections(0, &intersections);
-  SnapMidSegmentIntersections(1, &intersections);
+  SnapMidSegmentIntersections(0, intersections);
+  SnapMidSegmentIntersections(1, intersections);
 
-  SnapIntersectionsToVertices(0, lhs_polygon, &intersections);
-  SnapIntersectionsToVertices(1, rhs_polygon, &intersections);
-
-  return intersections;
+  SnapIntersectionsToVertices(0, lhs_polygon, intersections);
+  SnapIntersectionsToVertices(1, rhs_polygon, intersections);
 }
 
 // Removes the vertex pointed to by the given iterator, and its twin, from the
 // traversals, and returns an iterator pointing to the vertex after the one that
 // was removed.
 TraversalVertex::Iterator RemoveFromTraversals(
-    TraversalVertex::Iterator it, std::list<TraversalVertex> *vertices,
-    std::list<TraversalVertex> *other_vertices) {
+    TraversalVertex::Iterator it, ArenaList<TraversalVertex> *vertices,
+    ArenaList<TraversalVertex> *other_vertices) {
   ASSERT(it->type != VertexType::kNonIntersection);
   ASSERT(vertices->size() > 1);
   ASSERT(other_vertices->size() > 1);
@@ -812,7 +945,7 @@ TraversalVertex::Iterator RemoveFromTraversals(
   // twinned intersections.
 
   auto remove_from_one_side = [](TraversalVertex::Iterator it,
-                                 std::list<TraversalVertex> *vertices) {
+                                 ArenaList<TraversalVertex> *vertices) {
     if (it.BaseCurrent() == vertices->begin()) {
       *it = *std::next(it);
       if (it->type != VertexType::kNonIntersection) it->twin->twin = it;
@@ -832,8 +965,8 @@ TraversalVertex::Iterator RemoveFromTraversals(
   return remove_from_one_side(it, vertices);
 }
 
-void CorrectTopologyForSpikes(std::list<TraversalVertex> *vertices,
-                              std::list<TraversalVertex> *other_vertices) {
+void CorrectTopologyForSpikes(ArenaList<TraversalVertex> *vertices,
+                              ArenaList<TraversalVertex> *other_vertices) {
   for (auto base_it = vertices->begin(); base_it != vertices->end();
        ++base_it) {
     auto it0 = MakeCyclicIterator(vertices->begin(), vertices->end(), base_it);
@@ -869,8 +1002,8 @@ void CorrectTopologyForSpikes(std::list<TraversalVertex> *vertices,
   }
 }
 
-void RemoveDuplicateIntersections(std::list<TraversalVertex> *lhs_vertices,
-                                  std::list<TraversalVertex> *rhs_vertices) {
+void RemoveDuplicateIntersections(ArenaList<TraversalVertex> *lhs_vertices,
+                                  ArenaList<TraversalVertex> *rhs_vertices) {
   auto base_it = lhs_vertices->begin();
   while (base_it != lhs_vertices->end()) {
     auto it =
@@ -889,7 +1022,7 @@ void RemoveDuplicateIntersections(std::list<TraversalVertex> *lhs_vertices,
   }
 }
 
-void CorrectIntersectionTypesForSpikes(std::list<TraversalVertex> *vertices) {
+void CorrectIntersectionTypesForSpikes(ArenaList<TraversalVertex> *vertices) {
   auto it = MakeCyclicIterator(vertices->begin(), vertices->end());
   do {
     if (it->type != VertexType::kIntersectionAtVertex) {
@@ -959,20 +1092,23 @@ void CorrectIntersectionTypesForSpikes(std::list<TraversalVertex> *vertices) {
 
 // Constructs the traversal polygons, with the intersections merged in order
 // and linked to their twins. Returns true if intersections were found.
-bool ConstructTraversalPolygons(const Polygon &lhs_polygon,
-                                const Polygon &rhs_polygon,
-                                std::list<TraversalVertex> *lhs_vertices,
-                                std::list<TraversalVertex> *rhs_vertices) {
-  auto intersections = GetIntersections(lhs_polygon, rhs_polygon);
-
-  *lhs_vertices = MergeVerticesAndIntersections(0, lhs_polygon, rhs_polygon,
-                                                &intersections);
-  *rhs_vertices = MergeVerticesAndIntersections(1, rhs_polygon, lhs_polygon,
-                                                &intersections);
-  if (intersections.empty()) return false;
+// raw_intersections and intersections are used as scratch space.
+bool ConstructTraversalPolygons(
+    const Polygon &lhs_polygon, const Polygon &rhs_polygon,
+    std::vector<PolygonIntersection> *raw_intersections,
+    std::vector<IndexedIntersection> *intersections,
+    ArenaList<TraversalVertex> *lhs_vertices,
+    ArenaList<TraversalVertex> *rhs_vertices) {
+  GetIntersections(lhs_polygon, rhs_polygon, raw_intersections, intersections);
+
+  MergeVerticesAndIntersections(0, lhs_polygon, rhs_polygon, intersections,
+                                lhs_vertices);
+  MergeVerticesAndIntersections(1, rhs_polygon, lhs_polygon, intersections,
+                                rhs_vertices);
+  if (intersections->empty()) return false;
 
   // Link the intersections.
-  for (const auto &intx : intersections) {
+  for (const auto &intx : *intersections) {
     intx.traversal_it[0]->twin = MakeCyclicIterator(
         rhs_vertices->begin(), rhs_vertices->end(), intx.traversal_it[1]);
     intx.traversal_it[1]->twin = MakeCyclicIterator(
@@ -1016,11 +1152,14 @@ bool FindNextTraversalStart(const TraversalVertex::Iterator &begin,
 // polygon. max_traversal_size is used as a safety mechanism to prevent an
 // infinite loop in the case of an error, and should be the sum of the sizes of
 // the left- and right-hand vertex lists.
+// The traversal is accumulated in *traversal, which is cleared first.
 // This returns absl::nullopt if an error occurs.
 absl::optional<Polygon> TraverseLinkedVertexLists(
-    TraversalVertex::Iterator begin, int max_traversal_size) {
+    TraversalVertex::Iterator begin, int max_traversal_size,
+    std::vector<glm::vec2> *traversal_points) {
   SLOG(SLOG_BOOLEAN_OPERATION, "Starting Traversal");
-  std::vector<glm::vec2> traversal;
+  traversal_points->clear();
+  std::vector<glm::vec2> &traversal = *traversal_points;
   auto append_to_traversal = [&traversal](glm::vec2 v) {
     if (traversal.empty() || traversal.back() != v) traversal.emplace_back(v);
   };
@@ -1109,6 +1248,26 @@ absl::optional<glm::vec2> FindPointForContainmentCheck(
   return absl::nullopt;
 }
 
+}  // namespace
+
+struct BooleanOperationArena::Storage {
+  ArenaList<TraversalVertex> lhs_vertices;
+  ArenaList<TraversalVertex> rhs_vertices;
+  std::vector<PolygonIntersection> raw_intersections;
+  std::vector<IndexedIntersection> intersections;
+  std::vector<glm::vec2> traversal;
+};
+
+BooleanOperationArena::BooleanOperationArena()
+    : storage_(absl::make_unique<Storage>()) {}
+BooleanOperationArena::~BooleanOperationArena() {}
+BooleanOperationArena::BooleanOperationArena(BooleanOperationArena &&other) =
+    default;
+BooleanOperationArena &BooleanOperationArena::operator=(
+    BooleanOperationArena &&other) = default;
+
+namespace {
+
 enum class IntersectionResult {
   kError,
   kIntersection,
@@ -1119,6 +1278,7 @@ enum class IntersectionResult {
 };
 
 IntersectionResult IntersectionHelper(Polygon lhs_polygon, Polygon rhs_polygon,
+                                      BooleanOperationArena *arena,
                                       std::vector<Polygon> *result) {
   lhs_polygon.RemoveDuplicatePoints();
   rhs_polygon.RemoveDuplicatePoints();
@@ -1129,10 +1289,12 @@ IntersectionResult IntersectionHelper(Polygon lhs_polygon, Polygon rhs_polygon,
 
   // We find the difference by finding the intersection of the base polygon and
   // the complement of the cutting polygon.
-  std::list<TraversalVertex> lhs_vertices;
-  std::list<TraversalVertex> rhs_vertices;
+  BooleanOperationArena::Storage *storage = arena->GetStorage();
+  auto &lhs_vertices = storage->lhs_vertices;
+  auto &rhs_vertices = storage->rhs_vertices;
   bool found_intersections = ConstructTraversalPolygons(
-      lhs_polygon, rhs_polygon, &lhs_vertices, &rhs_vertices);
+      lhs_polygon, rhs_polygon, &storage->raw_intersections,
+      &storage->intersections, &lhs_vertices, &rhs_vertices);
 
   SLOG(SLOG_BOOLEAN_OPERATION, "LHS Traversal: $0",
        TraversalString(lhs_vertices, rhs_vertices));
@@ -1145,8 +1307,8 @@ IntersectionResult IntersectionHelper(Polygon lhs_polygon, Polygon rhs_polygon,
     auto begin = MakeCyclicIterator(lhs_vertices.begin(), lhs_vertices.end());
     auto it = begin;
     while (FindNextTraversalStart(begin, &it)) {
-      absl::optional<Polygon> traversal =
-          TraverseLinkedVertexLists(it, max_traversal_size);
+      absl::optional<Polygon> traversal = TraverseLinkedVertexLists(
+          it, max_traversal_size, &storage->traversal);
       if (traversal) {
         result->emplace_back(std::move(traversal.value()));
       } else {
@@ -1196,6 +1358,13 @@ IntersectionResult IntersectionHelper(Polygon lhs_polygon, Polygon rhs_polygon,
 
 std::vector<Polygon> Difference(const Polygon &base_polygon,
                                 const Polygon &cutting_polygon) {
+  BooleanOperationArena arena;
+  return Difference(base_polygon, cutting_polygon, &arena);
+}
+
+std::vector<Polygon> Difference(const Polygon &base_polygon,
+                                const Polygon &cutting_polygon,
+                                BooleanOperationArena *arena) {
   ASSERT(base_polygon.SignedArea() >= 0);
   ASSERT(cutting_polygon.SignedArea() >= 0);
 
@@ -1206,7 +1375,8 @@ std::vector<Polygon> Difference(const Polygon &base_polygon,
   // the complement of the cutting polygon.
   std::vector<Polygon> result;
   IntersectionResult result_type =
-      IntersectionHelper(base_polygon, reversed_cutting_polygon, &result);
+      IntersectionHelper(base_polygon, reversed_cutting_polygon, arena,
+                         &result);
   switch (result_type) {
     case IntersectionResult::kError:
       return {};
@@ -1227,12 +1397,19 @@ std::vector<Polygon> Difference(const Polygon &base_polygon,
 
 std::vector<Polygon> Intersection(const Polygon &lhs_polygon,
                                   const Polygon &rhs_polygon) {
+  BooleanOperationArena arena;
+  return Intersection(lhs_polygon, rhs_polygon, &arena);
+}
+
+std::vector<Polygon> Intersection(const Polygon &lhs_polygon,
+                                  const Polygon &rhs_polygon,
+                                  BooleanOperationArena *arena) {
   ASSERT(lhs_polygon.SignedArea() >= 0);
   ASSERT(rhs_polygon.SignedArea() >= 0);
 
   std::vector<Polygon> result;
   IntersectionResult result_type =
-      IntersectionHelper(lhs_polygon, rhs_polygon, &result);
+      IntersectionHelper(lhs_polygon, rhs_polygon, arena, &result);
   switch (result_type) {
     case IntersectionResult::kError:
       return {};
@@ -17,6 +17,7 @@
 #ifndef INK_ENGINE_GEOMETRY_ALGORITHMS_BOOLEAN_OPERATION_H_
 #define INK_ENGINE_GEOMETRY_ALGORITHMS_BOOLEAN_OPERATION_H_
 
+#include <memory>
 #include <vector>
 
 #include "third_party/glm/glm/glm.hpp"
@@ -25,6 +26,26 @@
 namespace ink {
 namespace geometry {
 
+// Scratch storage for the traversal structures used by the boolean operations.
+// Passing the same arena to successive operations allows them to reuse its
+// storage, so that once it has grown to fit the largest inputs, an operation
+// does not allocate until it builds its result.
+// An arena may only be used by one operation at a time.
+class BooleanOperationArena {
+ public:
+  BooleanOperationArena();
+  ~BooleanOperationArena();
+  BooleanOperationArena(BooleanOperationArena &&other);
+  BooleanOperationArena &operator=(BooleanOperationArena &&other);
+
+  // The contents of the storage are only visible to boolean_operation.cc.
+  struct Storage;
+  Storage *GetStorage() { return storage_.get(); }
+
+ private:
+  std::unique_ptr<Storage> storage_;
+};
+
 // These functions perform boolean operations on polygons, using a variation of
 // the Weiler-Atherton Algorithm. The input polygons must be oriented
 // counter-clockwise, and must not contain self-intersections.
@@ -38,6 +59,14 @@ std::vector<Polygon> Intersection(const Polygon &lhs_polygon,
 std::vector<Polygon> Difference(const Polygon &base_polygon,
                                 const Polygon &cutting_polygon);
 
+// As above, but using the given arena for scratch storage.
+std::vector<Polygon> Intersection(const Polygon &lhs_polygon,
+                                  const Polygon &rhs_polygon,
+                                  BooleanOperationArena *arena);
+std::vector<Polygon> Difference(const Polygon &base_polygon,
+                                const Polygon &cutting_polygon,
+                                BooleanOperationArena *arena);
+
 }  // namespace geometry
 }  // namespace ink
 
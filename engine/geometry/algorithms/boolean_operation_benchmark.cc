@@ -14,28 +14,76 @@
 
 #include "ink/engine/geometry/algorithms/boolean_operation.h"
 
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
 #include "testing/base/public/benchmark.h"
 #include "testing/base/public/gunit.h"
 #include "ink/engine/geometry/primitives/circle_utils.h"
 #include "ink/engine/geometry/primitives/polygon.h"
 #include "ink/engine/math_defines.h"
 
+// Counts the calls to the global operator new, so that each benchmark can
+// report the number of heap allocations per operation.
+std::atomic<int64_t> global_allocation_count(0);
+
+void *operator new(size_t size) {
+  global_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size == 0 ? 1 : size)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
 namespace ink {
 namespace geometry {
 namespace {
 
 struct IntersectionOp {
-  void operator()(const Polygon &lhs, const Polygon &rhs) const {
+  void operator()(const Polygon &lhs, const Polygon &rhs) {
     Intersection(lhs, rhs);
   }
 };
 
 struct DifferenceOp {
-  void operator()(const Polygon &lhs, const Polygon &rhs) const {
+  void operator()(const Polygon &lhs, const Polygon &rhs) {
     Difference(lhs, rhs);
   }
 };
 
+// These reuse the same arena for every iteration, as the MeshSplitter does for
+// each of the triangles that it cuts.
+struct ArenaIntersectionOp {
+  void operator()(const Polygon &lhs, const Polygon &rhs) {
+    Intersection(lhs, rhs, &arena);
+  }
+  BooleanOperationArena arena;
+};
+
+struct ArenaDifferenceOp {
+  void operator()(const Polygon &lhs, const Polygon &rhs) {
+    Difference(lhs, rhs, &arena);
+  }
+  BooleanOperationArena arena;
+};
+
+// Runs the benchmark loop, and reports the mean number of heap allocations per
+// operation in the "allocs" counter.
+template <typename Operation>
+void RunOperation(benchmark::State &state, const Polygon &lhs,
+                  const Polygon &rhs) {
+  Operation op;
+  int64_t allocations_before = global_allocation_count.load();
+  for (auto _ : state) op(lhs, rhs);
+  int64_t allocations = global_allocation_count.load() - allocations_before;
+  state.counters["allocs"] = benchmark::Counter(
+      static_cast<double>(allocations), benchmark::Counter::kAvgIterations);
+}
+
 std::vector<glm::vec2> MakeCircle(glm::vec2 center, float radius,
                                   int n_points) {
   // PointsOnCircle() always includes both endpoints, so we adjust the end angle
@@ -49,8 +97,7 @@ static void BM_DisjointPolygons(benchmark::State &state) {
   int n_points = state.range(0);
   Polygon lhs(MakeCircle({0, 0}, 40, n_points));
   Polygon rhs(MakeCircle({100, 0}, 40, n_points));
-  Operation op;
-  for (auto _ : state) op(lhs, rhs);
+  RunOperation<Operation>(state, lhs, rhs);
 }
 BENCHMARK(BM_DisjointPolygons<IntersectionOp>)->Range(4, 1024);
 BENCHMARK(BM_DisjointPolygons<DifferenceOp>)->Range(4, 1024);
@@ -60,8 +107,7 @@ static void BM_LeftInsideRight(benchmark::State &state) {
   int n_points = state.range(0);
   Polygon lhs(MakeCircle({0, 0}, 50, n_points));
   Polygon rhs(MakeCircle({0, 0}, 100, n_points));
-  Operation op;
-  for (auto _ : state) op(lhs, rhs);
+  RunOperation<Operation>(state, lhs, rhs);
 }
 BENCHMARK(BM_LeftInsideRight<IntersectionOp>)->Range(4, 1024);
 BENCHMARK(BM_LeftInsideRight<DifferenceOp>)->Range(4, 1024);
@@ -71,8 +117,7 @@ static void BM_RightInsideLeft(benchmark::State &state) {
   int n_points = state.range(0);
   Polygon lhs(MakeCircle({0, 0}, 100, n_points));
   Polygon rhs(MakeCircle({0, 0}, 50, n_points));
-  Operation op;
-  for (auto _ : state) op(lhs, rhs);
+  RunOperation<Operation>(state, lhs, rhs);
 }
 BENCHMARK(BM_RightInsideLeft<IntersectionOp>)->Range(4, 1024);
 BENCHMARK(BM_RightInsideLeft<DifferenceOp>)->Range(4, 1024);
@@ -82,8 +127,7 @@ static void BM_SimpleCase(benchmark::State &state) {
   int n_points = state.range(0);
   Polygon lhs(MakeCircle({0, 0}, 100, n_points));
   Polygon rhs(MakeCircle({100, 0}, 100, n_points));
-  Operation op;
-  for (auto _ : state) op(lhs, rhs);
+  RunOperation<Operation>(state, lhs, rhs);
 }
 BENCHMARK(BM_SimpleCase<IntersectionOp>)->Range(4, 1024);
 BENCHMARK(BM_SimpleCase<DifferenceOp>)->Range(4, 1024);
@@ -100,11 +144,49 @@ static void BM_ComplexCase(benchmark::State &state) {
   for (auto &p : points) p.y = 1.5 - p.y;
   std::reverse(points.begin(), points.end());
   Polygon rhs(points);
-  Operation op;
-  for (auto _ : state) op(lhs, rhs);
+  RunOperation<Operation>(state, lhs, rhs);
 }
 BENCHMARK(BM_ComplexCase<IntersectionOp>)->Range(4, 1024);
 BENCHMARK(BM_ComplexCase<DifferenceOp>)->Range(4, 1024);
+BENCHMARK(BM_ComplexCase<ArenaIntersectionOp>)->Range(4, 1024);
+BENCHMARK(BM_ComplexCase<ArenaDifferenceOp>)->Range(4, 1024);
+
+// The outline of a wavy stroke, n_points / 2 points along each side, similar to
+// what the stroke editing eraser produces for a long stroke.
+std::vector<glm::vec2> MakeStrokeOutline(int n_points) {
+  std::vector<glm::vec2> points;
+  points.reserve(n_points);
+  for (int i = 0; i < n_points / 2; ++i)
+    points.emplace_back(.5 * i, 20 * std::sin(.5 * i / 15) - 3);
+  for (int i = n_points / 2 - 1; i >= 0; --i)
+    points.emplace_back(.5 * i, 20 * std::sin(.5 * i / 15) + 3);
+  return points;
+}
+
+// Erases a piece from the middle of a long stroke outline with a circular
+// eraser. The argument is the number of points in the stroke outline.
+template <typename Operation>
+static void BM_StrokeOutlineAndEraser(benchmark::State &state) {
+  int n_points = state.range(0);
+  Polygon lhs(MakeStrokeOutline(n_points));
+  Polygon rhs(MakeCircle({.125 * n_points, 0}, 30, 64));
+  RunOperation<Operation>(state, lhs, rhs);
+}
+BENCHMARK(BM_StrokeOutlineAndEraser<IntersectionOp>)->Range(64, 4096);
+BENCHMARK(BM_StrokeOutlineAndEraser<DifferenceOp>)->Range(64, 4096);
+BENCHMARK(BM_StrokeOutlineAndEraser<ArenaIntersectionOp>)->Range(64, 4096);
+BENCHMARK(BM_StrokeOutlineAndEraser<ArenaDifferenceOp>)->Range(64, 4096);
+
+// Cuts a triangle with another triangle, as the MeshSplitter does for each pair
+// of overlapping triangles when erasing.
+template <typename Operation>
+static void BM_TriangleAndTriangle(benchmark::State &state) {
+  Polygon lhs(std::vector<glm::vec2>{{0, 0}, {10, 0}, {5, 8}});
+  Polygon rhs(std::vector<glm::vec2>{{5, 2}, {12, 4}, {6, 10}});
+  RunOperation<Operation>(state, lhs, rhs);
+}
+BENCHMARK(BM_TriangleAndTriangle<DifferenceOp>);
+BENCHMARK(BM_TriangleAndTriangle<ArenaDifferenceOp>);
 
 }  // namespace
 }  // namespace geometry
@@ -14,12 +14,16 @@
  * limitations under the License.
  */
 
+#include <cmath>
+#include <vector>
+
 #include "net/proto2/public/repeated_field.h"
 #include "security/fuzzing/blaze/proto_message_mutator.h"
 #include "ink/engine/geometry/algorithms/boolean_operation.h"
 #include "ink/engine/geometry/algorithms/boolean_operation_fuzzer.proto.h"
 #include "ink/engine/geometry/algorithms/intersect.h"
 #include "ink/engine/geometry/primitives/polygon.h"
+#include "ink/engine/util/dbg/errors.h"
 #include "ink/proto/geometry.proto.h"
 
 namespace ink {
@@ -53,6 +57,42 @@ bool ParsePolygon(const proto2::RepeatedPtrField<proto::Point>& proto_points,
   return polygon->SignedArea() >= 0 && !IsPolygonSelfIntersecting(*polygon);
 }
 
+bool SameFloat(float a, float b) {
+  return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+bool SamePoint(glm::vec2 a, glm::vec2 b) {
+  return SameFloat(a.x, b.x) && SameFloat(a.y, b.y);
+}
+
+bool SameIntersection(const PolygonIntersection& a,
+                      const PolygonIntersection& b) {
+  const SegmentIntersection& a_intx = a.intersection;
+  const SegmentIntersection& b_intx = b.intersection;
+  for (int i = 0; i < 2; ++i) {
+    if (a.indices[i] != b.indices[i] ||
+        !SameFloat(a_intx.segment1_interval[i], b_intx.segment1_interval[i]) ||
+        !SameFloat(a_intx.segment2_interval[i], b_intx.segment2_interval[i]))
+      return false;
+  }
+  return SamePoint(a_intx.intx.from, b_intx.intx.from) &&
+         SamePoint(a_intx.intx.to, b_intx.intx.to);
+}
+
+// The boolean operations are built on Intersection(), which switches between
+// an exhaustive search and a sweep depending on the size of the polygons. Both
+// must find exactly the same intersections.
+void CheckPolygonIntersectionStrategiesAgree(const Polygon& lhs,
+                                             const Polygon& rhs) {
+  std::vector<PolygonIntersection> exhaustive;
+  std::vector<PolygonIntersection> sweep;
+  IntersectionExhaustive(lhs, rhs, &exhaustive);
+  IntersectionSweep(lhs, rhs, &sweep);
+  EXPECT(exhaustive.size() == sweep.size());
+  for (size_t i = 0; i < exhaustive.size(); ++i)
+    EXPECT(SameIntersection(exhaustive[i], sweep[i]));
+}
+
 void PerformBooleanOperation(const proto::BooleanOperation& input) {
   if (!input.has_operation()) return;
 
@@ -62,6 +102,8 @@ void PerformBooleanOperation(const proto::BooleanOperation& input) {
       !ParsePolygon(input.rhs_polygon(), &rhs))
     return;
 
+  CheckPolygonIntersectionStrategiesAgree(lhs, rhs);
+
   switch (input.operation()) {
     case proto::BooleanOperation_Operation::
         BooleanOperation_Operation_DIFFERENCE:
@@ -51,6 +51,15 @@ Rect TextureEnvelope(const std::vector<Vertex>& vertices) {
                              [](const Vertex& v) { return v.texture_coords; });
 }
 
+Rect Envelope(const VertexStreams& vertices) {
+  return Envelope(vertices.Positions());
+}
+
+Rect TextureEnvelope(const VertexStreams& vertices) {
+  if (!vertices.HasTextureCoords()) return Rect(0, 0, 0, 0);
+  return Envelope(vertices.TextureCoords());
+}
+
 Rect Envelope(const Triangle& triangle) {
   return Rect(triangle[0], triangle[1]).Join(triangle[2]);
 }
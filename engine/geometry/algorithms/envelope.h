@@ -21,6 +21,7 @@
 
 #include "third_party/glm/glm/glm.hpp"
 #include "ink/engine/geometry/mesh/vertex.h"
+#include "ink/engine/geometry/mesh/vertex_streams.h"
 #include "ink/engine/geometry/primitives/rect.h"
 #include "ink/engine/geometry/primitives/rot_rect.h"
 #include "ink/engine/geometry/primitives/triangle.h"
@@ -35,9 +36,11 @@ Rect Envelope(const RotRect& rot_rect);
 
 // Finds the envelope of the vertices' positions.
 Rect Envelope(const std::vector<Vertex>& vertices);
+Rect Envelope(const VertexStreams& vertices);
 
 // Finds the envelope of the vertices' texture-coordinates.
 Rect TextureEnvelope(const std::vector<Vertex>& vertices);
+Rect TextureEnvelope(const VertexStreams& vertices);
 
 }  // namespace geometry
 }  // namespace ink
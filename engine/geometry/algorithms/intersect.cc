@@ -14,8 +14,10 @@
 
 #include "ink/engine/geometry/algorithms/intersect.h"
 
+#include <algorithm>
 #include <cmath>
 #include <iterator>
+#include <limits>
 
 #include "ink/engine/geometry/primitives/vector_utils.h"
 #include "ink/engine/util/dbg/errors.h"
@@ -114,6 +116,47 @@ int FindSafeExponentForSegmentIntersection(const Segment &segment1,
   return shiftExponent;
 }
 
+// The collinearity test used below treats points within twice the machine
+// epsilon of the largest coordinate as lying on a line (see Orientation()), and
+// then also checks the neighboring representable points, so segments may
+// intersect even if their bounding boxes are separated by a little more than
+// that distance. This returns the distance by which bounding boxes are padded,
+// so that segments whose padded boxes are disjoint do not intersect: eight
+// times the machine epsilon of the largest coordinate, i.e. four times the
+// collinearity tolerance, which also covers the rounding of the padded bounds
+// themselves, plus the smallest denormal so that it is non-zero at the origin.
+float BoundingBoxPadding(float max_abs_coordinate) {
+  return 8 * std::numeric_limits<float>::epsilon() * max_abs_coordinate +
+         std::numeric_limits<float>::denorm_min();
+}
+
+float MaxAbsCoordinate(glm::vec2 p) {
+  return std::max(std::abs(p.x), std::abs(p.y));
+}
+
+// Returns true if the padded bounding boxes of the segments are disjoint. This
+// is always false if any coordinate is NaN.
+bool BoundingBoxesAreDisjoint(const Segment &segment1,
+                              const Segment &segment2) {
+  float max_abs_coordinate =
+      std::max(std::max(MaxAbsCoordinate(segment1.from),
+                        MaxAbsCoordinate(segment1.to)),
+               std::max(MaxAbsCoordinate(segment2.from),
+                        MaxAbsCoordinate(segment2.to)));
+  float padding = BoundingBoxPadding(max_abs_coordinate);
+  auto disjoint = [padding](float min1, float max1, float min2, float max2) {
+    return max1 + padding < min2 || max2 + padding < min1;
+  };
+  return disjoint(std::min(segment1.from.x, segment1.to.x),
+                  std::max(segment1.from.x, segment1.to.x),
+                  std::min(segment2.from.x, segment2.to.x),
+                  std::max(segment2.from.x, segment2.to.x)) ||
+         disjoint(std::min(segment1.from.y, segment1.to.y),
+                  std::max(segment1.from.y, segment1.to.y),
+                  std::min(segment2.from.y, segment2.to.y),
+                  std::max(segment2.from.y, segment2.to.y));
+}
+
 bool SegmentIntersectionHelper(Segment segment1, Segment segment2,
                                std::array<float, 2> *seg1_interval,
                                std::array<float, 2> *seg2_interval) {
@@ -127,6 +170,12 @@ bool SegmentIntersectionHelper(Segment segment1, Segment segment2,
     return true;
   }
 
+  // Segments that are far apart cannot intersect. Beyond being a quick
+  // rejection, this guards against the determinant test below, which can
+  // report spurious intersections between distant, nearly-collinear segments
+  // due to cancellation error.
+  if (BoundingBoxesAreDisjoint(segment1, segment2)) return false;
+
   int exponent = FindSafeExponentForSegmentIntersection(segment1, segment2);
   if (exponent != 0) {
     segment1.from.x = ldexp(segment1.from.x, exponent);
@@ -397,8 +446,59 @@ bool Intersection(const Segment &segment, const Rect &rect, Segment *output) {
   return true;
 }
 
+namespace {
+
+// Below this many segment pairs, the exhaustive search is faster than sorting
+// the segments for the sweep.
+constexpr size_t kMinSegmentPairsForSweep = 256;
+
+// The axis-aligned bounding box of one polygon segment, padded to account for
+// the tolerance of the segment intersection test.
+struct SweepBox {
+  float min_x;
+  float max_x;
+  float min_y;
+  float max_y;
+  // 0 for polygon1, 1 for polygon2.
+  int polygon;
+  int index;
+};
+
+void AppendSweepBoxes(const Polygon &polygon, int polygon_idx, float padding,
+                      std::vector<SweepBox> *boxes) {
+  for (int i = 0; i < polygon.Size(); ++i) {
+    Segment segment = polygon.GetSegment(i);
+    boxes->push_back({std::min(segment.from.x, segment.to.x) - padding,
+                      std::max(segment.from.x, segment.to.x) + padding,
+                      std::min(segment.from.y, segment.to.y) - padding,
+                      std::max(segment.from.y, segment.to.y) + padding,
+                      polygon_idx, i});
+  }
+}
+
+// Returns the largest absolute value of any coordinate of the polygon, or
+// infinity if any coordinate is not finite.
+float MaxAbsCoordinate(const Polygon &polygon) {
+  float max_abs = 0;
+  for (const glm::vec2 &p : polygon.Points()) {
+    if (!std::isfinite(p.x) || !std::isfinite(p.y))
+      return std::numeric_limits<float>::infinity();
+    max_abs = std::max(max_abs, MaxAbsCoordinate(p));
+  }
+  return max_abs;
+}
+
+}  // namespace
+
 bool Intersection(const Polygon &polygon1, const Polygon &polygon2,
                   std::vector<PolygonIntersection> *output) {
+  if (polygon1.Size() * polygon2.Size() < kMinSegmentPairsForSweep)
+    return IntersectionExhaustive(polygon1, polygon2, output);
+  return IntersectionSweep(polygon1, polygon2, output);
+}
+
+bool IntersectionExhaustive(const Polygon &polygon1, const Polygon &polygon2,
+                            std::vector<PolygonIntersection> *output) {
   EXPECT(output->empty());
   for (int idx1 = 0; idx1 < polygon1.Size(); ++idx1) {
     for (int idx2 = 0; idx2 < polygon2.Size(); ++idx2) {
@@ -415,5 +515,63 @@ bool Intersection(const Polygon &polygon1, const Polygon &polygon2,
   return !output->empty();
 }
 
+bool IntersectionSweep(const Polygon &polygon1, const Polygon &polygon2,
+                       std::vector<PolygonIntersection> *output) {
+  EXPECT(output->empty());
+
+  // The boxes are padded by at least as much as the segment intersection test
+  // pads them, so the sweep never skips a pair that the exhaustive search would
+  // report. The padding isn't meaningful for non-finite coordinates, so we
+  // fall back to the exhaustive search.
+  float max_abs =
+      std::max(MaxAbsCoordinate(polygon1), MaxAbsCoordinate(polygon2));
+  if (!std::isfinite(max_abs))
+    return IntersectionExhaustive(polygon1, polygon2, output);
+  float padding = BoundingBoxPadding(max_abs);
+
+  std::vector<SweepBox> boxes;
+  boxes.reserve(polygon1.Size() + polygon2.Size());
+  AppendSweepBoxes(polygon1, 0, padding, &boxes);
+  AppendSweepBoxes(polygon2, 1, padding, &boxes);
+  std::sort(boxes.begin(), boxes.end(),
+            [](const SweepBox &lhs, const SweepBox &rhs) {
+              return lhs.min_x < rhs.min_x;
+            });
+
+  // The boxes of each polygon that may overlap the sweep line. Boxes that end
+  // before the sweep line are removed lazily, when next visited. The active
+  // lists aren't ordered by y, so each box visits every box of the other
+  // polygon that overlaps it in x, and the y-extents are compared here.
+  std::array<std::vector<const SweepBox *>, 2> active;
+  for (const SweepBox &box : boxes) {
+    auto &other_active = active[1 - box.polygon];
+    auto kept_end = other_active.begin();
+    for (const SweepBox *other : other_active) {
+      if (other->max_x < box.min_x) continue;
+      *kept_end++ = other;
+      if (other->max_y < box.min_y || box.max_y < other->min_y) continue;
+
+      const SweepBox &box1 = box.polygon == 0 ? box : *other;
+      const SweepBox &box2 = box.polygon == 0 ? *other : box;
+      SegmentIntersection intersection;
+      if (Intersection(polygon1.GetSegment(box1.index),
+                       polygon2.GetSegment(box2.index), &intersection)) {
+        output->emplace_back();
+        output->back().indices = {{box1.index, box2.index}};
+        output->back().intersection = intersection;
+      }
+    }
+    other_active.erase(kept_end, other_active.end());
+    active[box.polygon].push_back(&box);
+  }
+
+  // Each pair of segments is tested at most once, so the indices are unique.
+  std::sort(output->begin(), output->end(),
+            [](const PolygonIntersection &lhs, const PolygonIntersection &rhs) {
+              return lhs.indices < rhs.indices;
+            });
+  return !output->empty();
+}
+
 }  // namespace geometry
 }  // namespace ink
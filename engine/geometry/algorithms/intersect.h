@@ -86,14 +86,26 @@ struct PolygonIntersection {
 // polygons has a self-intersection, the result may also contain intersections
 // that are coincident -- these, however, are not true duplicates, as they occur
 // at different lengths along the polygon.
-// The output vector is expected be empty before this is called.
-// Note: This performs an exhaustive search of the segment pairs. Given polygons
-// with N and M vertices, respectively, the time complexity is O(N*M). There are
-// more efficient algorithms we could use, but, currently, we expect to be
-// operating on very small polygons, e.g. 5 or fewer vertices.
+// The output vector is expected be empty before this is called. The
+// intersections are ordered by indices[0], then by indices[1].
+// Note: For small polygons, this performs an exhaustive search of the segment
+// pairs. For larger ones, it sweeps the segments' bounding boxes along the
+// x-axis, and only tests pairs of segments whose boxes overlap. Every pair of
+// boxes whose x-extents overlap is visited, whether or not their y-extents do,
+// so given polygons with N and M vertices, and K pairs of boxes that overlap
+// in x, the time complexity is O((N + M) log (N + M) + K). This approaches the
+// exhaustive search's O(N * M) when most segments share the same x-range, e.g.
+// for a long vertical stroke.
 bool Intersection(const Polygon &polygon1, const Polygon &polygon2,
                   std::vector<PolygonIntersection> *output);
 
+// The two strategies used by the above function. These return exactly the same
+// output as each other; they are exposed for fuzzing and benchmarking.
+bool IntersectionExhaustive(const Polygon &polygon1, const Polygon &polygon2,
+                            std::vector<PolygonIntersection> *output);
+bool IntersectionSweep(const Polygon &polygon1, const Polygon &polygon2,
+                       std::vector<PolygonIntersection> *output);
+
 // These functions return whether the objects intersect, but don't include the
 // information about the intersections. In many cases, this will be more
 // efficient than the functions above.
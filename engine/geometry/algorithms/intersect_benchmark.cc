@@ -14,6 +14,10 @@
 
 #include "ink/engine/geometry/algorithms/intersect.h"
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include "testing/base/public/benchmark.h"
 #include "testing/base/public/gunit.h"
 #include "ink/engine/geometry/primitives/circle_utils.h"
@@ -142,6 +146,60 @@ static void BM_PolygonIntersectionManyHits(benchmark::State &state) {
 }
 BENCHMARK(BM_PolygonIntersectionManyHits)->Range(4, 1024);
 
+// The outline of a wavy stroke, n_points / 2 points along each side, similar to
+// what the stroke editing eraser produces for a long stroke.
+std::vector<glm::vec2> MakeStrokeOutline(int n_points) {
+  std::vector<glm::vec2> points;
+  points.reserve(n_points);
+  for (int i = 0; i < n_points / 2; ++i)
+    points.emplace_back(.5 * i, 20 * std::sin(.5 * i / 15) - 3);
+  for (int i = n_points / 2 - 1; i >= 0; --i)
+    points.emplace_back(.5 * i, 20 * std::sin(.5 * i / 15) + 3);
+  return points;
+}
+
+using PolygonIntersectionFn = bool (*)(const Polygon &, const Polygon &,
+                                       std::vector<PolygonIntersection> *);
+
+// Cuts a stroke outline with a circular eraser, crossing it in a few places.
+// The argument is the number of points in the stroke outline.
+template <PolygonIntersectionFn intersection_fn>
+static void BM_PolygonIntersectionStrokeOutline(benchmark::State &state) {
+  Polygon stroke(MakeStrokeOutline(state.range(0)));
+  Polygon eraser(PointsOnCircle({.125 * state.range(0), 0}, 30, 64, 0, M_TAU));
+  for (auto _ : state) {
+    std::vector<PolygonIntersection> result;
+    intersection_fn(stroke, eraser, &result);
+    testing::DoNotOptimize(result.data());
+  }
+}
+BENCHMARK(BM_PolygonIntersectionStrokeOutline<IntersectionExhaustive>)
+    ->Range(64, 8192);
+BENCHMARK(BM_PolygonIntersectionStrokeOutline<IntersectionSweep>)
+    ->Range(64, 8192);
+
+// Intersects two stroke outlines that cross each other along their whole
+// length. The argument is the number of points in each outline.
+template <PolygonIntersectionFn intersection_fn>
+static void BM_PolygonIntersectionCrossingStrokeOutlines(
+    benchmark::State &state) {
+  std::vector<glm::vec2> lhs_points = MakeStrokeOutline(state.range(0));
+  std::vector<glm::vec2> rhs_points = lhs_points;
+  for (auto &p : rhs_points) p.y = -p.y;
+  std::reverse(rhs_points.begin(), rhs_points.end());
+  Polygon lhs(lhs_points);
+  Polygon rhs(rhs_points);
+  for (auto _ : state) {
+    std::vector<PolygonIntersection> result;
+    intersection_fn(lhs, rhs, &result);
+    testing::DoNotOptimize(result.data());
+  }
+}
+BENCHMARK(BM_PolygonIntersectionCrossingStrokeOutlines<IntersectionExhaustive>)
+    ->Range(64, 8192);
+BENCHMARK(BM_PolygonIntersectionCrossingStrokeOutlines<IntersectionSweep>)
+    ->Range(64, 8192);
+
 }  // namespace
 }  // namespace geometry
 }  // namespace ink
@@ -17,6 +17,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <numeric>
+#include <utility>
 
 #include "ink/engine/geometry/algorithms/envelope.h"
 #include "ink/engine/geometry/algorithms/transform.h"
@@ -99,9 +100,10 @@ void Mesh::Append(const Mesh& other) {
 
   auto startidx = verts.size();
   auto t = glm::inverse(object_matrix) * other.object_matrix;
-  for (auto ov : other.verts) {
-    ov.position = geometry::Transform(ov.position, t);
-    verts.emplace_back(ov);
+  verts.Append(other.verts);
+  std::vector<glm::vec2>& positions = *verts.MutablePositions();
+  for (size_t i = startidx; i < positions.size(); ++i) {
+    positions[i] = geometry::Transform(positions[i], t);
   }
 
   for (auto i : other.idx) {
@@ -111,12 +113,13 @@ void Mesh::Append(const Mesh& other) {
 
 void Mesh::Deindex() {
   if (idx.empty()) return;
-  std::vector<Vertex> new_verts(idx.size());
+  VertexStreams new_verts;
+  new_verts.reserve(idx.size());
   for (size_t i = 0; i < idx.size(); i++) {
-    new_verts[i] = verts[idx[i]];
+    new_verts.push_back(verts[idx[i]]);
   }
   idx.clear();
-  verts.swap(new_verts);
+  verts = std::move(new_verts);
 }
 
 void Mesh::GenIndex() {
@@ -126,7 +129,7 @@ void Mesh::GenIndex() {
 
 void Mesh::NormalizeTriangleOrientation() {
   NormalizeTriangleHelper(
-      [this](IndexType index) { return verts[index].position; }, &idx);
+      [this](IndexType index) { return verts.Positions()[index]; }, &idx);
 }
 
 glm::vec2 Mesh::ObjectPosToWorld(const glm::vec2& object_pos) const {
@@ -184,7 +187,7 @@ OptimizedMesh::OptimizedMesh(ShaderType type, const Mesh& mesh)
 OptimizedMesh::OptimizedMesh(ShaderType type, const Mesh& mesh, Rect envelope)
     : type(type),
       texture(mesh.texture ? new TextureInfo(*mesh.texture) : nullptr),
-      color(mesh.verts.begin()->color),
+      color(mesh.verts.Colors().front()),
       mul_color_modifier(glm::vec4(1, 1, 1, 1)),
       add_color_modifier(glm::vec4(0, 0, 0, 0)) {
   EXPECT(!mesh.idx.empty() && mesh.idx.size() % 3 == 0);
@@ -239,14 +242,12 @@ void OptimizedMesh::ClearCpuMemoryVerts() {
 
 Mesh OptimizedMesh::ToMesh() const {
   Mesh m;
-  m.verts.resize(verts.size());
-  for (uint32_t i = 0; i < verts.size(); ++i) {
-    verts.UnpackVertex(i, &m.verts[i]);
+  verts.UnpackVertices(&m.verts);
+  for (glm::vec4& c : *m.verts.MutableColors()) {
     if (type == ShaderType::SingleColorShader) {
-      m.verts[i].color = color;
+      c = color;
     }
-    m.verts[i].color =
-        m.verts[i].color * mul_color_modifier + add_color_modifier;
+    c = c * mul_color_modifier + add_color_modifier;
   }
   if (absl::holds_alternative<std::vector<uint32_t>>(idx_)) {
     const auto& v = absl::get<std::vector<uint32_t>>(idx_);
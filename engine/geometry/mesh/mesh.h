@@ -25,6 +25,7 @@
 #include "third_party/glm/glm/glm.hpp"
 #include "ink/engine/geometry/mesh/shader_type.h"
 #include "ink/engine/geometry/mesh/vertex.h"
+#include "ink/engine/geometry/mesh/vertex_streams.h"
 #include "ink/engine/geometry/mesh/vertex_types.h"
 #include "ink/engine/geometry/primitives/rect.h"
 #include "ink/engine/geometry/primitives/triangle.h"
@@ -87,9 +88,10 @@ class ShaderMetadata {
 };
 
 // Value type to represent a simple (non-optimized) triangle mesh.
-// - A mesh is an ordered collection of 'Vertex' structs. The order is defined
-//   naturally by the vector, or if idx is present, indirectly by the idx
-//   vector.
+// - A mesh is an ordered collection of vertices. The order is defined
+//   naturally by the list, or if idx is present, indirectly by the idx
+//   vector. The vertices are stored as VertexStreams, so that a mesh that is
+//   not textured or animated does not pay for those attributes.
 // - A mesh may be indexed and it may have a texture.
 // - A mesh will have a translation matrix (defaults to Identity)
 //   and shader metadata (defaults to Blank()).
@@ -103,7 +105,7 @@ struct Mesh {
   // depending on the contents of the idx array. The "order" of the verts
   // depends on the contents of the idx array.  If the idx array is empty, then
   // the order is defined by the vertex array, itself.
-  std::vector<Vertex> verts;
+  VertexStreams verts;
 
   // An array of indices into the 'verts' vector. If idx.size() > 0, then it
   // defines the size of the mesh and the order of the vertices in the
@@ -170,20 +172,19 @@ struct Mesh {
     return static_cast<int>(idx.size() / 3);
   }
 
-  // Returns a const reference to the vertex that corresponds to the
-  // (vertex_index)th position in the (triangle_index)th triangle. Note that a
-  // single vertex may belong to any number of triangles.
-  const Vertex& GetVertex(int triangle_index, int vertex_index) const {
-    ASSERT(0 <= triangle_index && triangle_index < NumberOfTriangles() &&
-           0 <= vertex_index && vertex_index < 3);
-    return verts[idx[3 * triangle_index + vertex_index]];
+  // Returns the vertex that corresponds to the (vertex_index)th position in the
+  // (triangle_index)th triangle. Note that a single vertex may belong to any
+  // number of triangles.
+  const Vertex GetVertex(int triangle_index, int vertex_index) const {
+    return verts[VertexIndex(triangle_index, vertex_index)];
   }
 
   // Returns the geometric triangle at the given index.
   geometry::Triangle GetTriangle(int triangle_index) const {
-    return {GetVertex(triangle_index, 0).position,
-            GetVertex(triangle_index, 1).position,
-            GetVertex(triangle_index, 2).position};
+    const std::vector<glm::vec2>& positions = verts.Positions();
+    return {positions[VertexIndex(triangle_index, 0)],
+            positions[VertexIndex(triangle_index, 1)],
+            positions[VertexIndex(triangle_index, 2)]};
   }
 
   // Translates from object coords to world coords.
@@ -204,6 +205,14 @@ struct Mesh {
 
  private:
   bool Has16BitIndex() const;
+
+  // Returns the index into verts of the (vertex_index)th vertex of the
+  // (triangle_index)th triangle.
+  IndexType VertexIndex(int triangle_index, int vertex_index) const {
+    ASSERT(0 <= triangle_index && triangle_index < NumberOfTriangles() &&
+           0 <= vertex_index && vertex_index < 3);
+    return idx[3 * triangle_index + vertex_index];
+  }
 };
 
 struct OptimizedMesh {
@@ -14,20 +14,25 @@
 
 #include "ink/engine/geometry/mesh/mesh_splitter.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iterator>
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "third_party/glm/glm/glm.hpp"
 #include "ink/engine/geometry/algorithms/boolean_operation.h"
 #include "ink/engine/geometry/algorithms/envelope.h"
 #include "ink/engine/geometry/algorithms/transform.h"
+#include "ink/engine/geometry/mesh/shader_type.h"
 #include "ink/engine/geometry/mesh/vertex.h"
 #include "ink/engine/geometry/primitives/polygon.h"
 #include "ink/engine/geometry/primitives/rect.h"
 #include "ink/engine/geometry/primitives/triangle.h"
 #include "ink/engine/geometry/spatial/rtree_utils.h"
 #include "ink/engine/geometry/tess/tessellator.h"
+#include "ink/engine/processing/runner/parallel_for.h"
 #include "ink/engine/util/dbg/log.h"
 
 namespace ink {
@@ -37,6 +42,15 @@ using geometry::BarycentricInterpolate;
 using geometry::Polygon;
 using geometry::Triangle;
 
+// Below this many splitters per thread, the cost of starting a thread outweighs
+// the benefit of splitting in parallel.
+constexpr int kMinSplittersPerThread = 2;
+
+// The bounds of the base mesh, in the cutting mesh's coordinates, are padded by
+// this fraction of their largest coordinate, to cover rounding in the change of
+// coordinates.
+constexpr float kRelativeQueryPadding = 1e-4;
+
 // This returns a copy of the cutting mesh, transformed to the
 // object-coordinate-system of the base mesh.
 Mesh TransformCuttingMesh(const Mesh &cutting_mesh,
@@ -45,73 +59,135 @@ Mesh TransformCuttingMesh(const Mesh &cutting_mesh,
 
   auto cutting_to_base =
       glm::inverse(base_object_matrix) * cutting_mesh.object_matrix;
-  for (auto &v : transformed_mesh.verts)
-    v.position = geometry::Transform(v.position, cutting_to_base);
+  for (auto &p : *transformed_mesh.verts.MutablePositions())
+    p = geometry::Transform(p, cutting_to_base);
   return transformed_mesh;
 }
 
 }  // namespace
 
 MeshSplitter::MeshSplitter(const OptimizedMesh &base_mesh)
-    : base_mesh_(base_mesh), is_base_mesh_changed_(false) {}
+    : MeshSplitter(std::make_shared<const OptimizedMesh>(base_mesh)) {}
+
+MeshSplitter::MeshSplitter(std::shared_ptr<const OptimizedMesh> base_mesh)
+    : base_mesh_(std::move(base_mesh)),
+      object_matrix_(base_mesh_->object_matrix),
+      mul_color_modifier_(base_mesh_->mul_color_modifier),
+      add_color_modifier_(base_mesh_->add_color_modifier),
+      is_base_mesh_changed_(false) {}
 
 void MeshSplitter::Split(const Mesh &cutting_mesh) {
   if (!rtree_) InitializeRTree();
 
   auto transformed_mesh =
-      TransformCuttingMesh(cutting_mesh, base_mesh_.object_matrix);
-
-  for (int i = 0; i < transformed_mesh.NumberOfTriangles(); ++i) {
-    Triangle cutting_triangle = transformed_mesh.GetTriangle(i);
-
-    if (cutting_triangle.SignedArea() == 0) continue;
-    ASSERT(cutting_triangle.SignedArea() > 0);
-
-    Rect cutting_mbr = geometry::Envelope(cutting_triangle);
-    std::vector<IndexedTriangle> triangles_to_cut;
-    rtree_->FindAll(cutting_mbr, std::back_inserter(triangles_to_cut));
-    rtree_->RemoveAll(cutting_mbr);
-
-    for (const auto base_triangle : triangles_to_cut) {
-      if (base_triangle.triangle.SignedArea() == 0) continue;
-
-      ASSERT(base_triangle.triangle.SignedArea() > 0);
-      std::vector<Polygon> difference =
-          geometry::Difference(Polygon(base_triangle.triangle.Points()),
-                               Polygon(cutting_triangle.Points()));
-
-      // If the difference is the same as the original triangle, just re-insert
-      // it,
-      if (difference.size() == 1 && difference[0].Size() == 3 &&
-          (difference[0].Points() == base_triangle.triangle.Points() ||
-           difference[0].CircularShift(1).Points() ==
-               base_triangle.triangle.Points() ||
-           difference[0].CircularShift(2).Points() ==
-               base_triangle.triangle.Points())) {
-        rtree_->Insert(base_triangle);
-        continue;
-      }
+      TransformCuttingMesh(cutting_mesh, object_matrix_);
 
+  geometry::BooleanOperationArena arena;
+  for (int i = 0; i < transformed_mesh.NumberOfTriangles(); ++i)
+    CutWithTriangle(transformed_mesh.GetTriangle(i), &arena);
+}
 
-      is_base_mesh_changed_ = true;
+void MeshSplitter::SplitAll(const std::vector<MeshSplitter *> &splitters,
+                            const Mesh &cutting_mesh, int max_threads) {
+  if (splitters.empty()) return;
 
-      if (difference.empty()) continue;
+  auto cutting_rtree =
+      spatial::MakePackedRTreeFromMeshTriangles<IndexedTriangle,
+                                                IndexedTriangleEnvelope>(
+          cutting_mesh, [](const Mesh &m, int i) {
+            return IndexedTriangle{m.GetTriangle(i), i};
+          });
 
-      Tessellator tessellator;
-      if (tessellator.Tessellate(difference) && tessellator.HasMesh()) {
-        tessellator.mesh_.NormalizeTriangleOrientation();
-        for (int j = 0; j < tessellator.mesh_.NumberOfTriangles(); ++j) {
-          IndexedTriangle t{tessellator.mesh_.GetTriangle(j),
-                            base_triangle.original_index};
-          if (!t.triangle.IsDegenerate()) rtree_->Insert(t);
-        }
-      } else {
-        SLOG(SLOG_WARNING,
-             "Failed to tessellate polygon difference ($0). Re-inserting "
-             "original triangle.",
-             difference);
-        rtree_->Insert(base_triangle);
+  // The cost of a split varies wildly between elements, so rather than giving
+  // each thread a fixed share, the threads take the next splitter as they
+  // finish their previous one.
+  int n_splitters = splitters.size();
+  ParallelFor(n_splitters,
+              std::min(max_threads, n_splitters / kMinSplittersPerThread),
+              [&splitters, &cutting_mesh, &cutting_rtree](int i) {
+                splitters[i]->Split(cutting_mesh, *cutting_rtree);
+              });
+}
+
+void MeshSplitter::Split(const Mesh &cutting_mesh,
+                         const IndexedTriangleRTree &cutting_rtree) {
+  if (!rtree_) InitializeRTree();
+  if (rtree_->Size() == 0) return;
+
+  // A cutting triangle whose bounds don't overlap the base mesh's leaves it
+  // unchanged in Split() (the base mesh's bounds only shrink as it is cut), so
+  // only the triangles found here need to be cut with.
+  auto base_to_cutting =
+      glm::inverse(cutting_mesh.object_matrix) * object_matrix_;
+  Rect query = geometry::Transform(rtree_->Bounds(), base_to_cutting);
+  float magnitude =
+      std::max({std::abs(query.Left()), std::abs(query.Right()),
+                std::abs(query.Top()), std::abs(query.Bottom())});
+  query = query.Inset(glm::vec2(-kRelativeQueryPadding * magnitude));
+  std::vector<IndexedTriangle> cutting_triangles;
+  cutting_rtree.FindAll(query, std::back_inserter(cutting_triangles));
+  if (cutting_triangles.empty()) return;
+
+  // Cut with the same triangles, in the same order, as Split() would, so that
+  // the result is the same.
+  std::sort(cutting_triangles.begin(), cutting_triangles.end(),
+            [](const IndexedTriangle &lhs, const IndexedTriangle &rhs) {
+              return lhs.original_index < rhs.original_index;
+            });
+  auto transformed_mesh = TransformCuttingMesh(cutting_mesh, object_matrix_);
+  geometry::BooleanOperationArena arena;
+  for (const auto &t : cutting_triangles)
+    CutWithTriangle(transformed_mesh.GetTriangle(t.original_index), &arena);
+}
+
+void MeshSplitter::CutWithTriangle(const Triangle &cutting_triangle,
+                                   geometry::BooleanOperationArena *arena) {
+  if (cutting_triangle.SignedArea() == 0) return;
+  ASSERT(cutting_triangle.SignedArea() > 0);
+
+  Rect cutting_mbr = geometry::Envelope(cutting_triangle);
+  std::vector<IndexedTriangle> triangles_to_cut;
+  rtree_->FindAll(cutting_mbr, std::back_inserter(triangles_to_cut));
+  rtree_->RemoveAll(cutting_mbr);
+
+  for (const auto base_triangle : triangles_to_cut) {
+    if (base_triangle.triangle.SignedArea() == 0) continue;
+
+    ASSERT(base_triangle.triangle.SignedArea() > 0);
+    std::vector<Polygon> difference =
+        geometry::Difference(Polygon(base_triangle.triangle.Points()),
+                             Polygon(cutting_triangle.Points()), arena);
+
+    // If the difference is the same as the original triangle, just re-insert
+    // it,
+    if (difference.size() == 1 && difference[0].Size() == 3 &&
+        (difference[0].Points() == base_triangle.triangle.Points() ||
+         difference[0].CircularShift(1).Points() ==
+             base_triangle.triangle.Points() ||
+         difference[0].CircularShift(2).Points() ==
+             base_triangle.triangle.Points())) {
+      rtree_->Insert(base_triangle);
+      continue;
+    }
+
+    is_base_mesh_changed_ = true;
+
+    if (difference.empty()) continue;
+
+    Tessellator tessellator;
+    if (tessellator.Tessellate(difference) && tessellator.HasMesh()) {
+      tessellator.mesh_.NormalizeTriangleOrientation();
+      for (int j = 0; j < tessellator.mesh_.NumberOfTriangles(); ++j) {
+        IndexedTriangle t{tessellator.mesh_.GetTriangle(j),
+                          base_triangle.original_index};
+        if (!t.triangle.IsDegenerate()) rtree_->Insert(t);
       }
+    } else {
+      SLOG(SLOG_WARNING,
+           "Failed to tessellate polygon difference ($0). Re-inserting "
+           "original triangle.",
+           difference);
+      rtree_->Insert(base_triangle);
     }
   }
 }
@@ -133,19 +209,22 @@ bool MeshSplitter::GetResult(Mesh *result_mesh) const {
     IndexedVertex(int index_in, glm::vec2 position_in)
         : index(index_in), position(position_in) {}
   };
-  spatial::RTree<IndexedVertex> vertex_rtree([](const IndexedVertex &v) {
-    return Rect::CreateAtPoint(v.position, 0, 0);
-  });
+  struct IndexedVertexBounds {
+    Rect operator()(const IndexedVertex &v) const {
+      return Rect::CreateAtPoint(v.position, 0, 0);
+    }
+  };
+  spatial::PackedRTree<IndexedVertex, IndexedVertexBounds> vertex_rtree;
 
-  Mesh unpacked_mesh = base_mesh_.ToMesh();
+  Mesh unpacked_mesh = UnpackBaseMesh();
   for (const auto &t : result_triangles) {
     if (t.triangle.IsDegenerate()) continue;
 
     auto original_triangle = unpacked_mesh.GetTriangle(t.original_index);
     ASSERT(!original_triangle.IsDegenerate());
-    const auto &vertex0 = unpacked_mesh.GetVertex(t.original_index, 0);
-    const auto &vertex1 = unpacked_mesh.GetVertex(t.original_index, 1);
-    const auto &vertex2 = unpacked_mesh.GetVertex(t.original_index, 2);
+    const Vertex vertex0 = unpacked_mesh.GetVertex(t.original_index, 0);
+    const Vertex vertex1 = unpacked_mesh.GetVertex(t.original_index, 1);
+    const Vertex vertex2 = unpacked_mesh.GetVertex(t.original_index, 2);
     for (int i = 0; i < 3; ++i) {
       // Construct the new vertex by interpolating over the original triangle.
       Vertex v(t.triangle[i]);
@@ -175,21 +254,43 @@ bool MeshSplitter::GetResult(Mesh *result_mesh) const {
       }
     }
   }
-  result_mesh->object_matrix = base_mesh_.object_matrix;
-  if (base_mesh_.texture != nullptr)
-    result_mesh->texture = absl::make_unique<TextureInfo>(*base_mesh_.texture);
+  result_mesh->object_matrix = object_matrix_;
+  if (base_mesh_->texture != nullptr)
+    result_mesh->texture = absl::make_unique<TextureInfo>(*base_mesh_->texture);
   return true;
 }
 
+Rect MeshSplitter::IndexedTriangleEnvelope::operator()(
+    const IndexedTriangle &t) const {
+  return geometry::Envelope(t.triangle);
+}
+
 void MeshSplitter::InitializeRTree() {
-  Mesh unpacked_mesh = base_mesh_.ToMesh();
-  rtree_ = spatial::MakeRTreeFromMeshTriangles<IndexedTriangle>(
+  Mesh unpacked_mesh = UnpackBaseMesh();
+  rtree_ = spatial::MakePackedRTreeFromMeshTriangles<IndexedTriangle,
+                                                     IndexedTriangleEnvelope>(
       unpacked_mesh,
       [](const Mesh &m, int i) {
         return IndexedTriangle{m.GetTriangle(i), i};
       },
-      [](const IndexedTriangle &t) { return geometry::Envelope(t.triangle); },
       [](const Mesh &m, int i) { return !m.GetTriangle(i).IsDegenerate(); });
 }
 
+Mesh MeshSplitter::UnpackBaseMesh() const {
+  Mesh m;
+  base_mesh_->verts.UnpackVertices(&m.verts);
+  for (glm::vec4 &c : *m.verts.MutableColors()) {
+    if (base_mesh_->type == ShaderType::SingleColorShader) {
+      c = base_mesh_->color;
+    }
+    c = c * mul_color_modifier_ + add_color_modifier_;
+  }
+  m.idx.resize(base_mesh_->IndexSize());
+  for (size_t i = 0; i < m.idx.size(); ++i) m.idx[i] = base_mesh_->IndexAt(i);
+  m.object_matrix = object_matrix_;
+  if (base_mesh_->texture)
+    m.texture = absl::make_unique<TextureInfo>(*base_mesh_->texture);
+  return m;
+}
+
 }  // namespace ink
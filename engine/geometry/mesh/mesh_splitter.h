@@ -17,8 +17,14 @@
 #ifndef INK_ENGINE_GEOMETRY_MESH_MESH_SPLITTER_H_
 #define INK_ENGINE_GEOMETRY_MESH_MESH_SPLITTER_H_
 
+#include <memory>
+#include <vector>
+
+#include "ink/engine/geometry/algorithms/boolean_operation.h"
 #include "ink/engine/geometry/mesh/mesh.h"
-#include "ink/engine/geometry/spatial/rtree.h"
+#include "ink/engine/geometry/primitives/rect.h"
+#include "ink/engine/geometry/primitives/triangle.h"
+#include "ink/engine/geometry/spatial/packed_rtree.h"
 
 namespace ink {
 
@@ -35,12 +41,28 @@ class MeshSplitter {
   // client without memory growth.
   explicit MeshSplitter(const OptimizedMesh &base_mesh);
 
+  // As above, but shares base_mesh instead of copying it, e.g. a mesh pinned
+  // with SceneGraph::GetSharedMesh(). Its object matrix and color modifiers are
+  // copied here; only its vertices, indices, type, color, and texture are read
+  // afterwards, so the owner may keep changing the former on another thread.
+  explicit MeshSplitter(std::shared_ptr<const OptimizedMesh> base_mesh);
+
   // Removes the areas of the base mesh that intersect the cutting mesh. All
   // triangles in the mesh are expected to be oriented counter-clockwise (see
   // Mesh::NormalizeTriangleOrientation()). Note that the texture, color, and
   // animation data on the cutting mesh are ignored.
   void Split(const Mesh &cutting_mesh);
 
+  // Performs Split(cutting_mesh) on each of the splitters, dividing them
+  // between up to max_threads threads, including the calling thread (see
+  // ParallelFor()). Each splitter only tests the triangles of the cutting mesh
+  // that overlap its own bounds, which are found with an R-Tree of the cutting
+  // mesh that is shared by all of the splitters; the others can't change the
+  // base mesh, so the result is the same as calling Split() on each splitter in
+  // turn.
+  static void SplitAll(const std::vector<MeshSplitter *> &splitters,
+                       const Mesh &cutting_mesh, int max_threads = 1);
+
   // Returns true if the base mesh was affected by the split operations.
   bool IsMeshChanged() const { return is_base_mesh_changed_; }
 
@@ -61,12 +83,36 @@ class MeshSplitter {
     // This is required to preserve the color and texture-coordinates.
     int original_index;
   };
+  struct IndexedTriangleEnvelope {
+    Rect operator()(const IndexedTriangle &t) const;
+  };
+  using IndexedTriangleRTree =
+      spatial::PackedRTree<IndexedTriangle, IndexedTriangleEnvelope>;
 
   void InitializeRTree();
 
-  OptimizedMesh base_mesh_;
+  // Unpacks the base mesh, as OptimizedMesh::ToMesh() would, but with the
+  // object matrix and color modifiers that were copied on construction.
+  Mesh UnpackBaseMesh() const;
+
+  // As Split(), but only cuts with the triangles in cutting_rtree that overlap
+  // the base mesh's bounds. cutting_rtree holds the triangles of cutting_mesh,
+  // in its object coordinates, indexed by their position in cutting_mesh.
+  void Split(const Mesh &cutting_mesh,
+             const IndexedTriangleRTree &cutting_rtree);
+
+  // Removes the area of the cutting triangle, which is in the base mesh's
+  // object coordinates, from the triangles in the R-Tree. The arena is reused
+  // for each of the triangles that it cuts.
+  void CutWithTriangle(const geometry::Triangle &cutting_triangle,
+                       geometry::BooleanOperationArena *arena);
+
+  std::shared_ptr<const OptimizedMesh> base_mesh_;
+  glm::mat4 object_matrix_;
+  glm::vec4 mul_color_modifier_;
+  glm::vec4 add_color_modifier_;
   bool is_base_mesh_changed_;
-  std::unique_ptr<spatial::RTree<IndexedTriangle>> rtree_;
+  std::unique_ptr<IndexedTriangleRTree> rtree_;
 };
 
 }  // namespace ink
@@ -14,8 +14,12 @@
 
 #include "ink/engine/geometry/mesh/mesh_splitter.h"
 
+#include <memory>
+#include <vector>
+
 #include "testing/base/public/benchmark.h"
 #include "testing/base/public/gunit.h"
+#include "third_party/absl/memory/memory.h"
 #include "ink/engine/geometry/mesh/mesh.h"
 #include "ink/engine/geometry/mesh/mesh_test_helpers.h"
 
@@ -66,5 +70,66 @@ static void BM_SplitWaveWithWave(benchmark::State &state) {
 }
 BENCHMARK(BM_SplitWaveWithWave)->Range(8, 1024);
 
+constexpr int kOverlappingStrokeCount = 500;
+
+// A dense patch of handwriting: kOverlappingStrokeCount wavy strokes, each
+// overlapping dozens of its neighbors.
+std::vector<OptimizedMesh> MakeOverlappingStrokes() {
+  std::vector<OptimizedMesh> strokes;
+  strokes.reserve(kOverlappingStrokeCount);
+  for (int i = 0; i < kOverlappingStrokeCount; ++i) {
+    strokes.emplace_back(ShaderType::SingleColorShader,
+                         MakeSineWaveMesh({.2 * i, .5 * i}, 5, .02, 200, 3,
+                                          100));
+  }
+  return strokes;
+}
+
+// An eraser stroke that scrubs back and forth across all of the strokes.
+Mesh MakeScrubbingEraserMesh() {
+  Mesh mesh = MakeSineWaveMesh({50, 125}, 140, .01, 200, 10, 200);
+  mesh.NormalizeTriangleOrientation();
+  return mesh;
+}
+
+// Erases through the overlapping strokes by splitting each of them in turn
+// with the whole eraser mesh.
+static void BM_EraseThroughOverlappingStrokesSerial(benchmark::State &state) {
+  auto strokes = MakeOverlappingStrokes();
+  auto cutting_mesh = MakeScrubbingEraserMesh();
+  while (state.KeepRunning()) {
+    for (const auto &stroke : strokes) {
+      MeshSplitter splitter(stroke);
+      splitter.Split(cutting_mesh);
+      testing::DoNotOptimize(splitter.IsMeshChanged());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * strokes.size());
+}
+BENCHMARK(BM_EraseThroughOverlappingStrokesSerial);
+
+// As above, but using MeshSplitter::SplitAll(), as the StrokeEditingEraser
+// does, with up to state.range(0) threads. The eraser uses one, as it splits
+// from a task.
+static void BM_EraseThroughOverlappingStrokesSplitAll(
+    benchmark::State &state) {
+  auto strokes = MakeOverlappingStrokes();
+  auto cutting_mesh = MakeScrubbingEraserMesh();
+  while (state.KeepRunning()) {
+    std::vector<std::unique_ptr<MeshSplitter>> splitters;
+    std::vector<MeshSplitter *> splitter_ptrs;
+    splitters.reserve(strokes.size());
+    splitter_ptrs.reserve(strokes.size());
+    for (const auto &stroke : strokes) {
+      splitters.push_back(absl::make_unique<MeshSplitter>(stroke));
+      splitter_ptrs.push_back(splitters.back().get());
+    }
+    MeshSplitter::SplitAll(splitter_ptrs, cutting_mesh, state.range(0));
+    testing::DoNotOptimize(splitters.front()->IsMeshChanged());
+  }
+  state.SetItemsProcessed(state.iterations() * strokes.size());
+}
+BENCHMARK(BM_EraseThroughOverlappingStrokesSplitAll)->Arg(1)->Arg(4);
+
 }  // namespace
 }  // namespace ink
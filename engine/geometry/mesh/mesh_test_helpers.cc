@@ -30,7 +30,7 @@ namespace ink {
 Mesh MakeTriangleStrip(std::vector<Vertex> vertices) {
   EXPECT(vertices.size() >= 3);
   Mesh m;
-  m.verts = std::move(vertices);
+  m.verts = VertexStreams(vertices);
   m.idx.reserve(3 * (m.verts.size() - 2));
   for (int i = 0; i < m.verts.size() - 2; ++i) {
     m.idx.emplace_back(i);
@@ -73,8 +73,8 @@ Mesh MakeSineWaveMesh(glm::vec2 start, float amplitude, float frequency,
 
 Mesh FlattenObjectMatrix(const Mesh& mesh) {
   Mesh ans = mesh;
-  for (Vertex& vert : ans.verts) {
-    vert.position = geometry::Transform(vert.position, mesh.object_matrix);
+  for (glm::vec2& position : *ans.verts.MutablePositions()) {
+    position = geometry::Transform(position, mesh.object_matrix);
   }
   ans.object_matrix = glm::mat4{1};  // the identity
   return ans;
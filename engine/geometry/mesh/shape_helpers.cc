@@ -36,9 +36,9 @@ void MakeRectangleMesh(Mesh* mesh, const RotRect& object_rectangle,
   mesh->idx = {0, 1, 3, 1, 2, 3};
   mesh->verts.reserve(4);
   for (auto corner : object_rectangle.Corners()) {
-    mesh->verts.emplace_back(corner, color);
-    mesh->verts.back().texture_coords =
-        geometry::Transform(corner, object_to_uv);
+    Vertex vertex(corner, color);
+    vertex.texture_coords = geometry::Transform(corner, object_to_uv);
+    mesh->verts.push_back(vertex);
   }
 }
 
@@ -103,23 +103,16 @@ void MakeDashedRectangle(Mesh* mesh, Rect r, glm::vec4 color, float width,
 
   mesh->Clear();
 
-  std::vector<Vertex>* out = &mesh->verts;
+  VertexStreams* out = &mesh->verts;
 
-  std::vector<Vertex> top =
-      MakeDashedLine(r.Lefttop(), r.Righttop(), color, width, dash_length);
-  out->insert(out->end(), top.begin(), top.end());
-
-  std::vector<Vertex> right =
-      MakeDashedLine(r.Righttop(), r.Rightbottom(), color, width, dash_length);
-  out->insert(out->end(), right.begin(), right.end());
-
-  std::vector<Vertex> bottom = MakeDashedLine(r.Rightbottom(), r.Leftbottom(),
-                                              color, width, dash_length);
-  out->insert(out->end(), bottom.begin(), bottom.end());
-
-  std::vector<Vertex> left =
-      MakeDashedLine(r.Leftbottom(), r.Lefttop(), color, width, dash_length);
-  out->insert(out->end(), left.begin(), left.end());
+  out->Append(VertexStreams(
+      MakeDashedLine(r.Lefttop(), r.Righttop(), color, width, dash_length)));
+  out->Append(VertexStreams(MakeDashedLine(r.Righttop(), r.Rightbottom(),
+                                           color, width, dash_length)));
+  out->Append(VertexStreams(MakeDashedLine(r.Rightbottom(), r.Leftbottom(),
+                                           color, width, dash_length)));
+  out->Append(VertexStreams(
+      MakeDashedLine(r.Leftbottom(), r.Lefttop(), color, width, dash_length)));
 
   mesh->GenIndex();
 }
@@ -20,7 +20,7 @@ namespace funcs {
 static std::vector<Vertex> ExtractFlatVertices(const Mesh& mesh) {
   Mesh copy_mesh(mesh);
   copy_mesh.Deindex();
-  return copy_mesh.verts;
+  return copy_mesh.verts.ToVertices();
 }
 
 bool IsValidRectangleTriangulation(const Mesh& mesh,
@@ -0,0 +1,329 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/geometry/mesh/vertex_pack_kernels.h"
+
+// The kernels must round the result of each multiplication and addition, as the
+// per-vertex functions do, so the compiler must not fuse them into FMAs.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+#include "ink/engine/geometry/algorithms/transform.h"
+#include "ink/engine/util/funcs/float_pack.h"
+
+namespace ink {
+namespace {
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+
+// Thin wrappers around the vector intrinsics, so that the kernels below can be
+// written once for both instruction sets.
+#if defined(__AVX2__)
+struct Simd {
+  static constexpr int kWidth = 8;
+  using Float = __m256;
+  using Int = __m256i;
+
+  static Float Load(const float* p) { return _mm256_loadu_ps(p); }
+  static void Store(float* p, Float v) { _mm256_storeu_ps(p, v); }
+  static Float Splat(float f) { return _mm256_set1_ps(f); }
+  static Float Add(Float a, Float b) { return _mm256_add_ps(a, b); }
+  static Float Sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+  static Float Mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+  static Float Div(Float a, Float b) { return _mm256_div_ps(a, b); }
+  // Returns a < b ? a : b.
+  static Float Min(Float a, Float b) { return _mm256_min_ps(a, b); }
+  // Returns a > b ? a : b.
+  static Float Max(Float a, Float b) { return _mm256_max_ps(a, b); }
+  static Float Floor(Float a) { return _mm256_floor_ps(a); }
+  static Float Trunc(Float a) {
+    return _mm256_round_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+  }
+  static Float SignBit(Float a) { return _mm256_and_ps(a, Splat(-0.0f)); }
+  static Float Or(Float a, Float b) { return _mm256_or_ps(a, b); }
+  static Int TruncToInt(Float a) { return _mm256_cvttps_epi32(a); }
+  static Float ToFloat(Int a) { return _mm256_cvtepi32_ps(a); }
+  static Int Or(Int a, Int b) { return _mm256_or_si256(a, b); }
+  template <int kBits>
+  static Int ShiftLeft(Int a) {
+    return _mm256_slli_epi32(a, kBits);
+  }
+};
+#else
+struct Simd {
+  static constexpr int kWidth = 4;
+  using Float = __m128;
+  using Int = __m128i;
+
+  static Float Load(const float* p) { return _mm_loadu_ps(p); }
+  static void Store(float* p, Float v) { _mm_storeu_ps(p, v); }
+  static Float Splat(float f) { return _mm_set1_ps(f); }
+  static Float Add(Float a, Float b) { return _mm_add_ps(a, b); }
+  static Float Sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+  static Float Mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+  static Float Div(Float a, Float b) { return _mm_div_ps(a, b); }
+  // Returns a < b ? a : b.
+  static Float Min(Float a, Float b) { return _mm_min_ps(a, b); }
+  // Returns a > b ? a : b.
+  static Float Max(Float a, Float b) { return _mm_max_ps(a, b); }
+  static Float Floor(Float a) { return _mm_floor_ps(a); }
+  static Float Trunc(Float a) {
+    return _mm_round_ps(a, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+  }
+  static Float SignBit(Float a) { return _mm_and_ps(a, Splat(-0.0f)); }
+  static Float Or(Float a, Float b) { return _mm_or_ps(a, b); }
+  static Int TruncToInt(Float a) { return _mm_cvttps_epi32(a); }
+  static Float ToFloat(Int a) { return _mm_cvtepi32_ps(a); }
+  static Int Or(Int a, Int b) { return _mm_or_si128(a, b); }
+  template <int kBits>
+  static Int ShiftLeft(Int a) {
+    return _mm_slli_epi32(a, kBits);
+  }
+};
+#endif
+
+using Float = Simd::Float;
+using Int = Simd::Int;
+
+// The number of vertices processed per iteration. The vertices are staged in
+// small structure-of-arrays buffers of this size, so that they can be loaded
+// into vector registers a component at a time.
+constexpr int kBatchSize = 8;
+static_assert(kBatchSize % Simd::kWidth == 0,
+              "The batch size must be a multiple of the vector width");
+
+// The largest float less than 0.5.
+constexpr float kJustUnderHalf = 0.49999997f;
+// 2^-24, which maps the 24-bit packed integers into [0, 1).
+constexpr float kPackedScale = 1.0f / 16777216.0f;
+
+// The constant term of the given row of matrix * vec4(x, y, 0, 1).
+float TransformOffset(const glm::mat4& matrix, int row) {
+  return matrix[2][row] * 0.0f + matrix[3][row] * 1.0f;
+}
+
+// Returns the given row of matrix * vec4(x, y, 0, 1), where offset is
+// TransformOffset(matrix, row). The terms are summed in the same order that glm
+// uses, so that this matches geometry::Transform() exactly.
+Float TransformRow(Float x, Float y, const glm::mat4& matrix, int row,
+                   float offset) {
+  return Simd::Add(Simd::Add(Simd::Mul(Simd::Splat(matrix[0][row]), x),
+                             Simd::Mul(Simd::Splat(matrix[1][row]), y)),
+                   Simd::Splat(offset));
+}
+
+// Equivalent to static_cast<uint32_t>(util::Clamp0N(max, roundf(v))), where max
+// is an integer. Clamping before rounding gives the same result for every
+// input, including NaN, which is mapped to max either way. Once clamped, v is
+// non-negative, so roundf() is just truncation after adding (just under) 0.5.
+Int ClampAndRound(Float v, float max) {
+  Float clamped = Simd::Max(Simd::Splat(0), Simd::Min(v, Simd::Splat(max)));
+  return Simd::TruncToInt(Simd::Add(clamped, Simd::Splat(kJustUnderHalf)));
+}
+
+// Equivalent to static_cast<float>(static_cast<double>(bits) / 2^24), as both
+// are exact for bits < 2^24.
+Float BitsToPackedFloat(Int bits) {
+  return Simd::Mul(Simd::ToFloat(bits), Simd::Splat(kPackedScale));
+}
+
+// Equivalent to Fract() in float_pack.cc, i.e. std::fmod(v, 1.0), including
+// the sign of zero results.
+Float FractOf(Float v) {
+  return Simd::Or(Simd::Sub(v, Simd::Trunc(v)), Simd::SignBit(v));
+}
+
+// Returns floor(Fract(v) * scale).
+Float FloorFractOf(Float v, float scale) {
+  return Simd::Floor(Simd::Mul(FractOf(v), Simd::Splat(scale)));
+}
+
+// Returns floor(Fract(v * shift) * levels) / (levels - 1), which unpacks a
+// color channel that was stored with the given number of levels, after the
+// bits above it have been shifted out.
+Float UnpackChannel(Float v, float shift, float levels) {
+  return Simd::Div(FloorFractOf(Simd::Mul(v, Simd::Splat(shift)), levels),
+                   Simd::Splat(levels - 1));
+}
+
+#endif  // defined(__AVX2__) || defined(__SSE4_1__)
+
+}  // namespace
+
+void BatchPackPosition(const glm::vec2* positions, size_t n,
+                       const glm::mat4& transform, float* out,
+                       size_t out_stride) {
+  size_t i = 0;
+#if defined(__AVX2__) || defined(__SSE4_1__)
+  const float x_offset = TransformOffset(transform, 0);
+  const float y_offset = TransformOffset(transform, 1);
+  float x[kBatchSize], y[kBatchSize], packed[kBatchSize];
+  for (; i + kBatchSize <= n; i += kBatchSize) {
+    for (int j = 0; j < kBatchSize; ++j) {
+      x[j] = positions[i + j].x;
+      y[j] = positions[i + j].y;
+    }
+    for (int j = 0; j < kBatchSize; j += Simd::kWidth) {
+      Float vx = Simd::Load(x + j);
+      Float vy = Simd::Load(y + j);
+      Float tx = TransformRow(vx, vy, transform, 0, x_offset);
+      Float ty = TransformRow(vx, vy, transform, 1, y_offset);
+      Int px = ClampAndRound(tx, 4095);
+      Int py = ClampAndRound(ty, 4095);
+      Simd::Store(packed + j,
+                  BitsToPackedFloat(Simd::Or(Simd::ShiftLeft<12>(px), py)));
+    }
+    for (int j = 0; j < kBatchSize; ++j)
+      out[(i + j) * out_stride] = packed[j];
+  }
+#endif
+  for (; i < n; ++i) {
+    out[i * out_stride] =
+        PackPosition(geometry::Transform(positions[i], transform));
+  }
+}
+
+void BatchPackColorAndPosition(const glm::vec2* positions,
+                               const glm::vec4* colors, size_t n,
+                               const glm::mat4& transform, float* out,
+                               size_t out_stride) {
+  size_t i = 0;
+#if defined(__AVX2__) || defined(__SSE4_1__)
+  const float x_offset = TransformOffset(transform, 0);
+  const float y_offset = TransformOffset(transform, 1);
+  float x[kBatchSize], y[kBatchSize];
+  float r[kBatchSize], g[kBatchSize], b[kBatchSize], a[kBatchSize];
+  float packed1[kBatchSize], packed2[kBatchSize];
+  for (; i + kBatchSize <= n; i += kBatchSize) {
+    for (int j = 0; j < kBatchSize; ++j) {
+      x[j] = positions[i + j].x;
+      y[j] = positions[i + j].y;
+      r[j] = colors[i + j].r;
+      g[j] = colors[i + j].g;
+      b[j] = colors[i + j].b;
+      a[j] = colors[i + j].a;
+    }
+    for (int j = 0; j < kBatchSize; j += Simd::kWidth) {
+      Float vx = Simd::Load(x + j);
+      Float vy = Simd::Load(y + j);
+      Float tx = TransformRow(vx, vy, transform, 0, x_offset);
+      Float ty = TransformRow(vx, vy, transform, 1, y_offset);
+      Int px = ClampAndRound(tx, 2047);
+      Int py = ClampAndRound(ty, 2047);
+      Int pr = ClampAndRound(Simd::Mul(Simd::Load(r + j), Simd::Splat(63)), 63);
+      Int pg =
+          ClampAndRound(Simd::Mul(Simd::Load(g + j), Simd::Splat(127)), 127);
+      Int pb = ClampAndRound(Simd::Mul(Simd::Load(b + j), Simd::Splat(63)), 63);
+      Int pa =
+          ClampAndRound(Simd::Mul(Simd::Load(a + j), Simd::Splat(127)), 127);
+      Simd::Store(packed1 + j,
+                  BitsToPackedFloat(Simd::Or(
+                      Simd::Or(Simd::ShiftLeft<13>(px), Simd::ShiftLeft<6>(pa)),
+                      pr)));
+      Simd::Store(packed2 + j,
+                  BitsToPackedFloat(Simd::Or(
+                      Simd::Or(Simd::ShiftLeft<13>(py), Simd::ShiftLeft<6>(pg)),
+                      pb)));
+    }
+    for (int j = 0; j < kBatchSize; ++j) {
+      out[(i + j) * out_stride] = packed1[j];
+      out[(i + j) * out_stride + 1] = packed2[j];
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    glm::vec2 packed = PackColorAndPosition(
+        colors[i], geometry::Transform(positions[i], transform));
+    out[i * out_stride] = packed.x;
+    out[i * out_stride + 1] = packed.y;
+  }
+}
+
+void BatchUnpackPosition(const float* packed, size_t packed_stride, size_t n,
+                         const glm::mat4* transform, glm::vec2* out) {
+  size_t i = 0;
+#if defined(__AVX2__) || defined(__SSE4_1__)
+  const float x_offset = transform ? TransformOffset(*transform, 0) : 0;
+  const float y_offset = transform ? TransformOffset(*transform, 1) : 0;
+  float p[kBatchSize], x[kBatchSize], y[kBatchSize];
+  for (; i + kBatchSize <= n; i += kBatchSize) {
+    for (int j = 0; j < kBatchSize; ++j) p[j] = packed[(i + j) * packed_stride];
+    for (int j = 0; j < kBatchSize; j += Simd::kWidth) {
+      Float vp = Simd::Load(p + j);
+      Float vx = FloorFractOf(vp, 4096);
+      Float vy = Simd::Mul(FractOf(Simd::Mul(vp, Simd::Splat(4096))),
+                           Simd::Splat(4096));
+      if (transform) {
+        Float tx = TransformRow(vx, vy, *transform, 0, x_offset);
+        vy = TransformRow(vx, vy, *transform, 1, y_offset);
+        vx = tx;
+      }
+      Simd::Store(x + j, vx);
+      Simd::Store(y + j, vy);
+    }
+    for (int j = 0; j < kBatchSize; ++j)
+      out[i + j] = glm::vec2(x[j], y[j]);
+  }
+#endif
+  for (; i < n; ++i) {
+    glm::vec2 position = UnpackPosition(packed[i * packed_stride]);
+    out[i] = transform ? geometry::Transform(position, *transform) : position;
+  }
+}
+
+void BatchUnpackColorAndPosition(const float* packed, size_t packed_stride,
+                                 size_t n, glm::vec2* positions,
+                                 glm::vec4* colors) {
+  size_t i = 0;
+#if defined(__AVX2__) || defined(__SSE4_1__)
+  float p1[kBatchSize], p2[kBatchSize], x[kBatchSize], y[kBatchSize];
+  float r[kBatchSize], g[kBatchSize], b[kBatchSize], a[kBatchSize];
+  for (; i + kBatchSize <= n; i += kBatchSize) {
+    for (int j = 0; j < kBatchSize; ++j) {
+      p1[j] = packed[(i + j) * packed_stride];
+      p2[j] = packed[(i + j) * packed_stride + 1];
+    }
+    for (int j = 0; j < kBatchSize; j += Simd::kWidth) {
+      Float vp1 = Simd::Load(p1 + j);
+      Float vp2 = Simd::Load(p2 + j);
+      Simd::Store(x + j, FloorFractOf(vp1, 2048));
+      Simd::Store(a + j, UnpackChannel(vp1, 2048, 128));
+      Simd::Store(r + j, UnpackChannel(vp1, 262144, 64));
+      Simd::Store(y + j, FloorFractOf(vp2, 2048));
+      Simd::Store(g + j, UnpackChannel(vp2, 2048, 128));
+      Simd::Store(b + j, UnpackChannel(vp2, 262144, 64));
+    }
+    for (int j = 0; j < kBatchSize; ++j) {
+      positions[i + j] = glm::vec2(x[j], y[j]);
+      colors[i + j] = glm::vec4(r[j], g[j], b[j], a[j]);
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    UnpackColorAndPosition(
+        glm::vec2(packed[i * packed_stride], packed[i * packed_stride + 1]),
+        &colors[i], &positions[i]);
+  }
+}
+
+}  // namespace ink
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INK_ENGINE_GEOMETRY_MESH_VERTEX_PACK_KERNELS_H_
+#define INK_ENGINE_GEOMETRY_MESH_VERTEX_PACK_KERNELS_H_
+
+#include <cstddef>
+
+#include "third_party/glm/glm/glm.hpp"
+
+namespace ink {
+
+// Batch versions of the functions in float_pack.h, used by PackedVertList to
+// pack and unpack whole meshes. When built with AVX2 or SSE4.1 enabled, these
+// process eight vertices per iteration; otherwise, they just call the
+// per-vertex functions.
+//
+// The output is bit-identical to calling the per-vertex functions (composed
+// with geometry::Transform(), where a transform is given) on each vertex,
+// provided that those aren't built with floating-point contraction either. The
+// kernels disable it themselves, but geometry::Transform() is inlined into its
+// callers, which GCC and clang will fuse into FMAs where the target has them,
+// unless built with -ffp-contract=off. vertex_types_benchmark.cc checks this
+// for the build that it is run with.
+//
+// The packed data is read and written as floats with a stride, so that these
+// can operate directly on the vectors held by PackedVertList, e.g. the
+// x-component of a vector<glm::vec3> has a stride of 3. The unpacked data is
+// read and written as separate position, color, etc. arrays, as held by
+// VertexStreams.
+
+// For each i in [0, n), writes
+//   PackPosition(geometry::Transform(positions[i], transform))
+// to out[i * out_stride].
+void BatchPackPosition(const glm::vec2* positions, size_t n,
+                       const glm::mat4& transform, float* out,
+                       size_t out_stride);
+
+// For each i in [0, n), writes
+//   PackColorAndPosition(colors[i],
+//                        geometry::Transform(positions[i], transform))
+// to out[i * out_stride] and out[i * out_stride + 1].
+void BatchPackColorAndPosition(const glm::vec2* positions,
+                               const glm::vec4* colors, size_t n,
+                               const glm::mat4& transform, float* out,
+                               size_t out_stride);
+
+// For each i in [0, n), writes UnpackPosition(packed[i * packed_stride]) to
+// out[i]. If transform is non-null, the unpacked coordinates are transformed by
+// it, as with geometry::Transform().
+void BatchUnpackPosition(const float* packed, size_t packed_stride, size_t n,
+                         const glm::mat4* transform, glm::vec2* out);
+
+// For each i in [0, n), unpacks packed[i * packed_stride] and
+// packed[i * packed_stride + 1] with UnpackColorAndPosition() into
+// colors[i] and positions[i].
+void BatchUnpackColorAndPosition(const float* packed, size_t packed_stride,
+                                 size_t n, glm::vec2* positions,
+                                 glm::vec4* colors);
+
+}  // namespace ink
+
+#endif  // INK_ENGINE_GEOMETRY_MESH_VERTEX_PACK_KERNELS_H_
@@ -0,0 +1,166 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/geometry/mesh/vertex_streams.h"
+
+#include "ink/engine/util/dbg/errors.h"
+
+namespace ink {
+
+VertexStreams::AnimationData::AnimationData(const Vertex& vertex)
+    : position_from(vertex.position_from),
+      color_from(vertex.color_from),
+      texture_coords_from(vertex.texture_coords_from),
+      position_timings(vertex.position_timings),
+      color_timings(vertex.color_timings),
+      texture_timings(vertex.texture_timings) {}
+
+bool VertexStreams::AnimationData::IsZero() const {
+  return position_from == glm::vec2(0) && color_from == glm::vec4(0) &&
+         texture_coords_from == glm::vec2(0) &&
+         position_timings == glm::vec2(0) && color_timings == glm::vec2(0) &&
+         texture_timings == glm::vec2(0);
+}
+
+VertexStreams::VertexStreams(const std::vector<Vertex>& vertices) {
+  reserve(vertices.size());
+  for (const Vertex& v : vertices) push_back(v);
+}
+
+void VertexStreams::clear() {
+  positions_.clear();
+  colors_.clear();
+  has_texture_coords_ = false;
+  texture_coords_.clear();
+  has_animation_ = false;
+  animation_.clear();
+}
+
+void VertexStreams::reserve(size_t n) {
+  positions_.reserve(n);
+  colors_.reserve(n);
+  if (has_texture_coords_) texture_coords_.reserve(n);
+  if (has_animation_) animation_.reserve(n);
+}
+
+void VertexStreams::resize(size_t n) {
+  positions_.resize(n, glm::vec2(0));
+  colors_.resize(n, glm::vec4(0));
+  if (has_texture_coords_) texture_coords_.resize(n, glm::vec2(0));
+  if (has_animation_) animation_.resize(n);
+}
+
+const Vertex VertexStreams::Get(size_t index) const {
+  ASSERT(index < size());
+  Vertex v;
+  v.position = positions_[index];
+  v.color = colors_[index];
+  if (has_texture_coords_) v.texture_coords = texture_coords_[index];
+  if (has_animation_) {
+    const AnimationData& a = animation_[index];
+    v.position_from = a.position_from;
+    v.color_from = a.color_from;
+    v.texture_coords_from = a.texture_coords_from;
+    v.position_timings = a.position_timings;
+    v.color_timings = a.color_timings;
+    v.texture_timings = a.texture_timings;
+  }
+  return v;
+}
+
+void VertexStreams::Set(size_t index, const Vertex& vertex) {
+  ASSERT(index < size());
+  AddStreamsFor(vertex);
+  positions_[index] = vertex.position;
+  colors_[index] = vertex.color;
+  if (has_texture_coords_) texture_coords_[index] = vertex.texture_coords;
+  if (has_animation_) animation_[index] = AnimationData(vertex);
+}
+
+void VertexStreams::push_back(const Vertex& vertex) {
+  AddStreamsFor(vertex);
+  positions_.push_back(vertex.position);
+  colors_.push_back(vertex.color);
+  if (has_texture_coords_) texture_coords_.push_back(vertex.texture_coords);
+  if (has_animation_) animation_.emplace_back(vertex);
+}
+
+void VertexStreams::Append(const VertexStreams& other) {
+  if (other.has_texture_coords_) AddTextureCoordsStream();
+  if (other.has_animation_) AddAnimationStream();
+  positions_.insert(positions_.end(), other.positions_.begin(),
+                    other.positions_.end());
+  colors_.insert(colors_.end(), other.colors_.begin(), other.colors_.end());
+  if (has_texture_coords_) {
+    if (other.has_texture_coords_) {
+      texture_coords_.insert(texture_coords_.end(),
+                             other.texture_coords_.begin(),
+                             other.texture_coords_.end());
+    } else {
+      texture_coords_.resize(size(), glm::vec2(0));
+    }
+  }
+  if (has_animation_) {
+    if (other.has_animation_) {
+      animation_.insert(animation_.end(), other.animation_.begin(),
+                        other.animation_.end());
+    } else {
+      animation_.resize(size());
+    }
+  }
+}
+
+std::vector<glm::vec2>* VertexStreams::MutableTextureCoords() {
+  AddTextureCoordsStream();
+  return &texture_coords_;
+}
+
+std::vector<Vertex> VertexStreams::ToVertices() const {
+  std::vector<Vertex> vertices;
+  vertices.reserve(size());
+  for (size_t i = 0; i < size(); ++i) vertices.push_back(Get(i));
+  return vertices;
+}
+
+size_t VertexStreams::CapacityBytes() const {
+  return positions_.capacity() * sizeof(glm::vec2) +
+         colors_.capacity() * sizeof(glm::vec4) +
+         texture_coords_.capacity() * sizeof(glm::vec2) +
+         animation_.capacity() * sizeof(AnimationData);
+}
+
+void VertexStreams::AddStreamsFor(const Vertex& vertex) {
+  if (!has_texture_coords_ && vertex.texture_coords != glm::vec2(0)) {
+    AddTextureCoordsStream();
+  }
+  if (!has_animation_ && !AnimationData(vertex).IsZero()) {
+    AddAnimationStream();
+  }
+}
+
+void VertexStreams::AddTextureCoordsStream() {
+  if (has_texture_coords_) return;
+  has_texture_coords_ = true;
+  texture_coords_.reserve(positions_.capacity());
+  texture_coords_.resize(size(), glm::vec2(0));
+}
+
+void VertexStreams::AddAnimationStream() {
+  if (has_animation_) return;
+  has_animation_ = true;
+  animation_.reserve(positions_.capacity());
+  animation_.resize(size());
+}
+
+}  // namespace ink
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INK_ENGINE_GEOMETRY_MESH_VERTEX_STREAMS_H_
+#define INK_ENGINE_GEOMETRY_MESH_VERTEX_STREAMS_H_
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "third_party/glm/glm/glm.hpp"
+#include "ink/engine/geometry/mesh/vertex.h"
+
+namespace ink {
+
+// A list of vertices, stored as a structure of arrays: each attribute of Vertex
+// is kept in its own array ("stream"). The positions and colors are always
+// stored. The texture coordinates and the animation data (the *_from and
+// *_timings fields) are only stored once a vertex with non-zero values for
+// them is added, so a list of untextured, unanimated vertices, e.g. those of
+// most strokes, takes 24 bytes per vertex, instead of sizeof(Vertex), 88.
+// Animation data is only written for animated and particle brushes (see
+// ShaderMetadata::IsAnimated() and IsParticle()).
+//
+// Whole vertices are read and written by value, with Get() and Set(); code
+// that only needs some of the attributes should use the streams directly,
+// e.g. Positions().
+class VertexStreams {
+ public:
+  // Iterates over the vertices, by value.
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Vertex;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = const Vertex;
+
+    const_iterator() {}
+
+    const Vertex operator*() const { return streams_->Get(index_); }
+    const_iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator copy = *this;
+      ++index_;
+      return copy;
+    }
+    bool operator==(const const_iterator& other) const {
+      return index_ == other.index_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return index_ != other.index_;
+    }
+
+   private:
+    friend class VertexStreams;
+    const_iterator(const VertexStreams* streams, size_t index)
+        : streams_(streams), index_(index) {}
+
+    const VertexStreams* streams_ = nullptr;
+    size_t index_ = 0;
+  };
+
+  VertexStreams() {}
+  explicit VertexStreams(const std::vector<Vertex>& vertices);
+
+  size_t size() const { return positions_.size(); }
+  bool empty() const { return positions_.empty(); }
+
+  // Removes all of the vertices, and the optional streams.
+  void clear();
+  void reserve(size_t n);
+  // Adds default-constructed vertices or removes vertices from the back.
+  void resize(size_t n);
+
+  // Returns the vertex at the given index. The vertex is returned by value
+  // (and const, so that assigning to one of its fields doesn't compile): use
+  // Set(), or the mutable streams, to modify it.
+  const Vertex Get(size_t index) const;
+  const Vertex operator[](size_t index) const { return Get(index); }
+  const Vertex back() const { return Get(size() - 1); }
+  void Set(size_t index, const Vertex& vertex);
+
+  void push_back(const Vertex& vertex);
+  template <typename... Args>
+  void emplace_back(Args&&... args) {
+    push_back(Vertex(std::forward<Args>(args)...));
+  }
+  // Appends all of the other list's vertices.
+  void Append(const VertexStreams& other);
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size()); }
+
+  // The streams. The mutable streams may be modified in place, but must not be
+  // resized.
+  const std::vector<glm::vec2>& Positions() const { return positions_; }
+  std::vector<glm::vec2>* MutablePositions() { return &positions_; }
+  const std::vector<glm::vec4>& Colors() const { return colors_; }
+  std::vector<glm::vec4>* MutableColors() { return &colors_; }
+
+  // The texture coordinates are only stored if HasTextureCoords() is true;
+  // otherwise, TextureCoords() is empty and the vertices' texture coordinates
+  // are all zero. MutableTextureCoords() adds the stream if needed.
+  bool HasTextureCoords() const { return has_texture_coords_; }
+  const std::vector<glm::vec2>& TextureCoords() const {
+    return texture_coords_;
+  }
+  std::vector<glm::vec2>* MutableTextureCoords();
+
+  // Whether any vertex has animation data. If not, the vertices' animation
+  // fields are all zero.
+  bool HasAnimation() const { return has_animation_; }
+
+  // Returns the vertices, interleaved, e.g. for uploading to a VBO.
+  std::vector<Vertex> ToVertices() const;
+
+  // Returns the number of bytes allocated for vertex data.
+  size_t CapacityBytes() const;
+
+ private:
+  // The animation fields of a Vertex.
+  struct AnimationData {
+    glm::vec2 position_from{0, 0};
+    glm::vec4 color_from{0, 0, 0, 0};
+    glm::vec2 texture_coords_from{0, 0};
+    glm::vec2 position_timings{0, 0};
+    glm::vec2 color_timings{0, 0};
+    glm::vec2 texture_timings{0, 0};
+
+    AnimationData() {}
+    explicit AnimationData(const Vertex& vertex);
+    bool IsZero() const;
+  };
+
+  // Adds the optional streams that are needed to store the vertex.
+  void AddStreamsFor(const Vertex& vertex);
+  void AddTextureCoordsStream();
+  void AddAnimationStream();
+
+  std::vector<glm::vec2> positions_;
+  std::vector<glm::vec4> colors_;
+  bool has_texture_coords_ = false;
+  std::vector<glm::vec2> texture_coords_;
+  bool has_animation_ = false;
+  std::vector<AnimationData> animation_;
+};
+
+}  // namespace ink
+
+#endif  // INK_ENGINE_GEOMETRY_MESH_VERTEX_STREAMS_H_
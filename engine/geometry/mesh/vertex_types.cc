@@ -23,6 +23,7 @@
 #include "third_party/glm/glm/glm.hpp"
 #include "third_party/glm/glm/gtc/matrix_transform.hpp"
 #include "ink/engine/geometry/algorithms/transform.h"
+#include "ink/engine/geometry/mesh/vertex_pack_kernels.h"
 #include "ink/engine/util/dbg/errors.h"
 #include "ink/engine/util/dbg/log.h"
 #include "ink/engine/util/funcs/float_pack.h"
@@ -145,7 +146,62 @@ void PackedVertList::UnpackVertex(uint32_t idx, Vertex* vertex) const {
   }
 }
 
-PackedVertList PackedVertList::PackVerts(const std::vector<Vertex>& verts,
+void PackedVertList::UnpackVertices(VertexStreams* vertices) const {
+  uint32_t n = size();
+  vertices->clear();
+  vertices->resize(n);
+  glm::vec2* positions = vertices->MutablePositions()->data();
+  glm::vec4* colors = vertices->MutableColors()->data();
+  switch (format_) {
+    case VertFormat::x11a7r6y11g7b6:
+      BatchUnpackColorAndPosition(
+          reinterpret_cast<const float*>(Vec2Data().data()), 2, n, positions,
+          colors);
+      return;
+    case VertFormat::x32y32:
+      for (uint32_t i = 0; i < n; ++i) {
+        positions[i].x = Vec2Data()[i].x;
+        positions[i].y = Vec2Data()[i].y;
+      }
+      return;
+    case VertFormat::x12y12:
+      BatchUnpackPosition(FloatData().data(), 1, n, nullptr, positions);
+      return;
+    case VertFormat::x11a7r6y11g7b6u12v12: {
+      const float* packed = reinterpret_cast<const float*>(Vec3Data().data());
+      BatchUnpackColorAndPosition(packed, 3, n, positions, colors);
+      BatchUnpackPosition(packed + 2, 3, n, &packed_uv_to_uv_,
+                          vertices->MutableTextureCoords()->data());
+      return;
+    }
+  }
+}
+
+void PackedVertList::UnpackPositions(const glm::mat4& transform,
+                                     glm::vec2* out) const {
+  uint32_t n = size();
+  switch (format_) {
+    case VertFormat::x12y12:
+      BatchUnpackPosition(FloatData().data(), 1, n, &transform, out);
+      return;
+    case VertFormat::x32y32:
+      for (uint32_t i = 0; i < n; ++i) {
+        out[i] = geometry::Transform(Vec2Data()[i], transform);
+      }
+      return;
+    case VertFormat::x11a7r6y11g7b6:
+    case VertFormat::x11a7r6y11g7b6u12v12: {
+      Vertex vertex;
+      for (uint32_t i = 0; i < n; ++i) {
+        UnpackVertex(i, &vertex);
+        out[i] = geometry::Transform(vertex.position, transform);
+      }
+      return;
+    }
+  }
+}
+
+PackedVertList PackedVertList::PackVerts(const VertexStreams& verts,
                                          const glm::mat4& transform,
                                          VertFormat to_format) {
   PackedVertList res(to_format);
@@ -170,45 +226,42 @@ PackedVertList PackedVertList::PackVerts(const std::vector<Vertex>& verts,
   return res;
 }
 
-std::vector<float> PackedVertList::PackVertsX12Y12(
-    const std::vector<Vertex>& verts, const glm::mat4& transform,
-    float max_coord) {
+std::vector<float> PackedVertList::PackVertsX12Y12(const VertexStreams& verts,
+                                                   const glm::mat4& transform,
+                                                   float max_coord) {
   std::vector<float> floats(verts.size());
-  for (size_t i = 0; i < verts.size(); i++) {
-    // The vertices are rounded and clamped in PackPosition().
-    floats[i] = PackPosition(geometry::Transform(verts[i].position, transform));
-  }
+  // The vertices are rounded and clamped in PackPosition().
+  BatchPackPosition(verts.Positions().data(), verts.size(), transform,
+                    floats.data(), 1);
   return floats;
 }
 
 std::vector<glm::vec2> PackedVertList::PackVertsX32Y32(
-    const std::vector<Vertex>& verts, const glm::mat4& transform,
-    float max_coord) {
+    const VertexStreams& verts, const glm::mat4& transform, float max_coord) {
+  const std::vector<glm::vec2>& positions = verts.Positions();
   std::vector<glm::vec2> vec2s(verts.size());
   for (size_t i = 0; i < verts.size(); i++) {
     // The vertices may be outside the target bounds by ± epsilon after the
     // transform is applied, so we clamp them into the desired range.
     vec2s[i] = util::Clamp0N(max_coord,
-                             geometry::Transform(verts[i].position, transform));
+                             geometry::Transform(positions[i], transform));
   }
   return vec2s;
 }
 
 std::vector<glm::vec2> PackedVertList::PackVertsX11A7R6Y11G7B6(
-    const std::vector<Vertex>& verts, const glm::mat4& transform,
-    float max_coord) {
+    const VertexStreams& verts, const glm::mat4& transform, float max_coord) {
   std::vector<glm::vec2> vec2s(verts.size());
-  for (size_t i = 0; i < verts.size(); i++) {
-    // The vertices are rounded and clamped in PackColorAndPosition().
-    vec2s[i] = PackColorAndPosition(
-        verts[i].color, geometry::Transform(verts[i].position, transform));
-  }
+  // The vertices are rounded and clamped in PackColorAndPosition().
+  BatchPackColorAndPosition(verts.Positions().data(), verts.Colors().data(),
+                            verts.size(), transform,
+                            reinterpret_cast<float*>(vec2s.data()), 2);
   return vec2s;
 }
 
 std::vector<glm::vec3> PackedVertList::PackVertsX11A7R6Y11G7B6U12V12(
-    const std::vector<Vertex>& verts, const glm::mat4& transform,
-    float max_coord, glm::mat4* packed_uv_to_uv) {
+    const VertexStreams& verts, const glm::mat4& transform, float max_coord,
+    glm::mat4* packed_uv_to_uv) {
   // The texture uv-coordinates are packed into a single float (the z-component
   // of the vec3), in the same way that x12y12 vertices are packed.
   auto uv_to_packed_uv = CalculateUvToPackedUvTransform(
@@ -216,15 +269,21 @@ std::vector<glm::vec3> PackedVertList::PackVertsX11A7R6Y11G7B6U12V12(
       GetMaxCoordinateForFormat(VertFormat::x12y12));
   *packed_uv_to_uv = glm::inverse(uv_to_packed_uv);
   std::vector<glm::vec3> vec3s(verts.size());
-  for (size_t i = 0; i < verts.size(); i++) {
-    // The vertices are rounded and clamped in PackColorAndPosition() and
-    // PackPosition().
-    vec3s[i] = {
-        PackColorAndPosition(verts[i].color,
-                             geometry::Transform(verts[i].position, transform)),
-        PackPosition(
-            geometry::Transform(verts[i].texture_coords, uv_to_packed_uv))};
+  float* packed = reinterpret_cast<float*>(vec3s.data());
+  // The vertices are rounded and clamped in PackColorAndPosition() and
+  // PackPosition().
+  BatchPackColorAndPosition(verts.Positions().data(), verts.Colors().data(),
+                            verts.size(), transform, packed, 3);
+  // Untextured vertices have texture uv-coordinates of zero, which aren't
+  // stored.
+  std::vector<glm::vec2> zero_texture_coords;
+  if (!verts.HasTextureCoords()) {
+    zero_texture_coords.resize(verts.size(), glm::vec2(0));
   }
+  const std::vector<glm::vec2>& texture_coords =
+      verts.HasTextureCoords() ? verts.TextureCoords() : zero_texture_coords;
+  BatchPackPosition(texture_coords.data(), verts.size(), uv_to_packed_uv,
+                    packed + 2, 3);
   return vec3s;
 }
 
@@ -25,6 +25,7 @@
 #include "third_party/absl/types/variant.h"
 #include "third_party/glm/glm/glm.hpp"
 #include "ink/engine/geometry/mesh/vertex.h"
+#include "ink/engine/geometry/mesh/vertex_streams.h"
 #include "ink/engine/geometry/primitives/rect.h"
 
 namespace ink {
@@ -87,6 +88,16 @@ class PackedVertList {
   // Unpacks vertex at given index into provided vertex struct.
   void UnpackVertex(uint32_t idx, Vertex* vertex) const;
 
+  // Replaces the contents of vertices with all of the unpacked vertices. This
+  // is equivalent to calling UnpackVertex() for each index, but is
+  // considerably faster for large lists.
+  void UnpackVertices(VertexStreams* vertices) const;
+
+  // Writes the position of each vertex, transformed by the given matrix, to
+  // out[0] through out[size() - 1]. Unlike UnpackVertices(), this doesn't
+  // unpack the colors or texture coordinates.
+  void UnpackPositions(const glm::mat4& transform, glm::vec2* out) const;
+
   // This transform maps from the packed texture uv-coordinates to the unpacked
   // texture uv-coordinates. It is only used for VertexType::x12y12u12v12.
   const glm::mat4& PackedUvToUvTransform() const { return packed_uv_to_uv_; }
@@ -95,7 +106,7 @@ class PackedVertList {
   // with the same vertices and format. The MBR of the packed vertices will be
   // the rectangle from (0, 0) to (m, m), where m is the maximum coordinate for
   // the format.
-  static PackedVertList PackVerts(const std::vector<Vertex>& verts,
+  static PackedVertList PackVerts(const VertexStreams& verts,
                                   const glm::mat4& transform,
                                   VertFormat to_format);
 
@@ -108,17 +119,17 @@ class PackedVertList {
  private:
   // These helpers are used by PackVerts to construct the data vectors for the
   // various formats.
-  static std::vector<float> PackVertsX12Y12(const std::vector<Vertex>& verts,
+  static std::vector<float> PackVertsX12Y12(const VertexStreams& verts,
                                             const glm::mat4& transform,
                                             float max_coord);
-  static std::vector<glm::vec2> PackVertsX32Y32(
-      const std::vector<Vertex>& verts, const glm::mat4& transform,
-      float max_coord);
+  static std::vector<glm::vec2> PackVertsX32Y32(const VertexStreams& verts,
+                                                const glm::mat4& transform,
+                                                float max_coord);
   static std::vector<glm::vec2> PackVertsX11A7R6Y11G7B6(
-      const std::vector<Vertex>& verts, const glm::mat4& transform,
+      const VertexStreams& verts, const glm::mat4& transform,
       float max_coord);
   static std::vector<glm::vec3> PackVertsX11A7R6Y11G7B6U12V12(
-      const std::vector<Vertex>& verts, const glm::mat4& transform,
+      const VertexStreams& verts, const glm::mat4& transform,
       float max_coord, glm::mat4* packed_uv_to_uv);
 
   static glm::mat4 CalculateUvToPackedUvTransform(Rect uv_bounds,
@@ -0,0 +1,217 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/geometry/mesh/vertex_types.h"
+
+#include <cstring>
+#include <vector>
+
+#include "testing/base/public/benchmark.h"
+#include "third_party/glm/glm/glm.hpp"
+#include "ink/engine/geometry/algorithms/envelope.h"
+#include "ink/engine/geometry/algorithms/transform.h"
+#include "ink/engine/geometry/mesh/mesh.h"
+#include "ink/engine/geometry/mesh/mesh_test_helpers.h"
+#include "ink/engine/geometry/mesh/shader_type.h"
+#include "ink/engine/geometry/mesh/vertex_pack_kernels.h"
+#include "ink/engine/util/dbg/errors.h"
+#include "ink/engine/util/funcs/float_pack.h"
+
+namespace ink {
+namespace {
+
+// A ~1M vertex mesh of long, wavy strokes, with slightly varying colors and
+// texture coordinates along their length.
+Mesh MakeMillionVertexMesh() {
+  constexpr int kSubdivisions = 1 << 19;
+  Mesh mesh = MakeSineWaveMesh({0, 0}, 500, .0001, 100000, 20, kSubdivisions);
+  std::vector<glm::vec4> &colors = *mesh.verts.MutableColors();
+  std::vector<glm::vec2> &texture_coords = *mesh.verts.MutableTextureCoords();
+  for (size_t i = 0; i < mesh.verts.size(); ++i) {
+    float t = static_cast<float>(i) / mesh.verts.size();
+    colors[i] = glm::vec4(.2 + .5 * t, .4, .8 - .3 * t, .9);
+    texture_coords[i] = glm::vec2(t, i % 2);
+  }
+  return mesh;
+}
+
+// Returns true if a and b have the same bit pattern, so that e.g. -0 and 0
+// differ.
+template <typename T>
+bool BitIdentical(const T &a, const T &b) {
+  return std::memcmp(&a, &b, sizeof(T)) == 0;
+}
+
+// Checks that the batch kernels give bit-identical results to the per-vertex
+// functions on every vertex of the mesh, so that the benchmarks below compare
+// equivalent code. This fails if, e.g., the compiler has fused the per-vertex
+// functions' multiplications and additions into FMAs.
+void ExpectBatchKernelsMatchPerVertex(const Mesh &mesh) {
+  const std::vector<glm::vec2> &vert_positions = mesh.verts.Positions();
+  const std::vector<glm::vec4> &vert_colors = mesh.verts.Colors();
+  const size_t n = mesh.verts.size();
+  const Rect envelope = geometry::Envelope(mesh.verts);
+  const glm::mat4 position_transform =
+      PackedVertList::CalcTransformForFormat(envelope, VertFormat::x12y12);
+  const glm::mat4 color_transform = PackedVertList::CalcTransformForFormat(
+      envelope, VertFormat::x11a7r6y11g7b6);
+
+  std::vector<float> positions(n);
+  std::vector<glm::vec2> colors(n);
+  for (size_t i = 0; i < n; ++i) {
+    positions[i] = PackPosition(
+        geometry::Transform(vert_positions[i], position_transform));
+    colors[i] = PackColorAndPosition(
+        vert_colors[i],
+        geometry::Transform(vert_positions[i], color_transform));
+  }
+
+  size_t n_mismatched = 0;
+  std::vector<float> batch_positions(n);
+  BatchPackPosition(vert_positions.data(), n, position_transform,
+                    batch_positions.data(), 1);
+  std::vector<glm::vec2> batch_colors(n);
+  BatchPackColorAndPosition(vert_positions.data(), vert_colors.data(), n,
+                            color_transform, &batch_colors[0].x, 2);
+  for (size_t i = 0; i < n; ++i) {
+    if (!BitIdentical(positions[i], batch_positions[i]) ||
+        !BitIdentical(colors[i], batch_colors[i]))
+      ++n_mismatched;
+  }
+
+  // The positions are unpacked into the texture coordinates, with a transform,
+  // as PackedVertList does for x11a7r6y11g7b6u12v12.
+  const glm::mat4 unpack_transform = glm::inverse(position_transform);
+  std::vector<glm::vec2> unpacked_texture_coords(n);
+  std::vector<glm::vec2> unpacked_positions(n);
+  std::vector<glm::vec4> unpacked_colors(n);
+  BatchUnpackPosition(positions.data(), 1, n, &unpack_transform,
+                      unpacked_texture_coords.data());
+  BatchUnpackColorAndPosition(&colors[0].x, 2, n, unpacked_positions.data(),
+                              unpacked_colors.data());
+  for (size_t i = 0; i < n; ++i) {
+    glm::vec2 texture_coords =
+        geometry::Transform(UnpackPosition(positions[i]), unpack_transform);
+    glm::vec4 color;
+    glm::vec2 position;
+    UnpackColorAndPosition(colors[i], &color, &position);
+    if (!BitIdentical(texture_coords, unpacked_texture_coords[i]) ||
+        !BitIdentical(color, unpacked_colors[i]) ||
+        !BitIdentical(position, unpacked_positions[i]))
+      ++n_mismatched;
+  }
+  EXPECT(n_mismatched == 0);
+}
+
+const Mesh &MillionVertexMesh() {
+  static const Mesh *mesh = []() {
+    Mesh *mesh = new Mesh(MakeMillionVertexMesh());
+    ExpectBatchKernelsMatchPerVertex(*mesh);
+    return mesh;
+  }();
+  return *mesh;
+}
+
+// The argument is the VertFormat.
+static void BM_PackVerts(benchmark::State &state) {
+  const Mesh &mesh = MillionVertexMesh();
+  auto format = static_cast<VertFormat>(state.range(0));
+  glm::mat4 transform = PackedVertList::CalcTransformForFormat(
+      geometry::Envelope(mesh.verts), format);
+  while (state.KeepRunning()) {
+    testing::DoNotOptimize(
+        PackedVertList::PackVerts(mesh.verts, transform, format));
+  }
+  state.SetItemsProcessed(state.iterations() * mesh.verts.size());
+}
+BENCHMARK(BM_PackVerts)
+    ->Arg(static_cast<int>(VertFormat::x12y12))
+    ->Arg(static_cast<int>(VertFormat::x11a7r6y11g7b6))
+    ->Arg(static_cast<int>(VertFormat::x11a7r6y11g7b6u12v12));
+
+// The per-vertex equivalent of BM_PackVerts for x11a7r6y11g7b6, for
+// comparison.
+static void BM_PackVertsOneAtATime(benchmark::State &state) {
+  const Mesh &mesh = MillionVertexMesh();
+  glm::mat4 transform = PackedVertList::CalcTransformForFormat(
+      geometry::Envelope(mesh.verts), VertFormat::x11a7r6y11g7b6);
+  const std::vector<glm::vec2> &positions = mesh.verts.Positions();
+  const std::vector<glm::vec4> &colors = mesh.verts.Colors();
+  std::vector<glm::vec2> packed(mesh.verts.size());
+  while (state.KeepRunning()) {
+    for (size_t i = 0; i < mesh.verts.size(); ++i) {
+      packed[i] = PackColorAndPosition(
+          colors[i], geometry::Transform(positions[i], transform));
+    }
+    testing::DoNotOptimize(packed.data());
+  }
+  state.SetItemsProcessed(state.iterations() * mesh.verts.size());
+}
+BENCHMARK(BM_PackVertsOneAtATime);
+
+// The argument is the VertFormat.
+static void BM_UnpackVertices(benchmark::State &state) {
+  const Mesh &mesh = MillionVertexMesh();
+  auto format = static_cast<VertFormat>(state.range(0));
+  PackedVertList packed = PackedVertList::PackVerts(
+      mesh.verts,
+      PackedVertList::CalcTransformForFormat(geometry::Envelope(mesh.verts),
+                                             format),
+      format);
+  VertexStreams unpacked;
+  while (state.KeepRunning()) {
+    packed.UnpackVertices(&unpacked);
+    testing::DoNotOptimize(unpacked.Positions().data());
+  }
+  state.SetItemsProcessed(state.iterations() * packed.size());
+}
+BENCHMARK(BM_UnpackVertices)
+    ->Arg(static_cast<int>(VertFormat::x12y12))
+    ->Arg(static_cast<int>(VertFormat::x11a7r6y11g7b6))
+    ->Arg(static_cast<int>(VertFormat::x11a7r6y11g7b6u12v12));
+
+// The per-vertex equivalent of BM_UnpackVertices, for comparison.
+static void BM_UnpackVertexOneAtATime(benchmark::State &state) {
+  const Mesh &mesh = MillionVertexMesh();
+  auto format = static_cast<VertFormat>(state.range(0));
+  PackedVertList packed = PackedVertList::PackVerts(
+      mesh.verts,
+      PackedVertList::CalcTransformForFormat(geometry::Envelope(mesh.verts),
+                                             format),
+      format);
+  std::vector<Vertex> unpacked(packed.size());
+  while (state.KeepRunning()) {
+    for (uint32_t i = 0; i < packed.size(); ++i)
+      packed.UnpackVertex(i, &unpacked[i]);
+    testing::DoNotOptimize(unpacked.data());
+  }
+  state.SetItemsProcessed(state.iterations() * packed.size());
+}
+BENCHMARK(BM_UnpackVertexOneAtATime)
+    ->Arg(static_cast<int>(VertFormat::x12y12))
+    ->Arg(static_cast<int>(VertFormat::x11a7r6y11g7b6))
+    ->Arg(static_cast<int>(VertFormat::x11a7r6y11g7b6u12v12));
+
+static void BM_OptimizedMeshToMesh(benchmark::State &state) {
+  const Mesh &mesh = MillionVertexMesh();
+  OptimizedMesh optimized_mesh(ShaderType::ColoredVertShader, mesh);
+  while (state.KeepRunning()) {
+    testing::DoNotOptimize(optimized_mesh.ToMesh());
+  }
+  state.SetItemsProcessed(state.iterations() * mesh.verts.size());
+}
+BENCHMARK(BM_OptimizedMeshToMesh);
+
+}  // namespace
+}  // namespace ink
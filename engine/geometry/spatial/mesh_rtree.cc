@@ -43,10 +43,7 @@ MeshRTree::MeshRTree(const OptimizedMesh& mesh) : MeshRTree(mesh.ToMesh()) {}
 MeshRTree::MeshRTree(const Mesh& unpacked_mesh) {
   rtree_ = MakeRTreeFromMeshTriangles(unpacked_mesh);
 
-  std::vector<vec2> vertices;
-  vertices.reserve(unpacked_mesh.verts.size());
-  for (const auto& v : unpacked_mesh.verts) vertices.push_back(v.position);
-  convex_hull_ = geometry::ConvexHull(vertices);
+  convex_hull_ = geometry::ConvexHull(unpacked_mesh.verts.Positions());
 }
 
 Rect MeshRTree::Mbr(const glm::mat4& object_to_world) const {
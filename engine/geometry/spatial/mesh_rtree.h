@@ -24,7 +24,7 @@
 #include "ink/engine/geometry/mesh/mesh.h"
 #include "ink/engine/geometry/primitives/rect.h"
 #include "ink/engine/geometry/primitives/triangle.h"
-#include "ink/engine/geometry/spatial/rtree.h"
+#include "ink/engine/geometry/spatial/rtree_utils.h"
 #include "ink/engine/geometry/spatial/spatial_index.h"
 
 namespace ink {
@@ -50,11 +50,11 @@ class MeshRTree : public SpatialIndex {
   Mesh DebugMesh() const override;
 
  private:
-  const RTree<geometry::Triangle>* const GetTriRTree() const override {
+  const TriangleRTree* const GetTriRTree() const override {
     return rtree_.get();
   }
 
-  std::unique_ptr<RTree<geometry::Triangle>> rtree_;
+  std::unique_ptr<TriangleRTree> rtree_;
   std::vector<glm::vec2> convex_hull_;
 
   // Cache the result of the last call to Mbr().
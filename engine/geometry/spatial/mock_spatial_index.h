@@ -37,7 +37,7 @@ class MockSpatialIndex : public SpatialIndex {
   MOCK_CONST_METHOD0(DebugMesh, Mesh());
 
  private:
-  const RTree<geometry::Triangle>* const GetTriRTree() const override {
+  const TriangleRTree* const GetTriRTree() const override {
     // Mocks don't have an rtree.
     return nullptr;
   }
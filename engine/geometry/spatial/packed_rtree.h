@@ -0,0 +1,773 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INK_ENGINE_GEOMETRY_SPATIAL_PACKED_RTREE_H_
+#define INK_ENGINE_GEOMETRY_SPATIAL_PACKED_RTREE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "third_party/absl/container/inlined_vector.h"
+#include "third_party/absl/types/optional.h"
+#include "ink/engine/geometry/algorithms/envelope.h"
+#include "ink/engine/geometry/algorithms/intersect.h"
+#include "ink/engine/geometry/algorithms/transform.h"
+#include "ink/engine/geometry/primitives/rect.h"
+#include "ink/engine/util/dbg/errors.h"
+
+namespace ink {
+namespace spatial {
+
+// An R-Tree with the same interface and semantics as RTree (see rtree.h), but
+// laid out for cache-friendly traversal:
+//  - All nodes live in a single contiguous array, and refer to each other by
+//    index instead of by pointer.
+//  - Each node stores the bounds of its (up to 16) children as separate
+//    min-x/min-y/max-x/max-y arrays, so that all of them can be tested against
+//    a query region at once with SSE or AVX (with a scalar fallback).
+//  - The bounds function and the search predicates are template parameters,
+//    rather than std::functions, so that they can be inlined.
+//
+// Unlike RTree, nodes are allowed to underflow on removal (empty nodes are
+// still pruned), and overflowing nodes are split along the axis with the
+// largest spread. This keeps removal cheap, which suits the remove-and-reinsert
+// usage pattern of MeshSplitter.
+//
+// BoundsFunction must be a copyable functor with the signature:
+//   Rect operator()(const DataType &) const
+template <typename DataType, typename BoundsFunction>
+class PackedRTree {
+ public:
+  using value_type = DataType;
+
+  static constexpr int kMaxChildren = 16;
+
+  // Constructs an empty R-Tree.
+  explicit PackedRTree(BoundsFunction bounds_func = BoundsFunction());
+
+  // Constructs an R-Tree bulk loaded with the given elements, using the
+  // Sort-Tile-Recursive algorithm.
+  // InputIterator must be an iterator over DataType.
+  template <typename InputIterator>
+  PackedRTree(InputIterator begin, InputIterator end,
+              BoundsFunction bounds_func = BoundsFunction());
+
+  // Inserts an element into the R-Tree.
+  void Insert(const DataType &data);
+
+  // Finds the first element in the traversal, if any, whose bounding box
+  // intersects the given region, and that matches the predicate (if
+  // specified). See RTree::FindAny() for caveats on the traversal order.
+  // Predicate must be callable as bool(const DataType &).
+  absl::optional<DataType> FindAny(const Rect &region) const {
+    return FindAny(region, AcceptAll());
+  }
+  template <typename Predicate>
+  absl::optional<DataType> FindAny(const Rect &region,
+                                   Predicate predicate) const;
+
+  // Finds all elements whose bounding box intersects the given region, and
+  // that match the predicate (if specified). Returns the number of elements
+  // found. OutputIterator must be an output iterator over DataType.
+  template <typename OutputIterator>
+  int FindAll(const Rect &region, OutputIterator output) const {
+    return FindAll(region, output, AcceptAll());
+  }
+  template <typename OutputIterator, typename Predicate>
+  int FindAll(const Rect &region, OutputIterator output,
+              Predicate predicate) const;
+
+  // Removes the first element in the traversal whose bounding box intersects
+  // the given region, and that matches the predicate (if specified). Returns
+  // the removed element, if any.
+  absl::optional<DataType> Remove(const Rect &region) {
+    return Remove(region, AcceptAll());
+  }
+  template <typename Predicate>
+  absl::optional<DataType> Remove(const Rect &region, Predicate predicate);
+
+  // Removes all elements whose bounding boxes intersect the given region, and
+  // that match the predicate (if specified). Returns the number of elements
+  // that were removed.
+  int RemoveAll(const Rect &region) { return RemoveAll(region, AcceptAll()); }
+  template <typename Predicate>
+  int RemoveAll(const Rect &region, Predicate predicate);
+
+  // Clears the R-Tree, removing all elements.
+  void Clear();
+
+  // Returns the number of elements in the R-Tree.
+  std::size_t Size() const { return size_; }
+
+  // Returns the MBR of all of the elements in the R-Tree. If the R-Tree is
+  // empty, returns (0, 0)->(0, 0).
+  Rect Bounds() const;
+
+  // Returns true if this rtree intersects the passed in rtree holding elements
+  // of type U. See RTree::Intersects() for the required functions.
+  template <typename U, typename UBoundsFunction>
+  bool Intersects(const PackedRTree<U, UBoundsFunction> &other,
+                  const glm::mat4 &this_to_other) const;
+
+ private:
+  struct AcceptAll {
+    bool operator()(const DataType &) const { return true; }
+  };
+
+  // A node of the tree. At level 0, the children are indices into data_;
+  // otherwise they are indices into nodes_. Unused child slots always have
+  // inverted, infinite bounds, so that they never pass an intersection test.
+  struct Node {
+    float min_x[kMaxChildren];
+    float min_y[kMaxChildren];
+    float max_x[kMaxChildren];
+    float max_y[kMaxChildren];
+    int32_t child[kMaxChildren];
+    int32_t parent;
+    int16_t level;
+    int16_t count;
+
+    Rect ChildBounds(int i) const {
+      return Rect(min_x[i], min_y[i], max_x[i], max_y[i]);
+    }
+    void SetChildBounds(int i, const Rect &bounds) {
+      min_x[i] = bounds.from.x;
+      min_y[i] = bounds.from.y;
+      max_x[i] = bounds.to.x;
+      max_y[i] = bounds.to.y;
+    }
+    void ClearChild(int i) {
+      min_x[i] = min_y[i] = std::numeric_limits<float>::infinity();
+      max_x[i] = max_y[i] = -std::numeric_limits<float>::infinity();
+      child[i] = -1;
+    }
+  };
+
+  // A child entry that is being moved between nodes.
+  struct Entry {
+    Rect bounds;
+    int32_t child;
+  };
+
+  // Returns a bitmask with bit i set iff child i of the node intersects the
+  // region.
+  static uint32_t IntersectingChildren(const Node &node, const Rect &region);
+
+  static int CountTrailingZeros(uint32_t mask);
+
+  int32_t AllocateNode(int level);
+  void FreeNode(int32_t node_index);
+  int32_t AllocateData(const DataType &data);
+
+  Rect NodeBounds(int32_t node_index) const;
+  int IndexInParent(int32_t node_index) const;
+
+  // Recomputes the bounds of the node, and stores them in its parent's entry,
+  // continuing up the tree until the bounds no longer change.
+  void UpdateBoundsInParent(int32_t node_index);
+
+  // Descends from the root, choosing the child that would be least enlarged
+  // (and, in the event of a tie, the smallest), until a node at the given level
+  // is reached.
+  int32_t ChooseNode(const Rect &bounds, int level) const;
+
+  // Adds a child entry to the node, splitting it if necessary.
+  void AddEntry(int32_t node_index, const Entry &entry);
+  void SplitNode(int32_t node_index, const Entry &extra_entry);
+
+  // Removes the children of the leaf node flagged in the mask, pruning any
+  // nodes that become empty.
+  void RemoveFromLeaf(int32_t node_index, uint32_t mask);
+  void RemoveChildren(int32_t node_index, uint32_t mask);
+
+  // Removes any single-child roots above level 0.
+  void ShortenTree();
+
+  // Visits the leaf entries that intersect the region, in depth-first order,
+  // calling visitor(leaf_node_index, child_index). If the visitor returns
+  // true, the search stops and this returns true.
+  template <typename Visitor>
+  bool VisitLeafEntries(const Rect &region, Visitor visitor) const;
+
+  // Bulk-loads a level of the tree from the given entries, returning the
+  // entries for the nodes at the next level up.
+  std::vector<Entry> BulkLoadLevel(std::vector<Entry> *entries, int level);
+
+  std::vector<Node> nodes_;
+  std::vector<int32_t> free_nodes_;
+  std::vector<DataType> data_;
+  std::vector<int32_t> free_data_;
+  int32_t root_;
+  std::size_t size_;
+  BoundsFunction bounds_func_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//                            Implementation                                  //
+////////////////////////////////////////////////////////////////////////////////
+
+template <typename DataType, typename BoundsFunction>
+PackedRTree<DataType, BoundsFunction>::PackedRTree(BoundsFunction bounds_func)
+    : root_(-1), size_(0), bounds_func_(bounds_func) {
+  root_ = AllocateNode(0);
+}
+
+template <typename DataType, typename BoundsFunction>
+template <typename InputIterator>
+PackedRTree<DataType, BoundsFunction>::PackedRTree(InputIterator begin,
+                                                   InputIterator end,
+                                                   BoundsFunction bounds_func)
+    : root_(-1), size_(0), bounds_func_(bounds_func) {
+  std::vector<Entry> entries;
+  for (auto it = begin; it != end; ++it) {
+    entries.push_back(Entry{bounds_func_(*it), AllocateData(*it)});
+  }
+  size_ = entries.size();
+  if (entries.size() <= kMaxChildren) {
+    root_ = AllocateNode(0);
+    for (const auto &entry : entries) AddEntry(root_, entry);
+    return;
+  }
+
+  int level = 0;
+  while (entries.size() > 1) {
+    entries = BulkLoadLevel(&entries, level);
+    ++level;
+  }
+  root_ = entries.front().child;
+}
+
+template <typename DataType, typename BoundsFunction>
+void PackedRTree<DataType, BoundsFunction>::Insert(const DataType &data) {
+  Entry entry{bounds_func_(data), AllocateData(data)};
+  ++size_;
+  AddEntry(ChooseNode(entry.bounds, 0), entry);
+}
+
+template <typename DataType, typename BoundsFunction>
+template <typename Predicate>
+absl::optional<DataType> PackedRTree<DataType, BoundsFunction>::FindAny(
+    const Rect &region, Predicate predicate) const {
+  absl::optional<DataType> result;
+  VisitLeafEntries(region, [this, &predicate, &result](int32_t node_index,
+                                                       int child_index) {
+    const DataType &data = data_[nodes_[node_index].child[child_index]];
+    if (!predicate(data)) return false;
+    result = data;
+    return true;
+  });
+  return result;
+}
+
+template <typename DataType, typename BoundsFunction>
+template <typename OutputIterator, typename Predicate>
+int PackedRTree<DataType, BoundsFunction>::FindAll(const Rect &region,
+                                                   OutputIterator output,
+                                                   Predicate predicate) const {
+  int n_found = 0;
+  VisitLeafEntries(region, [this, &predicate, &output, &n_found](
+                               int32_t node_index, int child_index) {
+    const DataType &data = data_[nodes_[node_index].child[child_index]];
+    if (predicate(data)) {
+      *output++ = data;
+      ++n_found;
+    }
+    return false;
+  });
+  return n_found;
+}
+
+template <typename DataType, typename BoundsFunction>
+template <typename Predicate>
+absl::optional<DataType> PackedRTree<DataType, BoundsFunction>::Remove(
+    const Rect &region, Predicate predicate) {
+  int32_t found_node = -1;
+  int found_child = -1;
+  VisitLeafEntries(region, [this, &predicate, &found_node, &found_child](
+                               int32_t node_index, int child_index) {
+    if (!predicate(data_[nodes_[node_index].child[child_index]])) return false;
+    found_node = node_index;
+    found_child = child_index;
+    return true;
+  });
+  if (found_node < 0) return absl::nullopt;
+
+  absl::optional<DataType> result =
+      data_[nodes_[found_node].child[found_child]];
+  RemoveFromLeaf(found_node, 1u << found_child);
+  ShortenTree();
+  return result;
+}
+
+template <typename DataType, typename BoundsFunction>
+template <typename Predicate>
+int PackedRTree<DataType, BoundsFunction>::RemoveAll(const Rect &region,
+                                                     Predicate predicate) {
+  // Collect the entries to remove first, grouped by leaf, as removing them
+  // re-arranges the tree.
+  std::vector<std::pair<int32_t, uint32_t>> leaf_masks;
+  VisitLeafEntries(region, [this, &predicate, &leaf_masks](int32_t node_index,
+                                                           int child_index) {
+    if (predicate(data_[nodes_[node_index].child[child_index]])) {
+      if (leaf_masks.empty() || leaf_masks.back().first != node_index)
+        leaf_masks.emplace_back(node_index, 0);
+      leaf_masks.back().second |= 1u << child_index;
+    }
+    return false;
+  });
+
+  int n_removed = 0;
+  for (const auto &leaf_mask : leaf_masks) {
+    uint32_t mask = leaf_mask.second;
+    while (mask != 0) {
+      ++n_removed;
+      mask &= mask - 1;
+    }
+    RemoveFromLeaf(leaf_mask.first, leaf_mask.second);
+  }
+  ShortenTree();
+  return n_removed;
+}
+
+template <typename DataType, typename BoundsFunction>
+void PackedRTree<DataType, BoundsFunction>::Clear() {
+  nodes_.clear();
+  free_nodes_.clear();
+  data_.clear();
+  free_data_.clear();
+  size_ = 0;
+  root_ = AllocateNode(0);
+}
+
+template <typename DataType, typename BoundsFunction>
+Rect PackedRTree<DataType, BoundsFunction>::Bounds() const {
+  return NodeBounds(root_);
+}
+
+template <typename DataType, typename BoundsFunction>
+template <typename U, typename UBoundsFunction>
+bool PackedRTree<DataType, BoundsFunction>::Intersects(
+    const PackedRTree<U, UBoundsFunction> &other,
+    const glm::mat4 &this_to_other) const {
+  glm::mat4 other_to_this = glm::inverse(this_to_other);
+  Rect other_bounds_in_this =
+      geometry::Transform(other.Bounds(), other_to_this);
+  Rect intersection_in_this;
+  if (!geometry::Intersection(Bounds(), other_bounds_in_this,
+                              &intersection_in_this)) {
+    return false;
+  }
+
+  struct IntersectsThisData {
+    const DataType *this_data_in_other;
+    bool operator()(const U &other_data_in_other) const {
+      return geometry::Intersects(*this_data_in_other, other_data_in_other);
+    }
+  };
+  return FindAny(intersection_in_this,
+                 [&this_to_other, &other](const DataType &this_data_in_this) {
+                   auto this_data_in_other =
+                       geometry::Transform(this_data_in_this, this_to_other);
+                   return other
+                       .FindAny(geometry::Envelope(this_data_in_other),
+                                IntersectsThisData{&this_data_in_other})
+                       .has_value();
+                 })
+      .has_value();
+}
+
+template <typename DataType, typename BoundsFunction>
+uint32_t PackedRTree<DataType, BoundsFunction>::IntersectingChildren(
+    const Node &node, const Rect &region) {
+  // Child i intersects the region iff:
+  //   min_x[i] <= region.to.x && max_x[i] >= region.from.x &&
+  //   min_y[i] <= region.to.y && max_y[i] >= region.from.y
+  // which matches geometry::Intersects(const Rect &, const Rect &).
+  uint32_t mask = 0;
+#if defined(__AVX__)
+  const __m256 to_x = _mm256_set1_ps(region.to.x);
+  const __m256 to_y = _mm256_set1_ps(region.to.y);
+  const __m256 from_x = _mm256_set1_ps(region.from.x);
+  const __m256 from_y = _mm256_set1_ps(region.from.y);
+  for (int i = 0; i < kMaxChildren; i += 8) {
+    __m256 hit = _mm256_and_ps(
+        _mm256_and_ps(
+            _mm256_cmp_ps(_mm256_loadu_ps(node.min_x + i), to_x, _CMP_LE_OQ),
+            _mm256_cmp_ps(_mm256_loadu_ps(node.max_x + i), from_x,
+                          _CMP_GE_OQ)),
+        _mm256_and_ps(
+            _mm256_cmp_ps(_mm256_loadu_ps(node.min_y + i), to_y, _CMP_LE_OQ),
+            _mm256_cmp_ps(_mm256_loadu_ps(node.max_y + i), from_y,
+                          _CMP_GE_OQ)));
+    mask |= static_cast<uint32_t>(_mm256_movemask_ps(hit)) << i;
+  }
+#elif defined(__SSE2__)
+  const __m128 to_x = _mm_set1_ps(region.to.x);
+  const __m128 to_y = _mm_set1_ps(region.to.y);
+  const __m128 from_x = _mm_set1_ps(region.from.x);
+  const __m128 from_y = _mm_set1_ps(region.from.y);
+  for (int i = 0; i < kMaxChildren; i += 4) {
+    __m128 hit = _mm_and_ps(
+        _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(node.min_x + i), to_x),
+                   _mm_cmpge_ps(_mm_loadu_ps(node.max_x + i), from_x)),
+        _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(node.min_y + i), to_y),
+                   _mm_cmpge_ps(_mm_loadu_ps(node.max_y + i), from_y)));
+    mask |= static_cast<uint32_t>(_mm_movemask_ps(hit)) << i;
+  }
+#else
+  for (int i = 0; i < kMaxChildren; ++i) {
+    bool hit = node.min_x[i] <= region.to.x && node.max_x[i] >= region.from.x &&
+               node.min_y[i] <= region.to.y && node.max_y[i] >= region.from.y;
+    mask |= static_cast<uint32_t>(hit) << i;
+  }
+#endif
+  return mask & ((1u << node.count) - 1);
+}
+
+template <typename DataType, typename BoundsFunction>
+int PackedRTree<DataType, BoundsFunction>::CountTrailingZeros(uint32_t mask) {
+  ASSERT(mask != 0);
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctz(mask);
+#else
+  int n = 0;
+  while ((mask & 1) == 0) {
+    mask >>= 1;
+    ++n;
+  }
+  return n;
+#endif
+}
+
+template <typename DataType, typename BoundsFunction>
+template <typename Visitor>
+bool PackedRTree<DataType, BoundsFunction>::VisitLeafEntries(
+    const Rect &region, Visitor visitor) const {
+  if (size_ == 0) return false;
+
+  absl::InlinedVector<int32_t, 64> to_visit;
+  to_visit.push_back(root_);
+  while (!to_visit.empty()) {
+    int32_t node_index = to_visit.back();
+    to_visit.pop_back();
+    const Node &node = nodes_[node_index];
+    uint32_t mask = IntersectingChildren(node, region);
+    if (node.level == 0) {
+      while (mask != 0) {
+        if (visitor(node_index, CountTrailingZeros(mask))) return true;
+        mask &= mask - 1;
+      }
+    } else {
+      // Push the children in reverse, so that they are visited in order.
+      for (int i = node.count - 1; i >= 0; --i) {
+        if (mask & (1u << i)) to_visit.push_back(node.child[i]);
+      }
+    }
+  }
+  return false;
+}
+
+template <typename DataType, typename BoundsFunction>
+int32_t PackedRTree<DataType, BoundsFunction>::AllocateNode(int level) {
+  int32_t node_index;
+  if (free_nodes_.empty()) {
+    node_index = nodes_.size();
+    nodes_.emplace_back();
+  } else {
+    node_index = free_nodes_.back();
+    free_nodes_.pop_back();
+  }
+  Node &node = nodes_[node_index];
+  for (int i = 0; i < kMaxChildren; ++i) node.ClearChild(i);
+  node.parent = -1;
+  node.level = level;
+  node.count = 0;
+  return node_index;
+}
+
+template <typename DataType, typename BoundsFunction>
+void PackedRTree<DataType, BoundsFunction>::FreeNode(int32_t node_index) {
+  nodes_[node_index].count = 0;
+  free_nodes_.push_back(node_index);
+}
+
+template <typename DataType, typename BoundsFunction>
+int32_t PackedRTree<DataType, BoundsFunction>::AllocateData(
+    const DataType &data) {
+  if (free_data_.empty()) {
+    data_.push_back(data);
+    return data_.size() - 1;
+  }
+  int32_t data_index = free_data_.back();
+  free_data_.pop_back();
+  data_[data_index] = data;
+  return data_index;
+}
+
+template <typename DataType, typename BoundsFunction>
+Rect PackedRTree<DataType, BoundsFunction>::NodeBounds(
+    int32_t node_index) const {
+  const Node &node = nodes_[node_index];
+  if (node.count == 0) return Rect(0, 0, 0, 0);
+  Rect bounds = node.ChildBounds(0);
+  for (int i = 1; i < node.count; ++i) {
+    bounds.from.x = std::min(bounds.from.x, node.min_x[i]);
+    bounds.from.y = std::min(bounds.from.y, node.min_y[i]);
+    bounds.to.x = std::max(bounds.to.x, node.max_x[i]);
+    bounds.to.y = std::max(bounds.to.y, node.max_y[i]);
+  }
+  return bounds;
+}
+
+template <typename DataType, typename BoundsFunction>
+int PackedRTree<DataType, BoundsFunction>::IndexInParent(
+    int32_t node_index) const {
+  const Node &parent = nodes_[nodes_[node_index].parent];
+  for (int i = 0; i < parent.count; ++i) {
+    if (parent.child[i] == node_index) return i;
+  }
+  ASSERT(false);
+  return -1;
+}
+
+template <typename DataType, typename BoundsFunction>
+void PackedRTree<DataType, BoundsFunction>::UpdateBoundsInParent(
+    int32_t node_index) {
+  while (nodes_[node_index].parent >= 0) {
+    Rect bounds = NodeBounds(node_index);
+    int32_t parent_index = nodes_[node_index].parent;
+    int i = IndexInParent(node_index);
+    if (nodes_[parent_index].ChildBounds(i) == bounds) return;
+    nodes_[parent_index].SetChildBounds(i, bounds);
+    node_index = parent_index;
+  }
+}
+
+template <typename DataType, typename BoundsFunction>
+int32_t PackedRTree<DataType, BoundsFunction>::ChooseNode(const Rect &bounds,
+                                                          int level) const {
+  int32_t node_index = root_;
+  while (nodes_[node_index].level > level) {
+    const Node &node = nodes_[node_index];
+    int best = -1;
+    float min_enlargement = std::numeric_limits<float>::infinity();
+    float best_area = std::numeric_limits<float>::infinity();
+    for (int i = 0; i < node.count; ++i) {
+      Rect child_bounds = node.ChildBounds(i);
+      float area = child_bounds.Area();
+      float enlargement = child_bounds.Join(bounds).Area() - area;
+      if (enlargement < min_enlargement ||
+          (enlargement == min_enlargement && area < best_area)) {
+        best = i;
+        min_enlargement = enlargement;
+        best_area = area;
+      }
+    }
+    ASSERT(best >= 0);
+    node_index = node.child[best];
+  }
+  return node_index;
+}
+
+template <typename DataType, typename BoundsFunction>
+void PackedRTree<DataType, BoundsFunction>::AddEntry(int32_t node_index,
+                                                     const Entry &entry) {
+  if (nodes_[node_index].count == kMaxChildren) {
+    SplitNode(node_index, entry);
+    return;
+  }
+  Node &node = nodes_[node_index];
+  int i = node.count++;
+  node.SetChildBounds(i, entry.bounds);
+  node.child[i] = entry.child;
+  if (node.level > 0) nodes_[entry.child].parent = node_index;
+  UpdateBoundsInParent(node_index);
+}
+
+template <typename DataType, typename BoundsFunction>
+void PackedRTree<DataType, BoundsFunction>::SplitNode(int32_t node_index,
+                                                      const Entry &extra_entry) {
+  std::vector<Entry> entries;
+  entries.reserve(kMaxChildren + 1);
+  {
+    const Node &node = nodes_[node_index];
+    for (int i = 0; i < node.count; ++i)
+      entries.push_back(Entry{node.ChildBounds(i), node.child[i]});
+  }
+  entries.push_back(extra_entry);
+
+  // Split along the axis on which the children's centers are most spread out.
+  Rect center_bounds = Rect::CreateAtPoint(entries.front().bounds.Center());
+  for (const auto &entry : entries)
+    center_bounds.InplaceJoin(entry.bounds.Center());
+  bool split_x = center_bounds.Width() >= center_bounds.Height();
+  std::sort(entries.begin(), entries.end(),
+            [split_x](const Entry &lhs, const Entry &rhs) {
+              return split_x ? lhs.bounds.Center().x < rhs.bounds.Center().x
+                             : lhs.bounds.Center().y < rhs.bounds.Center().y;
+            });
+
+  int level = nodes_[node_index].level;
+  int32_t sibling_index = AllocateNode(level);
+  if (nodes_[node_index].parent < 0) {
+    // This is the root, so we add a new root above it, increasing the tree's
+    // height.
+    int32_t new_root = AllocateNode(level + 1);
+    Node &root = nodes_[new_root];
+    root.count = 1;
+    root.child[0] = node_index;
+    root.SetChildBounds(0, NodeBounds(node_index));
+    nodes_[node_index].parent = new_root;
+    root_ = new_root;
+  }
+
+  int n_entries = static_cast<int>(entries.size());
+  int n_left = n_entries / 2;
+  {
+    Node &node = nodes_[node_index];
+    for (int i = 0; i < kMaxChildren; ++i) node.ClearChild(i);
+    node.count = 0;
+    Node &sibling = nodes_[sibling_index];
+    for (int i = 0; i < n_entries; ++i) {
+      Node &target = i < n_left ? node : sibling;
+      int32_t target_index = i < n_left ? node_index : sibling_index;
+      int j = target.count++;
+      target.SetChildBounds(j, entries[i].bounds);
+      target.child[j] = entries[i].child;
+      if (level > 0) nodes_[entries[i].child].parent = target_index;
+    }
+  }
+
+  UpdateBoundsInParent(node_index);
+  AddEntry(nodes_[node_index].parent,
+           Entry{NodeBounds(sibling_index), sibling_index});
+}
+
+template <typename DataType, typename BoundsFunction>
+void PackedRTree<DataType, BoundsFunction>::RemoveFromLeaf(int32_t node_index,
+                                                           uint32_t mask) {
+  ASSERT(nodes_[node_index].level == 0);
+  const Node &node = nodes_[node_index];
+  for (int i = 0; i < node.count; ++i) {
+    if (mask & (1u << i)) {
+      free_data_.push_back(node.child[i]);
+      --size_;
+    }
+  }
+  RemoveChildren(node_index, mask);
+}
+
+template <typename DataType, typename BoundsFunction>
+void PackedRTree<DataType, BoundsFunction>::RemoveChildren(int32_t node_index,
+                                                           uint32_t mask) {
+  Node &node = nodes_[node_index];
+  int n_kept = 0;
+  for (int i = 0; i < node.count; ++i) {
+    if (mask & (1u << i)) continue;
+    if (n_kept != i) {
+      node.SetChildBounds(n_kept, node.ChildBounds(i));
+      node.child[n_kept] = node.child[i];
+    }
+    ++n_kept;
+  }
+  for (int i = n_kept; i < node.count; ++i) node.ClearChild(i);
+  node.count = n_kept;
+
+  if (n_kept == 0 && node.parent >= 0) {
+    // The node is empty, so we remove it from its parent.
+    int32_t parent_index = node.parent;
+    uint32_t parent_mask = 1u << IndexInParent(node_index);
+    FreeNode(node_index);
+    RemoveChildren(parent_index, parent_mask);
+  } else {
+    UpdateBoundsInParent(node_index);
+  }
+}
+
+template <typename DataType, typename BoundsFunction>
+void PackedRTree<DataType, BoundsFunction>::ShortenTree() {
+  while (nodes_[root_].level > 0 && nodes_[root_].count <= 1) {
+    int32_t old_root = root_;
+    if (nodes_[old_root].count == 0) {
+      root_ = AllocateNode(0);
+    } else {
+      root_ = nodes_[old_root].child[0];
+      nodes_[root_].parent = -1;
+    }
+    FreeNode(old_root);
+  }
+}
+
+template <typename DataType, typename BoundsFunction>
+std::vector<typename PackedRTree<DataType, BoundsFunction>::Entry>
+PackedRTree<DataType, BoundsFunction>::BulkLoadLevel(
+    std::vector<Entry> *entries, int level) {
+  auto compare_x = [](const Entry &lhs, const Entry &rhs) {
+    return lhs.bounds.from.x < rhs.bounds.from.x;
+  };
+  auto compare_y = [](const Entry &lhs, const Entry &rhs) {
+    return lhs.bounds.from.y < rhs.bounds.from.y;
+  };
+
+  std::sort(entries->begin(), entries->end(), compare_x);
+
+  // Divide the entries horizontally into slices, then divide each slice
+  // vertically into tiles of at most kMaxChildren entries.
+  int n_entries = entries->size();
+  int n_nodes = (n_entries + kMaxChildren - 1) / kMaxChildren;
+  int n_slices = std::ceil(std::sqrt(static_cast<float>(n_nodes)));
+  int entries_per_slice = (n_entries + n_slices - 1) / n_slices;
+
+  std::vector<Entry> parent_entries;
+  parent_entries.reserve(n_nodes + n_slices);
+  for (int slice_begin = 0; slice_begin < n_entries;
+       slice_begin += entries_per_slice) {
+    int slice_end = std::min(slice_begin + entries_per_slice, n_entries);
+    std::sort(entries->begin() + slice_begin, entries->begin() + slice_end,
+              compare_y);
+    for (int tile_begin = slice_begin; tile_begin < slice_end;
+         tile_begin += kMaxChildren) {
+      int tile_end = std::min(tile_begin + kMaxChildren, slice_end);
+      int32_t node_index = AllocateNode(level);
+      Node &node = nodes_[node_index];
+      for (int i = tile_begin; i < tile_end; ++i) {
+        const Entry &entry = (*entries)[i];
+        int j = node.count++;
+        node.SetChildBounds(j, entry.bounds);
+        node.child[j] = entry.child;
+        if (level > 0) nodes_[entry.child].parent = node_index;
+      }
+      parent_entries.push_back(Entry{NodeBounds(node_index), node_index});
+    }
+  }
+  return parent_entries;
+}
+
+}  // namespace spatial
+}  // namespace ink
+
+#endif  // INK_ENGINE_GEOMETRY_SPATIAL_PACKED_RTREE_H_
@@ -14,9 +14,13 @@
 
 #include "ink/engine/geometry/spatial/rtree.h"
 
+#include <cmath>
+#include <vector>
+
 #include "testing/base/public/benchmark.h"
 #include "third_party/glm/glm/glm.hpp"
 #include "ink/engine/geometry/primitives/rect.h"
+#include "ink/engine/geometry/spatial/packed_rtree.h"
 #include "ink/engine/util/funcs/rand_funcs.h"
 
 namespace ink {
@@ -26,6 +30,16 @@ namespace {
 Rect Bounds(glm::vec2 v) { return Rect::CreateAtPoint(v, 0, 0); }
 const Rect &Bounds(const Rect &r) { return r; }
 
+struct BoundsFunctor {
+  template <typename DataType>
+  Rect operator()(const DataType &d) const {
+    return Bounds(d);
+  }
+};
+
+template <typename DataType>
+using PackedTree = PackedRTree<DataType, BoundsFunctor>;
+
 void PopulateRandom(glm::vec2 *v) { *v = {Drand(-100, 100), Drand(-100, 100)}; }
 void PopulateRandom(Rect *r) {
   *r = Rect::CreateAtPoint({Drand(-100, 100), Drand(-100, 100)}, Drand(.1, 10),
@@ -51,6 +65,16 @@ void BM_BulkLoad(benchmark::State &state) {
 BENCHMARK_TEMPLATE(BM_BulkLoad, glm::vec2)->Range(8, 4096);
 BENCHMARK_TEMPLATE(BM_BulkLoad, Rect)->Range(8, 4096);
 
+template <typename DataType>
+void BM_PackedBulkLoad(benchmark::State &state) {
+  auto data = GenerateData<DataType>(state.range(0), 0);
+  for (auto _ : state) {
+    PackedTree<DataType>(data.begin(), data.end());
+  }
+}
+BENCHMARK_TEMPLATE(BM_PackedBulkLoad, glm::vec2)->Range(8, 4096);
+BENCHMARK_TEMPLATE(BM_PackedBulkLoad, Rect)->Range(8, 4096);
+
 template <typename DataType>
 void BM_Insert(benchmark::State &state) {
   auto data = GenerateData<DataType>(state.range(0), 0);
@@ -91,6 +115,59 @@ void BM_FindAll(benchmark::State &state) {
 BENCHMARK_TEMPLATE(BM_FindAll, glm::vec2)->Range(8, 4096);
 BENCHMARK_TEMPLATE(BM_FindAll, Rect)->Range(8, 4096);
 
+template <typename DataType>
+void BM_PackedFindAll(benchmark::State &state) {
+  auto data = GenerateData<DataType>(state.range(0), 0);
+  PackedTree<DataType> rtree(data.begin(), data.end());
+  std::vector<DataType> output;
+  output.reserve(state.range(0));
+  for (auto _ : state) {
+    output.clear();
+    rtree.FindAll({{-25, -25}, {75, 75}}, std::back_inserter(output));
+  }
+}
+BENCHMARK_TEMPLATE(BM_PackedFindAll, glm::vec2)->Range(8, 4096);
+BENCHMARK_TEMPLATE(BM_PackedFindAll, Rect)->Range(8, 4096);
+
+// The R-Tree intersection tests use two grids of small rects that are offset
+// from each other such that there are no intersections, forcing a full
+// traversal of both trees.
+const glm::mat4 kIntersectsTransform{1, 0, 0, 0, 0, 1, 0, 0,
+                                     0, 0, 1, 0, .5, .5, 0, 1};
+
+std::vector<Rect> GenerateGrid(int n_elements) {
+  std::vector<Rect> data;
+  data.reserve(n_elements);
+  int side = std::ceil(std::sqrt(n_elements));
+  for (int i = 0; i < n_elements; ++i)
+    data.emplace_back(Rect::CreateAtPoint(
+        {static_cast<float>(i % side), static_cast<float>(i / side)}, .4, .4));
+  return data;
+}
+
+void BM_Intersects(benchmark::State &state) {
+  auto data = GenerateGrid(state.range(0));
+  auto bounds_func = [](const Rect &r) { return r; };
+  RTree<Rect> rtree(data.begin(), data.end(), bounds_func);
+  RTree<Rect> other_rtree(data.begin(), data.end(), bounds_func);
+  for (auto _ : state) {
+    testing::DoNotOptimize(
+        rtree.Intersects(other_rtree, kIntersectsTransform));
+  }
+}
+BENCHMARK(BM_Intersects)->Range(8, 4096);
+
+void BM_PackedIntersects(benchmark::State &state) {
+  auto data = GenerateGrid(state.range(0));
+  PackedTree<Rect> rtree(data.begin(), data.end());
+  PackedTree<Rect> other_rtree(data.begin(), data.end());
+  for (auto _ : state) {
+    testing::DoNotOptimize(
+        rtree.Intersects(other_rtree, kIntersectsTransform));
+  }
+}
+BENCHMARK(BM_PackedIntersects)->Range(8, 4096);
+
 template <typename DataType>
 void BM_Remove(benchmark::State &state) {
   auto data = GenerateData<DataType>(state.range(0), 0);
@@ -23,6 +23,7 @@
 #include "ink/engine/geometry/algorithms/envelope.h"
 #include "ink/engine/geometry/mesh/mesh.h"
 #include "ink/engine/geometry/primitives/triangle.h"
+#include "ink/engine/geometry/spatial/packed_rtree.h"
 #include "ink/engine/geometry/spatial/rtree.h"
 
 namespace ink {
@@ -59,16 +60,45 @@ std::unique_ptr<RTree<DataType>> MakeRTreeFromMeshTriangles(
                                             bounds_function);
 }
 
+// As above, but creates a PackedRTree. The BoundsFunction is default
+// constructed.
+template <typename DataType, typename BoundsFunction>
+std::unique_ptr<PackedRTree<DataType, BoundsFunction>>
+MakePackedRTreeFromMeshTriangles(
+    const Mesh &mesh,
+    std::function<DataType(const Mesh &mesh, int triangle_index)> data_factory,
+    std::function<bool(const Mesh &mesh, int triangle_index)> triangle_filter =
+        nullptr) {
+  std::vector<DataType> data;
+  ASSERT(mesh.idx.size() % 3 == 0);
+  int n_triangles = mesh.NumberOfTriangles();
+  data.reserve(n_triangles);
+  for (int i = 0; i < n_triangles; ++i) {
+    if (!triangle_filter || triangle_filter(mesh, i))
+      data.emplace_back(data_factory(mesh, i));
+  }
+
+  return absl::make_unique<PackedRTree<DataType, BoundsFunction>>(data.begin(),
+                                                                  data.end());
+}
+
+struct TriangleEnvelope {
+  Rect operator()(const geometry::Triangle &t) const {
+    return geometry::Envelope(t);
+  }
+};
+
+// The R-Tree of triangles used by the mesh spatial indices.
+using TriangleRTree = PackedRTree<geometry::Triangle, TriangleEnvelope>;
+
 // This convenience overload creates an R-Tree containing geometry::Triangles.
-inline std::unique_ptr<RTree<geometry::Triangle>> MakeRTreeFromMeshTriangles(
+inline std::unique_ptr<TriangleRTree> MakeRTreeFromMeshTriangles(
     const Mesh &mesh) {
   using geometry::Triangle;
-  return MakeRTreeFromMeshTriangles<Triangle>(
-      mesh,
-      [](const Mesh &mesh, int triangle_index) {
+  return MakePackedRTreeFromMeshTriangles<Triangle, TriangleEnvelope>(
+      mesh, [](const Mesh &mesh, int triangle_index) {
         return mesh.GetTriangle(triangle_index);
-      },
-      [](const Triangle &t) { return geometry::Envelope(t); });
+      });
 }
 
 }  // namespace spatial
@@ -0,0 +1,114 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/scene/graph/scene_spatial_index.h"
+
+#include <memory>
+#include <vector>
+
+#include "testing/base/public/benchmark.h"
+#include "third_party/absl/memory/memory.h"
+#include "third_party/glm/glm/glm.hpp"
+#include "ink/engine/geometry/mesh/mesh.h"
+#include "ink/engine/geometry/mesh/shape_helpers.h"
+#include "ink/engine/geometry/primitives/rect.h"
+#include "ink/engine/geometry/spatial/mesh_rtree.h"
+#include "ink/engine/scene/types/element_id.h"
+#include "ink/engine/scene/types/element_index.h"
+#include "ink/engine/util/funcs/rand_funcs.h"
+
+namespace ink {
+namespace spatial {
+namespace {
+
+using benchmark::State;
+
+// A flat scene of small, randomly placed strokes, mirroring the data that the
+// SceneGraph keeps for each element in the root group.
+struct FlatScene {
+  ElementIndex<ElementId, ElementIdHasher> z_index;
+  ElementIdHashMap<std::unique_ptr<MeshRTree>> element_id_to_bounds;
+  SceneSpatialIndex scene_index;
+};
+
+std::unique_ptr<FlatScene> MakeFlatScene(int n_elements) {
+  Seed_random(0);
+  auto scene = absl::make_unique<FlatScene>();
+  ElementIdSource id_source(1);
+  for (int i = 0; i < n_elements; ++i) {
+    ElementId id = id_source.CreatePolyId();
+    Mesh mesh;
+    MakeRectangleMesh(
+        &mesh, Rect::CreateAtPoint({Drand(-1000, 1000), Drand(-1000, 1000)},
+                                   Drand(1, 20), Drand(1, 20)));
+    auto index = absl::make_unique<MeshRTree>(mesh);
+    scene->scene_index.Set(id, kInvalidElementId, index->Mbr(glm::mat4{1}));
+    scene->element_id_to_bounds[id] = std::move(index);
+    scene->z_index.AddToTop(id);
+  }
+  return scene;
+}
+
+// An eraser-sized query in the middle of the scene.
+const Rect kQueryRegion(-25, -25, 25, 25);
+
+static void BM_ElementsInRegionLinearWalk(State &state) {
+  auto scene = MakeFlatScene(state.range(0));
+  std::vector<ElementId> result;
+  while (state.KeepRunning()) {
+    result.clear();
+    for (auto id : scene->z_index.SortedElements()) {
+      if (scene->element_id_to_bounds[id]->Intersects(kQueryRegion,
+                                                      glm::mat4{1}))
+        result.push_back(id);
+    }
+  }
+}
+BENCHMARK(BM_ElementsInRegionLinearWalk)->Range(1024, 65536);
+
+static void BM_ElementsInRegionSceneSpatialIndex(State &state) {
+  auto scene = MakeFlatScene(state.range(0));
+  std::vector<ElementId> candidates;
+  std::vector<ElementId> result;
+  while (state.KeepRunning()) {
+    candidates.clear();
+    result.clear();
+    scene->scene_index.FindCandidates(kInvalidElementId, kQueryRegion,
+                                      std::back_inserter(candidates));
+    scene->z_index.Sort(candidates.begin(), candidates.end());
+    for (auto id : candidates) {
+      if (scene->element_id_to_bounds[id]->Intersects(kQueryRegion,
+                                                      glm::mat4{1}))
+        result.push_back(id);
+    }
+  }
+}
+BENCHMARK(BM_ElementsInRegionSceneSpatialIndex)->Range(1024, 65536);
+
+// Measures keeping the index in sync while an element is dragged around.
+static void BM_SceneSpatialIndexTransformElement(State &state) {
+  auto scene = MakeFlatScene(state.range(0));
+  ElementId id = *scene->z_index.SortedElements().begin();
+  Rect mbr = scene->element_id_to_bounds[id]->Mbr(glm::mat4{1});
+  float offset = 0;
+  while (state.KeepRunning()) {
+    offset = offset > 100 ? 0 : offset + 1;
+    scene->scene_index.Set(id, kInvalidElementId, mbr + offset);
+  }
+}
+BENCHMARK(BM_SceneSpatialIndexTransformElement)->Range(1024, 65536);
+
+}  // namespace
+}  // namespace spatial
+}  // namespace ink
@@ -22,7 +22,7 @@
 #include "ink/engine/geometry/mesh/mesh.h"
 #include "ink/engine/geometry/primitives/rect.h"
 #include "ink/engine/geometry/primitives/triangle.h"
-#include "ink/engine/geometry/spatial/rtree.h"
+#include "ink/engine/geometry/spatial/rtree_utils.h"
 #include "ink/engine/util/funcs/utils.h"
 
 namespace ink {
@@ -76,7 +76,7 @@ class SpatialIndex {
   // triangles. In the future, a subclass may have a different type. We
   // should add an accessor for the raw RTree here and use it in the
   // IntersectsSpatialIndex implementation.
-  virtual const RTree<geometry::Triangle>* const GetTriRTree() const = 0;
+  virtual const TriangleRTree* const GetTriRTree() const = 0;
 };
 
 }  // namespace spatial
@@ -29,6 +29,7 @@
 #include "ink/engine/geometry/spatial/sticker_spatial_index_factory.h"
 #include "ink/engine/geometry/tess/tessellator.h"
 #include "ink/engine/processing/marching_squares.h"
+#include "ink/engine/processing/runner/parallel_for.h"
 #include "ink/engine/processing/runner/task_runner.h"
 #include "ink/engine/rendering/baseGL/gpupixels.h"
 #include "ink/engine/rendering/gl_managers/texture.h"
@@ -67,11 +68,14 @@ void TextureRTreeCreator::Execute() {
   // The pixels are ABGR.
   MarchingSquares<ColorEqualPredicate> marching_squares(
       ColorEqualPredicate(0xFF000000), &processed_pixels);
+  // This task doesn't execute in parallel with others, so it has the task
+  // runner to itself, and can spread its work across the hardware threads.
+  const int max_threads = HardwareThreads();
   std::vector<std::vector<ivec2>> boundaries =
-      marching_squares.TraceAllBoundaries();
+      marching_squares.TraceAllBoundariesPacked(max_threads);
 
   std::vector<std::vector<Vertex>> vertices(boundaries.size());
-  for (int i = 0; i < boundaries.size(); ++i) {
+  ParallelFor(static_cast<int>(boundaries.size()), max_threads, [&](int i) {
     // Add the first point to the back of the boundary, or the simplification
     // won't consider the last point for removal.
     boundaries[i].push_back(boundaries[i].front());
@@ -83,7 +87,7 @@ void TextureRTreeCreator::Execute() {
     for (const auto& point : simplified) {
       vertices[i].emplace_back(point.x, dim.y - point.y);
     }
-  }
+  });
 
   Tessellator tessellator;
   if (tessellator.Tessellate(vertices)) {
@@ -36,6 +36,8 @@ class TextureRTreeCreator : public Task {
 
   bool RequiresPreExecute() const override { return false; }
   void PreExecute() override {}
+  // Traces and simplifies the texture's boundaries on up to HardwareThreads()
+  // threads, so this is not marked CanExecuteInParallel().
   void Execute() override;
   void OnPostExecute() override;
 
@@ -50,25 +50,26 @@ inline float Angle(const MeshTriSegment& s1, const MeshTriSegment& s2,
   // assert segments are connected, and in order
   // (assert is too slow) ASSERT(s1.idx[1] == s2.idx[0]);
 
-  auto& v1 = mesh->verts[s1.idx[0]].position;
-  auto& v2 = mesh->verts[s1.idx[1]].position;
-  auto& v3 = mesh->verts[s2.idx[1]].position;
+  auto& v1 = mesh->verts.Positions()[s1.idx[0]];
+  auto& v2 = mesh->verts.Positions()[s1.idx[1]];
+  auto& v3 = mesh->verts.Positions()[s2.idx[1]];
   auto outerang = TurnAngle(v1, v2, v3);
   return NormalizeAngle(M_PI - outerang);
 }
 
 inline float Angle(const MeshTriVert& v1, const MeshTriVert& v2,
                    const MeshTriVert& v3, const Mesh* mesh) {
-  auto outerang = TurnAngle(mesh->verts[v1.tri->idx[v1.interior_idx]].position,
-                            mesh->verts[v2.tri->idx[v2.interior_idx]].position,
-                            mesh->verts[v3.tri->idx[v3.interior_idx]].position);
+  const auto& positions = mesh->verts.Positions();
+  auto outerang = TurnAngle(positions[v1.tri->idx[v1.interior_idx]],
+                            positions[v2.tri->idx[v2.interior_idx]],
+                            positions[v3.tri->idx[v3.interior_idx]]);
   return NormalizeAngle(M_PI - outerang);
 }
 
 inline bool IsCCW(const MeshTriangle* tri, const Mesh* mesh) {
-  auto v1 = mesh->verts[tri->idx[0]].position;
-  auto v2 = mesh->verts[tri->idx[1]].position;
-  auto v3 = mesh->verts[tri->idx[2]].position;
+  auto v1 = mesh->verts.Positions()[tri->idx[0]];
+  auto v2 = mesh->verts.Positions()[tri->idx[1]];
+  auto v3 = mesh->verts.Positions()[tri->idx[2]];
 
   //    (xi - xi-1) * (yi+1 - yi) - (yi - yi-1) * (xi+1 - xi)
   auto x = (v2.x - v1.x) * (v3.y - v2.y) - (v2.y - v1.y) * (v3.x - v2.x);
@@ -128,23 +129,23 @@ bool CDR::ShouldFlip(MeshTetrahedron trh) { return ShouldFlip_Circle(trh); }
 
 bool CDR::ShouldFlip_Circle(MeshTetrahedron trh) {
   auto tri = trh.t1;
-  auto p1 = mesh_->verts[tri->idx[0]].position;
-  auto p2 = mesh_->verts[tri->idx[1]].position;
-  auto p3 = mesh_->verts[tri->idx[2]].position;
+  auto p1 = mesh_->verts.Positions()[tri->idx[0]];
+  auto p2 = mesh_->verts.Positions()[tri->idx[1]];
+  auto p3 = mesh_->verts.Positions()[tri->idx[2]];
 
   // likely suboptimal way of getting p4...
   glm::vec2 p4{0, 0};
   MeshTriVert tv(trh.t2, 0);
   if (!trh.IsShared(tv)) {
-    p4 = mesh_->verts[tv.Idx()].position;
+    p4 = mesh_->verts.Positions()[tv.Idx()];
   } else {
     tv = tv.Advance();
     if (!trh.IsShared(tv)) {
-      p4 = mesh_->verts[tv.Idx()].position;
+      p4 = mesh_->verts.Positions()[tv.Idx()];
     } else {
       tv = tv.Advance();
       if (!trh.IsShared(tv)) {
-        p4 = mesh_->verts[tv.Idx()].position;
+        p4 = mesh_->verts.Positions()[tv.Idx()];
       } else {
         EXPECT(false);
       }
@@ -68,10 +68,12 @@ void ColorLinearizer::LinearizeAllVerts() {
 void ColorLinearizer::Pass(std::vector<Mesh::IndexType>::iterator from,
                            std::vector<Mesh::IndexType>::iterator to,
                            float amt) {
+  const std::vector<glm::vec2>& positions = mesh_->verts.Positions();
+  std::vector<glm::vec4>& colors = *mesh_->verts.MutableColors();
   for (auto ai = from; ai != to; ai++) {
     ASSERT(*ai < mesh_->verts.size());
-    auto& pt = mesh_->verts[*ai];
-    auto ohsv = RGBtoHSV(pt.color);
+    auto& color = colors[*ai];
+    auto ohsv = RGBtoHSV(color);
     auto rng = pttoseg_.equal_range(*ai);
     if (rng.first == rng.second) continue;
 
@@ -79,9 +81,9 @@ void ColorLinearizer::Pass(std::vector<Mesh::IndexType>::iterator from,
     std::vector<glm::vec4> colors_hsv;
     for (auto aj = rng.first; aj != rng.second; aj++) {
       ASSERT(aj->second < mesh_->verts.size());
-      auto nbr = mesh_->verts[aj->second];
-      weights.push_back(geometry::Distance(pt.position, nbr.position));
-      colors_hsv.push_back(RGBtoHSV(nbr.color));
+      weights.push_back(
+          geometry::Distance(positions[*ai], positions[aj->second]));
+      colors_hsv.push_back(RGBtoHSV(colors[aj->second]));
     }
 
     // normalize weights
@@ -94,7 +96,7 @@ void ColorLinearizer::Pass(std::vector<Mesh::IndexType>::iterator from,
       nhsv += (colors_hsv[i] * weights[i]);
     }
     nhsv = nhsv * amt + ohsv * (1.0f - amt);
-    pt.color = HSVtoRGB(nhsv);
+    color = HSVtoRGB(nhsv);
   }
 }
 }  // namespace ink
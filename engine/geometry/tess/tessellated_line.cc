@@ -14,11 +14,34 @@
 
 #include "ink/engine/geometry/tess/tessellated_line.h"
 
+#include <algorithm>
+#include <limits>
+
+#include "ink/engine/geometry/algorithms/envelope.h"
+#include "ink/engine/geometry/algorithms/intersect.h"
+#include "ink/engine/geometry/primitives/vector_utils.h"
 #include "ink/engine/geometry/tess/cdrefinement.h"
 #include "ink/engine/geometry/tess/color_linearizer.h"
 #include "ink/engine/rendering/gl_managers/mesh_vbo_provider.h"
 
 namespace ink {
+namespace {
+
+// FatLine::Simplify() may modify the last 15 vertices of each side of the line
+// after every extrusion, so we don't cache a section until its end rung is at
+// least this far from the end of the line.
+constexpr size_t kRungStabilityLag = 16;
+
+// The minimum number of forward and backward vertices in a cached section.
+// Smaller sections have less tessellation overhead, but make the overlap checks
+// more expensive.
+constexpr size_t kMinSectionVertices = 32;
+
+// How far a rung's vertices may be shifted by the removal of the vertices
+// before them, before we give up on finding them.
+constexpr size_t kMaxRungShift = 64;
+
+}  // namespace
 
 void TessellatedLine::SetupNewLine(float min_screen_travel_threshold,
                                    TipType tip_type,
@@ -54,6 +77,22 @@ OptRect TessellatedLine::Extrude(glm::vec2 new_pt, InputTimeS time,
   line_.SetTurnVerts(n_turn_verts);
   OptRect new_region = line_.Extrude(new_pt, time, force);
   mesh_dirty_ = mesh_dirty_ || new_region.has_value();
+
+  if (new_region.has_value()) {
+    if (line_.MidPoints().size() <= 2) {
+      // The line has either just started, or has been pruned by the tip model,
+      // so any existing rungs or cached sections are no longer valid.
+      rungs_.clear();
+      ClearCachedSections();
+      has_overlapping_sections_ = false;
+    }
+    const auto& fwd = line_.ForwardLine();
+    const auto& back = line_.BackwardLine();
+    if (UsesIncrementalTessellation() && !fwd.empty() && !back.empty()) {
+      rungs_.push_back(Rung{fwd.size() - 1, back.size() - 1,
+                            fwd.back().position, back.back().position});
+    }
+  }
   return new_region;
 }
 
@@ -68,6 +107,16 @@ void TessellatedLine::ClearVertices() {
   mesh_dirty_ = false;
   has_end_cap_ = false;
   line_.ClearVertices();
+  rungs_.clear();
+  ClearCachedSections();
+  has_overlapping_sections_ = false;
+}
+
+void TessellatedLine::SetIncrementalTessellation(bool enabled) {
+  incremental_tessellation_ = enabled;
+  rungs_.clear();
+  ClearCachedSections();
+  mesh_dirty_ = true;
 }
 
 const Mesh& TessellatedLine::GetMesh() const {
@@ -75,26 +124,223 @@ const Mesh& TessellatedLine::GetMesh() const {
     return tessellator_.mesh_;
   }
 
-  tessellator_.ClearGeometry();
-  if (tessellator_.Tessellate(line_, has_end_cap_) && tessellator_.HasMesh()) {
-    if (params_.refine_mesh) {
-      auto cdr = CDR(&tessellator_.mesh_);
-      cdr.RefineMesh();
-      auto clr = ColorLinearizer(&tessellator_.mesh_);
-      if (params_.linearize_combined_verts) {
-        clr.LinearizeCombinedVerts();
-      }
-      if (params_.linearize_mesh_verts) {
-        clr.LinearizeAllVerts();
-      }
+  bool success;
+  if (UsesIncrementalTessellation()) {
+    success = TessellateIncrementally();
+  } else {
+    rungs_.clear();
+    ClearCachedSections();
+    success = TessellateFully();
+  }
+
+  if (success && tessellator_.HasMesh()) {
+    if (gl_resources_) {
+      gl_resources_->mesh_vbo_provider->ReplaceVBOs(&tessellator_.mesh_,
+                                                    GL_DYNAMIC_DRAW);
     }
-    gl_resources_->mesh_vbo_provider->ReplaceVBOs(&tessellator_.mesh_,
-                                                  GL_DYNAMIC_DRAW);
   } else {
     tessellator_.mesh_.Clear();
+    ClearCachedSections();
   }
   mesh_dirty_ = false;
   return tessellator_.mesh_;
 }
 
+bool TessellatedLine::TessellateFully() const {
+  tessellator_.ClearGeometry();
+  if (!tessellator_.Tessellate(line_, has_end_cap_) || !tessellator_.HasMesh())
+    return false;
+
+  if (params_.refine_mesh) {
+    auto cdr = CDR(&tessellator_.mesh_);
+    cdr.RefineMesh();
+    auto clr = ColorLinearizer(&tessellator_.mesh_);
+    if (params_.linearize_combined_verts) {
+      clr.LinearizeCombinedVerts();
+    }
+    if (params_.linearize_mesh_verts) {
+      clr.LinearizeAllVerts();
+    }
+  }
+  return true;
+}
+
+bool TessellatedLine::TessellateIncrementally() const {
+  const auto& fwd = line_.ForwardLine();
+  const auto& back = line_.BackwardLine();
+
+  if (!CachedSectionsAreValid()) ClearCachedSections();
+
+  // Discard the tessellation of the uncached part of the line from the last
+  // call.
+  Mesh& mesh = tessellator_.mesh_;
+  mesh.verts.resize(n_cached_verts_);
+  mesh.idx.resize(n_cached_indices_);
+  mesh.combined_idx.resize(n_cached_combined_verts_);
+
+  size_t fwd_begin = sections_.empty() ? 0 : sections_.back().end.fwd_index;
+  size_t back_begin = sections_.empty() ? 0 : sections_.back().end.back_index;
+
+  // Cache any sections that can no longer be modified. The rungs before
+  // next_rung are dropped below, whether or not they ended a section: the
+  // following sections only begin at the last section's end rung, which is kept
+  // in sections_.
+  size_t next_rung = 0;
+  for (; next_rung < rungs_.size(); ++next_rung) {
+    Rung& rung = rungs_[next_rung];
+    if (!LocateRung(&rung)) continue;
+    if (rung.fwd_index + kRungStabilityLag >= fwd.size() ||
+        rung.back_index + kRungStabilityLag >= back.size())
+      break;
+    if (rung.fwd_index < fwd_begin || rung.back_index < back_begin ||
+        (rung.fwd_index - fwd_begin) + (rung.back_index - back_begin) <
+            kMinSectionVertices)
+      continue;
+
+    std::vector<Vertex> outline = SectionOutline(
+        fwd_begin, rung.fwd_index + 1, back_begin, rung.back_index + 1, false);
+    if (OverlapsCachedSections(outline)) {
+      has_overlapping_sections_ = true;
+      ClearCachedSections();
+      return TessellateFully();
+    }
+    if (!AppendTessellation(outline)) return false;
+
+    TessellatedSection section;
+    section.end = rung;
+    section.envelope = geometry::Envelope(outline);
+    section.min_side_of_end = std::numeric_limits<float>::infinity();
+    section.max_side_of_end = -std::numeric_limits<float>::infinity();
+    glm::vec2 rung_vector = rung.back_position - rung.fwd_position;
+    for (const auto& v : outline) {
+      float side = Determinant(rung_vector, v.position - rung.fwd_position);
+      section.min_side_of_end = std::min(section.min_side_of_end, side);
+      section.max_side_of_end = std::max(section.max_side_of_end, side);
+    }
+    sections_.push_back(section);
+    n_cached_verts_ = mesh.verts.size();
+    n_cached_indices_ = mesh.idx.size();
+    n_cached_combined_verts_ = mesh.combined_idx.size();
+    fwd_begin = rung.fwd_index;
+    back_begin = rung.back_index;
+  }
+  rungs_.erase(rungs_.begin(), rungs_.begin() + next_rung);
+
+  std::vector<Vertex> outline = SectionOutline(fwd_begin, fwd.size(),
+                                               back_begin, back.size(),
+                                               has_end_cap_);
+  if (OverlapsCachedSections(outline)) {
+    has_overlapping_sections_ = true;
+    ClearCachedSections();
+    return TessellateFully();
+  }
+  return AppendTessellation(outline);
+}
+
+bool TessellatedLine::CachedSectionsAreValid() const {
+  if (sections_.empty()) return true;
+  const Rung& rung = sections_.back().end;
+  const auto& fwd = line_.ForwardLine();
+  const auto& back = line_.BackwardLine();
+  // FatLine::Simplify() only ever removes vertices, so if any vertex before the
+  // rung had been removed, the rung's vertices would have been shifted.
+  return rung.fwd_index < fwd.size() && rung.back_index < back.size() &&
+         fwd[rung.fwd_index].position == rung.fwd_position &&
+         back[rung.back_index].position == rung.back_position;
+}
+
+bool TessellatedLine::LocateRung(Rung* rung) const {
+  auto locate = [](const std::vector<Vertex>& side, glm::vec2 position,
+                   size_t* index) {
+    if (side.empty()) return false;
+    size_t start = std::min(*index, side.size() - 1);
+    size_t end = start > kMaxRungShift ? start - kMaxRungShift : 0;
+    for (size_t i = start + 1; i-- > end;) {
+      if (side[i].position == position) {
+        *index = i;
+        return true;
+      }
+    }
+    return false;
+  };
+  return locate(line_.ForwardLine(), rung->fwd_position, &rung->fwd_index) &&
+         locate(line_.BackwardLine(), rung->back_position, &rung->back_index);
+}
+
+std::vector<Vertex> TessellatedLine::SectionOutline(size_t fwd_begin,
+                                                    size_t fwd_end,
+                                                    size_t back_begin,
+                                                    size_t back_end,
+                                                    bool end_cap) const {
+  const auto& fwd = line_.ForwardLine();
+  const auto& back = line_.BackwardLine();
+  const auto& start_cap = line_.StartCap();
+  const auto& end_cap_verts = line_.EndCap();
+
+  // This follows the same order as Tessellator::Tessellate(const FatLine&,
+  // bool).
+  std::vector<Vertex> outline;
+  outline.reserve((fwd_end - fwd_begin) + (back_end - back_begin) +
+                  (sections_.empty() ? start_cap.size() : 0) +
+                  (end_cap ? end_cap_verts.size() : 0));
+  if (sections_.empty())
+    outline.insert(outline.end(), start_cap.begin(), start_cap.end());
+  outline.insert(outline.end(), fwd.begin() + fwd_begin, fwd.begin() + fwd_end);
+  if (end_cap)
+    outline.insert(outline.end(), end_cap_verts.begin(), end_cap_verts.end());
+  outline.insert(outline.end(), back.rbegin() + (back.size() - back_end),
+                 back.rbegin() + (back.size() - back_begin));
+  return outline;
+}
+
+bool TessellatedLine::OverlapsCachedSections(
+    const std::vector<Vertex>& outline) const {
+  if (sections_.empty() || outline.empty()) return false;
+
+  // Sections other than the last one don't share any vertices with the new
+  // outline, so we can check their envelopes.
+  Rect envelope = geometry::Envelope(outline);
+  for (size_t i = 0; i + 1 < sections_.size(); ++i) {
+    if (geometry::Intersects(envelope, sections_[i].envelope)) return true;
+  }
+
+  // The last section shares its end rung with the new outline, so their
+  // envelopes will always intersect. Instead, we check that they lie on
+  // opposite sides of the rung.
+  const TessellatedSection& last = sections_.back();
+  glm::vec2 rung_vector = last.end.back_position - last.end.fwd_position;
+  float min_side = std::numeric_limits<float>::infinity();
+  float max_side = -std::numeric_limits<float>::infinity();
+  for (const auto& v : outline) {
+    float side = Determinant(rung_vector, v.position - last.end.fwd_position);
+    min_side = std::min(min_side, side);
+    max_side = std::max(max_side, side);
+  }
+  bool is_separated = (last.max_side_of_end <= 0 && min_side >= 0) ||
+                      (last.min_side_of_end >= 0 && max_side <= 0);
+  return !is_separated;
+}
+
+bool TessellatedLine::AppendTessellation(
+    const std::vector<Vertex>& outline) const {
+  section_tessellator_.ClearGeometry();
+  if (!section_tessellator_.Tessellate(outline)) return false;
+
+  Mesh& mesh = tessellator_.mesh_;
+  const Mesh& section_mesh = section_tessellator_.mesh_;
+  Mesh::IndexType offset = mesh.verts.size();
+  mesh.verts.Append(section_mesh.verts);
+  for (auto i : section_mesh.idx) mesh.idx.push_back(i + offset);
+  for (auto i : section_mesh.combined_idx)
+    mesh.combined_idx.push_back(i + offset);
+  return true;
+}
+
+void TessellatedLine::ClearCachedSections() const {
+  sections_.clear();
+  n_cached_verts_ = 0;
+  n_cached_indices_ = 0;
+  n_cached_combined_verts_ = 0;
+}
+
 }  // namespace ink
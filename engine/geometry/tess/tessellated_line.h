@@ -17,12 +17,15 @@
 #ifndef INK_ENGINE_GEOMETRY_TESS_TESSELLATED_LINE_H_
 #define INK_ENGINE_GEOMETRY_TESS_TESSELLATED_LINE_H_
 
+#include <cstddef>
 #include <utility>
+#include <vector>
 
 #include "third_party/absl/types/optional.h"
 #include "third_party/glm/glm/glm.hpp"
 #include "ink/engine/geometry/line/fat_line.h"
 #include "ink/engine/geometry/mesh/mesh.h"
+#include "ink/engine/geometry/primitives/rect.h"
 #include "ink/engine/geometry/tess/tessellator.h"
 #include "ink/engine/realtime/modifiers/line_modifier.h"
 #include "ink/engine/rendering/gl_managers/gl_resource_manager.h"
@@ -30,9 +33,20 @@
 namespace ink {
 
 // A FatLine that is tessellated to create a mesh.
+//
+// If incremental tessellation is enabled (see SetIncrementalTessellation()),
+// the outline is split into sections at "rungs" (pairs of forward and backward
+// vertices that were added by the same Extrude() call), and once a section can
+// no longer be modified by FatLine's simplification, its tessellation is
+// cached. GetMesh() then only needs to tessellate the part of the line after
+// the last cached section. If a new section might overlap the cached geometry
+// (e.g. the stroke crosses itself), the whole line is re-tessellated for the
+// rest of the stroke, as the union of the separately tessellated sections would
+// otherwise contain overlapping triangles.
 class TessellatedLine {
  public:
-  // Creates a new TessellatedLine getting services from gl_resources.
+  // Creates a new TessellatedLine getting services from gl_resources. If
+  // gl_resources is null, the mesh will not be uploaded to the GPU.
   explicit TessellatedLine(std::shared_ptr<GLResourceManager> gl_resources)
       : gl_resources_(std::move(gl_resources)) {}
 
@@ -90,13 +104,102 @@ class TessellatedLine {
   // Returns a reference to the underlying FatLine.
   const FatLine& Line() const { return line_; }
 
+  // Enables or disables incremental tessellation (see above). This is disabled
+  // by default. Note that incremental tessellation is never used if the line
+  // modifier parameters require mesh refinement, as that operates on the whole
+  // mesh.
+  void SetIncrementalTessellation(bool enabled);
+
  private:
+  // A pair of vertices, one from each side of the line, that were the last
+  // vertices added by an Extrude() call. The segment between them spans the
+  // stroke, making it a safe place to split the outline.
+  struct Rung {
+    size_t fwd_index;
+    size_t back_index;
+    glm::vec2 fwd_position;
+    glm::vec2 back_position;
+  };
+
+  // A section of the line whose tessellation is cached, ending at the given
+  // rung. The first section begins with the start cap; each subsequent section
+  // begins at the end rung of the section before it.
+  struct TessellatedSection {
+    Rung end;
+    Rect envelope;
+    // The range of the signed distances (scaled by the rung's length) of the
+    // section's outline vertices from the line through the end rung. This is
+    // used to check that the next section lies on the other side of the rung.
+    float min_side_of_end;
+    float max_side_of_end;
+  };
+
+  // Returns true if GetMesh() will use TessellateIncrementally(), i.e. if rungs
+  // need to be recorded.
+  bool UsesIncrementalTessellation() const {
+    return incremental_tessellation_ && !params_.refine_mesh &&
+           !has_overlapping_sections_;
+  }
+
+  // Re-tessellates the whole line into tessellator_.mesh_, refining it if
+  // requested by the line modifier parameters. Returns false if the
+  // tessellation failed.
+  bool TessellateFully() const;
+
+  // Tessellates any newly stable sections and the remainder of the line,
+  // appending them to the cached sections in tessellator_.mesh_. Falls back to
+  // TessellateFully() if the cache cannot be used. Returns false if the
+  // tessellation failed.
+  bool TessellateIncrementally() const;
+
+  // Returns true if the end rung of the last cached section is still where it
+  // was, i.e. the vertices before it have not been modified.
+  bool CachedSectionsAreValid() const;
+
+  // Updates the rung's indices to account for vertices that have been removed
+  // before it by FatLine's simplification. Returns false if either of the
+  // rung's vertices can no longer be found.
+  bool LocateRung(Rung* rung) const;
+
+  // Returns the outline of the part of the line between the given indices
+  // (half-open ranges) of the forward and backward lines, beginning with the
+  // start cap if there are no cached sections, and ending with the end cap if
+  // end_cap is true.
+  std::vector<Vertex> SectionOutline(size_t fwd_begin, size_t fwd_end,
+                                     size_t back_begin, size_t back_end,
+                                     bool end_cap) const;
+
+  // Returns true if the outline may overlap the cached sections. This is
+  // conservative: it may return true for outlines that don't overlap.
+  bool OverlapsCachedSections(const std::vector<Vertex>& outline) const;
+
+  // Tessellates the outline, and appends the result to tessellator_.mesh_.
+  // Returns false if the tessellation failed.
+  bool AppendTessellation(const std::vector<Vertex>& outline) const;
+
+  // Discards the cached sections. This does not modify tessellator_.mesh_.
+  void ClearCachedSections() const;
+
   std::shared_ptr<GLResourceManager> gl_resources_;
 
   // These are mutable so that the line can be tessellated lazily.
   mutable Tessellator tessellator_;
   mutable bool mesh_dirty_ = false;
 
+  // Incremental tessellation state. tessellator_.mesh_ begins with the
+  // n_cached_* vertices and indices of the cached sections, followed by the
+  // tessellation of the rest of the line. rungs_ only holds the rungs after
+  // the end of the last cached section; earlier ones are dropped once they have
+  // been visited, so that it doesn't grow with the length of the stroke.
+  bool incremental_tessellation_ = false;
+  mutable Tessellator section_tessellator_;
+  mutable bool has_overlapping_sections_ = false;
+  mutable std::vector<Rung> rungs_;
+  mutable std::vector<TessellatedSection> sections_;
+  mutable size_t n_cached_verts_ = 0;
+  mutable size_t n_cached_indices_ = 0;
+  mutable size_t n_cached_combined_verts_ = 0;
+
   bool has_end_cap_ = false;
   FatLine line_;
   LineModParams params_;
@@ -0,0 +1,59 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/geometry/tess/tessellated_line.h"
+
+#include <cmath>
+
+#include "testing/base/public/benchmark.h"
+#include "third_party/glm/glm/glm.hpp"
+#include "ink/engine/brushes/size/tip_size_screen.h"
+#include "ink/engine/geometry/line/tip_type.h"
+#include "ink/engine/input/stylus_state_modeler.h"
+#include "ink/engine/realtime/modifiers/line_modifier.h"
+
+namespace ink {
+namespace {
+
+constexpr int kStrokeLength = 5000;
+
+// A gently curving stroke that never crosses itself.
+glm::vec2 StrokePoint(int i) {
+  return glm::vec2(2 * i, 50 * std::sin(.02 * i));
+}
+
+// Measures the cost of each Extrude() of a 5,000 point stroke, including
+// re-tessellating the mesh as would happen every frame. The argument selects
+// whether incremental tessellation is enabled.
+static void BM_ExtrudeLongStroke(benchmark::State &state) {
+  TessellatedLine line(nullptr);
+  line.SetIncrementalTessellation(state.range(0) != 0);
+  int i = kStrokeLength;
+  while (state.KeepRunning()) {
+    if (i == kStrokeLength) {
+      state.PauseTiming();
+      line.SetupNewLine(0, TipType::Round, nullptr, LineModParams());
+      i = 0;
+      state.ResumeTiming();
+    }
+    line.Extrude(StrokePoint(i), InputTimeS(.01 * i), TipSizeScreen{10, 10},
+                 input::kStylusStateUnknown, 10, false);
+    line.GetMesh();
+    ++i;
+  }
+}
+BENCHMARK(BM_ExtrudeLongStroke)->Arg(0)->Arg(1);
+
+}  // namespace
+}  // namespace ink
@@ -23,6 +23,7 @@
 #include "ink/engine/util/dbg/errors.h"
 #include "ink/engine/util/dbg/log.h"
 #include "ink/engine/util/dbg/log_levels.h"
+#include "ink/engine/util/dbg/trace.h"
 
 namespace ink {
 namespace {
@@ -146,6 +147,7 @@ void Tessellator::Inject(const T from, const T to) {
 }
 
 bool Tessellator::Tessellate(const FatLine& line, bool end_cap) {
+  INK_TRACE_EVENT("geometry", "Tessellator::Tessellate");
   did_error_ = false;
   gluTessBeginPolygon(glu_tess_, this);
   gluTessBeginContour(glu_tess_);
@@ -161,6 +163,7 @@ bool Tessellator::Tessellate(const FatLine& line, bool end_cap) {
 }
 
 bool Tessellator::Tessellate(const std::vector<Vertex>& pts) {
+  INK_TRACE_EVENT("geometry", "Tessellator::Tessellate");
   did_error_ = false;
   gluTessBeginPolygon(glu_tess_, this);
   gluTessBeginContour(glu_tess_);
@@ -180,6 +183,7 @@ void Tessellator::ClearGeometry() {
 }
 
 bool Tessellator::Tessellate(const std::vector<std::vector<Vertex>>& edges) {
+  INK_TRACE_EVENT("geometry", "Tessellator::Tessellate");
   did_error_ = false;
   gluTessProperty(glu_tess_, GLU_TESS_WINDING_RULE, GLU_TESS_WINDING_ODD);
   gluTessBeginPolygon(glu_tess_, this);
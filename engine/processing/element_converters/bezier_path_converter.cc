@@ -391,12 +391,11 @@ unique_ptr<ProcessedElement> BuildFill(
   mesh.object_matrix = bezier.Transform();
   glm::vec4 color = UintToVec4RGBA(path.fill_rgba());
   glm::vec4 premultiplied = RGBtoRGBPremultiplied(color);
-  for (size_t i = 0; i < mesh.verts.size(); ++i) {
-    mesh.verts[i].color = premultiplied;
-  }
+  for (glm::vec4& c : *mesh.verts.MutableColors()) c = premultiplied;
   if (!mesh.verts.empty()) {
     SLOG(SLOG_DATA_FLOW, "drawing fill with: $0 vertices, first at ($1, $2)",
-         mesh.verts.size(), mesh.verts[0].position.x, mesh.verts[0].position.y);
+         mesh.verts.size(), mesh.verts.Positions()[0].x,
+         mesh.verts.Positions()[0].y);
     MeshConverter mesh_converter(SingleColorShader, mesh);
     return mesh_converter.CreateProcessedElement(id, options);
   } else {
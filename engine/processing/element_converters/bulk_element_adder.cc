@@ -0,0 +1,171 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/processing/element_converters/bulk_element_adder.h"
+
+#include <utility>
+
+#include "third_party/absl/memory/memory.h"
+#include "ink/engine/processing/element_converters/bundle_proto_converter.h"
+#include "ink/engine/public/proto_validators.h"
+#include "ink/engine/public/types/uuid.h"
+#include "ink/engine/scene/data/common/serialized_element.h"
+#include "ink/engine/scene/graph/element_notifier.h"
+#include "ink/engine/util/dbg/errors.h"
+#include "ink/engine/util/dbg/log.h"
+#include "ink/engine/util/dbg/log_levels.h"
+
+namespace ink {
+
+BulkLoadMetrics::BulkLoadMetrics(std::shared_ptr<WallClockInterface> wall_clock,
+                                 size_t n_batches)
+    : wall_clock_(std::move(wall_clock)),
+      start_time_(wall_clock_->CurrentTime()),
+      n_batches_(n_batches) {}
+
+void BulkLoadMetrics::OnBatchAdded(size_t n_elements) {
+  ASSERT(n_batches_added_ < n_batches_);
+  ++n_batches_added_;
+  n_elements_added_ += n_elements;
+  DurationS elapsed = wall_clock_->CurrentTime() - start_time_;
+  if (n_batches_added_ == 1) {
+    time_to_first_frame_ = elapsed;
+    SLOG(SLOG_PERF, "document load: time to first frame: $0 ms",
+         static_cast<double>(time_to_first_frame_) * 1000.0);
+  }
+  if (IsFullyLoaded()) {
+    time_to_fully_loaded_ = elapsed;
+    SLOG(SLOG_PERF,
+         "document load: time to fully loaded: $0 ms ($1 elements in $2 "
+         "batches)",
+         static_cast<double>(time_to_fully_loaded_) * 1000.0,
+         n_elements_added_, n_batches_);
+  }
+}
+
+BulkElementAdder::BulkElementAdder(
+    std::vector<proto::ElementBundle> unsafe_bundles,
+    std::shared_ptr<SceneGraph> scene_graph, const settings::Flags& flags,
+    const SourceDetails& source_details,
+    std::shared_ptr<BulkLoadMetrics> metrics)
+    : unsafe_bundles_(std::move(unsafe_bundles)),
+      weak_scene_graph_(scene_graph),
+      source_details_(source_details),
+      metrics_(std::move(metrics)) {
+  element_converter_options_.low_memory_mode =
+      flags.GetFlag(settings::Flag::LowMemoryMode);
+  CallbackFlags callback_flags =
+      scene_graph->GetElementNotifier()->GetCallbackFlags(source_details);
+
+  ids_.resize(unsafe_bundles_.size(), kInvalidElementId);
+  groups_.resize(unsafe_bundles_.size(), kInvalidElementId);
+  elements_to_add_.resize(unsafe_bundles_.size());
+  for (size_t i = 0; i < unsafe_bundles_.size(); ++i) {
+    const auto& bundle = unsafe_bundles_[i];
+    Status status = ValidateProtoForAdd(bundle);
+    if (!status.ok()) {
+      SLOG(SLOG_ERROR, "Cannot add element bundle $0: $1", bundle.uuid(),
+           status);
+      continue;
+    }
+    if (!scene_graph->GetNextPolyId(bundle.uuid(), &ids_[i])) {
+      SLOG(SLOG_WARNING, "Cannot add element bundle $0", bundle.uuid());
+      ids_[i] = kInvalidElementId;
+      continue;
+    }
+    pending_ids_.insert(ids_[i]);
+
+    UUID group_uuid = kInvalidUUID;
+    if (bundle.group_uuid() != kInvalidUUID) {
+      groups_[i] = scene_graph->GroupIdFromUUID(bundle.group_uuid());
+      if (groups_[i] == kInvalidElementId) {
+        SLOG(SLOG_ERROR,
+             "Group $0 not found for element $1. Using the root as the group.",
+             bundle.group_uuid(), bundle.uuid());
+      } else {
+        group_uuid = bundle.group_uuid();
+      }
+    }
+    elements_to_add_[i].serialized_element =
+        absl::make_unique<SerializedElement>(bundle.uuid(), group_uuid,
+                                             source_details, callback_flags);
+  }
+  // Unlike SceneElementAdder, this listens even while bulk loading, as the
+  // document may be cleared or replaced while its batches are in flight.
+  if (!pending_ids_.empty()) scene_graph->AddListener(this);
+}
+
+void BulkElementAdder::Execute() {
+  for (size_t i = 0; i < unsafe_bundles_.size(); ++i) {
+    if (ids_[i] == kInvalidElementId) continue;
+
+    BundleProtoConverter converter(std::move(unsafe_bundles_[i]));
+    auto& element_to_add = elements_to_add_[i];
+    element_to_add.processed_element =
+        converter.CreateProcessedElement(ids_[i], element_converter_options_);
+    if (element_to_add.processed_element == nullptr) continue;
+
+    element_to_add.processed_element->group = groups_[i];
+    element_to_add.serialized_element->Serialize(
+        *element_to_add.processed_element);
+  }
+
+  // The bundles are no longer needed, and may be large.
+  unsafe_bundles_ = std::vector<proto::ElementBundle>();
+}
+
+void BulkElementAdder::OnPostExecute() {
+  auto scene_graph = weak_scene_graph_.lock();
+  if (scene_graph && !pending_ids_.empty()) scene_graph->RemoveListener(this);
+
+  std::vector<SceneGraph::ElementAdd> elements_to_add;
+  elements_to_add.reserve(elements_to_add_.size());
+  size_t n_failed = 0;
+  for (size_t i = 0; i < elements_to_add_.size(); ++i) {
+    // Elements that were removed before they could be added are dropped
+    // silently.
+    if (pending_ids_.count(ids_[i]) == 0) continue;
+    auto& element_to_add = elements_to_add_[i];
+    if (element_to_add.processed_element == nullptr) {
+      // Let the uuid be added again, e.g. by a later, valid bundle.
+      if (scene_graph) scene_graph->ReleaseUnusedPolyId(ids_[i]);
+      ++n_failed;
+      continue;
+    }
+    elements_to_add.push_back(std::move(element_to_add));
+  }
+  if (n_failed > 0) {
+    SLOG(SLOG_ERROR, "Could not load $0 of $1 elements", n_failed,
+         elements_to_add_.size());
+  }
+  elements_to_add_.clear();
+
+  if (scene_graph && !elements_to_add.empty()) {
+    size_t n_elements = elements_to_add.size();
+    scene_graph->AddStrokes(std::move(elements_to_add));
+    if (metrics_) metrics_->OnBatchAdded(n_elements);
+  } else if (metrics_) {
+    metrics_->OnBatchAdded(0);
+  }
+}
+
+void BulkElementAdder::OnElementsRemoved(
+    SceneGraph* graph, const std::vector<SceneGraphRemoval>& removed_elements) {
+  for (const auto& removal : removed_elements) {
+    pending_ids_.erase(removal.id);
+  }
+  if (pending_ids_.empty()) graph->RemoveListener(this);
+}
+
+}  // namespace ink
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INK_ENGINE_PROCESSING_ELEMENT_CONVERTERS_BULK_ELEMENT_ADDER_H_
+#define INK_ENGINE_PROCESSING_ELEMENT_CONVERTERS_BULK_ELEMENT_ADDER_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "ink/engine/processing/element_converters/element_converter.h"
+#include "ink/engine/processing/runner/task_runner.h"
+#include "ink/engine/scene/graph/scene_graph.h"
+#include "ink/engine/scene/graph/scene_graph_listener.h"
+#include "ink/engine/scene/types/element_id.h"
+#include "ink/engine/scene/types/source_details.h"
+#include "ink/engine/settings/flags.h"
+#include "ink/engine/util/time/time_types.h"
+#include "ink/engine/util/time/wall_clock.h"
+#include "ink/proto/elements_portable_proto.pb.h"
+
+namespace ink {
+
+// Records how long it takes to load a document that is split across several
+// BulkElementAdders, and logs the results when loading completes.
+class BulkLoadMetrics {
+ public:
+  // The load is considered to start when this is constructed.
+  BulkLoadMetrics(std::shared_ptr<WallClockInterface> wall_clock,
+                  size_t n_batches);
+
+  // Called on the main thread by each BulkElementAdder, once its elements have
+  // been added to the scene.
+  void OnBatchAdded(size_t n_elements);
+
+  bool IsFullyLoaded() const { return n_batches_added_ == n_batches_; }
+
+  // The time from the start of the load until the first batch was added to the
+  // scene, i.e. until the first frame on which part of the document is drawn.
+  // This is zero until the first batch has been added.
+  DurationS TimeToFirstFrame() const { return time_to_first_frame_; }
+
+  // The time from the start of the load until the last batch was added to the
+  // scene. This is zero until IsFullyLoaded() is true.
+  DurationS TimeToFullyLoaded() const { return time_to_fully_loaded_; }
+
+ private:
+  std::shared_ptr<WallClockInterface> wall_clock_;
+  WallTimeS start_time_;
+  size_t n_batches_;
+  size_t n_batches_added_ = 0;
+  size_t n_elements_added_ = 0;
+  DurationS time_to_first_frame_{0};
+  DurationS time_to_fully_loaded_{0};
+};
+
+// BulkElementAdder is a background task that converts a batch of element
+// bundles into ProcessedElements and SerializedElements, and then adds them to
+// the scene graph with a single call to SceneGraph::AddStrokes().
+//
+// It is used to load documents, which may hold many thousands of elements, in
+// place of a SceneElementAdder per element. Each batch is converted on a single
+// thread; a document's batches are only converted concurrently when the
+// EnableParallelTaskExecution flag, which is off by default, is set.
+//
+// Like SceneElementAdder, it listens for its elements being removed (e.g. by
+// clearing the scene, or loading another document) before they are added, and
+// skips those elements.
+class BulkElementAdder : public SceneGraphListener, public Task {
+ public:
+  // The bundles must be strokes or paths; groups and text are added directly
+  // by the RootController. The bundles' groups must already exist in the scene
+  // graph. metrics may be null.
+  BulkElementAdder(std::vector<proto::ElementBundle> unsafe_bundles,
+                   std::shared_ptr<SceneGraph> scene_graph,
+                   const settings::Flags& flags,
+                   const SourceDetails& source_details,
+                   std::shared_ptr<BulkLoadMetrics> metrics);
+
+  bool RequiresPreExecute() const override { return false; }
+  void PreExecute() override {}
+  void Execute() override;
+  // Execute() only converts the task's own bundles.
+  bool CanExecuteInParallel() const override { return true; }
+  void OnPostExecute() override;
+
+  void OnElementAdded(SceneGraph* graph, ElementId id) override {}
+  void OnElementsRemoved(
+      SceneGraph* graph,
+      const std::vector<SceneGraphRemoval>& removed_elements) override;
+  void OnElementsMutated(
+      SceneGraph* graph,
+      const std::vector<ElementMutationData>& mutation_data) override {}
+
+ private:
+  std::vector<proto::ElementBundle> unsafe_bundles_;
+  std::weak_ptr<SceneGraph> weak_scene_graph_;
+  SourceDetails source_details_;
+  IElementConverter::ElementConverterOptions element_converter_options_;
+  std::shared_ptr<BulkLoadMetrics> metrics_;
+
+  // These are parallel to unsafe_bundles_. An id of kInvalidElementId
+  // indicates that the bundle was invalid, or could not be allocated an id,
+  // and will be skipped. An element_to_add_ with a null processed_element
+  // indicates that the conversion failed.
+  std::vector<ElementId> ids_;
+  std::vector<GroupId> groups_;
+  std::vector<SceneGraph::ElementAdd> elements_to_add_;
+
+  // main thread only
+  // The ids that have been allocated, and not removed since.
+  ElementIdHashSet pending_ids_;
+};
+
+}  // namespace ink
+
+#endif  // INK_ENGINE_PROCESSING_ELEMENT_CONVERTERS_BULK_ELEMENT_ADDER_H_
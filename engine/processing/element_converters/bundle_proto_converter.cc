@@ -14,6 +14,8 @@
 
 #include "ink/engine/processing/element_converters/bundle_proto_converter.h"
 
+#include <utility>
+
 #include "ink/engine/processing/element_converters/bezier_path_converter.h"
 #include "ink/engine/scene/data/common/mesh_serializer_provider.h"
 #include "ink/engine/scene/data/common/stroke.h"
@@ -31,11 +33,15 @@ BundleProtoConverter::BundleProtoConverter(
     const ink::proto::ElementBundle& unsafe_bundle)
     : unsafe_proto_bundle_(unsafe_bundle) {}
 
+BundleProtoConverter::BundleProtoConverter(
+    ink::proto::ElementBundle&& unsafe_bundle)
+    : unsafe_proto_bundle_(std::move(unsafe_bundle)) {}
+
 unique_ptr<ProcessedElement> BundleProtoConverter::CreateProcessedElement(
     ElementId id, const ElementConverterOptions& options) {
   ink::ElementBundle bundle;
   if (ink::util::ReadFromProto(unsafe_proto_bundle_, &bundle)) {
-    ink::proto::Element element = bundle.unsafe_element();
+    const ink::proto::Element& element = bundle.unsafe_element();
 
     // Stroke.
     if (element.has_stroke()) {
@@ -29,6 +29,7 @@ namespace ink {
 class BundleProtoConverter : public IElementConverter {
  public:
   explicit BundleProtoConverter(const proto::ElementBundle& unsafe_bundle);
+  explicit BundleProtoConverter(proto::ElementBundle&& unsafe_bundle);
 
   // Disallow copy and assign.
   BundleProtoConverter(const BundleProtoConverter&) = delete;
@@ -77,8 +77,8 @@ std::unique_ptr<ProcessedElement> LineConverter::CreateProcessedElement(
     }
 
     tess.mesh_.object_matrix = glm::inverse(m);
-    for (auto& v : tess.mesh_.verts) {
-      v.position = geometry::Transform(v.position, m);
+    for (auto& p : *tess.mesh_.verts.MutablePositions()) {
+      p = geometry::Transform(p, m);
     }
 
     auto cdr = CDR(&tess.mesh_);
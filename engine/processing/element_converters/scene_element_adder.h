@@ -48,6 +48,8 @@ class SceneElementAdder : public SceneGraphListener, public Task {
   bool RequiresPreExecute() const override { return false; }
   void PreExecute() override {}
   void Execute() final;
+  // Execute() only runs the task's own converter.
+  bool CanExecuteInParallel() const override { return true; }
   void OnPostExecute() override;
 
   void OnElementAdded(SceneGraph* graph, ElementId id) override {}
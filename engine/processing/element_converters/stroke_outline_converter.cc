@@ -156,7 +156,7 @@ StrokeOutlineConverter::CreateProcessedElement(
     return nullptr;
   }
   tess.mesh_.object_matrix = glm::inverse(m_norm);
-  tess.mesh_.verts[0].color =
+  (*tess.mesh_.verts.MutableColors())[0] =
       RGBtoRGBPremultiplied(UintToVec4RGBA(stroke.rgba()));
 
   auto processed_element = absl::make_unique<ProcessedElement>(
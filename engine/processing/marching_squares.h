@@ -17,12 +17,17 @@
 #ifndef INK_ENGINE_PROCESSING_MARCHING_SQUARES_H_
 #define INK_ENGINE_PROCESSING_MARCHING_SQUARES_H_
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <type_traits>
 #include <vector>
 
 #include "third_party/glm/glm/glm.hpp"
+#include "ink/engine/processing/pixel_mask.h"
+#include "ink/engine/processing/runner/parallel_for.h"
 #include "ink/engine/rendering/baseGL/gpupixels.h"
 
 namespace ink {
@@ -33,11 +38,26 @@ class ColorEqualPredicate {
   explicit ColorEqualPredicate(uint32_t target_color)
       : target_color_(target_color) {}
   bool operator()(uint32_t value) const { return value == target_color_; }
+  uint32_t TargetColor() const { return target_color_; }
 
  private:
   uint32_t target_color_;
 };
 
+// Sets rows [first_row, end_row) of the mask from the pixels for which the
+// predicate is true. This is overloaded for predicates that have a faster way
+// to fill the mask.
+template <typename Predicate>
+void SetMaskRows(const GPUPixels& pixels, const Predicate& predicate,
+                 int first_row, int end_row, PixelMask* mask) {
+  mask->SetRows(pixels, predicate, first_row, end_row);
+}
+inline void SetMaskRows(const GPUPixels& pixels,
+                        const ColorEqualPredicate& predicate, int first_row,
+                        int end_row, PixelMask* mask) {
+  mask->SetRowsWithColor(pixels, predicate.TargetColor(), first_row, end_row);
+}
+
 // Template type Predicate is used to determine which pixels are considered
 // "filled". It must provide bool operator()(uint32_t) const.
 //
@@ -60,10 +80,52 @@ class MarchingSquares {
       const ForwardIt& begin, const ForwardIt& end) const;
   std::vector<std::vector<glm::ivec2>> TraceAllBoundaries() const;
 
+  // Returns the same result as TraceAllBoundaries() -- the same boundaries,
+  // starting at the same points, in the same order -- but first evaluates the
+  // predicate for every pixel into a PixelMask, then finds the points at which
+  // boundaries may start a word of the mask at a time, and traces the mask.
+  // Horizontal stripes of the image are packed and traced in parallel, by up
+  // to max_threads threads, including the calling thread (see ParallelFor()).
+  // The result doesn't depend on the number of threads.
+  std::vector<std::vector<glm::ivec2>> TraceAllBoundariesPacked(
+      int max_threads = 1) const;
+
+  // The number of rows in each stripe that TraceAllBoundariesPacked() packs or
+  // traces as a unit.
+  static constexpr int kStripeHeight = 64;
+
  private:
   enum class Direction { N, E, S, W, Unknown };
   Direction NextDirection(const glm::ivec2& position,
                           Direction previous_dir) const;
+  static Direction NextDirection(uint32_t neighbors, Direction previous_dir);
+  static glm::ivec2 Step(glm::ivec2 position, Direction dir);
+
+  // Traces the boundary of the mask that starts at start_position, as
+  // TraceBoundary() does, calling visitor(position, next_dir) for each point
+  // on it.
+  // Returns false if there is no boundary there, or if the visitor returns
+  // false to stop the trace.
+  template <typename Visitor>
+  static bool TraceMaskBoundary(const PixelMask& mask,
+                                const glm::ivec2& start_position,
+                                Visitor visitor);
+
+  // Appends the boundaries whose lowest points lie in grid rows
+  // [first_row, end_row) to "boundaries", each starting at its lowest point.
+  // "visited" holds a bit per grid point, and is shared by all stripes.
+  static void TraceMaskStripe(const PixelMask& mask, int first_row,
+                              int end_row,
+                              std::vector<std::atomic<uint64_t>>* visited,
+                              std::vector<std::vector<glm::ivec2>>* boundaries);
+
+  // Replaces the boundaries in "deferred", whose lowest points are saddle
+  // points, with the boundaries that TraceAllBoundaries() would find in their
+  // place, and merges them into "boundaries", which hold the rest.
+  static void MergeDeferredBoundaries(
+      const PixelMask& mask,
+      const std::vector<std::vector<glm::ivec2>>& deferred,
+      std::vector<std::vector<glm::ivec2>>* boundaries);
   bool TestPixel(const glm::ivec2& pixel_index) const;
   uint32_t NeighborPixelState(glm::ivec2 position) const;
 
@@ -127,14 +189,7 @@ std::vector<glm::ivec2> MarchingSquares<Predicate>::TraceBoundary(
     }
 
     result.push_back(position);
-    if (next_dir == Direction::N)
-      position.y++;
-    else if (next_dir == Direction::W)
-      position.x--;
-    else if (next_dir == Direction::S)
-      position.y--;
-    else if (next_dir == Direction::E)
-      position.x++;
+    position = Step(position, next_dir);
 
     next_dir = NextDirection(position, next_dir);
     EXPECT(next_dir != Direction::Unknown);
@@ -174,6 +229,201 @@ MarchingSquares<Predicate>::TraceAllBoundaries() const {
                          GridIter(grid_size, glm::ivec2(0, grid_size.y)));
 }
 
+template <typename Predicate>
+std::vector<std::vector<glm::ivec2>>
+MarchingSquares<Predicate>::TraceAllBoundariesPacked(int max_threads) const {
+  glm::ivec2 pixel_size = pb_->PixelDim();
+  PixelMask mask(pixel_size);
+  ParallelFor((pixel_size.y + kStripeHeight - 1) / kStripeHeight, max_threads,
+              [this, &mask, pixel_size](int stripe) {
+                int first_row = stripe * kStripeHeight;
+                SetMaskRows(*pb_, test_predicate_, first_row,
+                            std::min(first_row + kStripeHeight, pixel_size.y),
+                            &mask);
+              });
+
+  int n_grid_rows = pixel_size.y + 1;
+  int n_stripes = (n_grid_rows + kStripeHeight - 1) / kStripeHeight;
+  std::vector<std::atomic<uint64_t>> visited(
+      static_cast<size_t>(n_grid_rows) * ((pixel_size.x + 1 + 63) / 64));
+  std::vector<std::vector<std::vector<glm::ivec2>>> stripe_boundaries(
+      n_stripes);
+  ParallelFor(n_stripes, max_threads,
+              [&mask, &visited, &stripe_boundaries, n_grid_rows](int stripe) {
+                int first_row = stripe * kStripeHeight;
+                TraceMaskStripe(
+                    mask, first_row,
+                    std::min(first_row + kStripeHeight, n_grid_rows),
+                    &visited, &stripe_boundaries[stripe]);
+              });
+
+  // TraceAllBoundaries() traces from each grid point in turn, skipping the
+  // points on the boundaries that it has already found. A boundary whose
+  // lowest point is a saddle point shares that point with another boundary,
+  // which may have been found first; it is then found from a later point, or,
+  // if all of its points are shared, not at all. Those boundaries are set
+  // aside and found again as TraceAllBoundaries() would. Any other boundary is
+  // found from its lowest point by both.
+  std::vector<std::vector<glm::ivec2>> boundaries;
+  std::vector<std::vector<glm::ivec2>> deferred;
+  for (auto& stripe : stripe_boundaries) {
+    for (auto& boundary : stripe) {
+      uint32_t start_state = mask.NeighborState(boundary.front());
+      if (start_state == 0b0101 || start_state == 0b1010) {
+        deferred.push_back(std::move(boundary));
+      } else {
+        boundaries.push_back(std::move(boundary));
+      }
+    }
+  }
+  if (!deferred.empty()) MergeDeferredBoundaries(mask, deferred, &boundaries);
+  return boundaries;
+}
+
+template <typename Predicate>
+void MarchingSquares<Predicate>::MergeDeferredBoundaries(
+    const PixelMask& mask,
+    const std::vector<std::vector<glm::ivec2>>& deferred,
+    std::vector<std::vector<glm::ivec2>>* boundaries) {
+  auto before = [](const glm::ivec2& lhs, const glm::ivec2& rhs) {
+    return lhs.y < rhs.y || (lhs.y == rhs.y && lhs.x < rhs.x);
+  };
+  const int grid_width = mask.Size().x + 1;
+  std::vector<bool> visited(static_cast<size_t>(grid_width) *
+                            (mask.Size().y + 1));
+  auto mark_visited = [&visited, grid_width](const glm::ivec2& position) {
+    visited[static_cast<size_t>(position.y) * grid_width + position.x] = true;
+  };
+  // Each of the other boundaries is found from its lowest point, before
+  // TraceAllBoundaries() reaches any of the deferred boundaries' points that
+  // it shares, so they may all be marked up front.
+  for (const auto& boundary : *boundaries) {
+    for (const glm::ivec2& position : boundary) mark_visited(position);
+  }
+
+  // Every boundary that passes through an unvisited point of a deferred
+  // boundary is itself deferred, so those points are the only ones from which
+  // TraceAllBoundaries() finds them.
+  std::vector<glm::ivec2> points;
+  for (const auto& boundary : deferred)
+    points.insert(points.end(), boundary.begin(), boundary.end());
+  std::sort(points.begin(), points.end(), before);
+  points.erase(std::unique(points.begin(), points.end()), points.end());
+
+  std::vector<std::vector<glm::ivec2>> found;
+  for (const glm::ivec2& start : points) {
+    if (visited[static_cast<size_t>(start.y) * grid_width + start.x])
+      continue;
+    std::vector<glm::ivec2> boundary;
+    TraceMaskBoundary(mask, start,
+                      [&boundary](const glm::ivec2& position, Direction) {
+                        boundary.push_back(position);
+                        return true;
+                      });
+    for (const glm::ivec2& position : boundary) mark_visited(position);
+    if (!boundary.empty()) found.push_back(std::move(boundary));
+  }
+
+  std::vector<std::vector<glm::ivec2>> merged;
+  merged.reserve(boundaries->size() + found.size());
+  std::merge(std::make_move_iterator(boundaries->begin()),
+             std::make_move_iterator(boundaries->end()),
+             std::make_move_iterator(found.begin()),
+             std::make_move_iterator(found.end()), std::back_inserter(merged),
+             [&before](const std::vector<glm::ivec2>& lhs,
+                       const std::vector<glm::ivec2>& rhs) {
+               return before(lhs.front(), rhs.front());
+             });
+  *boundaries = std::move(merged);
+}
+
+template <typename Predicate>
+void MarchingSquares<Predicate>::TraceMaskStripe(
+    const PixelMask& mask, int first_row, int end_row,
+    std::vector<std::atomic<uint64_t>>* visited,
+    std::vector<std::vector<glm::ivec2>>* boundaries) {
+  // A boundary is only kept when it is traced from its lowest point, so that
+  // each is found exactly once, no matter which stripe holds the rest of it.
+  // Tracing from any other start point stops as soon as it passes a point
+  // lower than the start.
+  //
+  // The points that a trace passes are marked as visited, so that they aren't
+  // traced from again, unless a different boundary would start there, as at
+  // the points that join two boundaries. None of them is the lowest point of
+  // its boundary, as the trace would have stopped there, or was traced from
+  // it. Other threads may not see the marks right away, which only costs them
+  // some repeated work.
+  const int words_per_row = (mask.Size().x + 1 + 63) / 64;
+  auto mark_visited = [&mask, visited, words_per_row](
+                          const glm::ivec2& position, Direction next_dir) {
+    if (NextDirection(mask.NeighborState(position), Direction::Unknown) !=
+        next_dir)
+      return;
+    (*visited)[static_cast<size_t>(position.y) * words_per_row +
+               position.x / 64]
+        .fetch_or(uint64_t{1} << (position.x % 64), std::memory_order_relaxed);
+  };
+  auto is_visited = [visited, words_per_row](const glm::ivec2& position) {
+    return ((*visited)[static_cast<size_t>(position.y) * words_per_row +
+                       position.x / 64]
+                .load(std::memory_order_relaxed) >>
+            (position.x % 64)) &
+           1;
+  };
+
+  std::vector<glm::ivec2> start_points;
+  std::vector<glm::ivec2> boundary;
+  for (int y = first_row; y < end_row; ++y) {
+    start_points.clear();
+    mask.AppendStartPoints(y, &start_points);
+    for (const glm::ivec2& start : start_points) {
+      if (is_visited(start)) continue;
+      boundary.clear();
+      if (TraceMaskBoundary(
+              mask, start,
+              [&boundary, &start, &mark_visited](const glm::ivec2& position,
+                                                 Direction next_dir) {
+                if (position.y < start.y ||
+                    (position.y == start.y && position.x < start.x))
+                  return false;
+                mark_visited(position, next_dir);
+                boundary.push_back(position);
+                return true;
+              })) {
+        boundaries->push_back(boundary);
+      }
+    }
+  }
+}
+
+template <typename Predicate>
+template <typename Visitor>
+bool MarchingSquares<Predicate>::TraceMaskBoundary(
+    const PixelMask& mask, const glm::ivec2& start_position, Visitor visitor) {
+  Direction start_dir =
+      NextDirection(mask.NeighborState(start_position), Direction::Unknown);
+  if (start_dir == Direction::Unknown) return false;
+
+  // Each edge between grid points is crossed at most once.
+  const glm::ivec2 grid_size = mask.Size() + glm::ivec2(1, 1);
+  const int64_t max_iterations =
+      2 * static_cast<int64_t>(grid_size.x) * grid_size.y;
+  glm::ivec2 position = start_position;
+  Direction next_dir = start_dir;
+  int64_t iterations = 0;
+  do {
+    if (iterations++ > max_iterations) {
+      ASSERT(false);
+      return false;
+    }
+    if (!visitor(position, next_dir)) return false;
+    position = Step(position, next_dir);
+    next_dir = NextDirection(mask.NeighborState(position), next_dir);
+    EXPECT(next_dir != Direction::Unknown);
+  } while (position != start_position || next_dir != start_dir);
+  return true;
+}
+
 template <typename Predicate>
 bool MarchingSquares<Predicate>::TestPixel(
     const glm::ivec2& pixel_index) const {
@@ -201,7 +451,27 @@ template <typename Predicate>
 typename MarchingSquares<Predicate>::Direction
 MarchingSquares<Predicate>::NextDirection(const glm::ivec2& position,
                                           Direction previous_dir) const {
-  uint32_t neighbors = NeighborPixelState(position);
+  return NextDirection(NeighborPixelState(position), previous_dir);
+}
+
+template <typename Predicate>
+glm::ivec2 MarchingSquares<Predicate>::Step(glm::ivec2 position,
+                                            Direction dir) {
+  if (dir == Direction::N)
+    position.y++;
+  else if (dir == Direction::W)
+    position.x--;
+  else if (dir == Direction::S)
+    position.y--;
+  else if (dir == Direction::E)
+    position.x++;
+  return position;
+}
+
+template <typename Predicate>
+typename MarchingSquares<Predicate>::Direction
+MarchingSquares<Predicate>::NextDirection(uint32_t neighbors,
+                                          Direction previous_dir) {
   if (neighbors == 0b0101) {
     if (previous_dir == Direction::N)
       return Direction::W;
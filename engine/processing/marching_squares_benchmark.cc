@@ -14,12 +14,14 @@
 
 #include "ink/engine/processing/marching_squares.h"
 
+#include <cstdint>
 #include <vector>
 
 #include "testing/base/public/benchmark.h"
 #include "third_party/glm/glm/glm.hpp"
 #include "ink/engine/geometry/algorithms/distance.h"
 #include "ink/engine/rendering/baseGL/gpupixels.h"
+#include "ink/engine/util/dbg/errors.h"
 
 namespace ink {
 namespace marching_squares {
@@ -29,18 +31,11 @@ using glm::vec2;
 using glm::ivec2;
 using benchmark::State;
 
-static void BM_TraceSolidImage(State &state) {
-  int size = state.range(0);
-  GPUPixels pixels(ivec2(size, size), std::vector<uint32_t>(size * size, 0x1));
-  MarchingSquares<ColorEqualPredicate> ms(ColorEqualPredicate(1), &pixels);
-  while (state.KeepRunning()) {
-    ms.TraceAllBoundaries();
-  }
+GPUPixels SolidImage(int size) {
+  return GPUPixels(ivec2(size, size), std::vector<uint32_t>(size * size, 0x1));
 }
-BENCHMARK(BM_TraceSolidImage)->Arg(128)->Arg(256)->Arg(512)->Arg(1024);
 
-static void BM_TraceBullseye(State &state) {
-  int size = state.range(0);
+GPUPixels Bullseye(int size) {
   GPUPixels pixels(ivec2(size, size), std::vector<uint32_t>(size * size, 0x0));
   vec2 center(.5 * (size - 1), .5 * (size - 1));
   for (int x = 0; x < size; ++x) {
@@ -49,28 +44,130 @@ static void BM_TraceBullseye(State &state) {
         pixels.Set(ivec2(x, y), 0x1);
     }
   }
-  MarchingSquares<ColorEqualPredicate> ms(ColorEqualPredicate(1), &pixels);
-  while (state.KeepRunning()) {
-    ms.TraceAllBoundaries();
-  }
+  return pixels;
 }
-BENCHMARK(BM_TraceBullseye)->Arg(128)->Arg(256)->Arg(512)->Arg(1024);
 
-static void BM_TraceCheckerboard(State &state) {
-  int size = state.range(0);
+GPUPixels Checkerboard(int size) {
   GPUPixels pixels(ivec2(size, size), std::vector<uint32_t>(size * size, 0x0));
-  vec2 center(.5 * (size - 1), .5 * (size - 1));
   for (int x = 0; x < size; ++x) {
     for (int y = 0; y < size; ++y) {
       if ((x + y) % 2 == 0) pixels.Set(ivec2(x, y), 0x1);
     }
   }
+  return pixels;
+}
+
+// Matches the same pixels as ColorEqualPredicate, but doesn't have its SIMD
+// path for filling a PixelMask.
+class GenericColorEqualPredicate {
+ public:
+  explicit GenericColorEqualPredicate(uint32_t target_color)
+      : target_color_(target_color) {}
+  bool operator()(uint32_t value) const { return value == target_color_; }
+
+ private:
+  uint32_t target_color_;
+};
+
+// TraceAllBoundariesPacked() must return exactly what TraceAllBoundaries()
+// does. Most of the checkerboard's boundaries start at saddle points, which is
+// where the two are most likely to differ.
+template <typename Predicate>
+void ExpectPackedMatchesUnpacked(const MarchingSquares<Predicate> &ms,
+                                 int max_threads) {
+  EXPECT(ms.TraceAllBoundariesPacked(max_threads) == ms.TraceAllBoundaries());
+}
+
+static void BM_TraceSolidImage(State &state) {
+  GPUPixels pixels = SolidImage(state.range(0));
+  MarchingSquares<ColorEqualPredicate> ms(ColorEqualPredicate(1), &pixels);
+  while (state.KeepRunning()) {
+    ms.TraceAllBoundaries();
+  }
+}
+BENCHMARK(BM_TraceSolidImage)
+    ->Arg(128)
+    ->Arg(256)
+    ->Arg(512)
+    ->Arg(1024)
+    ->Arg(4096);
+
+static void BM_TraceBullseye(State &state) {
+  GPUPixels pixels = Bullseye(state.range(0));
+  MarchingSquares<ColorEqualPredicate> ms(ColorEqualPredicate(1), &pixels);
+  while (state.KeepRunning()) {
+    ms.TraceAllBoundaries();
+  }
+}
+BENCHMARK(BM_TraceBullseye)->Arg(128)->Arg(256)->Arg(512)->Arg(1024)->Arg(4096);
+
+static void BM_TraceCheckerboard(State &state) {
+  GPUPixels pixels = Checkerboard(state.range(0));
   MarchingSquares<ColorEqualPredicate> ms(ColorEqualPredicate(1), &pixels);
   while (state.KeepRunning()) {
     ms.TraceAllBoundaries();
   }
 }
-BENCHMARK(BM_TraceCheckerboard)->Arg(128)->Arg(256)->Arg(512)->Arg(1024);
+BENCHMARK(BM_TraceCheckerboard)
+    ->Arg(128)
+    ->Arg(256)
+    ->Arg(512)
+    ->Arg(1024)
+    ->Arg(4096);
+
+// The packed benchmarks take the image size and the maximum number of threads.
+static void BM_TraceSolidImagePacked(State &state) {
+  GPUPixels pixels = SolidImage(state.range(0));
+  MarchingSquares<ColorEqualPredicate> ms(ColorEqualPredicate(1), &pixels);
+  ExpectPackedMatchesUnpacked(ms, state.range(1));
+  while (state.KeepRunning()) {
+    ms.TraceAllBoundariesPacked(state.range(1));
+  }
+}
+BENCHMARK(BM_TraceSolidImagePacked)
+    ->ArgPair(1024, 1)
+    ->ArgPair(4096, 1)
+    ->ArgPair(4096, 4);
+
+static void BM_TraceBullseyePacked(State &state) {
+  GPUPixels pixels = Bullseye(state.range(0));
+  MarchingSquares<ColorEqualPredicate> ms(ColorEqualPredicate(1), &pixels);
+  ExpectPackedMatchesUnpacked(ms, state.range(1));
+  while (state.KeepRunning()) {
+    ms.TraceAllBoundariesPacked(state.range(1));
+  }
+}
+BENCHMARK(BM_TraceBullseyePacked)
+    ->ArgPair(1024, 1)
+    ->ArgPair(4096, 1)
+    ->ArgPair(4096, 4);
+
+static void BM_TraceBullseyePackedGenericPredicate(State &state) {
+  GPUPixels pixels = Bullseye(state.range(0));
+  MarchingSquares<GenericColorEqualPredicate> ms(GenericColorEqualPredicate(1),
+                                                 &pixels);
+  ExpectPackedMatchesUnpacked(ms, state.range(1));
+  while (state.KeepRunning()) {
+    ms.TraceAllBoundariesPacked(state.range(1));
+  }
+}
+BENCHMARK(BM_TraceBullseyePackedGenericPredicate)
+    ->ArgPair(1024, 1)
+    ->ArgPair(4096, 1)
+    ->ArgPair(4096, 4);
+
+static void BM_TraceCheckerboardPacked(State &state) {
+  GPUPixels pixels = Checkerboard(state.range(0));
+  MarchingSquares<ColorEqualPredicate> ms(ColorEqualPredicate(1), &pixels);
+  ExpectPackedMatchesUnpacked(ms, state.range(1));
+  while (state.KeepRunning()) {
+    ms.TraceAllBoundariesPacked(state.range(1));
+  }
+}
+BENCHMARK(BM_TraceCheckerboardPacked)
+    ->ArgPair(1024, 1)
+    ->ArgPair(4096, 1)
+    ->ArgPair(4096, 4);
 
 }  // namespace
 }  // namespace marching_squares
@@ -0,0 +1,113 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/processing/pixel_mask.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+
+namespace ink {
+namespace marching_squares {
+namespace {
+
+int CountTrailingZeros(uint64_t word) {
+  ASSERT(word != 0);
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(word);
+#else
+  int n = 0;
+  while ((word & 1) == 0) {
+    word >>= 1;
+    ++n;
+  }
+  return n;
+#endif
+}
+
+// Returns a word whose bit i is set if pixel i of the 64 starting at "pixels"
+// is "color". Only the first n pixels are read.
+uint64_t MatchColor(const uint32_t* pixels, int n, uint32_t color) {
+  uint64_t bits = 0;
+  int i = 0;
+#if defined(__SSE2__)
+  const __m128i target = _mm_set1_epi32(static_cast<int>(color));
+  for (; i + 4 <= n; i += 4) {
+    __m128i values =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+    __m128i equal = _mm_cmpeq_epi32(values, target);
+    bits |= static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(equal)))
+            << i;
+  }
+#endif
+  for (; i < n; ++i)
+    bits |= static_cast<uint64_t>(pixels[i] == color ? 1 : 0) << i;
+  return bits;
+}
+
+}  // namespace
+
+PixelMask::PixelMask(glm::ivec2 size)
+    : size_(size),
+      // Each row holds size.x pixels and a border pixel on either side.
+      words_per_row_((size.x + 2 + 63) / 64),
+      bits_(static_cast<size_t>(size.y + 2) * words_per_row_, 0) {
+  ASSERT(size.x >= 0 && size.y >= 0);
+}
+
+void PixelMask::AppendStartPoints(int y,
+                                  std::vector<glm::ivec2>* points) const {
+  ASSERT(y >= 0 && y <= size_.y);
+  const uint64_t* down = Row(y - 1);
+  const uint64_t* up = Row(y);
+  // Grid point x lies between padded bits x and x + 1, so only the points up
+  // to size.x, which is the last bit to consider, are in the grid.
+  const int last_word = size_.x / 64;
+  for (int word = 0; word <= last_word; ++word) {
+    uint64_t down_next = word + 1 < words_per_row_ ? down[word + 1] : 0;
+    uint64_t up_next = word + 1 < words_per_row_ ? up[word + 1] : 0;
+    // Bit i of each word holds the pixel to the left of grid point i, and bit
+    // i of the shifted words the pixel to its right.
+    uint64_t down_left = down[word];
+    uint64_t up_left = up[word];
+    uint64_t down_right = (down_left >> 1) | (down_next << 63);
+    uint64_t up_right = (up_left >> 1) | (up_next << 63);
+    uint64_t starts = (~(down_left ^ down_right) & ~(down_left ^ up_left) &
+                       (up_left ^ up_right)) |
+                      (down_left & ~down_right & ~up_left & up_right);
+    if (word == last_word && size_.x % 64 != 63)
+      starts &= (uint64_t{1} << (size_.x % 64 + 1)) - 1;
+    while (starts != 0) {
+      points->emplace_back(word * 64 + CountTrailingZeros(starts), y);
+      starts &= starts - 1;
+    }
+  }
+}
+
+void PixelMask::SetRowsWithColor(const GPUPixels& pixels, uint32_t color,
+                                 int first_row, int end_row) {
+  ASSERT(pixels.PixelDim() == size_);
+  const uint32_t* data = pixels.RawData().data();
+  for (int y = first_row; y < end_row; ++y) {
+    const uint32_t* src = data + static_cast<size_t>(y) * size_.x;
+    uint64_t* row = MutableRow(y);
+    for (int x = 0; x < size_.x; x += 64)
+      OrPixels(row, x, MatchColor(src + x, std::min(64, size_.x - x), color));
+  }
+}
+
+}  // namespace marching_squares
+}  // namespace ink
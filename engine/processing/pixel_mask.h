@@ -0,0 +1,142 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INK_ENGINE_PROCESSING_PIXEL_MASK_H_
+#define INK_ENGINE_PROCESSING_PIXEL_MASK_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "third_party/glm/glm/glm.hpp"
+#include "ink/engine/rendering/baseGL/gpupixels.h"
+#include "ink/engine/util/dbg/errors.h"
+
+namespace ink {
+namespace marching_squares {
+
+// A packed mask of one bit per pixel, used by MarchingSquares to trace an
+// image without re-evaluating its predicate.
+//
+// Each row is surrounded by a border of unset pixels, so that the neighbors of
+// every grid point can be read without bounds checks: pixel (x, y) is stored in
+// bit x + 1 of row y + 1, and rows -1 and size.y, like columns -1 and size.x,
+// are always unset.
+class PixelMask {
+ public:
+  PixelMask() {}
+  explicit PixelMask(glm::ivec2 size);
+
+  glm::ivec2 Size() const { return size_; }
+
+  // Pixels outside of the mask are unset.
+  bool Get(glm::ivec2 pixel) const {
+    if (pixel.x < -1 || pixel.x > size_.x || pixel.y < -1 || pixel.y > size_.y)
+      return false;
+    return (Row(pixel.y)[(pixel.x + 1) / 64] >> ((pixel.x + 1) % 64)) & 1;
+  }
+
+  // Returns the state of the four pixels around the grid point, in the same
+  // bits as MarchingSquares: 1 for the pixel down and to the left, 2 for down
+  // and to the right, 4 for up and to the right, and 8 for up and to the left.
+  // The point must lie within [0, size.x]x[0, size.y].
+  uint32_t NeighborState(glm::ivec2 position) const {
+    int word = position.x / 64;
+    int bit = position.x % 64;
+    uint64_t down = PairAt(Row(position.y - 1), word, bit);
+    uint64_t up = PairAt(Row(position.y), word, bit);
+    return static_cast<uint32_t>((down & 1) | (down & 2) | ((up & 2) << 1) |
+                                 ((up & 1) << 3));
+  }
+
+  // Appends to "points" the grid points in row y, from left to right, that may
+  // be the lowest (and then leftmost) point of a boundary. y must lie in
+  // [0, size.y]. This scans the mask a word at a time.
+  //
+  // No boundary may leave such a point downward or to the left, so the pixels
+  // below it and up and to the left of it must match, and differ from the one
+  // up and to the right (0b0100 and 0b1011), unless the point joins two
+  // boundaries, with set pixels down and to the left and up and to the right
+  // (0b0101).
+  void AppendStartPoints(int y, std::vector<glm::ivec2>* points) const;
+
+  // Sets rows [first_row, end_row) of the mask from "pixels", which must have
+  // the same size as the mask, setting each pixel for which the predicate is
+  // true. The rows must not have been set before.
+  template <typename Predicate>
+  void SetRows(const GPUPixels& pixels, const Predicate& predicate,
+               int first_row, int end_row);
+
+  // As above, setting each pixel whose value is "color". This compares several
+  // pixels at a time with SIMD instructions, where they are available.
+  void SetRowsWithColor(const GPUPixels& pixels, uint32_t color,
+                        int first_row, int end_row);
+
+ private:
+  // Returns the padded row for pixel row y, which must lie in [-1, size.y].
+  const uint64_t* Row(int y) const {
+    return &bits_[static_cast<size_t>(y + 1) * words_per_row_];
+  }
+  uint64_t* MutableRow(int y) {
+    return &bits_[static_cast<size_t>(y + 1) * words_per_row_];
+  }
+
+  // Returns bits [bit, bit + 1] of the padded row, starting in the given word,
+  // in the low two bits of the result.
+  static uint64_t PairAt(const uint64_t* row, int word, int bit) {
+    uint64_t pair = row[word] >> bit;
+    if (bit == 63) pair |= row[word + 1] << 1;
+    return pair & 3;
+  }
+
+  // ORs the 64 pixels in "bits", starting at pixel x (a multiple of 64), into
+  // the padded row.
+  static void OrPixels(uint64_t* row, int x, uint64_t bits) {
+    row[x / 64] |= bits << 1;
+    // Pixel x + 63 lies in the next word. If it is set, that word exists.
+    if (bits >> 63) row[x / 64 + 1] |= 1;
+  }
+
+  glm::ivec2 size_{0, 0};
+  int words_per_row_ = 0;
+  std::vector<uint64_t> bits_;
+};
+
+template <typename Predicate>
+void PixelMask::SetRows(const GPUPixels& pixels, const Predicate& predicate,
+                        int first_row, int end_row) {
+  ASSERT(pixels.PixelDim() == size_);
+  const uint32_t* data = pixels.RawData().data();
+  for (int y = first_row; y < end_row; ++y) {
+    const uint32_t* src = data + static_cast<size_t>(y) * size_.x;
+    uint64_t* row = MutableRow(y);
+    for (int x = 0; x < size_.x; x += 64) {
+      int n = std::min(64, size_.x - x);
+      // A branch-free loop, which the compiler can vectorize for simple
+      // predicates.
+      uint64_t bits = 0;
+      for (int i = 0; i < n; ++i)
+        bits |= static_cast<uint64_t>(predicate(src[x + i]) ? 1 : 0) << i;
+      OrPixels(row, x, bits);
+    }
+  }
+}
+
+}  // namespace marching_squares
+}  // namespace ink
+
+#endif  // INK_ENGINE_PROCESSING_PIXEL_MASK_H_
@@ -14,20 +14,34 @@
 
 #include "ink/engine/processing/runner/async_task_runner.h"
 
+#include <algorithm>
+
 #include "third_party/absl/types/optional.h"
 #include "ink/engine/processing/runner/task_runner.h"
 #include "ink/engine/util/dbg/errors.h"
 #include "ink/engine/util/dbg/log.h"
 #include "ink/engine/util/dbg/log_levels.h"
+#include "ink/engine/util/dbg/trace.h"
 
 namespace ink {
 
 AsyncTaskRunner::AsyncTaskRunner(const service::UncheckedRegistry& registry)
-    : AsyncTaskRunner(registry.GetShared<FrameState>()) {}
+    : AsyncTaskRunner(registry.GetShared<FrameState>(),
+                      registry.GetShared<settings::Flags>()) {}
+
+AsyncTaskRunner::AsyncTaskRunner(std::shared_ptr<FrameState> frame_state,
+                                 std::shared_ptr<settings::Flags> flags)
+    : AsyncTaskRunner(std::move(frame_state)) {
+  flags_ = std::move(flags);
+  flags_->AddListener(this);
+  if (flags_->GetFlag(settings::Flag::EnableParallelTaskExecution))
+    SetMaxConcurrentTasks(MaxWorkerThreads());
+}
 
-AsyncTaskRunner::AsyncTaskRunner(std::shared_ptr<FrameState> frame_state)
+AsyncTaskRunner::AsyncTaskRunner(std::shared_ptr<FrameState> frame_state,
+                                 int max_concurrent_tasks)
     : frame_state_(std::move(frame_state)) {
-  worker_thread_ = std::thread(&AsyncTaskRunner::ThreadProc, this);
+  SetMaxConcurrentTasks(max_concurrent_tasks);
 }
 
 AsyncTaskRunner::~AsyncTaskRunner() {
@@ -36,7 +50,32 @@ AsyncTaskRunner::~AsyncTaskRunner() {
     absl::MutexLock scoped_lock(&mutex_);
     should_exit_ = true;
   }
-  worker_thread_.join();
+  for (auto& thread : worker_threads_) thread.join();
+}
+
+int AsyncTaskRunner::MaxWorkerThreads() {
+  // hardware_concurrency() may return 0 if the value is not computable.
+  int hardware_threads = std::thread::hardware_concurrency();
+  return std::max(1, hardware_threads - 1);
+}
+
+void AsyncTaskRunner::SetMaxConcurrentTasks(int max_concurrent_tasks) {
+  max_concurrent_tasks =
+      std::min(std::max(1, max_concurrent_tasks), MaxWorkerThreads());
+  {
+    absl::MutexLock lock(&mutex_);
+    max_concurrent_tasks_ = max_concurrent_tasks;
+  }
+
+  // Worker threads are only ever added; if the limit is lowered, the extra
+  // threads will simply wait until it is raised again.
+  while (worker_threads_.size() < static_cast<size_t>(max_concurrent_tasks))
+    worker_threads_.emplace_back(&AsyncTaskRunner::ThreadProc, this);
+}
+
+void AsyncTaskRunner::OnFlagChanged(settings::Flag which, bool new_value) {
+  if (which == settings::Flag::EnableParallelTaskExecution)
+    SetMaxConcurrentTasks(new_value ? MaxWorkerThreads() : 1);
 }
 
 void AsyncTaskRunner::PushTask(std::unique_ptr<Task> task) {
@@ -49,6 +88,7 @@ void AsyncTaskRunner::PushTask(std::unique_ptr<Task> task) {
 
   TaskWrapper wrapper(std::move(task));
   if (num_pending_tasks_ == 0 && !wrapper.IsReadyForExecutePhase()) {
+    INK_TRACE_EVENT("task", "Task::PreExecute");
     wrapper.PreExecute();
   }
 
@@ -63,6 +103,7 @@ void AsyncTaskRunner::PushTask(std::unique_ptr<Task> task) {
 
 void AsyncTaskRunner::ServiceMainThreadTasks() {
   while (auto task = TakeNextPostExecuteTask()) {
+    INK_TRACE_EVENT("task", "Task::OnPostExecute");
     task.value().OnPostExecute();
     num_pending_tasks_--;
   }
@@ -71,15 +112,18 @@ void AsyncTaskRunner::ServiceMainThreadTasks() {
     framelock_.reset();
   } else {
     absl::MutexLock lock(&mutex_);
-    // If there's nothing currently executing on the background thread, and
+    // If there's nothing currently executing on the worker threads, and
     // nothing in the post-execution queue, we can run PreExecute() on the
     // next task. Note that we need to check the post-execution queue, even
     // though we just emptied it, because a task may have completed its Execute
     // phase and been asynchronously pushed to the post-execute queue since
     // then.
-    if (!is_executing_ && post_execute_tasks_.empty() &&
-        !async_tasks_.empty() && !async_tasks_.front().IsReadyForExecutePhase())
+    if (num_executing_ == 0 && executed_tasks_.empty() &&
+        !async_tasks_.empty() &&
+        !async_tasks_.front().IsReadyForExecutePhase()) {
+      INK_TRACE_EVENT("task", "Task::PreExecute");
       async_tasks_.front().PreExecute();
+    }
   }
 }
 
@@ -88,18 +132,24 @@ AsyncTaskRunner::TakeNextPostExecuteTask() {
   absl::optional<TaskWrapper> task;
 
   absl::MutexLock scoped_lock(&mutex_);
-  if (!post_execute_tasks_.empty()) {
-    task = std::move(post_execute_tasks_.front());
-    post_execute_tasks_.pop();
+  // Tasks may finish executing out of order, so we only pop the task that
+  // comes next in push order.
+  auto it = executed_tasks_.begin();
+  if (it != executed_tasks_.end() &&
+      it->first == next_post_execute_sequence_number_) {
+    task = std::move(it->second);
+    executed_tasks_.erase(it);
+    ++next_post_execute_sequence_number_;
   }
 
   return task;
 }
 
 void AsyncTaskRunner::ThreadProc() {
+  trace::SetCurrentThreadName("AsyncTaskRunner worker");
   while (true) {
     // Block until either should_exit_ is true, or the front task in
-    // async_queue_ is ready for execution.
+    // async_queue_ is ready for execution and there is a free execution slot.
     mutex_.LockWhen(
         absl::Condition(this, &AsyncTaskRunner::CanContinueAsyncExecution));
     if (should_exit_) {
@@ -112,22 +162,35 @@ void AsyncTaskRunner::ThreadProc() {
     ASSERT(!async_tasks_.empty());
     auto task = std::move(async_tasks_.front());
     async_tasks_.pop();
-    is_executing_ = true;
+    uint64_t sequence_number = next_execute_sequence_number_++;
+    num_executing_++;
+    bool is_serial = !task.CanExecuteInParallel();
+    if (is_serial) is_executing_serial_task_ = true;
     mutex_.Unlock();
 
-    task.Execute();
+    {
+      INK_TRACE_EVENT("task", "Task::Execute");
+      task.Execute();
+    }
 
     absl::MutexLock lock(&mutex_);
-    is_executing_ = false;
-    post_execute_tasks_.push(std::move(task));
+    num_executing_--;
+    if (is_serial) is_executing_serial_task_ = false;
+    executed_tasks_.emplace(sequence_number, std::move(task));
   }
 
   SLOG(SLOG_OBJ_LIFETIME, "taskrunner thread exit");
 }
 
 bool AsyncTaskRunner::CanContinueAsyncExecution() const {
-  return should_exit_ || (!async_tasks_.empty() &&
-                          async_tasks_.front().IsReadyForExecutePhase());
+  if (should_exit_) return true;
+  if (num_executing_ >= max_concurrent_tasks_ || is_executing_serial_task_ ||
+      async_tasks_.empty())
+    return false;
+  // A task that can't execute in parallel waits for the others to finish.
+  const TaskWrapper& next = async_tasks_.front();
+  return next.IsReadyForExecutePhase() &&
+         (num_executing_ == 0 || next.CanExecuteInParallel());
 }
 
 }  // namespace ink
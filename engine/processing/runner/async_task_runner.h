@@ -22,9 +22,12 @@
 #error "AsyncTaskRunner is not compatible with asm.js or non-threaded WASM.";
 #endif
 
+#include <cstdint>
+#include <map>
 #include <memory>
 // Note this library uses standard C++11 thread support libraries.
 #include <thread>
+#include <vector>
 
 #include "third_party/absl/base/thread_annotations.h"
 #include "third_party/absl/synchronization/mutex.h"
@@ -32,22 +35,43 @@
 #include "ink/engine/scene/frame_state/frame_state.h"
 #include "ink/engine/service/dependencies.h"
 #include "ink/engine/service/unchecked_registry.h"
+#include "ink/engine/settings/flags.h"
 
 namespace ink {
 
-// A task runner that performs work on a separate worker thread. Each tasks'
-// Execute() method is run on the worker thread, in the order that they were
-// pushed to the queue. ServiceMainThreadTasks() calls OnPostExecute() for each
-// task that has completed its Execute() method, in the same order -- this
-// occurs on the main thread.
+// A task runner that performs work on separate worker threads. Tasks are taken
+// from the queue in the order that they were pushed, and their Execute()
+// methods are run on the worker threads. ServiceMainThreadTasks() calls
+// OnPostExecute() for each task that has completed its Execute() method, in the
+// order that they were pushed -- this occurs on the main thread.
+//
+// By default, only one task may be in its Execute() phase at a time, i.e. the
+// tasks are executed serially on a single worker thread. When the
+// EnableParallelTaskExecution flag is set, up to MaxWorkerThreads() tasks whose
+// CanExecuteInParallel() returns true may execute concurrently. Any other task
+// executes alone: it waits for the tasks before it to finish executing, and
+// the tasks after it wait for it. OnPostExecute() is still called in push
+// order, holding back tasks that finish early until all of the tasks before
+// them have finished.
+//
+// A task that requires a PreExecute() phase acts as a barrier: its PreExecute()
+// method is not called until every task before it has completed its
+// OnPostExecute() phase, and no task after it may begin executing until its
+// PreExecute() phase is complete.
+//
 // Acquires a framerate lock when a task is pushed, and releases it in
 // ServiceMainThreadTasks() when no tasks remain.
-class AsyncTaskRunner : public ITaskRunner {
+class AsyncTaskRunner : public ITaskRunner, public settings::FlagListener {
  public:
-  using SharedDeps = service::Dependencies<FrameState>;
+  using SharedDeps = service::Dependencies<FrameState, settings::Flags>;
 
   explicit AsyncTaskRunner(const service::UncheckedRegistry& registry);
-  explicit AsyncTaskRunner(std::shared_ptr<FrameState> frame_state);
+  AsyncTaskRunner(std::shared_ptr<FrameState> frame_state,
+                  std::shared_ptr<settings::Flags> flags);
+  // Constructs an AsyncTaskRunner that is not driven by the engine flags, and
+  // runs at most max_concurrent_tasks Execute() phases at a time.
+  explicit AsyncTaskRunner(std::shared_ptr<FrameState> frame_state,
+                           int max_concurrent_tasks = 1);
 
   // Disallow copy and assign.
   AsyncTaskRunner(const AsyncTaskRunner&) = delete;
@@ -60,17 +84,29 @@ class AsyncTaskRunner : public ITaskRunner {
 
   // The number of tasks that have been pushed by PushTask and not popped by
   // ServiceMainThreadTasks yet. Note that this may not be the same as
-  // async_tasks_.size() + post_execute_tasks_.size(), as ThreadProc() and
+  // async_tasks_.size() + executed_tasks_.size(), as the worker threads and
   // ServiceMainThreadTasks() take ownership of a task before running Execute()
   // or PostExecute(), respectively.
   int NumPendingTasks() const override { return num_pending_tasks_; }
 
+  // Sets the number of tasks that may be in their Execute() phase at the same
+  // time, starting more worker threads if needed. The value is clamped to
+  // [1, MaxWorkerThreads()].
+  void SetMaxConcurrentTasks(int max_concurrent_tasks);
+
+  void OnFlagChanged(settings::Flag which, bool new_value) override;
+
+  // The number of worker threads used when parallel execution is enabled. This
+  // leaves one hardware thread for the main thread.
+  static int MaxWorkerThreads();
+
  private:
-  // Pops the foremost task off of the post-execution queue, taking ownership of
-  // it. Returns absl::nullopt if the post-execution queue is empty.
+  // Pops the next task, in push order, off of the post-execution queue, taking
+  // ownership of it. Returns absl::nullopt if that task has not finished its
+  // Execute() phase yet.
   absl::optional<TaskWrapper> TakeNextPostExecuteTask();
 
-  // This function indicates whether the worker thread may proceed with the
+  // This function indicates whether a worker thread may proceed with the
   // Execute() phase of the next task in the async queue.
   bool CanContinueAsyncExecution() const EXCLUSIVE_LOCKS_REQUIRED(mutex_);
 
@@ -78,24 +114,38 @@ class AsyncTaskRunner : public ITaskRunner {
   void ThreadProc();
 
   absl::Mutex mutex_;
-  std::thread worker_thread_;
+  std::vector<std::thread> worker_threads_;
   const std::shared_ptr<FrameState> frame_state_;
+  std::shared_ptr<settings::Flags> flags_;
   std::unique_ptr<FramerateLock> framelock_;
   int num_pending_tasks_ = 0;
 
   // This indicates that the AsyncTaskRunner destructor has been called, and
-  // that the worker thread should exit.
+  // that the worker threads should exit.
   bool should_exit_ GUARDED_BY(mutex_) = false;
 
-  // This indicates that the worker thread is currently running the Execute()
-  // phase of a task.
-  bool is_executing_ GUARDED_BY(mutex_) = false;
+  // The maximum number of tasks that may be in their Execute() phase at once.
+  int max_concurrent_tasks_ GUARDED_BY(mutex_) = 1;
 
-  // Tasks queued for execution on the worker thread.
+  // The number of tasks currently in their Execute() phase.
+  int num_executing_ GUARDED_BY(mutex_) = 0;
+
+  // Whether the task in its Execute() phase, if any, is one that must execute
+  // alone (see Task::CanExecuteInParallel()).
+  bool is_executing_serial_task_ GUARDED_BY(mutex_) = false;
+
+  // Tasks queued for execution on the worker threads.
   std::queue<TaskWrapper> async_tasks_ GUARDED_BY(mutex_);
 
-  // Tasks already executed on the worker thread and queued for post-execution.
-  std::queue<TaskWrapper> post_execute_tasks_ GUARDED_BY(mutex_);
+  // The sequence number that will be given to the next task taken from
+  // async_tasks_, and the sequence number of the next task to be popped for
+  // post-execution. Because tasks are taken from async_tasks_ in order, the
+  // sequence numbers reflect the push order.
+  uint64_t next_execute_sequence_number_ GUARDED_BY(mutex_) = 0;
+  uint64_t next_post_execute_sequence_number_ GUARDED_BY(mutex_) = 0;
+
+  // Tasks that have completed their Execute() phase, keyed by sequence number.
+  std::map<uint64_t, TaskWrapper> executed_tasks_ GUARDED_BY(mutex_);
 };
 
 }  // namespace ink
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INK_ENGINE_PROCESSING_RUNNER_PARALLEL_FOR_H_
+#define INK_ENGINE_PROCESSING_RUNNER_PARALLEL_FOR_H_
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#if (defined(__asmjs__) || defined(__wasm__)) && \
+    !defined(__EMSCRIPTEN_PTHREADS__)
+#define INK_PARALLEL_FOR_HAS_THREADS 0
+#else
+#define INK_PARALLEL_FOR_HAS_THREADS 1
+#include <thread>
+#endif
+
+namespace ink {
+
+// Calls fn(i) for each i in [0, n), spread over up to max_threads threads,
+// including the calling thread, and returns once all of the calls have
+// returned. Threads take the indices in order as they finish their previous
+// ones, so items whose cost varies widely are still balanced.
+//
+// The caller chooses max_threads: code that runs inside a task that executes in
+// parallel with others (see Task::CanExecuteInParallel()) should pass 1, rather
+// than starting threads of its own. Other tasks' Execute() phases run alone,
+// and may use HardwareThreads(). Where threads are unavailable (asm.js and WASM
+// without pthreads), fn is always called on the calling thread.
+template <typename Fn>
+void ParallelFor(int n, int max_threads, const Fn& fn) {
+  int n_threads = std::max(1, std::min(max_threads, n));
+#if INK_PARALLEL_FOR_HAS_THREADS
+  if (n_threads > 1) {
+    std::atomic<int> next(0);
+    auto run = [n, &fn, &next]() {
+      for (int i = next++; i < n; i = next++) fn(i);
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(n_threads - 1);
+    for (int t = 1; t < n_threads; ++t) threads.emplace_back(run);
+    run();
+    for (auto& thread : threads) thread.join();
+    return;
+  }
+#endif
+  for (int i = 0; i < n; ++i) fn(i);
+}
+
+// The number of hardware threads, or 1 where threads are unavailable or the
+// number is not computable. This is a sensible max_threads for callers on the
+// main thread, or in tools.
+inline int HardwareThreads() {
+#if INK_PARALLEL_FOR_HAS_THREADS
+  return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+#else
+  return 1;
+#endif
+}
+
+}  // namespace ink
+
+#endif  // INK_ENGINE_PROCESSING_RUNNER_PARALLEL_FOR_H_
@@ -32,6 +32,7 @@ class SequencePointTask : public Task {
   bool RequiresPreExecute() const override { return false; }
   void PreExecute() override {}
   void Execute() override {}
+  bool CanExecuteInParallel() const override { return true; }
   void OnPostExecute() override;
 
  private:
@@ -49,8 +49,17 @@ class Task {
   // be called on the main thread, and as such should not modify anything in the
   // scene -- rather, it should save it results, and commit them in the
   // OnPostExecute() phase.
+  // NOTE: Unless CanExecuteInParallel() returns true, no other task's
+  // Execute() phase runs at the same time as this one. OnPostExecute() is
+  // always called in the order that the tasks were pushed.
   virtual void Execute() = 0;
 
+  // Whether the Execute() phase may run concurrently with the Execute() phases
+  // of other tasks, on a task runner that runs tasks in parallel. A task should
+  // only return true if Execute() reads and writes nothing but the task's own
+  // members, and starts no threads of its own.
+  virtual bool CanExecuteInParallel() const { return false; }
+
   // This function may be used to perform any work that must occur on the main
   // thread after the Execute() phase, such as committing the results from the
   // Execute() phase.
@@ -123,6 +132,9 @@ class ITaskRunner {
       is_pre_execute_complete_ = true;
     }
     void Execute() override { task_->Execute(); }
+    bool CanExecuteInParallel() const override {
+      return task_->CanExecuteInParallel();
+    }
     void OnPostExecute() override { task_->OnPostExecute(); }
 
     bool IsReadyForExecutePhase() const {
@@ -0,0 +1,110 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Replays recorded PlaybackStreams against a headless engine and reports
+// input latency, frame time, task latency and peak memory as JSON, e.g.:
+//   replay_benchmark --streams=scribble.pb,pan_zoom.pb --output=results.json
+// With --export_max_dimension_px, each scene is also exported with the software
+// backend, and compared with <--gl_export_dir>/<stream basename>.rgba, the raw
+// RGBA bytes of the same export rendered with the GL backend, if it exists.
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "base/commandlineflags.h"
+#include "base/init_google.h"
+#include "base/logging.h"
+#include "file/base/helpers.h"
+#include "file/base/options.h"
+#include "file/base/path.h"
+#include "third_party/absl/flags/flag.h"
+#include "third_party/absl/strings/str_cat.h"
+#include "third_party/absl/strings/str_split.h"
+#include "ink/engine/public/replay/replay_harness.h"
+#include "ink/proto/sengine_portable_proto.pb.h"
+
+ABSL_FLAG(string, streams, "",
+          "Comma-separated paths of serialized PlaybackStreams to replay.");
+ABSL_FLAG(string, output, "",
+          "Path of the JSON file to write. If empty, JSON is written to "
+          "stdout.");
+ABSL_FLAG(double, frame_interval_ms, 1000.0 / 60,
+          "Interval of recorded input time at which frames are drawn.");
+ABSL_FLAG(int32, max_flush_frames, 600,
+          "Most frames to draw after the last input, while tasks are pending.");
+ABSL_FLAG(uint64, random_seed, 0, "Random seed for the engine.");
+ABSL_FLAG(int32, export_max_dimension_px, 0,
+          "If non-zero, each scene is exported with the software backend at "
+          "this size.");
+ABSL_FLAG(string, gl_export_dir, "",
+          "Directory of the GL backend's exports, as raw RGBA bytes named "
+          "<stream basename>.rgba, to compare the software exports with.");
+ABSL_FLAG(int32, export_tolerance, 8,
+          "Largest channel difference from the GL export that a pixel may "
+          "have without being counted.");
+
+namespace ink {
+void exit() { std::exit(-1); }
+}  // namespace ink
+
+int main(int argc, char** argv) {
+  InitGoogle(argv[0], &argc, &argv, true);
+
+  const string streams = absl::GetFlag(FLAGS_streams);
+  const string output_path = absl::GetFlag(FLAGS_output);
+  QCHECK(!streams.empty()) << "Requires --streams=<path>[,<path>...]";
+
+  ink::replay::ReplayOptions options;
+  options.frame_interval_s = absl::GetFlag(FLAGS_frame_interval_ms) / 1000;
+  options.max_flush_frames = absl::GetFlag(FLAGS_max_flush_frames);
+  options.random_seed = absl::GetFlag(FLAGS_random_seed);
+  QCHECK_GT(options.frame_interval_s, 0) << "--frame_interval_ms must be > 0";
+  QCHECK_GE(absl::GetFlag(FLAGS_export_max_dimension_px), 0);
+  options.export_max_dimension_px =
+      absl::GetFlag(FLAGS_export_max_dimension_px);
+  options.export_tolerance = absl::GetFlag(FLAGS_export_tolerance);
+  const string gl_export_dir = absl::GetFlag(FLAGS_gl_export_dir);
+  if (!gl_export_dir.empty()) {
+    options.load_gl_export = [&gl_export_dir](const string& name,
+                                              string* rgba) {
+      const string path = file::JoinPath(
+          gl_export_dir, absl::StrCat(file::Basename(name), ".rgba"));
+      return file::GetContents(path, rgba, file::Defaults()).ok();
+    };
+  }
+  ink::replay::ReplayHarness harness(options);
+
+  std::vector<ink::replay::ReplayResult> results;
+  for (const string& path :
+       std::vector<string>(absl::StrSplit(streams, ',', absl::SkipEmpty()))) {
+    string data;
+    QCHECK_OK(file::GetContents(path, &data, file::Defaults()));
+    ink::proto::PlaybackStream stream;
+    QCHECK(stream.ParseFromString(data))
+        << "Could not parse " << path << " as PlaybackStream.";
+    results.push_back(harness.Replay(path, stream));
+    LOG(INFO) << path << ": " << results.back().input_count << " inputs, "
+              << results.back().frame_count << " frames";
+  }
+
+  const string json = ink::replay::ReplayHarness::ToJson(results);
+  if (output_path.empty()) {
+    std::cout << json;
+  } else {
+    QCHECK_OK(file::SetContents(output_path, json, file::Overwrite()));
+  }
+  return 0;
+}
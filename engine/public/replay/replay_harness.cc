@@ -0,0 +1,397 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/public/replay/replay_harness.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdlib>
+#include <memory>
+#include <utility>
+
+#include "geo/render/ion/gfx/tests/fakeglcontext.h"
+#include "geo/render/ion/gfx/tests/fakegraphicsmanager.h"
+#include "geo/render/ion/portgfx/glcontext.h"
+#include "third_party/absl/memory/memory.h"
+#include "third_party/absl/strings/str_cat.h"
+#include "third_party/absl/strings/substitute.h"
+#include "ink/engine/camera/camera.h"
+#include "ink/engine/input/sinput.h"
+#include "ink/engine/input/sinput_helpers.h"
+#include "ink/engine/processing/runner/deterministic_task_runner.h"
+#include "ink/engine/processing/runner/task_runner.h"
+#include "ink/engine/public/host/host.h"
+#include "ink/engine/public/sengine.h"
+#include "ink/engine/public/types/exported_image.h"
+#include "ink/engine/rendering/export/image_exporter.h"
+#include "ink/engine/rendering/gl_managers/gl_resource_manager.h"
+#include "ink/engine/rendering/gl_managers/ion_graphics_manager_provider.h"
+#include "ink/engine/scene/default_services.h"
+#include "ink/engine/scene/frame_state/frame_state.h"
+#include "ink/engine/service/dependencies.h"
+#include "ink/engine/settings/flags.h"
+#include "ink/engine/util/dbg/log.h"
+#include "ink/engine/util/time/wall_clock.h"
+#include "ink/public/document/single_user_document.h"
+#include "ink/public/document/storage/in_memory_storage.h"
+
+namespace ink {
+namespace replay {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+size_t PeakRssBytes() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+  return static_cast<size_t>(usage.ru_maxrss);
+#else
+  // Linux reports kilobytes.
+  return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+// Counts the elements that the engine adds, and otherwise ignores everything.
+class ReplayHost : public Host {
+ public:
+  void BindScreen() override {}
+  bool ShouldPreloadShaders() const override { return false; }
+  void ElementsAdded(const proto::ElementBundleAdds& element_bundle_adds,
+                     const proto::SourceDetails& source_details) override {
+    elements_added_ += element_bundle_adds.element_bundle_add_size();
+  }
+
+  size_t ElementsAddedCount() const { return elements_added_; }
+
+ private:
+  size_t elements_added_ = 0;
+};
+
+// A clock that reads whatever time it was last set to, so that everything
+// that depends on it follows the recorded input times.
+class ReplayClock : public WallClockInterface {
+ public:
+  WallTimeS CurrentTime() const override { return time_; }
+  void SetTime(WallTimeS time) { time_ = time; }
+
+ private:
+  WallTimeS time_{0};
+};
+
+class FakeGraphicsManagerProvider : public IonGraphicsManagerProvider {
+ public:
+  FakeGraphicsManagerProvider()
+      : graphics_manager_(new ion::gfx::testing::FakeGraphicsManager()) {}
+
+  ion::gfx::GraphicsManagerPtr GetGraphicsManager() override {
+    return graphics_manager_;
+  }
+
+ private:
+  ion::gfx::GraphicsManagerPtr graphics_manager_;
+};
+
+// Runs tasks with a DeterministicTaskRunner, recording how long each waits
+// between being pushed and completing.
+class TimedTaskRunner : public ITaskRunner {
+ public:
+  using SharedDeps = service::Dependencies<FrameState>;
+
+  explicit TimedTaskRunner(std::shared_ptr<FrameState> frame_state)
+      : runner_(std::move(frame_state)) {}
+
+  void PushTask(std::unique_ptr<Task> task) override {
+    runner_.PushTask(absl::make_unique<TimedTask>(std::move(task), this));
+  }
+  void ServiceMainThreadTasks() override { runner_.ServiceMainThreadTasks(); }
+  int NumPendingTasks() const override { return runner_.NumPendingTasks(); }
+
+  const std::vector<double>& TaskLatencies() const { return latencies_s_; }
+
+ private:
+  class TimedTask : public Task {
+   public:
+    TimedTask(std::unique_ptr<Task> task, TimedTaskRunner* runner)
+        : task_(std::move(task)), runner_(runner), push_time_(Clock::now()) {}
+
+    bool RequiresPreExecute() const override {
+      return task_->RequiresPreExecute();
+    }
+    void PreExecute() override { task_->PreExecute(); }
+    void Execute() override { task_->Execute(); }
+    bool CanExecuteInParallel() const override {
+      return task_->CanExecuteInParallel();
+    }
+    void OnPostExecute() override {
+      task_->OnPostExecute();
+      runner_->latencies_s_.push_back(SecondsSince(push_time_));
+    }
+
+   private:
+    std::unique_ptr<Task> task_;
+    TimedTaskRunner* runner_;
+    Clock::time_point push_time_;
+  };
+
+  DeterministicTaskRunner runner_;
+  std::vector<double> latencies_s_;
+};
+
+// Appends "name": {...} for the stats, with durations in microseconds.
+void AppendJson(const std::string& name, const LatencyStats& stats,
+                std::string* out) {
+  absl::SubstituteAndAppend(
+      out,
+      R"("$0": {"count": $1, "mean_us": $2, "p50_us": $3, "p90_us": $4, )"
+      R"("p99_us": $5, "max_us": $6})",
+      name, stats.count, stats.mean_s * 1e6, stats.p50_s * 1e6,
+      stats.p90_s * 1e6, stats.p99_s * 1e6, stats.max_s * 1e6);
+}
+
+// Compares the software export with the GL export's RGBA bytes, setting the
+// export_* fields of the result.
+void CompareExports(const ExportedImage& image, const std::string& gl_rgba,
+                    int tolerance, ReplayResult* result) {
+  if (gl_rgba.size() != image.bytes.size()) {
+    SLOG(SLOG_ERROR,
+         "Cannot compare the exports of $0: the GL export has $1 bytes, but "
+         "the software export has $2",
+         result->name, gl_rgba.size(), image.bytes.size());
+    return;
+  }
+  result->export_compared = true;
+  for (size_t px = 0; px < image.bytes.size(); px += 4) {
+    int diff = 0;
+    for (size_t c = px; c < px + 4; ++c) {
+      diff = std::max(diff, std::abs(static_cast<int>(image.bytes[c]) -
+                                     static_cast<uint8_t>(gl_rgba[c])));
+    }
+    result->export_max_channel_diff =
+        std::max(result->export_max_channel_diff, diff);
+    if (diff > tolerance) ++result->export_pixels_over_tolerance;
+  }
+}
+
+// Escapes the characters that may not appear in a JSON string as they are.
+std::string JsonEscape(const std::string& s) {
+  std::string escaped;
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      escaped.push_back('\\');
+      escaped.push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      static const char kHexDigits[] = "0123456789abcdef";
+      absl::StrAppend(&escaped, "\\u00", std::string(1, kHexDigits[c >> 4]),
+                      std::string(1, kHexDigits[c & 0xf]));
+    } else {
+      escaped.push_back(c);
+    }
+  }
+  return escaped;
+}
+
+}  // namespace
+
+LatencyStats LatencyStats::FromSamples(std::vector<double> samples_s) {
+  LatencyStats stats;
+  if (samples_s.empty()) return stats;
+  std::sort(samples_s.begin(), samples_s.end());
+  double total = 0;
+  for (double s : samples_s) total += s;
+  auto percentile = [&samples_s](double p) {
+    size_t i = static_cast<size_t>(p * (samples_s.size() - 1) + .5);
+    return samples_s[i];
+  };
+  stats.count = samples_s.size();
+  stats.mean_s = total / samples_s.size();
+  stats.p50_s = percentile(.5);
+  stats.p90_s = percentile(.9);
+  stats.p99_s = percentile(.99);
+  stats.max_s = samples_s.back();
+  return stats;
+}
+
+ReplayOptions::ReplayOptions() {
+  tool_params.set_tool(proto::ToolParams::LINE);
+  tool_params.set_brush_type(proto::BrushType::BALLPOINT);
+  tool_params.set_rgba(0x000000ff);
+  tool_params.mutable_line_size()->set_stroke_width(2);
+  tool_params.mutable_line_size()->set_units(proto::LineSize::POINTS);
+}
+
+ReplayHarness::ReplayHarness(const ReplayOptions& options)
+    : options_(options) {}
+
+ReplayResult ReplayHarness::Replay(const std::string& name,
+                                   const proto::PlaybackStream& stream) const {
+  ReplayResult result;
+  result.name = name;
+  if (!stream.has_initial_camera() || stream.events_size() == 0) {
+    SLOG(SLOG_ERROR, "Cannot replay $0: it has no initial camera or no events",
+         name);
+    return result;
+  }
+
+  // Ion's fake GL context must be current while the engine exists.
+  auto gl_context = ion::gfx::testing::FakeGlContext::Create(
+      stream.initial_camera().viewport().width(),
+      stream.initial_camera().viewport().height());
+  ion::portgfx::GlContext::MakeCurrent(gl_context);
+
+  auto clock = std::make_shared<ReplayClock>();
+  auto definitions = DefaultServiceDefinitions();
+  definitions->DefineService<IonGraphicsManagerProvider,
+                             FakeGraphicsManagerProvider>();
+  definitions->DefineExistingService<WallClockInterface>(clock);
+  definitions->DefineService<ITaskRunner, TimedTaskRunner>();
+
+  auto host = std::make_shared<ReplayHost>();
+  SEngine engine(host, stream.initial_camera().viewport(),
+                 options_.random_seed,
+                 std::make_shared<SingleUserDocument>(
+                     std::make_shared<InMemoryStorage>()),
+                 std::move(definitions));
+  engine.SetCameraPosition(stream.initial_camera().position());
+  engine.setToolParams(options_.tool_params);
+  if (options_.export_max_dimension_px > 0) {
+    auto* flags = engine.registry()->Get<settings::Flags>();
+    flags->SetFlag(settings::Flag::KeepMeshesInCpuMemory, true);
+    flags->SetFlag(settings::Flag::KeepTexturesInCpuMemory, true);
+  }
+  auto* task_runner =
+      static_cast<TimedTaskRunner*>(engine.registry()->Get<ITaskRunner>());
+
+  std::vector<double> input_latencies;
+  std::vector<double> frame_times;
+  double next_frame_time = 0;
+  bool has_frame_time = false;
+  auto draw_frame = [&]() {
+    clock->SetTime(WallTimeS(next_frame_time));
+    result.max_pending_tasks =
+        std::max(result.max_pending_tasks, task_runner->NumPendingTasks());
+    Clock::time_point start = Clock::now();
+    engine.draw(next_frame_time);
+    frame_times.push_back(SecondsSince(start));
+    next_frame_time += options_.frame_interval_s;
+  };
+
+  bool success = ProcessPlaybackStream(
+      stream,
+      [&engine, &stream](const size_t index, const Camera& camera) {
+        engine.SetCameraPosition(
+            stream.events(index).camera_on_input().position());
+        return true;
+      },
+      [&](const size_t index, const Camera& camera, SInput sinput) {
+        double input_time = static_cast<double>(sinput.time_s);
+        if (!has_frame_time) {
+          next_frame_time = input_time;
+          has_frame_time = true;
+        }
+        // Draw the frames that would have been drawn before this input
+        // arrived.
+        while (next_frame_time <= input_time) draw_frame();
+        clock->SetTime(WallTimeS(input_time));
+
+        Clock::time_point start = Clock::now();
+        engine.dispatchInput(sinput.type, sinput.id, sinput.flags, input_time,
+                             sinput.screen_pos.x, sinput.screen_pos.y,
+                             sinput.wheel_delta_x, sinput.wheel_delta_y,
+                             sinput.pressure, sinput.tilt, sinput.orientation);
+        input_latencies.push_back(SecondsSince(start));
+        return true;
+      });
+  if (!success) SLOG(SLOG_ERROR, "Errors occurred while replaying $0", name);
+
+  // Let the engine finish the work that the inputs started.
+  draw_frame();
+  for (int i = 0;
+       i < options_.max_flush_frames && task_runner->NumPendingTasks() > 0; ++i)
+    draw_frame();
+
+  result.input_count = input_latencies.size();
+  result.frame_count = frame_times.size();
+  result.elements_added = host->ElementsAddedCount();
+  result.input_latency = LatencyStats::FromSamples(std::move(input_latencies));
+  result.frame_time = LatencyStats::FromSamples(std::move(frame_times));
+  result.task_latency = LatencyStats::FromSamples(task_runner->TaskLatencies());
+  result.peak_rss_bytes = PeakRssBytes();
+  const auto& mesh_stats = engine.registry()
+                               ->Get<GLResourceManager>()
+                               ->shader_manager->PackedShader()
+                               .GetStats();
+  result.draw_calls = mesh_stats.draw_calls;
+  result.shader_binds = mesh_stats.shader_binds;
+  result.texture_binds = mesh_stats.texture_binds;
+
+  if (options_.export_max_dimension_px > 0) {
+    ExportedImage image;
+    Clock::time_point start = Clock::now();
+    engine.registry()->Get<ImageExporter>()->Render(
+        options_.export_max_dimension_px,
+        engine.registry()->Get<Camera>()->WorldWindow(),
+        ImageExporter::BackgroundOptions::kDraw,
+        ImageExporter::CurrentToolOptions::kSkip,
+        ImageExporter::DrawablesOptions::kSkip,
+        ImageExporter::BackendOptions::kSoftware, kInvalidElementId, &image);
+    result.export_time_s = SecondsSince(start);
+    std::string gl_rgba;
+    if (options_.load_gl_export && options_.load_gl_export(name, &gl_rgba)) {
+      CompareExports(image, gl_rgba, options_.export_tolerance, &result);
+    }
+  }
+  return result;
+}
+
+std::string ReplayHarness::ToJson(const std::vector<ReplayResult>& results) {
+  std::string json = "{\"results\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const ReplayResult& r = results[i];
+    if (i > 0) json.append(",");
+    absl::SubstituteAndAppend(
+        &json,
+        "\n  {\"name\": \"$0\", \"input_count\": $1, \"frame_count\": $2, "
+        "\"elements_added\": $3, \"max_pending_tasks\": $4, "
+        "\"peak_rss_bytes\": $5, \"draw_calls\": $6, "
+        "\"shader_binds\": $7, \"texture_binds\": $8, ",
+        JsonEscape(r.name), r.input_count, r.frame_count, r.elements_added,
+        r.max_pending_tasks, r.peak_rss_bytes, r.draw_calls, r.shader_binds,
+        r.texture_binds);
+    absl::SubstituteAndAppend(
+        &json,
+        "\"export_us\": $0, \"export_compared\": $1, "
+        "\"export_max_channel_diff\": $2, "
+        "\"export_pixels_over_tolerance\": $3, ",
+        r.export_time_s * 1e6, r.export_compared ? "true" : "false",
+        r.export_max_channel_diff, r.export_pixels_over_tolerance);
+    AppendJson("input_latency", r.input_latency, &json);
+    json.append(", ");
+    AppendJson("frame_time", r.frame_time, &json);
+    json.append(", ");
+    AppendJson("task_latency", r.task_latency, &json);
+    json.append("}");
+  }
+  json.append("\n]}\n");
+  return json;
+}
+
+}  // namespace replay
+}  // namespace ink
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INK_ENGINE_PUBLIC_REPLAY_REPLAY_HARNESS_H_
+#define INK_ENGINE_PUBLIC_REPLAY_REPLAY_HARNESS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ink/proto/sengine_portable_proto.pb.h"
+
+namespace ink {
+namespace replay {
+
+// Summarizes a set of durations, in seconds.
+struct LatencyStats {
+  size_t count = 0;
+  double mean_s = 0;
+  double p50_s = 0;
+  double p90_s = 0;
+  double p99_s = 0;
+  double max_s = 0;
+
+  static LatencyStats FromSamples(std::vector<double> samples_s);
+};
+
+struct ReplayOptions {
+  // The tool with which the streams are replayed. By default, a ballpoint pen.
+  proto::ToolParams tool_params;
+  // Frames are drawn at this interval of the recorded input time, so that the
+  // number of frames, and the inputs handled in each, don't depend on how
+  // fast the replay runs.
+  double frame_interval_s = 1.0 / 60;
+  // After the last input, frames are drawn until no tasks are pending, up to
+  // this many.
+  int max_flush_frames = 600;
+  uint64_t random_seed = 0;
+
+  // If non-zero, once each stream has been replayed, the camera's view of the
+  // scene is exported with the software backend at this size (see
+  // ImageExporter::Render()), and the export is timed. The engine then holds
+  // its meshes and textures in CPU memory, which the software backend needs.
+  uint32_t export_max_dimension_px = 0;
+  // If set, this is called with the stream's name to load the raw RGBA bytes
+  // of the same export rendered with the GL backend, which the fake GL context
+  // cannot do, so they are captured on a device. It returns false if there is
+  // no such image, in which case the export isn't compared.
+  std::function<bool(const std::string& name, std::string* rgba)>
+      load_gl_export;
+  // The largest difference in any channel that a pixel of the software export
+  // may have from the GL export without being counted in
+  // ReplayResult::export_pixels_over_tolerance. The backends antialias edges
+  // differently, so some difference is expected there.
+  int export_tolerance = 8;
+
+  ReplayOptions();
+};
+
+struct ReplayResult {
+  std::string name;
+  size_t input_count = 0;
+  size_t frame_count = 0;
+  size_t elements_added = 0;
+  // The wall time taken by SEngine::dispatchInput() for each input, which
+  // covers InputDispatch, the tool and its LineBuilder.
+  LatencyStats input_latency;
+  // The wall time taken by each frame, including the tasks serviced in it.
+  LatencyStats frame_time;
+  // The wall time from when each task was pushed until its OnPostExecute()
+  // phase completed.
+  LatencyStats task_latency;
+  // The largest number of tasks pending at the start of a frame.
+  int max_pending_tasks = 0;
+  // The mesh shader's draw calls and state changes over all frames. See
+  // shaders::PackedVertShader::Stats.
+  uint64_t draw_calls = 0;
+  uint64_t shader_binds = 0;
+  uint64_t texture_binds = 0;
+  // The process's peak resident set size once the stream was replayed. This
+  // never decreases, so it is only an upper bound for later streams.
+  size_t peak_rss_bytes = 0;
+  // The wall time taken by the software export, if there was one (see
+  // ReplayOptions::export_max_dimension_px).
+  double export_time_s = 0;
+  // Whether the software export was compared with the GL export, the largest
+  // difference in any channel, and the number of pixels whose difference was
+  // more than ReplayOptions::export_tolerance.
+  bool export_compared = false;
+  int export_max_channel_diff = 0;
+  size_t export_pixels_over_tolerance = 0;
+};
+
+// Replays recorded input streams against a headless engine, backed by a fake
+// GL context, a DeterministicTaskRunner and a clock that follows the recorded
+// input times, so that each replay of a stream does the same work.
+//
+// Each stream is replayed in a new engine, with the stream's initial camera,
+// by dispatching its inputs one at a time. camera_on_input events move the
+// camera, as they would with SEngine::dispatchInput(stream, true).
+class ReplayHarness {
+ public:
+  explicit ReplayHarness(const ReplayOptions& options);
+
+  ReplayResult Replay(const std::string& name,
+                      const proto::PlaybackStream& stream) const;
+
+  // Returns the results as a JSON object, with one entry per result in
+  // "results", and durations in microseconds.
+  static std::string ToJson(const std::vector<ReplayResult>& results);
+
+ private:
+  ReplayOptions options_;
+};
+
+}  // namespace replay
+}  // namespace ink
+
+#endif  // INK_ENGINE_PUBLIC_REPLAY_REPLAY_HARNESS_H_
@@ -14,6 +14,8 @@
 
 #include "ink/engine/public/sengine.h"
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "third_party/absl/memory/memory.h"
 #include "third_party/absl/strings/match.h"
@@ -29,8 +31,10 @@
 #include "ink/engine/public/types/uuid.h"
 #include "ink/engine/realtime/edit_tool.h"
 #include "ink/engine/rendering/compositing/live_renderer.h"
+#include "ink/engine/rendering/export/image_exporter.h"
 #include "ink/engine/rendering/gl_managers/text_texture_provider.h"
 #include "ink/engine/rendering/strategy/rendering_strategy.h"
+#include "ink/engine/scene/data/common/poly_store.h"
 #include "ink/engine/scene/default_services.h"
 #include "ink/engine/scene/element_animation/element_animation.h"
 #include "ink/engine/scene/element_animation/element_animation_controller.h"
@@ -44,6 +48,7 @@
 #include "ink/engine/scene/types/element_bundle.h"
 #include "ink/engine/scene/types/element_metadata.h"
 #include "ink/engine/util/dbg/glerrors.h"
+#include "ink/engine/util/dbg/trace.h"
 #include "ink/engine/util/dbg_helper.h"
 #include "ink/engine/util/funcs/rand_funcs.h"
 #include "ink/engine/util/funcs/utils.h"
@@ -208,15 +213,16 @@ void SEngine::SetDocument(std::shared_ptr<Document> document) {
             .IgnoreError();
       }
     }
-    for (const auto& b : snapshot.element()) {
+    std::vector<proto::ElementBundle> elements;
+    elements.reserve(snapshot.element_size());
+    for (auto& b : *snapshot.mutable_element()) {
       if (!b.element().attributes().is_group()) {
         SLOG(SLOG_DOCUMENT, "loading element $0 as child of $1", b.uuid(),
              b.group_uuid());
-        root_controller_->unsafe_helper_
-            ->AddElement(b, kInvalidUUID, host_source)
-            .IgnoreError();
+        elements.push_back(std::move(b));
       }
     }
+    root_controller_->BulkLoadElements(std::move(elements), host_source);
 
     // If we have an active layer stored in the document, set it active in
     // LayerManager. If we don't have an element with that ID, we fall back to
@@ -399,6 +405,7 @@ class UndoRedoTask : public Task {
   bool RequiresPreExecute() const override { return false; }
   void PreExecute() override {}
   void Execute() override {}
+  bool CanExecuteInParallel() const override { return true; }
   void OnPostExecute() override {
     if (auto document = weak_document_.lock()) {
       switch (operation_) {
@@ -838,10 +845,14 @@ void SEngine::startImageExport(const proto::ImageExport& image_export) {
     }
     render_only_group = render_only_group_or.ValueOrDie();
   }
+  ImageExporter::BackendOptions backend_options =
+      image_export.use_software_rasterizer()
+          ? ImageExporter::BackendOptions::kSoftware
+          : ImageExporter::BackendOptions::kGL;
   ExportedImage img;
   root_controller_->Render(image_export.max_dimension_px(),
                            image_export.should_draw_background(), world_rect,
-                           render_only_group, &img);
+                           render_only_group, backend_options, &img);
   host_->ImageExportComplete(img.size_px.x, img.size_px.y, img.bytes,
                              img.fingerprint);
 }
@@ -850,9 +861,27 @@ void SEngine::exportImage(uint32_t maxPixelDimension, Rect worldRect,
                           ExportedImage* out) {
   constexpr bool shouldDrawBackground = true;
   root_controller_->Render(maxPixelDimension, shouldDrawBackground, worldRect,
-                           kInvalidElementId, out);
+                           kInvalidElementId,
+                           ImageExporter::BackendOptions::kGL, out);
+}
+
+void SEngine::exportImageTiled(uint32_t maxPixelDimension, Rect worldRect,
+                               bool useSoftwareRasterizer,
+                               ImageExportSink* sink) {
+  constexpr bool shouldDrawBackground = true;
+  root_controller_->RenderTiled(
+      maxPixelDimension, shouldDrawBackground, worldRect, kInvalidElementId,
+      useSoftwareRasterizer ? ImageExporter::BackendOptions::kSoftware
+                            : ImageExporter::BackendOptions::kGL,
+      sink);
+}
+
+std::string SEngine::exportTrace() const {
+  return trace::ExportChromeTraceJson();
 }
 
+void SEngine::clearTrace() { trace::Clear(); }
+
 void SEngine::addImageData(const proto::ImageInfo& image_info,
                            const ClientBitmap& client_bitmap) {
   if (!image_info.has_uri()) {
@@ -1059,6 +1088,10 @@ void SEngine::setHandwritingDataEnabled(bool enabled) {
       ->SetCallbackFlags(SourceDetails::FromEngine(), flags);
 }
 
+void SEngine::setMeshMemoryBudget(uint32_t maxBytes) {
+  root_controller_->service<PolyStore>()->SetMemoryBudget(maxBytes);
+}
+
 void SEngine::setCameraBoundsConfig(
     const proto::CameraBoundsConfig& camera_bounds_config) {
   if (!BoundsCheckIncInc(camera_bounds_config.fraction_padding(), 0,
@@ -35,6 +35,7 @@
 #include "ink/engine/public/types/itexture_request_handler.h"
 #include "ink/engine/public/types/status.h"
 #include "ink/engine/public/types/uuid.h"
+#include "ink/engine/rendering/export/image_exporter.h"
 #include "ink/engine/rendering/gl_managers/text_texture_provider.h"
 #include "ink/engine/rendering/strategy/rendering_strategy.h"
 #include "ink/engine/scene/graph/scene_change_notifier.h"
@@ -209,6 +210,21 @@ class SEngine : public IDocumentListener {
   void exportImage(uint32_t maxPixelDimension, Rect worldRect,
                    ExportedImage* out);
 
+  // Render a bitmap of the current scene as exportImage() does, but without
+  // limiting its size to GL_MAX_TEXTURE_SIZE. The bitmap is rendered in tiles
+  // and written to sink one band of rows at a time. If useSoftwareRasterizer
+  // is true, the tiles are rasterized on the CPU, in parallel (see
+  // proto::ImageExport.use_software_rasterizer).
+  void exportImageTiled(uint32_t maxPixelDimension, Rect worldRect,
+                        bool useSoftwareRasterizer, ImageExportSink* sink);
+
+  // Returns the events recorded while the ENABLE_TRACING flag was set, as
+  // Chrome trace_event JSON (see chrome://tracing). Tracing is process-wide,
+  // so this includes the events of every engine in the process.
+  std::string exportTrace() const;
+  // Discards the recorded trace events.
+  void clearTrace();
+
   void SetCameraPosition(const Rect& position);
   void SetCameraPosition(const proto::CameraPosition& position);
   proto::CameraPosition GetCameraPosition() const;
@@ -234,6 +250,13 @@ class SEngine : public IDocumentListener {
   void setOutlineExportEnabled(bool enabled);
   void setHandwritingDataEnabled(bool enabled);
 
+  // Sets the target size, in bytes, of the stroke meshes held in memory. Meshes
+  // of elements far from the camera's window are evicted to meet it, and are
+  // rebuilt from their compressed form when needed again. Only elements that
+  // are added after the budget is set can be evicted, so this should be called
+  // before a document is loaded. 0, the default, means no budget.
+  void setMeshMemoryBudget(uint32_t maxBytes);
+
   void setCameraBoundsConfig(
       const proto::CameraBoundsConfig& cameraBoundsConfig);
 
@@ -0,0 +1,125 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/public/types/interned_uuid.h"
+
+#include <memory>
+
+#include "third_party/absl/container/flat_hash_map.h"
+#include "third_party/absl/memory/memory.h"
+#include "third_party/absl/synchronization/mutex.h"
+
+namespace ink {
+
+using interned_uuid_internal::Entry;
+
+namespace {
+
+// The entries are keyed by views of their own strings, which don't move while
+// the entries are in the pool.
+//
+// A count only drops from 1 to 0 in Release(), under the writer lock, which
+// also removes the entry. Intern() and Find() only increment counts under the
+// lock, so they never return an entry that is being removed.
+class Pool {
+ public:
+  Entry* Intern(absl::string_view uuid) {
+    Entry* entry = Find(uuid);
+    if (entry != nullptr) return entry;
+    absl::MutexLock lock(&mutex_);
+    auto it = entries_.find(uuid);
+    if (it == entries_.end()) {
+      auto new_entry = absl::make_unique<Entry>(uuid);
+      absl::string_view key = new_entry->uuid;
+      it = entries_.emplace(key, std::move(new_entry)).first;
+    }
+    entry = it->second.get();
+    entry->ref_count.fetch_add(1, std::memory_order_relaxed);
+    return entry;
+  }
+
+  Entry* Find(absl::string_view uuid) {
+    absl::ReaderMutexLock lock(&mutex_);
+    auto it = entries_.find(uuid);
+    if (it == entries_.end()) return nullptr;
+    it->second->ref_count.fetch_add(1, std::memory_order_relaxed);
+    return it->second.get();
+  }
+
+  void Release(Entry* entry) {
+    absl::MutexLock lock(&mutex_);
+    if (entry->ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      entries_.erase(absl::string_view(entry->uuid));
+    }
+  }
+
+ private:
+  absl::Mutex mutex_;
+  absl::flat_hash_map<absl::string_view, std::unique_ptr<Entry>> entries_
+      GUARDED_BY(mutex_);
+};
+
+Pool* GetPool() {
+  // Never destroyed, so that InternedUUIDs may be used during static
+  // destruction.
+  static Pool* pool = new Pool();
+  return pool;
+}
+
+}  // namespace
+
+InternedUUID::InternedUUID(absl::string_view uuid)
+    : entry_(uuid.empty() ? nullptr : GetPool()->Intern(uuid)) {}
+
+bool InternedUUID::Find(absl::string_view uuid, InternedUUID* result) {
+  if (uuid.empty()) {
+    *result = InternedUUID();
+    return true;
+  }
+  Entry* entry = GetPool()->Find(uuid);
+  if (entry == nullptr) return false;
+  *result = InternedUUID(entry);
+  return true;
+}
+
+void InternedUUID::Unref() {
+  if (entry_ == nullptr) return;
+  // Dropping a reference that isn't the last one doesn't need the lock.
+  int count = entry_->ref_count.load(std::memory_order_relaxed);
+  while (count > 1) {
+    if (entry_->ref_count.compare_exchange_weak(count, count - 1,
+                                                std::memory_order_acq_rel)) {
+      entry_ = nullptr;
+      return;
+    }
+  }
+  GetPool()->Release(entry_);
+  entry_ = nullptr;
+}
+
+std::vector<InternedUUID> InternUUIDs(const std::vector<UUID>& uuids) {
+  std::vector<InternedUUID> result;
+  result.reserve(uuids.size());
+  for (const UUID& uuid : uuids) result.emplace_back(uuid);
+  return result;
+}
+
+std::vector<UUID> UUIDStrings(const std::vector<InternedUUID>& uuids) {
+  std::vector<UUID> result;
+  result.reserve(uuids.size());
+  for (const InternedUUID& uuid : uuids) result.push_back(uuid.str());
+  return result;
+}
+
+}  // namespace ink
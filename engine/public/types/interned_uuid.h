@@ -0,0 +1,137 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INK_ENGINE_PUBLIC_TYPES_INTERNED_UUID_H_
+#define INK_ENGINE_PUBLIC_TYPES_INTERNED_UUID_H_
+
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "third_party/absl/container/flat_hash_map.h"
+#include "third_party/absl/container/flat_hash_set.h"
+#include "third_party/absl/strings/string_view.h"
+#include "ink/engine/public/types/uuid.h"
+
+namespace ink {
+
+namespace interned_uuid_internal {
+
+// A pooled UUID string, and the number of InternedUUIDs that refer to it.
+struct Entry {
+  explicit Entry(absl::string_view uuid) : uuid(uuid) {}
+
+  const UUID uuid;
+  std::atomic<int> ref_count{0};
+};
+
+}  // namespace interned_uuid_internal
+
+// A UUID, interned in a process-wide pool, so that it is the size of a
+// pointer, and comparing and hashing it doesn't touch the string.
+//
+// UUIDs arrive from hosts and protos as strings, which is_valid_uuid() only
+// loosely constrains (they are not necessarily 128-bit UUIDs), so they are
+// interned rather than packed. Converting a string to an InternedUUID hashes
+// it once, under the pool's lock; that should happen where the string crosses
+// into the document or the engine, and the InternedUUID should be passed on
+// from there, rather than the string.
+//
+// The pool is reference-counted: a UUID stays in it only while an InternedUUID
+// refers to it, so the pool holds the UUIDs of the live elements, of the
+// elements that undo can restore, and of little else. Copying an InternedUUID
+// costs an atomic increment. This is safe to use from any thread.
+class InternedUUID {
+ public:
+  // The invalid UUID, kInvalidUUID.
+  InternedUUID() : entry_(nullptr) {}
+  explicit InternedUUID(absl::string_view uuid);
+
+  InternedUUID(const InternedUUID& other) : entry_(other.entry_) { Ref(); }
+  InternedUUID(InternedUUID&& other) noexcept : entry_(other.entry_) {
+    other.entry_ = nullptr;
+  }
+  InternedUUID& operator=(const InternedUUID& other) {
+    InternedUUID(other).swap(*this);
+    return *this;
+  }
+  InternedUUID& operator=(InternedUUID&& other) noexcept {
+    InternedUUID(std::move(other)).swap(*this);
+    return *this;
+  }
+  ~InternedUUID() { Unref(); }
+
+  // If the uuid is in the pool, sets *result and returns true. Otherwise,
+  // returns false without adding it: no map keyed by InternedUUID can contain
+  // it. Prefer this for lookups of UUIDs that may be unknown, as it only takes
+  // the pool's lock for reading.
+  static bool Find(absl::string_view uuid, InternedUUID* result);
+
+  const UUID& str() const {
+    return entry_ == nullptr ? kInvalidUUID : entry_->uuid;
+  }
+  bool IsValid() const { return entry_ != nullptr; }
+
+  void swap(InternedUUID& other) noexcept { std::swap(entry_, other.entry_); }
+
+  bool operator==(const InternedUUID& other) const {
+    return entry_ == other.entry_;
+  }
+  bool operator!=(const InternedUUID& other) const {
+    return entry_ != other.entry_;
+  }
+  // Orders by the string, so that the order is the same from run to run.
+  bool operator<(const InternedUUID& other) const {
+    return entry_ != other.entry_ && str() < other.str();
+  }
+
+  std::string ToString() const { return str(); }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const InternedUUID& uuid) {
+    return H::combine(std::move(h), uuid.entry_);
+  }
+
+ private:
+  // Takes over a reference to entry that the pool has already counted.
+  explicit InternedUUID(interned_uuid_internal::Entry* entry)
+      : entry_(entry) {}
+
+  void Ref() const {
+    if (entry_ != nullptr) {
+      entry_->ref_count.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  void Unref();
+
+  // Points into the pool, or is nullptr for kInvalidUUID.
+  interned_uuid_internal::Entry* entry_;
+};
+
+// Interns each of the uuids; kInvalidUUID becomes the invalid InternedUUID.
+std::vector<InternedUUID> InternUUIDs(const std::vector<UUID>& uuids);
+
+// The strings of each of the uuids.
+std::vector<UUID> UUIDStrings(const std::vector<InternedUUID>& uuids);
+
+template <typename T>
+using InternedUUIDHashMap = absl::flat_hash_map<InternedUUID, T>;
+using InternedUUIDHashSet = absl::flat_hash_set<InternedUUID>;
+
+}  // namespace ink
+
+#endif  // INK_ENGINE_PUBLIC_TYPES_INTERNED_UUID_H_
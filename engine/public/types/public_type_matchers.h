@@ -97,8 +97,8 @@ MATCHER_P2(ElementBundleMatchesRect, expectedRect, expectedUUID, "") {
   if (!funcs::IsValidRectangleTriangulation(flatMesh, expectedRect)) {
     *result_listener << "mesh did not match rectangle: " << Str(expectedRect)
                      << ", vertices:\n";
-    for (auto v : flatMesh.verts) {
-      *result_listener << Str(v.position) << "\n";
+    for (const auto& position : flatMesh.verts.Positions()) {
+      *result_listener << Str(position) << "\n";
     }
     return false;
   }
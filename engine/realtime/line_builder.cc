@@ -56,6 +56,8 @@ void LineBuilder::SetupNewLine(
     pt->color *= ModifyVertexOpacity(input_type, pt->position);
   };
 
+  unstable_line_.SetIncrementalTessellation(
+      flags_->GetFlag(settings::Flag::EnableIncrementalTessellation));
   unstable_line_.SetupNewLine(
       modifier_->GetMinScreenTravelThreshold(down_camera_), tip_type,
       vertex_callback_, modifier_->params());
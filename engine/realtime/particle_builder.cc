@@ -75,7 +75,8 @@ void ParticleBuilder::ExtrudeModeledInput(
     // From -100 to 100 in world coords.
     float init_x_velocity = Drand(-100.0, 100.0);
 
-    for (auto& vert : mesh.verts) {
+    for (size_t i = 0; i < mesh.verts.size(); ++i) {
+      Vertex vert = mesh.verts[i];
       vert.color_from = rgba_;
       vert.color = glm::vec4(0.0, 0.0, 0.0, 0.0);
       vert.color_timings = glm::vec2(start_time, end_time);
@@ -83,6 +84,7 @@ void ParticleBuilder::ExtrudeModeledInput(
       // We are using position_from to pass initial velocity.
       vert.position_from = glm::vec2(init_x_velocity, 350);
       vert.position_timings = glm::vec2(start_time, end_time);
+      mesh.verts.Set(i, vert);
     }
     mesh_->Append(mesh);
     earliest_release_time_ = FrameTimeS(std::max(
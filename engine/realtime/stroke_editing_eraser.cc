@@ -14,9 +14,12 @@
 
 #include "ink/engine/realtime/stroke_editing_eraser.h"
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "third_party/absl/memory/memory.h"
 #include "ink/engine/geometry/mesh/mesh.h"
+#include "ink/engine/processing/runner/parallel_for.h"
 #include "ink/engine/processing/runner/task_runner.h"
 #include "ink/engine/public/types/uuid.h"
 #include "ink/engine/scene/data/common/processed_element.h"
@@ -73,10 +76,13 @@ void StrokeEditingEraser::CuttingEraserTask::PreExecute() {
     }
 
     auto data = absl::make_unique<ElementData>();
-    OptimizedMesh* opt_mesh;
-    if (scene_graph->GetMesh(old_id, &opt_mesh)) {
-      data->splitter = absl::make_unique<MeshSplitter>(*opt_mesh);
+    // The splitter shares the scene's mesh, rather than copying it, which pins
+    // the mesh in the PolyStore until the splitter is destroyed. Evicted
+    // meshes are rebuilt here, so this only fails if the element has no mesh.
+    std::shared_ptr<const OptimizedMesh> opt_mesh;
+    if (scene_graph->GetSharedMesh(old_id, &opt_mesh)) {
       data->shader_type = opt_mesh->type;
+      data->splitter = absl::make_unique<MeshSplitter>(std::move(opt_mesh));
       data->attributes = scene_graph->GetElementMetadata(old_id).attributes;
       local_data_map_.emplace(old_id, std::move(data));
     } else {
@@ -92,12 +98,17 @@ void StrokeEditingEraser::CuttingEraserTask::Execute() {
   if (elements_to_cut_.empty()) return;
 
   cutting_mesh_.NormalizeTriangleOrientation();
+  std::vector<MeshSplitter*> splitters;
+  splitters.reserve(elements_to_cut_.size());
   for (const auto& id : elements_to_cut_) {
     auto data_it = local_data_map_.find(id);
     if (data_it == local_data_map_.end()) continue;
 
-    data_it->second->splitter->Split(cutting_mesh_);
+    splitters.push_back(data_it->second->splitter.get());
   }
+  // This task doesn't execute in parallel with others, so it has the task
+  // runner to itself, and can split on all of the hardware threads.
+  MeshSplitter::SplitAll(splitters, cutting_mesh_, HardwareThreads());
 }
 
 void StrokeEditingEraser::CuttingEraserTask::OnPostExecute() {
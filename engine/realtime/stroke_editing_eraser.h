@@ -92,7 +92,8 @@ class StrokeEditingEraser : public Tool {
     // will take ownership of any ElementData that has already been initialized.
     void PreExecute() override;
 
-    // This function performs the mesh split.
+    // This function performs the mesh split, on up to HardwareThreads()
+    // threads, so this task is not marked CanExecuteInParallel().
     void Execute() override;
 
     // This returns ownership of the ElementData back to the shared data map.
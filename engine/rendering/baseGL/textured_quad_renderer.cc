@@ -109,9 +109,13 @@ class TexturedQuadRenderWorker {
                       world_to_uv_);
 
     auto world_to_prev_uv = world_to_uv_ * params.transform_new_to_old;
-    for (auto& vertex : renderer_->mesh_.verts)
+    VertexStreams& verts = renderer_->mesh_.verts;
+    for (size_t i = 0; i < verts.size(); ++i) {
+      Vertex vertex = verts[i];
       vertex.texture_coords_from =
           geometry::Transform(vertex.position, world_to_prev_uv);
+      verts.Set(i, vertex);
+    }
     renderer_->gl_resources_->mesh_vbo_provider->ReplaceVBOs(&renderer_->mesh_,
                                                              GL_DYNAMIC_DRAW);
 
@@ -16,7 +16,6 @@
 
 #include "ink/engine/rendering/gl_managers/scissor.h"
 #include "ink/engine/scene/frame_state/frame_state.h"
-#include "ink/engine/scene/graph/region_query.h"
 #include "ink/engine/util/time/time_types.h"
 
 namespace ink {
@@ -29,16 +28,38 @@ DirectRenderer::DirectRenderer(std::shared_ptr<SceneGraph> scene_graph,
       frame_state_(std::move(frame_state)),
       gl_resources_(gl_resources),
       layer_manager_(layer_manager),
-      element_renderer_(gl_resources) {
+      element_renderer_(gl_resources),
+      visible_set_(scene_graph_) {
   scene_graph_->AddListener(this);
 }
 
 DirectRenderer::~DirectRenderer() { scene_graph_->RemoveListener(this); }
 
 void DirectRenderer::Draw(const Camera& cam, FrameTimeS draw_time) const {
-  RegionQuery query = RegionQuery::MakeCameraQuery(cam);
-  elements_on_screen_ = scene_graph_->ElementsInRegionByGroup(query);
+  const auto& visible_elements = visible_set_.Update(cam);
 
+  absl::optional<size_t> active_layer;
+  if (layer_manager_->IsActive()) {
+    auto active_layer_or = layer_manager_->IndexOfActiveLayer();
+    if (active_layer_or.ok()) active_layer = active_layer_or.ValueOrDie();
+  }
+  if (visible_set_.Version() != elements_on_screen_version_ ||
+      active_layer != elements_on_screen_active_layer_) {
+    elements_on_screen_version_ = visible_set_.Version();
+    elements_on_screen_active_layer_ = active_layer;
+    elements_on_screen_ = visible_elements;
+    PartitionElementsOnScreen(active_layer);
+  }
+
+  DrawRange(cam, draw_time, elements_on_screen_.begin(), post_tool_iterator_);
+
+  for (auto& d : scene_graph_->GetDrawables()) {
+    d->Draw(cam, draw_time);
+  }
+}
+
+void DirectRenderer::PartitionElementsOnScreen(
+    absl::optional<size_t> active_layer) const {
   auto begin = elements_on_screen_.begin();
   auto end = elements_on_screen_.end();
 
@@ -48,31 +69,22 @@ void DirectRenderer::Draw(const Camera& cam, FrameTimeS draw_time) const {
 
   // If the layer manager is active, then set the post tool iterator to the
   // first layer (group) after the active layer.
-  if (layer_manager_->IsActive()) {
-    auto active_layer_or = layer_manager_->IndexOfActiveLayer();
-    if (active_layer_or.ok()) {
-      size_t active_layer = active_layer_or.ValueOrDie();
-      post_tool_iterator_ = std::stable_partition(
-          begin, end,
-          [this, active_layer](const SceneGraph::GroupedElements& item) {
-            auto index_or =
-                layer_manager_->IndexForLayerWithGroupId(item.group_id);
-            if (index_or.ok()) {
-              return index_or.ValueOrDie() <= active_layer;
-            } else {
-              SLOG(SLOG_ERROR,
-                   "SceneGraph rendering layer unknown to LayerManager, $0",
-                   item.group_id);
-            }
-            return true;
-          });
-    }
-  }
-
-  DrawRange(cam, draw_time, begin, post_tool_iterator_);
-
-  for (auto& d : scene_graph_->GetDrawables()) {
-    d->Draw(cam, draw_time);
+  if (active_layer) {
+    size_t active_layer_index = *active_layer;
+    post_tool_iterator_ = std::stable_partition(
+        begin, end,
+        [this, active_layer_index](const SceneGraph::GroupedElements& item) {
+          auto index_or =
+              layer_manager_->IndexForLayerWithGroupId(item.group_id);
+          if (index_or.ok()) {
+            return index_or.ValueOrDie() <= active_layer_index;
+          } else {
+            SLOG(SLOG_ERROR,
+                 "SceneGraph rendering layer unknown to LayerManager, $0",
+                 item.group_id);
+          }
+          return true;
+        });
   }
 }
 
@@ -99,24 +111,37 @@ void DirectRenderer::DrawRange(
     }
     for (ElementId poly_id : element_group->poly_ids) {
       SLOG(SLOG_DRAWING, "    Drawing element $0", poly_id);
-      if (!element_renderer_.Draw(poly_id, *scene_graph_, cam, draw_time)) {
+      if (!element_renderer_.DrawInRun(poly_id, *scene_graph_, cam,
+                                       draw_time)) {
         SLOG(SLOG_WARNING, "    FAILED to draw element $0", poly_id);
       }
     }
   }
+  element_renderer_.EndRun();
 }
 
 void DirectRenderer::OnElementAdded(SceneGraph* graph, ElementId id) {
+  visible_set_.OnElementChanged(id);
   frame_state_->RequestFrame();
 }
 
 void DirectRenderer::OnElementsRemoved(
     SceneGraph* graph, const std::vector<SceneGraphRemoval>& removed_elements) {
+  for (const auto& removal : removed_elements)
+    visible_set_.OnElementChanged(removal.id);
   frame_state_->RequestFrame();
 }
 
 void DirectRenderer::OnElementsMutated(
     SceneGraph* graph, const std::vector<ElementMutationData>& mutation_data) {
+  for (const auto& mutation : mutation_data)
+    visible_set_.OnElementChanged(mutation.modified_element_data.id);
+  frame_state_->RequestFrame();
+}
+
+void DirectRenderer::OnElementsChanged(SceneGraph* graph,
+                                       const std::vector<ElementId>& ids) {
+  visible_set_.OnElementsChanged(ids);
   frame_state_->RequestFrame();
 }
 
@@ -17,12 +17,15 @@
 #ifndef INK_ENGINE_RENDERING_COMPOSITING_DIRECT_RENDERER_H_
 #define INK_ENGINE_RENDERING_COMPOSITING_DIRECT_RENDERER_H_
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
+#include "third_party/absl/types/optional.h"
 #include "third_party/glm/glm/glm.hpp"
 #include "ink/engine/camera/camera.h"
 #include "ink/engine/rendering/compositing/scene_graph_renderer.h"
+#include "ink/engine/rendering/compositing/visible_set_cache.h"
 #include "ink/engine/rendering/gl_managers/gl_resource_manager.h"
 #include "ink/engine/rendering/renderers/element_renderer.h"
 #include "ink/engine/scene/frame_state/frame_state.h"
@@ -57,14 +60,21 @@ class DirectRenderer : public SceneGraphRenderer, public SceneGraphListener {
   void Resize(glm::ivec2 size) override { size_ = size; }
   glm::ivec2 RenderingSize() const override { return size_; }
 
-  void Invalidate() override {}
+  void Invalidate() override { visible_set_.Invalidate(); }
 
   void Synchronize(FrameTimeS draw_time) override {}
 
+  const VisibleSetCache::Stats& GetVisibleSetStats() const {
+    return visible_set_.GetStats();
+  }
+
  private:
   void DrawRange(const Camera& cam, FrameTimeS draw_time,
                  SceneGraph::GroupedElementsList::const_iterator begin,
                  SceneGraph::GroupedElementsList::const_iterator end) const;
+  // Sets post_tool_iterator_, moving the layers above the active layer to the
+  // end of elements_on_screen_.
+  void PartitionElementsOnScreen(absl::optional<size_t> active_layer) const;
 
   void OnElementAdded(SceneGraph* graph, ElementId id) override;
   void OnElementsRemoved(
@@ -73,6 +83,8 @@ class DirectRenderer : public SceneGraphRenderer, public SceneGraphListener {
   void OnElementsMutated(
       SceneGraph* graph,
       const std::vector<ElementMutationData>& mutation_data) override;
+  void OnElementsChanged(SceneGraph* graph,
+                         const std::vector<ElementId>& ids) override;
 
   std::shared_ptr<SceneGraph> scene_graph_;
   std::shared_ptr<FrameState> frame_state_;
@@ -81,9 +93,16 @@ class DirectRenderer : public SceneGraphRenderer, public SceneGraphListener {
   ElementRenderer element_renderer_;
   glm::ivec2 size_{0, 0};
 
+  // The elements on screen, kept from frame to frame.
+  mutable VisibleSetCache visible_set_;
+
   // Elements organized by group to be rendered either before or after the tool.
   // See post_tool_iterator.
   mutable SceneGraph::GroupedElementsList elements_on_screen_;
+  // The visible_set_ version and the active layer that elements_on_screen_ was
+  // copied and partitioned for. Until either changes, it can be drawn as is.
+  mutable uint64_t elements_on_screen_version_ = 0;
+  mutable absl::optional<size_t> elements_on_screen_active_layer_;
 
   // Divides elements_on_screen_ into a partition. Everything before this
   // should be rendered pre tool rendering. Everything after should be rendered
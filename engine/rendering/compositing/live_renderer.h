@@ -31,6 +31,7 @@
 #include "ink/engine/scene/frame_state/frame_state.h"
 #include "ink/engine/scene/graph/scene_graph.h"
 #include "ink/engine/scene/layer_manager.h"
+#include "ink/engine/scene/data/common/poly_store.h"
 #include "ink/engine/scene/page/page_manager.h"
 #include "ink/engine/scene/types/drawable.h"
 #include "ink/engine/util/time/time_types.h"
@@ -51,7 +52,8 @@ class LiveRenderer : public SceneGraphRenderer {
   using SharedDeps =
       service::Dependencies<SceneGraph, FrameState, GLResourceManager,
                             LayerManager, input::InputDispatch,
-                            WallClockInterface, PageManager, settings::Flags>;
+                            WallClockInterface, PageManager, settings::Flags,
+                            PolyStore>;
 
   LiveRenderer(std::shared_ptr<SceneGraph> scene_graph,
                std::shared_ptr<FrameState> frame_state,
@@ -60,7 +62,8 @@ class LiveRenderer : public SceneGraphRenderer {
                std::shared_ptr<input::InputDispatch> input_dispatch,
                std::shared_ptr<WallClockInterface> wall_clock,
                std::shared_ptr<PageManager> page_manager,
-               std::shared_ptr<settings::Flags> flags);
+               std::shared_ptr<settings::Flags> flags,
+               std::shared_ptr<PolyStore> poly_store);
   ~LiveRenderer() override;
 
   void Use(RenderingStrategy rendering_strategy);
@@ -92,6 +95,7 @@ class LiveRenderer : public SceneGraphRenderer {
   std::shared_ptr<WallClockInterface> wall_clock_;
   std::shared_ptr<PageManager> page_manager_;
   std::shared_ptr<settings::Flags> flags_;
+  std::shared_ptr<PolyStore> poly_store_;
 
   mutable std::unique_ptr<SceneGraphRenderer> delegate_;
   RenderingStrategy strategy_{RenderingStrategy::kBufferedRenderer};
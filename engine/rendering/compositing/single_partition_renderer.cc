@@ -215,7 +215,8 @@ int SinglePartitionRenderer::UpdateBack(const Timer& frame_timer,
       scissor->SetScissor(back_camera_, graph.Mbr({parent}), CoordType::kWorld);
     }
 
-    if (element_renderer_.Draw(element, graph, back_camera_, back_time_)) {
+    if (element_renderer_.DrawInRun(element, graph, back_camera_,
+                                    back_time_)) {
       float cvg = graph.Coverage(back_camera_, element);
       adjusted_draw_count += Lerp(0.25f, 1.0f, Normalize(0.0f, 0.4f, cvg));
     }
@@ -230,6 +231,7 @@ int SinglePartitionRenderer::UpdateBack(const Timer& frame_timer,
     // we'll always (eventually) converge
     if (adjusted_draw_count > batch_size && frame_timer.Expired()) break;
   }
+  element_renderer_.EndRun();
   back_update_timer_.Pause();
   return actual_draw_count;
 }
@@ -37,6 +37,7 @@
 #include "ink/engine/util/dbg/errors.h"
 #include "ink/engine/util/dbg/log.h"
 #include "ink/engine/util/dbg/log_levels.h"
+#include "ink/engine/util/dbg/trace.h"
 #include "ink/engine/util/funcs/step_utils.h"
 #include "ink/engine/util/time/time_types.h"
 #include "ink/engine/util/time/wall_clock.h"
@@ -51,7 +52,8 @@ TripleBufferedRenderer::TripleBufferedRenderer(
     std::shared_ptr<WallClockInterface> wall_clock,
     std::shared_ptr<PageManager> page_manager,
     std::shared_ptr<LayerManager> layer_manager,
-    std::shared_ptr<settings::Flags> flags)
+    std::shared_ptr<settings::Flags> flags,
+    std::shared_ptr<PolyStore> poly_store)
     : back_region_query_(Rect(0, 0, 0, 0)),
       has_drawn_(false),
       valid_(false),
@@ -65,6 +67,7 @@ TripleBufferedRenderer::TripleBufferedRenderer(
       page_manager_(std::move(page_manager)),
       layer_manager_(std::move(layer_manager)),
       flags_(std::move(flags)),
+      poly_store_(std::move(poly_store)),
       tile_(absl::make_unique<DBRenderTarget>(wall_clock_, gl_resources)),
       above_tile_(absl::make_unique<DBRenderTarget>(wall_clock_, gl_resources)),
       cached_enable_motion_blur_flag_(
@@ -72,6 +75,7 @@ TripleBufferedRenderer::TripleBufferedRenderer(
       current_back_draw_timer_(wall_clock_, false) {
   scene_graph_->AddListener(this);
   gl_resources_->texture_manager->AddListener(this);
+  poly_store_->AddListener(this);
   flags_->AddListener(this);
 }
 
@@ -79,10 +83,12 @@ TripleBufferedRenderer::~TripleBufferedRenderer() {
   flags_->RemoveListener(this);
   scene_graph_->RemoveListener(this);
   gl_resources_->texture_manager->RemoveListener(this);
+  poly_store_->RemoveListener(this);
 }
 
 void TripleBufferedRenderer::Draw(const Camera& cam,
                                   FrameTimeS draw_time) const {
+  INK_TRACE_EVENT("render", "TripleBufferedRenderer::Draw");
   SLOG(SLOG_DRAWING, "triple buffer draw request blitting to window: $0",
        cam.WorldWindow());
 
@@ -183,6 +189,7 @@ void TripleBufferedRenderer::Update(const Timer& timer, const Camera& cam,
 void TripleBufferedRenderer::UpdateBuffers(const Timer& timer,
                                            const Camera& cam,
                                            FrameTimeS draw_time) {
+  INK_TRACE_EVENT("render", "TripleBufferedRenderer::UpdateBuffers");
   // watch for view change, but only restart:
   //   if we've finished drawing the old buffer
   //   or we're flagged to always restart on view change
@@ -212,6 +219,7 @@ void TripleBufferedRenderer::UpdateBuffers(const Timer& timer,
 
   if ((changed || !front_is_valid_) && IsBackBufferComplete()) {
     SLOG(SLOG_DRAWING, "tiled renderer completed back, resolving...");
+    INK_TRACE_EVENT("render", "TripleBufferedRenderer::BlitBackToFront");
     tile_->BlitBackToFront();
     front_buffer_bounds_ = back_camera_->WorldRotRect();
     if (!layer_manager_->IsActiveLayerTopmost()) {
@@ -249,6 +257,7 @@ bool TripleBufferedRenderer::DrawToBack(const Timer& timer, const Camera& cam,
 
 void TripleBufferedRenderer::InitBackBuffer(const Camera& cam,
                                             FrameTimeS draw_time) {
+  INK_TRACE_EVENT("render", "TripleBufferedRenderer::InitBackBuffer");
   SLOG(SLOG_DRAWING, "tiled renderer clearing back buffer");
   back_camera_ = cam;
   back_region_query_ = RegionQuery::MakeCameraQuery(*back_camera_);
@@ -261,7 +270,7 @@ void TripleBufferedRenderer::InitBackBuffer(const Camera& cam,
       scene_graph_->ElementsInRegionByGroup(back_region_query_);
   backbuffer_set_.clear();
   next_id_to_render_ = kInvalidElementId;
-  backbuffer_id_to_zindex_ = scene_graph_->CopyZIndex();
+  backbuffer_id_to_zindex_ = scene_graph_->ZIndexesOf(backbuffer_elements_);
 
   group_ordering_.clear();
   for (const auto& group : backbuffer_elements_) {
@@ -281,6 +290,8 @@ void TripleBufferedRenderer::InitBackBuffer(const Camera& cam,
 
 bool TripleBufferedRenderer::RenderOutstandingBackBufferElements(
     const Timer& timer, const Camera& cam, FrameTimeS draw_time) {
+  INK_TRACE_EVENT(
+      "render", "TripleBufferedRenderer::RenderOutstandingBackBufferElements");
   bool drew_anything = false;
   float itercount = 0;
   const float kBatchSize = 4;
@@ -341,6 +352,8 @@ ElementId TripleBufferedRenderer::GetTopBackBufferElementForGroup(
 }
 
 bool TripleBufferedRenderer::RenderNewElementsToBackBuffer(const Camera& cam) {
+  INK_TRACE_EVENT("render",
+                  "TripleBufferedRenderer::RenderNewElementsToBackBuffer");
   bool drew_anything = false;
   // If we get an add and then an invalidate an element could end up in
   // backbuffer_elements_ and new_elements_ as we requery backbuffer_elements_
@@ -623,6 +636,8 @@ void TripleBufferedRenderer::OnTextureEvicted(const TextureInfo& info) {
   Invalidate();
 }
 
+void TripleBufferedRenderer::OnMeshRestored(ElementId id) { Invalidate(); }
+
 void TripleBufferedRenderer::BindTileForGroup(const GroupId& group_id) const {
   if (!layer_manager_->IsActive() || group_id == kInvalidElementId) {
     tile_->BindBack();  // Rendering elements attached to root.
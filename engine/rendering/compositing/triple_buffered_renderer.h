@@ -31,6 +31,7 @@
 #include "ink/engine/rendering/gl_managers/gl_resource_manager.h"
 #include "ink/engine/rendering/renderers/element_renderer.h"
 #include "ink/engine/rendering/renderers/mesh_renderer.h"
+#include "ink/engine/scene/data/common/poly_store.h"
 #include "ink/engine/scene/frame_state/frame_state.h"
 #include "ink/engine/scene/graph/region_query.h"
 #include "ink/engine/scene/graph/scene_graph.h"
@@ -59,12 +60,13 @@ namespace ink {
 class TripleBufferedRenderer : public SceneGraphRenderer,
                                public SceneGraphListener,
                                public TextureListener,
+                               public PolyStoreListener,
                                public settings::FlagListener {
  public:
   using SharedDeps =
       service::Dependencies<FrameState, GLResourceManager, input::InputDispatch,
                             SceneGraph, WallClockInterface, PageManager,
-                            LayerManager, settings::Flags>;
+                            LayerManager, settings::Flags, PolyStore>;
 
   TripleBufferedRenderer(std::shared_ptr<FrameState> frame_state,
                          std::shared_ptr<GLResourceManager> gl_resources,
@@ -73,7 +75,8 @@ class TripleBufferedRenderer : public SceneGraphRenderer,
                          std::shared_ptr<WallClockInterface> wall_clock,
                          std::shared_ptr<PageManager> page_manager,
                          std::shared_ptr<LayerManager> layer_manager,
-                         std::shared_ptr<settings::Flags> flags);
+                         std::shared_ptr<settings::Flags> flags,
+                         std::shared_ptr<PolyStore> poly_store);
   ~TripleBufferedRenderer() override;
 
   void Draw(const Camera& cam, FrameTimeS draw_time) const override;
@@ -107,6 +110,9 @@ class TripleBufferedRenderer : public SceneGraphRenderer,
   void OnTextureLoaded(const TextureInfo& info) override;
   void OnTextureEvicted(const TextureInfo& info) override;
 
+  // Elements whose meshes were evicted were skipped when drawing the buffers.
+  void OnMeshRestored(ElementId id) override;
+
   void OnElementRemoved(ElementId removed_id);
 
   void UpdateBuffers(const Timer& timer, const Camera& cam,
@@ -152,7 +158,9 @@ class TripleBufferedRenderer : public SceneGraphRenderer,
   CachedSetDifference<ElementId> new_elements_filter_;
 
   // backbuffer_id_to_zindex_ is a snapshot of the scenegraph's per-group
-  // z-indexes.
+  // z-indexes of the elements in the backbuffer. Only these elements have been
+  // rendered, so only their z-indexes are needed to decide whether a mutation
+  // invalidates the backbuffer.
   SceneGraph::IdToZIndexPerGroup backbuffer_id_to_zindex_;
   std::unordered_map<ElementId, ElementId, ElementIdHasher> top_id_per_group_;
 
@@ -178,6 +186,7 @@ class TripleBufferedRenderer : public SceneGraphRenderer,
   std::shared_ptr<PageManager> page_manager_;
   std::shared_ptr<LayerManager> layer_manager_;
   std::shared_ptr<settings::Flags> flags_;
+  std::shared_ptr<PolyStore> poly_store_;
   std::unique_ptr<FramerateLock> frame_lock_;
   std::unique_ptr<DBRenderTarget> tile_;
   std::unique_ptr<DBRenderTarget> above_tile_;
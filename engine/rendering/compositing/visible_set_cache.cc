@@ -0,0 +1,273 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/rendering/compositing/visible_set_cache.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "ink/engine/geometry/algorithms/intersect.h"
+#include "ink/engine/util/dbg/errors.h"
+
+namespace ink {
+namespace {
+
+// Appends the parts of a that are outside b, as up to four disjoint rects.
+void AppendDifference(const Rect& a, const Rect& b, std::vector<Rect>* out) {
+  Rect overlap;
+  if (!geometry::Intersection(a, b, &overlap)) {
+    out->push_back(a);
+    return;
+  }
+  // The strips below and above the overlap span a's width, and the strips to
+  // its left and right span the overlap's height.
+  if (a.from.y < overlap.from.y)
+    out->emplace_back(a.from.x, a.from.y, a.to.x, overlap.from.y);
+  if (overlap.to.y < a.to.y)
+    out->emplace_back(a.from.x, overlap.to.y, a.to.x, a.to.y);
+  if (a.from.x < overlap.from.x)
+    out->emplace_back(a.from.x, overlap.from.y, overlap.from.x, overlap.to.y);
+  if (overlap.to.x < a.to.x)
+    out->emplace_back(overlap.to.x, overlap.from.y, a.to.x, overlap.to.y);
+}
+
+}  // namespace
+
+VisibleSetCache::VisibleSetCache(std::shared_ptr<const SceneGraph> scene_graph)
+    : scene_graph_(std::move(scene_graph)) {}
+
+const SceneGraph::GroupedElementsList& VisibleSetCache::Update(
+    const Camera& cam) {
+  RegionQuery query = RegionQuery::MakeCameraQuery(cam);
+  if (valid_ && query.Region() == window_ && changed_.empty()) {
+    ++stats_.hits;
+    return elements_;
+  }
+
+  ElementIdHashSet to_remove;
+  std::vector<ElementId> to_insert;
+  if (valid_ && FindChanges(query, &to_remove, &to_insert)) {
+    ++stats_.incremental_updates;
+    stats_.elements_entered += to_insert.size();
+    stats_.elements_left += to_remove.size();
+    window_ = query.Region();
+    if (!to_remove.empty() || !to_insert.empty()) {
+      Apply(to_remove, to_insert);
+      Flatten();
+      ++version_;
+    }
+  } else {
+    ++stats_.rebuilds;
+    Rebuild(query);
+    ++version_;
+  }
+  changed_.clear();
+  return elements_;
+}
+
+void VisibleSetCache::OnElementsChanged(const std::vector<ElementId>& ids) {
+  for (ElementId id : ids) OnElementChanged(id);
+}
+
+void VisibleSetCache::OnElementChanged(ElementId id) {
+  if (!valid_) return;
+  if (id.Type() == POLY) {
+    changed_.insert(id);
+  } else {
+    // A group's transform, bounds, visibility and order affect all of its
+    // children, so there's nothing to gain from patching the set.
+    Invalidate();
+  }
+}
+
+void VisibleSetCache::Rebuild(const RegionQuery& query) {
+  elements_ = scene_graph_->ElementsInRegionByGroup(query);
+  window_ = query.Region();
+  expanded_groups_ = ExpandedGroups(query);
+  children_.clear();
+  visible_.clear();
+
+  std::vector<ElementId> root_children;
+  for (const auto& group : elements_) {
+    if (group.group_id == kInvalidElementId) {
+      root_children.insert(root_children.end(), group.poly_ids.begin(),
+                           group.poly_ids.end());
+    } else {
+      root_children.push_back(group.group_id);
+      children_[group.group_id] = group.poly_ids;
+    }
+    for (ElementId id : group.poly_ids) visible_[id] = group.group_id;
+  }
+  children_[kInvalidElementId] = std::move(root_children);
+
+  // Expanded groups with no visible children don't appear in elements_, but
+  // must be in children_ for their children to be inserted later.
+  std::vector<ElementId> empty_groups;
+  for (GroupId group_id : expanded_groups_) {
+    if (children_.emplace(group_id, std::vector<ElementId>()).second)
+      empty_groups.push_back(group_id);
+  }
+  InsertSorted(kInvalidElementId, std::move(empty_groups));
+  valid_ = true;
+}
+
+bool VisibleSetCache::FindChanges(const RegionQuery& query,
+                                  ElementIdHashSet* to_remove,
+                                  std::vector<ElementId>* to_insert) const {
+  // A changed element is removed and, if it's still visible, inserted again,
+  // since its z-index or its group may have changed.
+  for (ElementId id : changed_) {
+    if (visible_.count(id) > 0) to_remove->insert(id);
+    if (scene_graph_->ElementExists(id) && IsVisible(id, query))
+      to_insert->push_back(id);
+  }
+
+  const Rect& window = query.Region();
+  if (window == window_) return true;
+  if (ExpandedGroups(query) != expanded_groups_) return false;
+
+  // An element that entered or left the window intersects one of the strips
+  // between the old and the new windows.
+  std::vector<Rect> strips;
+  AppendDifference(window_, window, &strips);
+  AppendDifference(window, window_, &strips);
+  std::vector<ElementId> candidates;
+  for (const Rect& strip : strips)
+    scene_graph_->PolyCandidatesInRegion(strip, &candidates);
+
+  ElementIdHashSet tested(changed_.begin(), changed_.end());
+  for (ElementId id : candidates) {
+    if (!tested.insert(id).second) continue;
+    bool was_visible = visible_.count(id) > 0;
+    if (was_visible != IsVisible(id, query)) {
+      if (was_visible) {
+        to_remove->insert(id);
+      } else {
+        to_insert->push_back(id);
+      }
+    }
+  }
+  return true;
+}
+
+GroupIdHashSet VisibleSetCache::ExpandedGroups(
+    const RegionQuery& query) const {
+  // As in SceneGraph::ElementsInRegionByGroup(). All groups are children of
+  // the root.
+  RegionQuery group_query = query;
+  group_query.SetAllowedTypes({GROUP});
+  GroupIdHashSet groups;
+  for (const auto& kv : scene_graph_->GetElementIndex()) {
+    if (kv.first != kInvalidElementId &&
+        scene_graph_->IsElementInRegion(kv.first, group_query))
+      groups.insert(kv.first);
+  }
+  return groups;
+}
+
+bool VisibleSetCache::IsVisible(ElementId id,
+                                const RegionQuery& query) const {
+  if (id.Type() != POLY) return false;
+  GroupId group_id = scene_graph_->GetParentGroupId(id);
+  if (group_id != kInvalidElementId && expanded_groups_.count(group_id) == 0)
+    return false;
+  return scene_graph_->IsElementInRegion(id, query);
+}
+
+void VisibleSetCache::Apply(const ElementIdHashSet& to_remove,
+                            const std::vector<ElementId>& to_insert) {
+  GroupIdHashSet removed_from;
+  for (ElementId id : to_remove) {
+    auto it = visible_.find(id);
+    removed_from.insert(it->second);
+    visible_.erase(it);
+  }
+  for (GroupId group_id : removed_from) {
+    std::vector<ElementId>& children = children_[group_id];
+    children.erase(std::remove_if(children.begin(), children.end(),
+                                  [&to_remove](ElementId id) {
+                                    return to_remove.count(id) > 0;
+                                  }),
+                   children.end());
+  }
+
+  GroupIdHashMap<std::vector<ElementId>> inserted_into;
+  for (ElementId id : to_insert) {
+    GroupId group_id = scene_graph_->GetParentGroupId(id);
+    visible_[id] = group_id;
+    inserted_into[group_id].push_back(id);
+  }
+  for (auto& kv : inserted_into) InsertSorted(kv.first, std::move(kv.second));
+}
+
+void VisibleSetCache::InsertSorted(GroupId group_id,
+                                   std::vector<ElementId> ids) {
+  if (ids.empty()) return;
+  const auto& indices = scene_graph_->GetElementIndex();
+  auto index_it = indices.find(group_id);
+  ASSERT(index_it != indices.end());
+  const SceneGraph::ElementIdIndex& index = *index_it->second;
+  index.Sort(ids.begin(), ids.end());
+
+  // Each id's position is found by binary search, so this looks up the
+  // z-indices of O(ids.size() * log(children.size())) elements.
+  std::vector<ElementId>& children = children_[group_id];
+  std::vector<ElementId> merged;
+  merged.reserve(children.size() + ids.size());
+  auto from = children.begin();
+  for (ElementId id : ids) {
+    auto to = std::upper_bound(from, children.end(), index.ZIndexOf(id),
+                               [&index](uint32_t z_index, ElementId child) {
+                                 return z_index < index.ZIndexOf(child);
+                               });
+    merged.insert(merged.end(), from, to);
+    merged.push_back(id);
+    from = to;
+  }
+  merged.insert(merged.end(), from, children.end());
+  children = std::move(merged);
+}
+
+void VisibleSetCache::Flatten() {
+  // Groups the children as SceneGraph::GroupElementsInSceneByWalk() does: each
+  // expanded group's children are one entry, and the root's children between
+  // two groups are another.
+  elements_.clear();
+  SceneGraph::GroupedElements root_run;
+  root_run.group_id = kInvalidElementId;
+  root_run.bounds = Rect(0, 0, 0, 0);
+  auto end_root_run = [this, &root_run]() {
+    if (root_run.poly_ids.empty()) return;
+    elements_.push_back(root_run);
+    root_run.poly_ids.clear();
+  };
+  for (ElementId id : children_[kInvalidElementId]) {
+    if (id.Type() == POLY) {
+      root_run.poly_ids.push_back(id);
+      continue;
+    }
+    auto group_it = children_.find(id);
+    if (group_it == children_.end() || group_it->second.empty()) continue;
+    end_root_run();
+    SceneGraph::GroupedElements group;
+    group.group_id = id;
+    group.bounds = scene_graph_->IsClippableGroup(id) ? scene_graph_->Mbr({id})
+                                                      : Rect(0, 0, 0, 0);
+    group.poly_ids = group_it->second;
+    elements_.push_back(std::move(group));
+  }
+  end_root_run();
+}
+
+}  // namespace ink
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INK_ENGINE_RENDERING_COMPOSITING_VISIBLE_SET_CACHE_H_
+#define INK_ENGINE_RENDERING_COMPOSITING_VISIBLE_SET_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ink/engine/camera/camera.h"
+#include "ink/engine/geometry/primitives/rect.h"
+#include "ink/engine/scene/graph/region_query.h"
+#include "ink/engine/scene/graph/scene_graph.h"
+#include "ink/engine/scene/types/element_id.h"
+
+namespace ink {
+
+// Keeps the result of SceneGraph::ElementsInRegionByGroup() for the camera's
+// window from frame to frame.
+//
+// When the window moves, only the elements that may intersect the strips
+// between the old and the new windows are tested against the new window, and
+// when the scene changes, only the changed elements are. The rest of the
+// previous frame's set is kept as is. The set is queried from scratch when
+// a group changes, or when the groups that the window intersects change.
+//
+// The owner must forward the SceneGraphListener events to OnElementsChanged().
+class VisibleSetCache {
+ public:
+  struct Stats {
+    // Calls to Update() that returned the previous set unchanged.
+    uint64_t hits = 0;
+    // Calls to Update() that patched the previous set, and the elements that
+    // the patches inserted and removed. A changed element that is still
+    // visible is both removed and inserted again.
+    uint64_t incremental_updates = 0;
+    uint64_t elements_entered = 0;
+    uint64_t elements_left = 0;
+    // Calls to Update() that queried the scene graph from scratch.
+    uint64_t rebuilds = 0;
+  };
+
+  explicit VisibleSetCache(std::shared_ptr<const SceneGraph> scene_graph);
+
+  // Brings the set up to date with the camera's window and the scene, and
+  // returns it, in the same order as ElementsInRegionByGroup(). The reference
+  // is valid until the next call.
+  const SceneGraph::GroupedElementsList& Update(const Camera& cam);
+
+  // Changes each time that Update() returns a different set.
+  uint64_t Version() const { return version_; }
+
+  // Marks the elements as needing to be tested again. Changes to GROUPs cause
+  // a rebuild.
+  void OnElementsChanged(const std::vector<ElementId>& ids);
+  void OnElementChanged(ElementId id);
+
+  // Causes the next Update() to rebuild the set.
+  void Invalidate() { valid_ = false; }
+
+  const Stats& GetStats() const { return stats_; }
+
+ private:
+  void Rebuild(const RegionQuery& query);
+
+  // Finds the elements that entered and left the set since the last update,
+  // or returns false if the set must be rebuilt.
+  bool FindChanges(const RegionQuery& query, ElementIdHashSet* to_remove,
+                   std::vector<ElementId>* to_insert) const;
+  // Computes the groups whose children are in the set for the query.
+  GroupIdHashSet ExpandedGroups(const RegionQuery& query) const;
+  // Returns true if the element passes the query, and its group is expanded.
+  bool IsVisible(ElementId id, const RegionQuery& query) const;
+
+  void Apply(const ElementIdHashSet& to_remove,
+             const std::vector<ElementId>& to_insert);
+  // Inserts the ids into the z-sorted children of group_id.
+  void InsertSorted(GroupId group_id, std::vector<ElementId> ids);
+  // Converts children_ to elements_.
+  void Flatten();
+
+  std::shared_ptr<const SceneGraph> scene_graph_;
+
+  bool valid_ = false;
+  Rect window_;
+  GroupIdHashSet expanded_groups_;
+  // The visible POLYs and the expanded groups that are children of the root,
+  // and the visible POLYs that are children of each expanded group, sorted
+  // back to front.
+  GroupIdHashMap<std::vector<ElementId>> children_;
+  // The group of each visible POLY.
+  ElementIdHashMap<GroupId> visible_;
+  // The elements to test again at the next update.
+  ElementIdHashSet changed_;
+
+  SceneGraph::GroupedElementsList elements_;
+  uint64_t version_ = 0;
+  Stats stats_;
+};
+
+}  // namespace ink
+
+#endif  // INK_ENGINE_RENDERING_COMPOSITING_VISIBLE_SET_CACHE_H_
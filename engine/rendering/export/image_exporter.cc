@@ -15,21 +15,33 @@
 #include "ink/engine/rendering/export/image_exporter.h"
 
 #include <algorithm>
+#include <cstring>
 #include <iterator>
+#include <limits>
 #include <vector>
 
+#include "third_party/absl/memory/memory.h"
+#include "third_party/absl/types/optional.h"
 #include "third_party/glm/glm/gtc/type_ptr.hpp"
 #include "ink/engine/camera/camera.h"
+#include "ink/engine/geometry/mesh/shader_type.h"
 #include "ink/engine/gl.h"
+#include "ink/engine/processing/runner/parallel_for.h"
+#include "ink/engine/public/types/client_bitmap.h"
 #include "ink/engine/rendering/baseGL/blit_attrs.h"
 #include "ink/engine/rendering/baseGL/gpupixels.h"
 #include "ink/engine/rendering/baseGL/render_target.h"
 #include "ink/engine/rendering/compositing/partition_data.h"
 #include "ink/engine/rendering/compositing/single_partition_renderer.h"
+#include "ink/engine/rendering/export/scene_fingerprint.h"
+#include "ink/engine/rendering/export/software_rasterizer.h"
+#include "ink/engine/rendering/gl_managers/background_state.h"
+#include "ink/engine/rendering/gl_managers/texture.h"
+#include "ink/engine/rendering/gl_managers/texture_info.h"
+#include "ink/engine/rendering/gl_managers/texture_manager.h"
 #include "ink/engine/rendering/renderers/background_renderer.h"
 #include "ink/engine/scene/graph/region_query.h"
 #include "ink/engine/scene/types/element_id.h"
-#include "ink/engine/scene/types/element_metadata.h"
 #include "ink/engine/util/dbg/errors.h"
 #include "ink/engine/util/dbg/log.h"
 #include "ink/engine/util/dbg/log_levels.h"
@@ -37,7 +49,6 @@
 #include "ink/engine/util/time/timer.h"
 #include "ink/engine/util/time/wall_clock.h"
 #include "ink/proto/elements_portable_proto.pb.h"
-#include "ink/public/fingerprint/fingerprint.h"
 
 namespace ink {
 namespace {
@@ -46,6 +57,37 @@ template <typename T>
 bool WantDraw(const T t) {
   return t == T::kDraw;
 }
+
+// The size of the tiles that RenderTiled() renders with each backend. Smaller
+// tiles give the software backend's workers a more even share of the work.
+constexpr int kGLTileSizePx = 1024;
+constexpr int kSoftwareTileSizePx = 512;
+
+// Sets *sampler to the texture's texels, or returns false if they are not held
+// in CPU memory (see Texture::RetainCpuTexels()).
+bool SamplerForTexture(const Texture& texture,
+                       SoftwareRasterizer::TextureSampler* sampler) {
+  const std::vector<uint8_t>& texels = texture.CpuTexels();
+  glm::ivec2 size = texture.size();
+  if (texels.empty() || size.x <= 0 || size.y <= 0) return false;
+  ASSERT(texels.size() == static_cast<size_t>(size.x) * size.y * 4);
+  sampler->texels = texels.data();
+  sampler->size = size;
+  sampler->wrap_x = texture.Params().wrap_x;
+  sampler->wrap_y = texture.Params().wrap_y;
+  sampler->minify_filter = texture.Params().minify_filter;
+  sampler->magnify_filter = texture.Params().magnify_filter;
+  return true;
+}
+
+void LogSkippedElements(size_t n_skipped) {
+  if (n_skipped > 0) {
+    SLOG(SLOG_WARNING,
+         "Software export skipped $0 element draws that are zoomable, or "
+         "whose meshes or textures are not held in CPU memory",
+         n_skipped);
+  }
+}
 }  // namespace
 
 glm::ivec2 ImageExporter::BestTextureSize(const Rect& world_rect,
@@ -73,53 +115,71 @@ DefaultImageExporter::DefaultImageExporter(
       wall_clock_(registry.GetShared<WallClockInterface>()),
       root_renderer_(registry.GetShared<RootRenderer>()),
       tools_(registry.GetShared<ToolController>()),
-      frame_state_(registry.GetShared<FrameState>()) {}
+      frame_state_(registry.GetShared<FrameState>()) {
+  auto flags = registry.GetShared<settings::Flags>();
+  gl_resources_->texture_manager->SetRetainCpuTexels(
+      flags->GetFlag(settings::Flag::KeepTexturesInCpuMemory));
+  flags->AddListener(this);
+}
+
+void DefaultImageExporter::OnFlagChanged(settings::Flag which,
+                                         bool new_value) {
+  if (which == settings::Flag::KeepTexturesInCpuMemory) {
+    gl_resources_->texture_manager->SetRetainCpuTexels(new_value);
+  }
+}
 
-// The specific order of draw operations in Render should be kept in sync with
-// RootRenderer.
-//
 void DefaultImageExporter::Render(
     uint32_t max_dimension_px, const Rect& image_export_world_bounds,
     const ImageExporter::BackgroundOptions background_options,
     const ImageExporter::CurrentToolOptions current_tool_options,
     const ImageExporter::DrawablesOptions drawables_options,
+    const ImageExporter::BackendOptions backend_options,
     GroupId render_only_group, ExportedImage* out) {
   ASSERT(image_export_world_bounds.Width() > 0);
   ASSERT(image_export_world_bounds.Height() > 0);
 
-  const FrameTimeS draw_time = frame_state_->GetFrameTime();
-
   out->size_px = BestTextureSizeWithinAvailableLimits(
-      max_dimension_px, image_export_world_bounds);
+      max_dimension_px, image_export_world_bounds, backend_options);
 
   SLOG(SLOG_INFO, "Creating image: widthPx: $0, heightPx: $1, world bounds: $2",
        out->size_px.x, out->size_px.y, image_export_world_bounds);
 
-  Camera export_cam;
-  export_cam.SetScreenDim(out->size_px);
-  export_cam.SetWorldWindow(image_export_world_bounds);
-  SinglePartitionRenderer renderer(wall_clock_, gl_resources_);
+  if (backend_options == BackendOptions::kSoftware) {
+    // This is called on the main thread, rather than from a task, so the
+    // rasterization may use every hardware thread.
+    MakeSoftwareSceneRenderer().Render(
+        out->size_px, image_export_world_bounds, WantDraw(background_options),
+        render_only_group, HardwareThreads(), out);
+  } else {
+    out->fingerprint = SceneFingerprint(*scene_graph_);
+    RenderWithGL(image_export_world_bounds, out->size_px, background_options,
+                 current_tool_options, drawables_options, render_only_group,
+                 &out->bytes);
+  }
+}
 
-  ink::Fingerprinter fingerprinter;
+// The specific order of draw operations in RenderWithGL should be kept in sync
+// with RootRenderer.
+void DefaultImageExporter::RenderWithGL(
+    const Rect& world_bounds, glm::ivec2 size_px,
+    const ImageExporter::BackgroundOptions background_options,
+    const ImageExporter::CurrentToolOptions current_tool_options,
+    const ImageExporter::DrawablesOptions drawables_options,
+    GroupId render_only_group, std::vector<uint8_t>* bytes) {
+  const FrameTimeS draw_time = frame_state_->GetFrameTime();
 
-  std::vector<ElementId> all_elements;
-  scene_graph_->ElementsInScene(std::back_inserter(all_elements));
-  for (ElementId id : all_elements) {
-    // The fingerprinter cares about whether the elements relative to their
-    // groups are the same, not if (for example) the pages are re-layed out.
-    if (id.Type() != GROUP) {
-      ElementMetadata md = scene_graph_->GetElementMetadata(id);
-      fingerprinter.Note(md.uuid, md.group_transform);
-    }
-  }
-  out->fingerprint = fingerprinter.GetFingerprint();
+  Camera export_cam;
+  export_cam.SetScreenDim(size_px);
+  export_cam.SetWorldWindow(world_bounds);
+  SinglePartitionRenderer renderer(wall_clock_, gl_resources_);
 
   RegionQuery query = RegionQuery::MakeCameraQuery(export_cam)
                           .SetGroupFilter(render_only_group);
   auto elements_by_group = scene_graph_->ElementsInRegionByGroup(query);
 
   renderer.AssignPartitionData(PartitionData(1, elements_by_group));
-  renderer.Resize(out->size_px);
+  renderer.Resize(size_px);
 
   // Draw scene to target
   while (renderer.CacheState() != PartitionCacheState::Complete) {
@@ -132,7 +192,7 @@ void DefaultImageExporter::Render(
   // that directly took from it's cached front buffer
   RenderTarget target(gl_resources_);
   export_cam.FlipWorldToDevice();
-  target.Resize(out->size_px);
+  target.Resize(size_px);
   target.Clear(glm::vec4(0));
 
   if (WantDraw(drawables_options)) {
@@ -179,11 +239,170 @@ void DefaultImageExporter::Render(
   }
 
   // Read back pixels from target
-  target.GetPixels(&out->bytes);
+  target.GetPixels(bytes);
+}
+
+SoftwareSceneRenderer DefaultImageExporter::MakeSoftwareSceneRenderer()
+    const {
+  BackgroundState* background_state = gl_resources_->background_state.get();
+  std::shared_ptr<TextureManager> texture_manager =
+      gl_resources_->texture_manager;
+
+  SoftwareSceneRenderer::Background background;
+  background.color = background_state->GetColor();
+  ImageBackgroundState* image_background = nullptr;
+  if (background_state->IsImageAndReady(texture_manager.get())) {
+    EXPECT(background_state->GetImage(&image_background));
+    background.is_image = true;
+    background.draw_image = image_background->HasFirstInstanceWorldCoords();
+    background.world_to_uv = image_background->WorldToUV();
+    Texture* texture = nullptr;
+    if (texture_manager->GetTexture(image_background->TextureHandle(),
+                                    &texture)) {
+      SamplerForTexture(*texture, &background.image);
+    }
+  }
+
+  return SoftwareSceneRenderer(
+      scene_graph_, background,
+      [texture_manager](const std::string& uri,
+                        SoftwareRasterizer::TextureSampler* sampler) {
+        Texture* texture = nullptr;
+        return texture_manager->GetTexture(TextureInfo(uri), &texture) &&
+               SamplerForTexture(*texture, sampler);
+      });
+}
+
+void DefaultImageExporter::RenderTiled(
+    uint32_t max_dimension_px, const Rect& image_export_world_bounds,
+    const ImageExporter::BackgroundOptions background_options,
+    const ImageExporter::BackendOptions backend_options,
+    GroupId render_only_group, ImageExportSink* sink) {
+  ASSERT(image_export_world_bounds.Width() > 0);
+  ASSERT(image_export_world_bounds.Height() > 0);
+
+  // Unlike Render(), the size is not limited by the maximum texture size.
+  const glm::ivec2 size_px = glm::max(
+      BestTextureSize(image_export_world_bounds, max_dimension_px),
+      glm::ivec2(1));
+  int tile_size_px = kSoftwareTileSizePx;
+  if (backend_options == BackendOptions::kGL) {
+    int max_texture_size = 0;
+    gl_resources_->gl->GetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    EXPECT(max_texture_size > 0);
+    tile_size_px = std::min(kGLTileSizePx, max_texture_size);
+  }
+  const int n_columns = (size_px.x + tile_size_px - 1) / tile_size_px;
+  const int n_rows = (size_px.y + tile_size_px - 1) / tile_size_px;
+
+  SLOG(SLOG_INFO,
+       "Creating tiled image: widthPx: $0, heightPx: $1, tiles: $2x$3, world "
+       "bounds: $4",
+       size_px.x, size_px.y, n_columns, n_rows, image_export_world_bounds);
+
+  sink->Begin(size_px, SceneFingerprint(*scene_graph_));
+
+  // The world rectangle covered by the pixels [x0, x1) x [y0, y1), where the
+  // first row of pixels is the top of the world bounds.
+  const glm::dvec2 world_per_px(
+      static_cast<double>(image_export_world_bounds.Width()) / size_px.x,
+      static_cast<double>(image_export_world_bounds.Height()) / size_px.y);
+  auto tile_world_rect = [&image_export_world_bounds, &world_per_px](
+                             int x0, int y0, int x1, int y1) {
+    const Rect& world = image_export_world_bounds;
+    return Rect(world.from.x + x0 * world_per_px.x,
+                world.to.y - y1 * world_per_px.y,
+                world.from.x + x1 * world_per_px.x,
+                world.to.y - y0 * world_per_px.y);
+  };
+
+  // Only one row of tiles is held at once, and it is handed to the sink as a
+  // band of full-width rows.
+  std::vector<uint8_t> band;
+  std::vector<std::vector<uint8_t>> tile_bytes(n_columns);
+  std::vector<std::unique_ptr<SoftwareRasterizer>> rasterizers(n_columns);
+  absl::optional<SoftwareSceneRenderer> software_renderer;
+  if (backend_options == BackendOptions::kSoftware)
+    software_renderer = MakeSoftwareSceneRenderer();
+  // Each mesh is unpacked once, when the first tile that it overlaps is drawn,
+  // and dropped once the last row of tiles that it overlaps has been drawn.
+  SoftwareSceneRenderer::MeshCache mesh_cache;
+  size_t n_skipped = 0;
+  for (int row = 0; row < n_rows; ++row) {
+    const int y0 = row * tile_size_px;
+    const int y1 = std::min(y0 + tile_size_px, size_px.y);
+
+    if (backend_options == BackendOptions::kSoftware) {
+      // Each tile's draws are recorded here, as they read the scene graph, and
+      // the tiles are then rasterized in parallel, each by a single worker.
+      // The tiles share the whole image's transform, so they join without
+      // seams, and each one's query is padded by a pixel so that rounding
+      // can't drop an element that touches its edge.
+      for (int column = 0; column < n_columns; ++column) {
+        const int x0 = column * tile_size_px;
+        const int x1 = std::min(x0 + tile_size_px, size_px.x);
+        rasterizers[column] = absl::make_unique<SoftwareRasterizer>(
+            glm::ivec2(x1 - x0, y1 - y0), glm::ivec2(x0, y0), size_px,
+            image_export_world_bounds);
+        n_skipped += software_renderer->Draw(
+            tile_world_rect(x0 - 1, y0 - 1, x1 + 1, y1 + 1),
+            WantDraw(background_options), render_only_group,
+            rasterizers[column].get(), &mesh_cache);
+      }
+      // The next row's query starts a pixel above its first row.
+      mesh_cache.DropMeshesAbove(tile_world_rect(0, y1 - 1, 1, y1).to.y);
+      // This is called on the main thread, rather than from a task, so the
+      // tiles may be rasterized on every hardware thread.
+      ParallelFor(n_columns, HardwareThreads(),
+                  [&rasterizers, &tile_bytes](int column) {
+                    const SoftwareRasterizer& rasterizer =
+                        *rasterizers[column];
+                    glm::ivec2 tile_size = rasterizer.SizePx();
+                    tile_bytes[column].resize(
+                        static_cast<size_t>(tile_size.x) * tile_size.y * 4);
+                    ClientBitmapWrapper bitmap(
+                        tile_bytes[column].data(),
+                        ImageSize(tile_size.x, tile_size.y),
+                        ImageFormat::BITMAP_FORMAT_RGBA_8888);
+                    rasterizer.Rasterize(&bitmap, 1);
+                  });
+      for (auto& rasterizer : rasterizers) rasterizer.reset();
+    } else {
+      for (int column = 0; column < n_columns; ++column) {
+        const int x0 = column * tile_size_px;
+        const int x1 = std::min(x0 + tile_size_px, size_px.x);
+        RenderWithGL(tile_world_rect(x0, y0, x1, y1),
+                     glm::ivec2(x1 - x0, y1 - y0), background_options,
+                     CurrentToolOptions::kSkip, DrawablesOptions::kSkip,
+                     render_only_group, &tile_bytes[column]);
+      }
+    }
+
+    // Interleave the tiles' rows into the band.
+    band.resize(static_cast<size_t>(size_px.x) * (y1 - y0) * 4);
+    for (int column = 0; column < n_columns; ++column) {
+      const int x0 = column * tile_size_px;
+      const size_t tile_row_bytes =
+          static_cast<size_t>(std::min(tile_size_px, size_px.x - x0)) * 4;
+      EXPECT(tile_bytes[column].size() == tile_row_bytes * (y1 - y0));
+      for (int y = 0; y < y1 - y0; ++y) {
+        std::memcpy(band.data() + (static_cast<size_t>(y) * size_px.x + x0) * 4,
+                    tile_bytes[column].data() + y * tile_row_bytes,
+                    tile_row_bytes);
+      }
+    }
+    sink->WriteRows(y0, y1 - y0, band.data());
+  }
+  LogSkippedElements(n_skipped);
 }
 
 glm::ivec2 DefaultImageExporter::BestTextureSizeWithinAvailableLimits(
-    uint32_t max_dimension_px, const Rect& world_rect) const {
+    uint32_t max_dimension_px, const Rect& world_rect,
+    const ImageExporter::BackendOptions backend_options) const {
+  // The software backend's images are only limited by memory.
+  if (backend_options == BackendOptions::kSoftware)
+    return BestTextureSize(world_rect, max_dimension_px);
+
   int max_texture_size = 0;
   gl_resources_->gl->GetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
   EXPECT(max_texture_size > 0);
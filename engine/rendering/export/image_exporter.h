@@ -17,24 +17,45 @@
 #ifndef INK_ENGINE_RENDERING_EXPORT_IMAGE_EXPORTER_H_
 #define INK_ENGINE_RENDERING_EXPORT_IMAGE_EXPORTER_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "third_party/glm/glm/glm.hpp"
 #include "ink/engine/geometry/primitives/rect.h"
 #include "ink/engine/public/types/exported_image.h"
 #include "ink/engine/realtime/tool_controller.h"
+#include "ink/engine/rendering/export/software_scene_renderer.h"
 #include "ink/engine/rendering/gl_managers/gl_resource_manager.h"
 #include "ink/engine/scene/frame_state/frame_state.h"
 #include "ink/engine/scene/graph/scene_graph.h"
 #include "ink/engine/scene/page/page_bounds.h"
 #include "ink/engine/scene/root_renderer.h"
 #include "ink/engine/service/registry.h"
+#include "ink/engine/settings/flags.h"
 #include "ink/engine/util/time/time_types.h"
 #include "ink/engine/util/time/wall_clock.h"
 #include "ink/proto/elements_portable_proto.pb.h"
 
 namespace ink {
+
+// Receives an image from ImageExporter::RenderTiled(), one band of rows at a
+// time, so that the whole image never needs to be held in memory.
+class ImageExportSink {
+ public:
+  virtual ~ImageExportSink() {}
+
+  // Called once, before any rows are written, with the size of the image and
+  // the fingerprint of the scene (see ExportedImage).
+  virtual void Begin(glm::ivec2 size_px, uint64_t fingerprint) = 0;
+
+  // Called with consecutive bands of rows, from the top of the image to the
+  // bottom. rgba holds n_rows rows of RGBA 8888 pixels, each the full width of
+  // the image, and is only valid for the duration of the call.
+  virtual void WriteRows(int first_row, int n_rows, const uint8_t* rgba) = 0;
+};
+
 // This service provides a means for rendering an Ink SceneGraph to a rasterized
 // buffer (which you can export to your preferred image format for taking
 // screenshots, recording videos, etc.).
@@ -67,6 +88,17 @@ class ImageExporter {
     kDraw,
   };
 
+  // Indicates whether the image should be rasterized with GL or on the CPU,
+  // with a SoftwareSceneRenderer. The software backend does not draw the
+  // current tool or in-scene drawables, and can only draw elements whose meshes
+  // and textures are held in CPU memory (see Flag::KeepMeshesInCpuMemory and
+  // Flag::KeepTexturesInCpuMemory); other elements are skipped. Hosts without
+  // GL can use SoftwareSceneRenderer directly.
+  enum class BackendOptions {
+    kGL = 0,
+    kSoftware,
+  };
+
   virtual ~ImageExporter() {}
 
   // Creates an image of the current from world coords
@@ -77,16 +109,32 @@ class ImageExporter {
   // If render_only_group is set to something other than kInvalidElementId, then
   // only elements in that group will be rendered.
   //
-  // If either the width or height (in px) exceeds GL_MAX_TEXTURE_SIZE, the
-  // output is scaled so no dimension is too large but the aspect ratio is
-  // preserved (see "BestTextureSize()").
+  // With the GL backend, if either the width or height (in px) exceeds
+  // GL_MAX_TEXTURE_SIZE (or 4096), the output is scaled so no dimension is too
+  // large but the aspect ratio is preserved (see "BestTextureSize()").
   virtual void Render(uint32_t max_dimension_px,
                       const Rect& image_export_world_bounds,
                       BackgroundOptions background_options,
                       CurrentToolOptions current_tool_options,
                       DrawablesOptions drawables_options,
+                      BackendOptions backend_options,
                       GroupId render_only_group, ExportedImage* out) = 0;
 
+  // Creates an image as Render() does, but without limiting its size to the
+  // maximum texture size: the image is split into tiles, which are rendered
+  // independently, each visiting only the elements that overlap it, and are
+  // written to the sink a row of tiles at a time. With the software backend,
+  // the tiles in each row are rasterized in parallel.
+  //
+  // The current tool and in-scene drawables are never drawn, as they can't be
+  // drawn piecewise.
+  virtual void RenderTiled(uint32_t max_dimension_px,
+                           const Rect& image_export_world_bounds,
+                           BackgroundOptions background_options,
+                           BackendOptions backend_options,
+                           GroupId render_only_group,
+                           ImageExportSink* sink) = 0;
+
   // Returns the dimensions, in pixels, of the rectangle that fits within a GL
   // texture that can be provided and whose aspect ratio matches that of
   // world_rect. These dimensions may be as large as allowed by world_rect and
@@ -95,17 +143,19 @@ class ImageExporter {
   //
   // Images exported with Render() will have their size determined by this
   // method. It may be used to precompute the size of images that Render() will
-  // provide.
+  // provide. The software backend is only limited by max_dimension_px.
   virtual glm::ivec2 BestTextureSizeWithinAvailableLimits(
-      uint32_t max_dimension_px, const Rect& world_rect) const = 0;
+      uint32_t max_dimension_px, const Rect& world_rect,
+      BackendOptions backend_options) const = 0;
 };
 
-class DefaultImageExporter : public ImageExporter {
+class DefaultImageExporter : public ImageExporter,
+                             public settings::FlagListener {
  public:
   using SharedDeps =
       service::Dependencies<SceneGraph, GLResourceManager, PageBounds,
                             WallClockInterface, RootRenderer, ToolController,
-                            FrameState>;
+                            FrameState, settings::Flags>;
 
   explicit DefaultImageExporter(
       const service::Registry<DefaultImageExporter>& registry);
@@ -113,13 +163,34 @@ class DefaultImageExporter : public ImageExporter {
   void Render(uint32_t max_dimension_px, const Rect& image_export_world_bounds,
               BackgroundOptions background_options,
               CurrentToolOptions current_tool_options,
-              DrawablesOptions drawables_options, GroupId render_only_group,
+              DrawablesOptions drawables_options,
+              BackendOptions backend_options, GroupId render_only_group,
               ExportedImage* out) override;
 
+  void RenderTiled(uint32_t max_dimension_px,
+                   const Rect& image_export_world_bounds,
+                   BackgroundOptions background_options,
+                   BackendOptions backend_options, GroupId render_only_group,
+                   ImageExportSink* sink) override;
+
   glm::ivec2 BestTextureSizeWithinAvailableLimits(
-      uint32_t max_dimension_px, const Rect& world_rect) const override;
+      uint32_t max_dimension_px, const Rect& world_rect,
+      BackendOptions backend_options) const override;
+
+  void OnFlagChanged(settings::Flag which, bool new_value) override;
 
  private:
+  // Renders world_bounds with GL into bytes, an RGBA 8888 image of size_px.
+  void RenderWithGL(const Rect& world_bounds, glm::ivec2 size_px,
+                    BackgroundOptions background_options,
+                    CurrentToolOptions current_tool_options,
+                    DrawablesOptions drawables_options,
+                    GroupId render_only_group, std::vector<uint8_t>* bytes);
+
+  // Returns a renderer for the software backend, which reads the background
+  // and the textures' CPU texels from the GL resources.
+  SoftwareSceneRenderer MakeSoftwareSceneRenderer() const;
+
   std::shared_ptr<SceneGraph> scene_graph_;
   std::shared_ptr<GLResourceManager> gl_resources_;
   std::shared_ptr<PageBounds> page_bounds_;
@@ -0,0 +1,42 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/rendering/export/scene_fingerprint.h"
+
+#include <iterator>
+#include <vector>
+
+#include "ink/engine/scene/types/element_id.h"
+#include "ink/engine/scene/types/element_metadata.h"
+#include "ink/public/fingerprint/fingerprint.h"
+
+namespace ink {
+
+uint64_t SceneFingerprint(const SceneGraph& scene_graph) {
+  ink::Fingerprinter fingerprinter;
+
+  std::vector<ElementId> all_elements;
+  scene_graph.ElementsInScene(std::back_inserter(all_elements));
+  for (ElementId id : all_elements) {
+    // The fingerprinter cares about whether the elements relative to their
+    // groups are the same, not if (for example) the pages are re-layed out.
+    if (id.Type() != GROUP) {
+      ElementMetadata md = scene_graph.GetElementMetadata(id);
+      fingerprinter.Note(md.uuid, md.group_transform);
+    }
+  }
+  return fingerprinter.GetFingerprint();
+}
+
+}  // namespace ink
@@ -0,0 +1,33 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INK_ENGINE_RENDERING_EXPORT_SCENE_FINGERPRINT_H_
+#define INK_ENGINE_RENDERING_EXPORT_SCENE_FINGERPRINT_H_
+
+#include <cstdint>
+
+#include "ink/engine/scene/graph/scene_graph.h"
+
+namespace ink {
+
+// Returns the fingerprint of the elements in the scene, as reported with
+// exported images (see ExportedImage). It depends on the elements' UUIDs and
+// their transforms relative to their groups.
+uint64_t SceneFingerprint(const SceneGraph& scene_graph);
+
+}  // namespace ink
+
+#endif  // INK_ENGINE_RENDERING_EXPORT_SCENE_FINGERPRINT_H_
@@ -0,0 +1,639 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/rendering/export/software_rasterizer.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#include "ink/engine/geometry/algorithms/transform.h"
+#include "ink/engine/geometry/mesh/vertex_types.h"
+#include "ink/engine/processing/runner/parallel_for.h"
+#include "ink/engine/util/dbg/errors.h"
+#include "ink/engine/util/dbg/log.h"
+#include "ink/engine/util/dbg/log_levels.h"
+#include "ink/engine/util/funcs/step_utils.h"
+
+namespace ink {
+namespace {
+
+// The positions of the four samples within a pixel, relative to its top-left
+// corner, in the rotated-grid pattern used by 4x MSAA.
+constexpr double kSampleX[4] = {0.375, 0.875, 0.125, 0.625};
+constexpr double kSampleY[4] = {0.125, 0.375, 0.625, 0.875};
+constexpr double kMinSampleY = 0.125;
+constexpr double kMaxSampleY = 0.875;
+constexpr int kSamplesPerPixel = 4;
+
+// The edge function of the directed edge from p to q, which is positive to the
+// left of the edge (in pixel coordinates, where y points down).
+//
+// The coefficients and evaluations are done in double precision so that,
+// for coordinates that come from floats, the function of the reversed edge is
+// exactly the negation of this one; together with the tie-breaking rule, this
+// ensures that no sample on an edge shared by two triangles is covered twice
+// or missed.
+struct EdgeFunction {
+  EdgeFunction(glm::vec2 p, glm::vec2 q)
+      : a(static_cast<double>(p.y) - q.y),
+        b(static_cast<double>(q.x) - p.x),
+        c(static_cast<double>(p.x) * q.y - static_cast<double>(p.y) * q.x),
+        owns_ties(a > 0 || (a == 0 && b > 0)) {}
+
+  double Evaluate(double x, double y) const { return a * x + (b * y + c); }
+
+  double a;
+  double b;
+  double c;
+  // Whether samples exactly on the edge are inside. Of the two directions of
+  // an edge, exactly one owns its ties.
+  bool owns_ties;
+};
+
+// Returns the mask of the samples of the pixel at column x that are inside all
+// three edges, where row_terms[e][s] holds b * y + c for edge e at the y of
+// sample s.
+inline int CoverageMask(const EdgeFunction* edges, double x,
+                        const double row_terms[3][kSamplesPerPixel]) {
+#if defined(__AVX2__)
+  const __m256d sample_x =
+      _mm256_add_pd(_mm256_set1_pd(x), _mm256_loadu_pd(kSampleX));
+  int mask = 0xf;
+  for (int e = 0; e < 3; ++e) {
+    __m256d value =
+        _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(edges[e].a), sample_x),
+                      _mm256_loadu_pd(row_terms[e]));
+    __m256d inside =
+        edges[e].owns_ties
+            ? _mm256_cmp_pd(value, _mm256_setzero_pd(), _CMP_GE_OQ)
+            : _mm256_cmp_pd(value, _mm256_setzero_pd(), _CMP_GT_OQ);
+    mask &= _mm256_movemask_pd(inside);
+  }
+  return mask;
+#elif defined(__SSE4_1__)
+  const __m128d x_vec = _mm_set1_pd(x);
+  const __m128d sample_x_lo = _mm_add_pd(x_vec, _mm_loadu_pd(kSampleX));
+  const __m128d sample_x_hi = _mm_add_pd(x_vec, _mm_loadu_pd(kSampleX + 2));
+  int mask = 0xf;
+  for (int e = 0; e < 3; ++e) {
+    const __m128d a = _mm_set1_pd(edges[e].a);
+    __m128d value_lo = _mm_add_pd(_mm_mul_pd(a, sample_x_lo),
+                                  _mm_loadu_pd(row_terms[e]));
+    __m128d value_hi = _mm_add_pd(_mm_mul_pd(a, sample_x_hi),
+                                  _mm_loadu_pd(row_terms[e] + 2));
+    __m128d inside_lo, inside_hi;
+    if (edges[e].owns_ties) {
+      inside_lo = _mm_cmpge_pd(value_lo, _mm_setzero_pd());
+      inside_hi = _mm_cmpge_pd(value_hi, _mm_setzero_pd());
+    } else {
+      inside_lo = _mm_cmpgt_pd(value_lo, _mm_setzero_pd());
+      inside_hi = _mm_cmpgt_pd(value_hi, _mm_setzero_pd());
+    }
+    mask &= _mm_movemask_pd(inside_lo) | (_mm_movemask_pd(inside_hi) << 2);
+  }
+  return mask;
+#else
+  int mask = 0;
+  for (int s = 0; s < kSamplesPerPixel; ++s) {
+    bool inside = true;
+    for (int e = 0; e < 3 && inside; ++e) {
+      double value = edges[e].a * (x + kSampleX[s]) + row_terms[e][s];
+      inside = edges[e].owns_ties ? value >= 0 : value > 0;
+    }
+    if (inside) mask |= 1 << s;
+  }
+  return mask;
+#endif
+}
+
+// Returns round(v / 255) for v in [0, 255 * 255].
+inline uint32_t DivideBy255(uint32_t v) {
+  v += 128;
+  return (v + (v >> 8)) >> 8;
+}
+
+// Blends the premultiplied color src over the samples of a pixel that are set
+// in mask, as with glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA).
+inline void BlendPixel(uint32_t src, int mask, uint32_t* samples) {
+  const uint8_t* src_bytes = reinterpret_cast<const uint8_t*>(&src);
+  const uint32_t inverse_alpha = 255 - src_bytes[3];
+  if (inverse_alpha == 0 && mask == 0xf) {
+    std::fill(samples, samples + kSamplesPerPixel, src);
+    return;
+  }
+#if defined(__SSE4_1__)
+  const __m128i dst =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples));
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i scale = _mm_set1_epi16(inverse_alpha);
+  const __m128i bias = _mm_set1_epi16(128);
+  // dst * (255 - src_alpha) / 255, rounded, in 16-bit lanes.
+  __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_cvtepu8_epi16(dst), scale),
+                             bias);
+  __m128i hi =
+      _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), scale), bias);
+  lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+  hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+  const __m128i blended = _mm_adds_epu8(_mm_packus_epi16(lo, hi),
+                                        _mm_set1_epi32(static_cast<int>(src)));
+  const __m128i bits = _mm_set_epi32(8, 4, 2, 1);
+  const __m128i selected =
+      _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(mask), bits), bits);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(samples),
+                   _mm_blendv_epi8(dst, blended, selected));
+#else
+  for (int s = 0; s < kSamplesPerPixel; ++s) {
+    if ((mask & (1 << s)) == 0) continue;
+    uint8_t* dst_bytes = reinterpret_cast<uint8_t*>(samples + s);
+    for (int c = 0; c < 4; ++c) {
+      dst_bytes[c] = std::min<uint32_t>(
+          255, src_bytes[c] + DivideBy255(dst_bytes[c] * inverse_alpha));
+    }
+  }
+#endif
+}
+
+// Writes the average of each pixel's samples to out, for n pixels.
+void ResolveRow(const uint32_t* samples, int n, uint8_t* out) {
+  int x = 0;
+#if defined(__SSE4_1__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i bias = _mm_set1_epi16(2);
+  for (; x + 1 < n; x += 2) {
+    // Each pixel's four samples fill one register.
+    __m128i pixel0 = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(samples + x * kSamplesPerPixel));
+    __m128i pixel1 = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(samples + (x + 1) * kSamplesPerPixel));
+    // Sum samples (0, 2) and (1, 3), then the two halves.
+    __m128i sum0 = _mm_add_epi16(_mm_cvtepu8_epi16(pixel0),
+                                 _mm_unpackhi_epi8(pixel0, zero));
+    __m128i sum1 = _mm_add_epi16(_mm_cvtepu8_epi16(pixel1),
+                                 _mm_unpackhi_epi8(pixel1, zero));
+    __m128i sums = _mm_add_epi16(_mm_unpacklo_epi64(sum0, sum1),
+                                 _mm_unpackhi_epi64(sum0, sum1));
+    __m128i average = _mm_srli_epi16(_mm_add_epi16(sums, bias), 2);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * 4),
+                     _mm_packus_epi16(average, zero));
+  }
+#endif
+  for (; x < n; ++x) {
+    const uint8_t* pixel =
+        reinterpret_cast<const uint8_t*>(samples + x * kSamplesPerPixel);
+    for (int c = 0; c < 4; ++c) {
+      out[x * 4 + c] =
+          (pixel[c] + pixel[4 + c] + pixel[8 + c] + pixel[12 + c] + 2) / 4;
+    }
+  }
+}
+
+// Converts a premultiplied color to RGBA 8888, in memory order.
+uint32_t ToRgba8888(glm::vec4 color) {
+  uint8_t bytes[4];
+  for (int c = 0; c < 4; ++c)
+    bytes[c] = static_cast<uint8_t>(util::Clamp01(color[c]) * 255.0f + 0.5f);
+  uint32_t rgba;
+  std::memcpy(&rgba, bytes, sizeof(rgba));
+  return rgba;
+}
+
+// Maps a texel coordinate onto [0, size), as GL does for the wrap mode.
+int WrapTexelCoordinate(int i, int size, TextureWrap wrap) {
+  switch (wrap) {
+    case TextureWrap::ClampToEdge:
+      return std::min(std::max(i, 0), size - 1);
+    case TextureWrap::Repeat:
+      i %= size;
+      return i < 0 ? i + size : i;
+    case TextureWrap::MirroredRepeat:
+      i %= 2 * size;
+      if (i < 0) i += 2 * size;
+      return i < size ? i : 2 * size - 1 - i;
+  }
+  return 0;
+}
+
+// Converts a texture coordinate, scaled to texels, to an int without
+// overflowing. Coordinates this far out are meaningless at float precision
+// anyway.
+int FloorToTexel(float t) {
+  constexpr float kLimit = 1 << 30;
+  if (!(t > -kLimit)) return -(1 << 30);
+  if (!(t < kLimit)) return 1 << 30;
+  return static_cast<int>(std::floor(t));
+}
+
+// Returns floor(v) clamped to [lo, hi], without overflowing for vertices far
+// outside of the image.
+int FloorClamped(float v, int lo, int hi) {
+  if (!(v > lo)) return lo;
+  if (!(v < hi)) return hi;
+  return static_cast<int>(std::floor(v));
+}
+
+}  // namespace
+
+constexpr int SoftwareRasterizer::kBandHeight;
+
+bool SoftwareRasterizer::TextureSampler::FromBitmap(
+    const ClientBitmap& bitmap, const TextureParams& params,
+    TextureSampler* sampler) {
+  ImageSize size = bitmap.sizeInPx();
+  if (bitmap.format() != ImageFormat::BITMAP_FORMAT_RGBA_8888 ||
+      size.width <= 0 || size.height <= 0)
+    return false;
+  sampler->texels = static_cast<const uint8_t*>(bitmap.imageByteData());
+  sampler->size = glm::ivec2(size.width, size.height);
+  sampler->wrap_x = params.wrap_x;
+  sampler->wrap_y = params.wrap_y;
+  sampler->minify_filter = params.minify_filter;
+  sampler->magnify_filter = params.magnify_filter;
+  return true;
+}
+
+glm::vec4 SoftwareRasterizer::TextureSampler::Sample(
+    glm::vec2 uv, TextureMapping filter) const {
+  auto texel = [this](int x, int y) {
+    x = WrapTexelCoordinate(x, size.x, wrap_x);
+    y = WrapTexelCoordinate(y, size.y, wrap_y);
+    const uint8_t* t = texels + 4 * (static_cast<size_t>(y) * size.x + x);
+    return glm::vec4(t[0], t[1], t[2], t[3]) * (1.0f / 255.0f);
+  };
+  glm::vec2 t = uv * glm::vec2(size);
+  if (filter == TextureMapping::Nearest)
+    return texel(FloorToTexel(t.x), FloorToTexel(t.y));
+
+  t -= glm::vec2(0.5f);
+  int x = FloorToTexel(t.x);
+  int y = FloorToTexel(t.y);
+  glm::vec2 f = t - glm::floor(t);
+  if (!std::isfinite(f.x)) f.x = 0;
+  if (!std::isfinite(f.y)) f.y = 0;
+  return glm::mix(glm::mix(texel(x, y), texel(x + 1, y), f.x),
+                  glm::mix(texel(x, y + 1), texel(x + 1, y + 1), f.x), f.y);
+}
+
+SoftwareRasterizer::SoftwareRasterizer(glm::ivec2 size_px,
+                                       const Rect& world_window)
+    : SoftwareRasterizer(size_px, glm::ivec2(0), size_px, world_window) {}
+
+SoftwareRasterizer::SoftwareRasterizer(glm::ivec2 size_px,
+                                       glm::ivec2 tile_origin_px,
+                                       glm::ivec2 image_size_px,
+                                       const Rect& world_window)
+    : size_px_(glm::max(size_px, glm::ivec2(0))),
+      world_window_(world_window),
+      world_to_pixel_(world_window.CalcTransformTo(
+          Rect(0, 0, image_size_px.x, image_size_px.y), true)),
+      tile_origin_px_(tile_origin_px),
+      clip_max_(size_px_),
+      band_triangles_((size_px_.y + kBandHeight - 1) / kBandHeight) {}
+
+void SoftwareRasterizer::Clear(const glm::vec4& color) {
+  clear_color_ = color;
+  vertices_.clear();
+  triangles_.clear();
+  draw_calls_.clear();
+  for (auto& band : band_triangles_) band.clear();
+}
+
+void SoftwareRasterizer::SetClipRect(const Rect& world_rect) {
+  Rect pixel_rect = geometry::Transform(world_rect, world_to_pixel_);
+  clip_min_ = glm::clamp(
+      glm::ivec2(glm::floor(pixel_rect.from - tile_origin_px_)),
+      glm::ivec2(0), size_px_);
+  clip_max_ = glm::clamp(
+      glm::ivec2(glm::ceil(pixel_rect.to - tile_origin_px_)), glm::ivec2(0),
+      size_px_);
+}
+
+void SoftwareRasterizer::ClearClipRect() {
+  clip_min_ = glm::ivec2(0);
+  clip_max_ = size_px_;
+}
+
+bool SoftwareRasterizer::UnpackedMesh::Unpack(const OptimizedMesh& mesh) {
+  if (mesh.verts.size() == 0 || mesh.IndexSize() == 0) return false;
+  mesh.verts.UnpackVertices(&verts);
+  indices.resize(mesh.IndexSize());
+  for (size_t i = 0; i < indices.size(); ++i) indices[i] = mesh.IndexAt(i);
+  return true;
+}
+
+bool SoftwareRasterizer::DrawMesh(const OptimizedMesh& mesh,
+                                  const TextureSampler* texture) {
+  if (mesh.texture && texture == nullptr) return false;
+  UnpackedMesh unpacked;
+  return unpacked.Unpack(mesh) && DrawMesh(mesh, unpacked, texture);
+}
+
+bool SoftwareRasterizer::DrawMesh(const OptimizedMesh& mesh,
+                                  const UnpackedMesh& unpacked,
+                                  const TextureSampler* texture) {
+  if (mesh.texture && texture == nullptr) return false;
+  switch (mesh.verts.GetFormat()) {
+    case VertFormat::x12y12:
+    case VertFormat::x32y32: {
+      glm::vec4 color = util::Clamp01(
+          glm::fma(mesh.color, mesh.mul_color_modifier,
+                   mesh.add_color_modifier));
+      AddTriangles(unpacked.verts, unpacked.indices, mesh.object_matrix,
+                   mesh.texture ? texture : nullptr, &color);
+    } break;
+    case VertFormat::x11a7r6y11g7b6:
+    case VertFormat::x11a7r6y11g7b6u12v12:
+      AddTriangles(unpacked.verts, unpacked.indices, mesh.object_matrix,
+                   mesh.texture ? texture : nullptr);
+      break;
+  }
+  return true;
+}
+
+bool SoftwareRasterizer::FillMesh(const OptimizedMesh& mesh,
+                                  const glm::vec4& color) {
+  UnpackedMesh unpacked;
+  if (!unpacked.Unpack(mesh)) return false;
+  FillMesh(mesh, unpacked, color);
+  return true;
+}
+
+void SoftwareRasterizer::FillMesh(const OptimizedMesh& mesh,
+                                  const UnpackedMesh& unpacked,
+                                  const glm::vec4& color) {
+  AddTriangles(unpacked.verts, unpacked.indices, mesh.object_matrix, nullptr,
+               &color);
+}
+
+bool SoftwareRasterizer::FillMesh(const OptimizedMesh& mesh,
+                                  const TextureSampler& texture,
+                                  const glm::mat4& world_to_uv) {
+  UnpackedMesh unpacked;
+  if (!unpacked.Unpack(mesh)) return false;
+  FillMesh(mesh, unpacked, texture, world_to_uv);
+  return true;
+}
+
+void SoftwareRasterizer::FillMesh(const OptimizedMesh& mesh,
+                                  const UnpackedMesh& unpacked,
+                                  const TextureSampler& texture,
+                                  const glm::mat4& world_to_uv) {
+  const glm::vec4 white(1);
+  const glm::mat4 object_to_uv = world_to_uv * mesh.object_matrix;
+  AddTriangles(unpacked.verts, unpacked.indices, mesh.object_matrix, &texture,
+               &white, &object_to_uv);
+}
+
+void SoftwareRasterizer::FillRect(const Rect& world_rect,
+                                  const TextureSampler& texture,
+                                  const glm::mat4& world_to_uv) {
+  VertexStreams verts(std::vector<Vertex>{
+      Vertex(world_rect.Leftbottom()), Vertex(world_rect.Rightbottom()),
+      Vertex(world_rect.Righttop()), Vertex(world_rect.Lefttop())});
+  const glm::vec4 white(1);
+  AddTriangles(verts, {0, 1, 2, 0, 2, 3}, glm::mat4{1}, &texture, &white,
+               &world_to_uv);
+}
+
+void SoftwareRasterizer::AddTriangles(const VertexStreams& verts,
+                                      const std::vector<uint32_t>& indices,
+                                      const glm::mat4& object_to_world,
+                                      const TextureSampler* texture,
+                                      const glm::vec4* color,
+                                      const glm::mat4* object_to_uv) {
+  if (clip_min_.x >= clip_max_.x || clip_min_.y >= clip_max_.y) return;
+
+  const auto draw_call = static_cast<uint32_t>(draw_calls_.size());
+  DrawCall call;
+  call.clip_min = clip_min_;
+  call.clip_max = clip_max_;
+  call.is_textured = texture != nullptr;
+  if (texture) call.texture = *texture;
+  draw_calls_.push_back(call);
+
+  const auto first_vertex = static_cast<uint32_t>(vertices_.size());
+  glm::mat4 object_to_pixel = world_to_pixel_ * object_to_world;
+  const std::vector<glm::vec2>& positions = verts.Positions();
+  const std::vector<glm::vec4>& colors = verts.Colors();
+  const std::vector<glm::vec2>& texture_coords = verts.TextureCoords();
+  vertices_.reserve(vertices_.size() + verts.size());
+  for (size_t i = 0; i < verts.size(); ++i) {
+    glm::vec2 uv{0, 0};
+    if (object_to_uv) {
+      uv = geometry::Transform(positions[i], *object_to_uv);
+    } else if (verts.HasTextureCoords()) {
+      uv = texture_coords[i];
+    }
+    vertices_.push_back(
+        {geometry::Transform(positions[i], object_to_pixel) - tile_origin_px_,
+         color ? *color : colors[i], uv});
+  }
+
+  const glm::vec2 clip_min(clip_min_);
+  const glm::vec2 clip_max(clip_max_);
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    if (indices[i] >= verts.size() || indices[i + 1] >= verts.size() ||
+        indices[i + 2] >= verts.size()) {
+      SLOG(SLOG_ERROR, "Skipping triangle with out-of-range index");
+      continue;
+    }
+    RasterTriangle triangle = {{first_vertex + indices[i],
+                                first_vertex + indices[i + 1],
+                                first_vertex + indices[i + 2]},
+                               draw_call};
+    const glm::vec2 p0 = vertices_[triangle.vertices[0]].position;
+    const glm::vec2 p1 = vertices_[triangle.vertices[1]].position;
+    const glm::vec2 p2 = vertices_[triangle.vertices[2]].position;
+    const glm::vec2 min = glm::min(p0, glm::min(p1, p2));
+    const glm::vec2 max = glm::max(p0, glm::max(p1, p2));
+    // This also rejects triangles with non-finite coordinates.
+    if (!(max.x > clip_min.x && min.x < clip_max.x && max.y > clip_min.y &&
+          min.y < clip_max.y))
+      continue;
+
+    const auto triangle_index = static_cast<uint32_t>(triangles_.size());
+    triangles_.push_back(triangle);
+    int first_row = FloorClamped(min.y, clip_min_.y, clip_max_.y - 1);
+    int last_row = FloorClamped(max.y, clip_min_.y, clip_max_.y - 1);
+    for (int band = first_row / kBandHeight; band <= last_row / kBandHeight;
+         ++band) {
+      band_triangles_[band].push_back(triangle_index);
+    }
+  }
+}
+
+void SoftwareRasterizer::Rasterize(ClientBitmap* bitmap,
+                                   int max_threads) const {
+  if (bitmap->format() != ImageFormat::BITMAP_FORMAT_RGBA_8888 ||
+      bitmap->sizeInPx().width != size_px_.x ||
+      bitmap->sizeInPx().height != size_px_.y) {
+    SLOG(SLOG_ERROR, "Cannot rasterize a $0x$1 image into $2", size_px_.x,
+         size_px_.y, *bitmap);
+    return;
+  }
+  uint8_t* out = static_cast<uint8_t*>(bitmap->imageByteData());
+  const int n_bands = static_cast<int>(band_triangles_.size());
+
+  // Each worker reuses one band's worth of samples, and takes bands in order
+  // as it finishes its previous ones, since the amount of work per band can
+  // vary widely.
+  const int n_workers = std::max(1, std::min(max_threads, n_bands));
+  std::atomic<int> next_band(0);
+  ParallelFor(n_workers, n_workers, [this, out, n_bands, &next_band](int) {
+    std::vector<uint32_t> samples(static_cast<size_t>(size_px_.x) *
+                                  kBandHeight * kSamplesPerPixel);
+    for (int band = next_band++; band < n_bands; band = next_band++)
+      RasterizeBand(band, samples.data(), out);
+  });
+}
+
+void SoftwareRasterizer::RasterizeBand(int band, uint32_t* samples,
+                                       uint8_t* out) const {
+  const int band_y = band * kBandHeight;
+  const int band_end_y = std::min(band_y + kBandHeight, size_px_.y);
+  const size_t n_samples = static_cast<size_t>(size_px_.x) *
+                           (band_end_y - band_y) * kSamplesPerPixel;
+  std::fill(samples, samples + n_samples, ToRgba8888(clear_color_));
+
+  for (uint32_t triangle_index : band_triangles_[band])
+    RasterizeTriangle(triangles_[triangle_index], band_y, band_end_y, samples);
+
+  for (int y = band_y; y < band_end_y; ++y) {
+    ResolveRow(samples + static_cast<size_t>(y - band_y) * size_px_.x *
+                             kSamplesPerPixel,
+               size_px_.x, out + static_cast<size_t>(y) * size_px_.x * 4);
+  }
+}
+
+void SoftwareRasterizer::RasterizeTriangle(const RasterTriangle& triangle,
+                                           int band_y, int band_end_y,
+                                           uint32_t* samples) const {
+  const DrawCall& call = draw_calls_[triangle.draw_call];
+  const RasterVertex* v[3] = {&vertices_[triangle.vertices[0]],
+                              &vertices_[triangle.vertices[1]],
+                              &vertices_[triangle.vertices[2]]};
+  // Orient the triangle so that its interior is to the left of each edge.
+  if (EdgeFunction(v[0]->position, v[1]->position)
+          .Evaluate(v[2]->position.x, v[2]->position.y) < 0)
+    std::swap(v[1], v[2]);
+  const EdgeFunction edges[3] = {
+      EdgeFunction(v[0]->position, v[1]->position),
+      EdgeFunction(v[1]->position, v[2]->position),
+      EdgeFunction(v[2]->position, v[0]->position)};
+  const double area = edges[0].Evaluate(v[2]->position.x, v[2]->position.y);
+  if (!(area > 0)) return;
+
+  const glm::vec2 min = glm::min(v[0]->position,
+                                 glm::min(v[1]->position, v[2]->position));
+  const glm::vec2 max = glm::max(v[0]->position,
+                                 glm::max(v[1]->position, v[2]->position));
+  const int x_begin = FloorClamped(min.x, call.clip_min.x, call.clip_max.x);
+  const int x_end =
+      FloorClamped(max.x, call.clip_min.x, call.clip_max.x - 1) + 1;
+  const int clip_y_begin = std::max(call.clip_min.y, band_y);
+  const int clip_y_end = std::min(call.clip_max.y, band_end_y);
+  const int y_begin = FloorClamped(min.y, clip_y_begin, clip_y_end);
+  const int y_end = FloorClamped(max.y, clip_y_begin, clip_y_end - 1) + 1;
+  if (x_begin >= x_end || y_begin >= y_end) return;
+
+  // The interpolated attributes are planes over the pixel coordinates,
+  // relative to v[0].
+  const glm::vec2 origin = v[0]->position;
+  const glm::vec2 d1 = v[1]->position - origin;
+  const glm::vec2 d2 = v[2]->position - origin;
+  const auto inverse_area = static_cast<float>(1.0 / area);
+  const glm::vec4 dc1 = v[1]->color - v[0]->color;
+  const glm::vec4 dc2 = v[2]->color - v[0]->color;
+  const glm::vec4 color_dx = (dc1 * d2.y - dc2 * d1.y) * inverse_area;
+  const glm::vec4 color_dy = (dc2 * d1.x - dc1 * d2.x) * inverse_area;
+  const glm::vec2 duv1 = v[1]->texture_coords - v[0]->texture_coords;
+  const glm::vec2 duv2 = v[2]->texture_coords - v[0]->texture_coords;
+  const glm::vec2 uv_dx = (duv1 * d2.y - duv2 * d1.y) * inverse_area;
+  const glm::vec2 uv_dy = (duv2 * d1.x - duv1 * d2.x) * inverse_area;
+  TextureMapping filter = call.texture.magnify_filter;
+  if (call.is_textured) {
+    const glm::vec2 texture_size(call.texture.size);
+    float texels_per_pixel = std::max(glm::length(uv_dx * texture_size),
+                                      glm::length(uv_dy * texture_size));
+    if (texels_per_pixel > 1) filter = call.texture.minify_filter;
+  }
+  // If every vertex has the same color, there is no need to interpolate it.
+  const bool is_flat_color = !call.is_textured &&
+                             v[0]->color == v[1]->color &&
+                             v[0]->color == v[2]->color;
+  const uint32_t flat_color = ToRgba8888(v[0]->color);
+  if (is_flat_color && flat_color == 0) return;
+
+  double row_terms[3][kSamplesPerPixel];
+  for (int y = y_begin; y < y_end; ++y) {
+    for (int e = 0; e < 3; ++e) {
+      for (int s = 0; s < kSamplesPerPixel; ++s)
+        row_terms[e][s] = edges[e].b * (y + kSampleY[s]) + edges[e].c;
+    }
+
+    // Narrow the row to the span in which the triangle may cover samples. For
+    // each edge that isn't horizontal, the boundary crosses the row's samples
+    // between the x-intercepts at the top and bottom sample, and the padding
+    // absorbs any rounding.
+    double span_begin = x_begin;
+    double span_end = x_end;
+    for (int e = 0; e < 3; ++e) {
+      const EdgeFunction& edge = edges[e];
+      if (edge.a == 0) continue;
+      double x_top = -(edge.b * (y + kMinSampleY) + edge.c) / edge.a;
+      double x_bottom = -(edge.b * (y + kMaxSampleY) + edge.c) / edge.a;
+      if (edge.a > 0) {
+        span_begin = std::max(span_begin, std::min(x_top, x_bottom) - 2);
+      } else {
+        span_end = std::min(span_end, std::max(x_top, x_bottom) + 1);
+      }
+    }
+    if (!(span_begin < span_end)) continue;
+    const int row_begin = static_cast<int>(std::floor(span_begin));
+    const int row_end = static_cast<int>(std::ceil(span_end));
+
+    const float center_dy = y + 0.5f - origin.y;
+    const glm::vec4 row_color = v[0]->color + color_dy * center_dy;
+    const glm::vec2 row_uv = v[0]->texture_coords + uv_dy * center_dy;
+    uint32_t* row_samples =
+        samples +
+        static_cast<size_t>(y - band_y) * size_px_.x * kSamplesPerPixel;
+    for (int x = row_begin; x < row_end; ++x) {
+      int mask = CoverageMask(edges, x, row_terms);
+      if (mask == 0) continue;
+
+      uint32_t src = flat_color;
+      if (!is_flat_color) {
+        const float center_dx = x + 0.5f - origin.x;
+        glm::vec4 color = row_color + color_dx * center_dx;
+        if (call.is_textured) {
+          color *= call.texture.Sample(row_uv + uv_dx * center_dx, filter);
+        }
+        src = ToRgba8888(color);
+        if (src == 0) continue;
+      }
+      BlendPixel(src, mask, row_samples + x * kSamplesPerPixel);
+    }
+  }
+}
+
+}  // namespace ink
@@ -0,0 +1,224 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INK_ENGINE_RENDERING_EXPORT_SOFTWARE_RASTERIZER_H_
+#define INK_ENGINE_RENDERING_EXPORT_SOFTWARE_RASTERIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "third_party/glm/glm/glm.hpp"
+#include "ink/engine/geometry/mesh/mesh.h"
+#include "ink/engine/geometry/mesh/vertex.h"
+#include "ink/engine/geometry/mesh/vertex_streams.h"
+#include "ink/engine/geometry/primitives/rect.h"
+#include "ink/engine/public/types/client_bitmap.h"
+#include "ink/engine/rendering/gl_managers/texture_params.h"
+
+namespace ink {
+
+// SoftwareRasterizer draws meshes into an RGBA 8888 bitmap on the CPU, for
+// exporting images where no GL context is available. It reads textures from
+// CPU memory, through TextureSamplers, and never touches GL.
+//
+// It mirrors the GL export path: colors are premultiplied and are blended as
+// with glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA), and edges are anti-aliased
+// with four samples per pixel in the rotated-grid pattern used by 4x MSAA. As
+// with MSAA, colors and texels are evaluated once per pixel, at its center,
+// and triangles that share an edge cover each sample exactly once.
+//
+// Draw calls only record the triangles. Rasterize() then splits the image into
+// horizontal bands, which may be rasterized in parallel; each band replays the
+// triangles that overlap it, in the order in which they were drawn.
+class SoftwareRasterizer {
+ public:
+  // The texels of a texture, in RGBA 8888 format, and how to sample them. The
+  // texels are not copied: they must stay alive and unchanged until after
+  // Rasterize().
+  struct TextureSampler {
+    const uint8_t* texels = nullptr;
+    glm::ivec2 size{0, 0};
+    TextureWrap wrap_x = TextureWrap::ClampToEdge;
+    TextureWrap wrap_y = TextureWrap::ClampToEdge;
+    TextureMapping minify_filter = TextureMapping::Linear;
+    TextureMapping magnify_filter = TextureMapping::Linear;
+
+    // Returns a sampler for the bitmap, which must be in RGBA 8888 format,
+    // with the given wrap modes and filters, or false if the bitmap is empty
+    // or in another format.
+    static bool FromBitmap(const ClientBitmap& bitmap,
+                           const TextureParams& params,
+                           TextureSampler* sampler);
+
+    // Returns the premultiplied color at the given texture coordinates, as GL
+    // would sample it with the given filter.
+    glm::vec4 Sample(glm::vec2 uv, TextureMapping filter) const;
+  };
+
+  // A mesh's vertices and indices, unpacked from its vertex format. The draw
+  // calls that take one don't modify it, so a mesh drawn into several
+  // rasterizers, e.g. the tiles of an image, need only be unpacked once.
+  struct UnpackedMesh {
+    VertexStreams verts;
+    std::vector<uint32_t> indices;
+
+    // Unpacks the mesh. Returns false if its vertices are not held in CPU
+    // memory (see OptimizedMesh::ClearCpuMemoryVerts()).
+    bool Unpack(const OptimizedMesh& mesh);
+  };
+
+  // The image is size_px, and shows the world rectangle world_window. As with
+  // images exported with GL, the first row of the image is the top of
+  // world_window.
+  SoftwareRasterizer(glm::ivec2 size_px, const Rect& world_window);
+
+  // Rasterizes only the tile of size size_px whose top-left corner is at
+  // tile_origin_px, within an image of size image_size_px that shows the world
+  // rectangle world_window. Tiles of the same image join without seams: each
+  // sample is covered exactly as it would be in the whole image.
+  SoftwareRasterizer(glm::ivec2 size_px, glm::ivec2 tile_origin_px,
+                     glm::ivec2 image_size_px, const Rect& world_window);
+
+  // Disallow copy and assign.
+  SoftwareRasterizer(const SoftwareRasterizer&) = delete;
+  SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+
+  glm::ivec2 SizePx() const { return size_px_; }
+
+  // The world rectangle shown by the whole image, of which this may be a tile.
+  const Rect& WorldWindow() const { return world_window_; }
+
+  // Fills the whole image with the given premultiplied color, discarding
+  // everything drawn so far. This ignores the clip rectangle, like glClear()
+  // without a scissor. The image is initially transparent black.
+  void Clear(const glm::vec4& color);
+
+  // Restricts subsequent draws to the given world rectangle, in the same manner
+  // as a Scissor, until ClearClipRect() is called.
+  void SetClipRect(const Rect& world_rect);
+  void ClearClipRect();
+
+  // Draws the mesh as the PackedVertShader would: meshes in a format without
+  // per-vertex colors are filled with the mesh's color (with its color
+  // modifiers applied), and textured meshes are drawn with "texture", tinted by
+  // their vertex colors. "texture" is ignored if the mesh has no texture.
+  //
+  // Returns false, without drawing anything, if the mesh's vertices are not
+  // held in CPU memory (see OptimizedMesh::ClearCpuMemoryVerts()), or if the
+  // mesh has a texture and "texture" is null.
+  bool DrawMesh(const OptimizedMesh& mesh, const TextureSampler* texture);
+  bool DrawMesh(const OptimizedMesh& mesh, const UnpackedMesh& unpacked,
+                const TextureSampler* texture);
+
+  // Fills the mesh's triangles with the given premultiplied color, ignoring the
+  // mesh's own colors, e.g. to draw an eraser mesh over a background color.
+  // Returns false if the mesh's vertices are not held in CPU memory.
+  bool FillMesh(const OptimizedMesh& mesh, const glm::vec4& color);
+  void FillMesh(const OptimizedMesh& mesh, const UnpackedMesh& unpacked,
+                const glm::vec4& color);
+
+  // Fills the mesh's triangles with the texture, where world_to_uv maps world
+  // coordinates to texture coordinates, e.g. to draw an eraser mesh over a
+  // background image. Returns false if the mesh's vertices are not held in CPU
+  // memory.
+  bool FillMesh(const OptimizedMesh& mesh, const TextureSampler& texture,
+                const glm::mat4& world_to_uv);
+  void FillMesh(const OptimizedMesh& mesh, const UnpackedMesh& unpacked,
+                const TextureSampler& texture, const glm::mat4& world_to_uv);
+
+  // Fills the world rectangle with the texture, where world_to_uv maps world
+  // coordinates to texture coordinates.
+  void FillRect(const Rect& world_rect, const TextureSampler& texture,
+                const glm::mat4& world_to_uv);
+
+  // Rasterizes everything that has been drawn into the bitmap, which must have
+  // format RGBA 8888 and the same size as this. The textures that were drawn
+  // must still be alive. The bands are shared among up to max_threads threads,
+  // including the calling thread (see ParallelFor()).
+  void Rasterize(ClientBitmap* bitmap, int max_threads = 1) const;
+
+  // The number of rows in each band that Rasterize() processes as a unit.
+  static constexpr int kBandHeight = 32;
+
+ private:
+  // A vertex, in pixel coordinates.
+  struct RasterVertex {
+    glm::vec2 position;
+    glm::vec4 color;
+    glm::vec2 texture_coords;
+  };
+
+  // A set of triangles that share a clip rectangle and texture. The clip
+  // rectangle is in pixels, [min, max).
+  struct DrawCall {
+    glm::ivec2 clip_min;
+    glm::ivec2 clip_max;
+    bool is_textured;
+    TextureSampler texture;
+  };
+
+  struct RasterTriangle {
+    uint32_t vertices[3];
+    uint32_t draw_call;
+  };
+
+  // Appends a draw call for the triangles given by indices into verts, whose
+  // positions are transformed by object_to_world. If color is non-null, it
+  // replaces the vertices' colors, and if object_to_uv is non-null, each
+  // vertex's texture coordinates are its position transformed by it. If
+  // texture is non-null, each pixel's color is the texture sampled at the
+  // interpolated texture coordinates, multiplied by the interpolated color.
+  void AddTriangles(const VertexStreams& verts,
+                    const std::vector<uint32_t>& indices,
+                    const glm::mat4& object_to_world,
+                    const TextureSampler* texture,
+                    const glm::vec4* color = nullptr,
+                    const glm::mat4* object_to_uv = nullptr);
+
+  // Draws the triangles that overlap the given band into samples, which holds
+  // four RGBA 8888 samples for each pixel in the band, and then resolves the
+  // samples into the band's rows of out, the RGBA 8888 image.
+  void RasterizeBand(int band, uint32_t* samples, uint8_t* out) const;
+
+  // Blends the part of the triangle within rows [band_y, band_end_y) into the
+  // samples of that band.
+  void RasterizeTriangle(const RasterTriangle& triangle, int band_y,
+                         int band_end_y, uint32_t* samples) const;
+
+  glm::ivec2 size_px_;
+  Rect world_window_;
+  // Maps world coordinates to the pixels of the whole image. The tile's
+  // origin is subtracted afterwards, which is exact, so that every tile
+  // computes the same positions as the whole image would.
+  glm::mat4 world_to_pixel_;
+  glm::vec2 tile_origin_px_;
+  glm::vec4 clear_color_{0, 0, 0, 0};
+  glm::ivec2 clip_min_{0, 0};
+  glm::ivec2 clip_max_;
+
+  std::vector<RasterVertex> vertices_;
+  std::vector<RasterTriangle> triangles_;
+  std::vector<DrawCall> draw_calls_;
+
+  // For each band, the indices into triangles_ of the triangles whose bounds
+  // overlap it, in the order in which they were drawn.
+  std::vector<std::vector<uint32_t>> band_triangles_;
+};
+
+}  // namespace ink
+
+#endif  // INK_ENGINE_RENDERING_EXPORT_SOFTWARE_RASTERIZER_H_
@@ -0,0 +1,153 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/rendering/export/software_scene_renderer.h"
+
+#include <utility>
+
+#include "ink/engine/geometry/mesh/shader_type.h"
+#include "ink/engine/public/types/client_bitmap.h"
+#include "ink/engine/rendering/export/scene_fingerprint.h"
+#include "ink/engine/scene/graph/region_query.h"
+#include "ink/engine/util/dbg/errors.h"
+#include "ink/engine/util/dbg/log.h"
+#include "ink/engine/util/dbg/log_levels.h"
+
+namespace ink {
+
+SoftwareSceneRenderer::SoftwareSceneRenderer(
+    std::shared_ptr<const SceneGraph> scene_graph, const Background& background,
+    TextureLookup texture_lookup)
+    : scene_graph_(std::move(scene_graph)),
+      background_(background),
+      texture_lookup_(std::move(texture_lookup)) {}
+
+void SoftwareSceneRenderer::MeshCache::DropMeshesAbove(float world_y) {
+  for (auto it = meshes_.begin(); it != meshes_.end();) {
+    if (it->second.world_bounds.from.y > world_y) {
+      meshes_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
+
+// This mirrors the GL backend's draw order for the scene, but does not draw the
+// tool or drawables, which can only be drawn with GL.
+size_t SoftwareSceneRenderer::Draw(const Rect& world_bounds,
+                                   bool draw_background,
+                                   GroupId render_only_group,
+                                   SoftwareRasterizer* rasterizer,
+                                   MeshCache* mesh_cache) const {
+  const bool has_background_texels =
+      background_.is_image && background_.image.texels != nullptr;
+  if (draw_background) {
+    if (!background_.is_image) {
+      rasterizer->Clear(background_.color);
+    } else if (background_.draw_image) {
+      if (has_background_texels) {
+        rasterizer->FillRect(rasterizer->WorldWindow(), background_.image,
+                             background_.world_to_uv);
+      } else {
+        SLOG(SLOG_WARNING,
+             "Background image is not held in CPU memory, not drawing it");
+      }
+    }
+  }
+
+  // The query's per-group R-trees prune elements whose bounds don't overlap
+  // world_bounds, so only the elements in the image are visited.
+  RegionQuery query =
+      RegionQuery(world_bounds).SetGroupFilter(render_only_group);
+  size_t n_skipped = 0;
+  SoftwareRasterizer::UnpackedMesh uncached;
+  for (const auto& group : scene_graph_->ElementsInRegionByGroup(query)) {
+    if (group.bounds.Area() != 0) {
+      rasterizer->SetClipRect(group.bounds);
+    } else {
+      rasterizer->ClearClipRect();
+    }
+    for (ElementId poly_id : group.poly_ids) {
+      OptimizedMesh* mesh = nullptr;
+      if (!scene_graph_->GetMesh(poly_id, &mesh) ||
+          scene_graph_->GetElementMetadata(poly_id).attributes.is_zoomable) {
+        ++n_skipped;
+        continue;
+      }
+
+      const SoftwareRasterizer::UnpackedMesh* unpacked = &uncached;
+      if (mesh_cache) {
+        auto it = mesh_cache->meshes_.find(poly_id);
+        if (it == mesh_cache->meshes_.end()) {
+          it = mesh_cache->meshes_.emplace(poly_id, MeshCache::Entry()).first;
+          it->second.world_bounds = mesh->WorldBounds();
+          it->second.unpacked = it->second.mesh.Unpack(*mesh);
+        }
+        if (!it->second.unpacked) {
+          ++n_skipped;
+          continue;
+        }
+        unpacked = &it->second.mesh;
+      } else if (!uncached.Unpack(*mesh)) {
+        ++n_skipped;
+        continue;
+      }
+
+      if (mesh->type == EraseShader) {
+        if (has_background_texels) {
+          rasterizer->FillMesh(*mesh, *unpacked, background_.image,
+                               background_.world_to_uv);
+        } else {
+          rasterizer->FillMesh(*mesh, *unpacked, background_.color);
+        }
+      } else {
+        SoftwareRasterizer::TextureSampler texture;
+        bool has_texture =
+            mesh->texture && texture_lookup_(mesh->texture->uri, &texture);
+        if (!rasterizer->DrawMesh(*mesh, *unpacked,
+                                  has_texture ? &texture : nullptr)) {
+          ++n_skipped;
+        }
+      }
+    }
+  }
+  return n_skipped;
+}
+
+void SoftwareSceneRenderer::Render(glm::ivec2 size_px, const Rect& world_bounds,
+                                   bool draw_background,
+                                   GroupId render_only_group, int max_threads,
+                                   ExportedImage* out) const {
+  ASSERT(size_px.x > 0 && size_px.y > 0);
+  out->size_px = size_px;
+  out->fingerprint = SceneFingerprint(*scene_graph_);
+
+  SoftwareRasterizer rasterizer(size_px, world_bounds);
+  size_t n_skipped =
+      Draw(world_bounds, draw_background, render_only_group, &rasterizer);
+  if (n_skipped > 0) {
+    SLOG(SLOG_WARNING,
+         "Software export skipped $0 element draws that are zoomable, or "
+         "whose meshes or textures are not held in CPU memory",
+         n_skipped);
+  }
+
+  out->bytes.resize(static_cast<size_t>(size_px.x) * size_px.y * 4);
+  ClientBitmapWrapper bitmap(out->bytes.data(),
+                             ImageSize(size_px.x, size_px.y),
+                             ImageFormat::BITMAP_FORMAT_RGBA_8888);
+  rasterizer.Rasterize(&bitmap, max_threads);
+}
+
+}  // namespace ink
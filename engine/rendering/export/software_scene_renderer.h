@@ -0,0 +1,122 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INK_ENGINE_RENDERING_EXPORT_SOFTWARE_SCENE_RENDERER_H_
+#define INK_ENGINE_RENDERING_EXPORT_SOFTWARE_SCENE_RENDERER_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "third_party/glm/glm/glm.hpp"
+#include "ink/engine/geometry/primitives/rect.h"
+#include "ink/engine/public/types/exported_image.h"
+#include "ink/engine/rendering/export/software_rasterizer.h"
+#include "ink/engine/scene/graph/scene_graph.h"
+#include "ink/engine/scene/types/element_id.h"
+
+namespace ink {
+
+// SoftwareSceneRenderer draws a scene graph's elements with a
+// SoftwareRasterizer. It reads the meshes from the scene graph and the
+// textures from CPU memory, through a TextureLookup, so it needs no GL context,
+// TextureManager or MeshVBOProvider: given a scene graph whose meshes are held
+// in CPU memory (see Flag::KeepMeshesInCpuMemory), it can export images from a
+// process that never initializes GL.
+//
+// DefaultImageExporter uses it for its software backend, looking the textures
+// up in the TextureManager.
+class SoftwareSceneRenderer {
+ public:
+  // Sets *sampler to the texels of the texture with the given URI, or returns
+  // false if they are not available, in which case the elements that use the
+  // texture are skipped. The texels must stay alive until the rasterizers that
+  // they were drawn into have been rasterized.
+  using TextureLookup = std::function<bool(
+      const std::string& uri, SoftwareRasterizer::TextureSampler* sampler)>;
+
+  // The canvas background. As with the PackedVertShader, erasers are drawn
+  // with the background image if its texels are available, and otherwise with
+  // the background color.
+  struct Background {
+    // The premultiplied background color.
+    glm::vec4 color{1, 1, 1, 1};
+    // Whether the background is an image, rather than the color.
+    bool is_image = false;
+    // Whether the image is drawn behind the scene (see
+    // ImageBackgroundState::HasFirstInstanceWorldCoords()).
+    bool draw_image = false;
+    // The image's texels, which are null if they are not available, and the
+    // map from world coordinates to its texture coordinates.
+    SoftwareRasterizer::TextureSampler image;
+    glm::mat4 world_to_uv{1};
+  };
+
+  // Holds the meshes that Draw() has unpacked, so that drawing the same
+  // element into several rasterizers, e.g. the tiles of an image, only unpacks
+  // its mesh once. A cache must only be used while the scene is unchanged.
+  class MeshCache {
+   public:
+    // Drops the meshes whose world bounds lie entirely above world_y, e.g.
+    // once all of the tiles that they overlap have been drawn.
+    void DropMeshesAbove(float world_y);
+
+   private:
+    friend class SoftwareSceneRenderer;
+
+    struct Entry {
+      Rect world_bounds;
+      // Whether the mesh's vertices were held in CPU memory; if not, the
+      // element is skipped.
+      bool unpacked = false;
+      SoftwareRasterizer::UnpackedMesh mesh;
+    };
+    ElementIdHashMap<Entry> meshes_;
+  };
+
+  SoftwareSceneRenderer(std::shared_ptr<const SceneGraph> scene_graph,
+                        const Background& background,
+                        TextureLookup texture_lookup);
+
+  // Draws the background, if draw_background is true, and the elements that
+  // overlap world_bounds into the rasterizer, whose image (or tile) lies
+  // within world_bounds. If render_only_group is not kInvalidElementId, only
+  // the elements in that group are drawn.
+  //
+  // Zoomable elements, and elements whose meshes or textures are not held in
+  // CPU memory, are skipped. Returns the number of elements skipped. If
+  // mesh_cache is non-null, the unpacked meshes are read from and added to it.
+  size_t Draw(const Rect& world_bounds, bool draw_background,
+              GroupId render_only_group, SoftwareRasterizer* rasterizer,
+              MeshCache* mesh_cache = nullptr) const;
+
+  // Renders world_bounds into an image of size size_px, as
+  // ImageExporter::Render() does with the software backend, rasterizing it
+  // with up to max_threads threads (see ParallelFor()).
+  void Render(glm::ivec2 size_px, const Rect& world_bounds,
+              bool draw_background, GroupId render_only_group,
+              int max_threads, ExportedImage* out) const;
+
+ private:
+  std::shared_ptr<const SceneGraph> scene_graph_;
+  Background background_;
+  TextureLookup texture_lookup_;
+};
+
+}  // namespace ink
+
+#endif  // INK_ENGINE_RENDERING_EXPORT_SOFTWARE_SCENE_RENDERER_H_
@@ -84,7 +84,10 @@ void MeshVBOProvider::GenVBOs(Mesh *m, GLenum usage) {
   ASSERT(!HasVBOs(*m));
   if (ABSL_PREDICT_TRUE(!m->verts.empty())) {
     ASSERT(!m->idx.empty());
-    SetVBOs(m, Partition(vbo_split_threshold_, gl_, *m, m->verts, usage));
+    // The VBOs hold interleaved Vertex structs, which the shaders' attributes
+    // are laid out for.
+    SetVBOs(m, Partition(vbo_split_threshold_, gl_, *m, m->verts.ToVertices(),
+                         usage));
   }
 }
 
@@ -96,7 +99,7 @@ void MeshVBOProvider::ExtendVBOs(Mesh *m, GLenum usage) {
   // Update indices and vertices.
   VboVec *vbos = GetVBOs(*m);
   ASSERT(vbos->size() == 1);
-  (*vbos)[0].SetData(m->Index16(), m->verts);
+  (*vbos)[0].SetData(m->Index16(), m->verts.ToVertices());
 }
 
 void MeshVBOProvider::ReplaceVBOs(Mesh *m, GLenum usage) {
@@ -24,6 +24,7 @@
 #include "ink/engine/util/dbg/glerrors.h"
 #include "ink/engine/util/dbg/log.h"
 #include "ink/engine/util/dbg/log_levels.h"
+#include "ink/engine/util/dbg/trace.h"
 #include "ink/engine/util/funcs/utils.h"
 
 namespace ink {
@@ -63,10 +64,12 @@ Texture& Texture::operator=(Texture&& from) {
   swap(gl_id_, from.gl_id_);
   swap(texture_params_, from.texture_params_);
   swap(gl_, from.gl_);
+  swap(cpu_texels_, from.cpu_texels_);
   return *this;
 }
 
 void Texture::Load(const ClientBitmap& client_bitmap, TextureParams params) {
+  INK_TRACE_EVENT("texture", "Texture::Load");
   if (params.is_nine_patch) {
     nine_patch_info_ = NinePatchInfo(client_bitmap);
   }
@@ -115,6 +118,17 @@ void Texture::Unload() {
     gl_->DeleteTextures(1, &gl_id_);
     gl_id_ = kBadGLHandle;
   }
+  cpu_texels_ = std::vector<uint8_t>();
+}
+
+void Texture::RetainCpuTexels(const ClientBitmap& client_bitmap) {
+  ASSERT(client_bitmap.sizeInPx().width == size_.x &&
+         client_bitmap.sizeInPx().height == size_.y);
+  cpu_texels_ = client_bitmap.Rgba8888ByteData();
+  if (cpu_texels_.size() != static_cast<size_t>(size_.x) * size_.y * 4) {
+    SLOG(SLOG_ERROR, "Could not retain texels for $0", client_bitmap);
+    cpu_texels_ = std::vector<uint8_t>();
+  }
 }
 
 bool Texture::getNinePatchInfo(NinePatchInfo* nine_patch_info) const {
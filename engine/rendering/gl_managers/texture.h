@@ -17,6 +17,9 @@
 #ifndef INK_ENGINE_RENDERING_GL_MANAGERS_TEXTURE_H_
 #define INK_ENGINE_RENDERING_GL_MANAGERS_TEXTURE_H_
 
+#include <cstdint>
+#include <vector>
+
 #include "geo/render/ion/gfx/graphicsmanager.h"
 #include "third_party/glm/glm/glm.hpp"
 #include "ink/engine/gl.h"
@@ -46,6 +49,16 @@ class Texture {
   // Removes image byte data from gpu.  Safe to call extra times.
   void Unload();
 
+  // Keeps an RGBA 8888 copy of "client_bitmap" in CPU memory, so that the
+  // texture can be sampled without GL (see SoftwareRasterizer). This should be
+  // given the same bitmap that was passed to Load().
+  void RetainCpuTexels(const ClientBitmap& client_bitmap);
+
+  // The texels kept by RetainCpuTexels(), in RGBA 8888 format, in row-major
+  // order starting from the first row of the bitmap. This is empty if the
+  // texels were not retained.
+  const std::vector<uint8_t>& CpuTexels() const { return cpu_texels_; }
+
   // Wraps glBindTexture.
   virtual void Bind(GLuint gl_texture_location) const;
 
@@ -54,6 +67,8 @@ class Texture {
   S_WARN_UNUSED_RESULT bool getNinePatchInfo(
       NinePatchInfo* nine_patch_info) const;
 
+  const TextureParams& Params() const { return texture_params_; }
+
   bool UseForHitTesting() const { return texture_params_.use_for_hit_testing; }
 
   bool IsValid() const;
@@ -77,6 +92,8 @@ class Texture {
   GLuint gl_id_;
 
   TextureParams texture_params_;
+
+  std::vector<uint8_t> cpu_texels_;
 };
 
 }  // namespace ink
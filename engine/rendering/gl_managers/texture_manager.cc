@@ -39,6 +39,7 @@ uint32_t htonl(uint32_t hostlong) { return __builtin_bswap32(hostlong); }
 #include "ink/engine/util/dbg/errors.h"
 #include "ink/engine/util/dbg/log.h"
 #include "ink/engine/util/dbg/log_levels.h"
+#include "ink/engine/util/dbg/trace.h"
 
 namespace ink {
 
@@ -71,6 +72,7 @@ TextureManager::TextureManager(ion::gfx::GraphicsManagerPtr gl,
 TextureInfo TextureManager::GenerateTexture(const std::string& uri,
                                             const ClientBitmap& client_bitmap,
                                             TextureParams params) {
+  INK_TRACE_EVENT("texture", "TextureManager::GenerateTexture");
   TextureId id;
   if (uri_to_id_.count(uri) > 0) {
     id = uri_to_id_[uri];
@@ -84,6 +86,7 @@ TextureInfo TextureManager::GenerateTexture(const std::string& uri,
 
   unique_ptr<Texture> tex = CreateTexture();
   tex->Load(client_bitmap, params);
+  if (retain_cpu_texels_) tex->RetainCpuTexels(client_bitmap);
   id_to_texture_[id] = std::move(tex);
   uri_to_id_[uri] = id;
 
@@ -191,6 +191,14 @@ class TextureManager : public FrameStateListener,
    */
   void RemoveTextureRequestHandler(const std::string& handler_id);
 
+  // If true, textures generated after this is set also keep a copy of their
+  // texels in CPU memory (see Texture::RetainCpuTexels()), so that they can be
+  // drawn by the software image exporter. This is off by default, as it doubles
+  // the memory used by each texture.
+  void SetRetainCpuTexels(bool retain_cpu_texels) {
+    retain_cpu_texels_ = retain_cpu_texels;
+  }
+
   TilePolicy GetTilePolicy() const { return TilePolicy(tile_policy_); }
 
   void SetTilePolicy(const TilePolicy& new_policy);
@@ -250,6 +258,7 @@ class TextureManager : public FrameStateListener,
   std::shared_ptr<ITaskRunner> task_runner_;
   std::shared_ptr<EventDispatch<TextureListener>> dispatch_;
   TilePolicy tile_policy_;
+  bool retain_cpu_texels_ = false;
 
   // Implementation notes:
   //
@@ -30,16 +30,34 @@ ElementRenderer::ElementRenderer(
 bool ElementRenderer::Draw(ElementId element, const SceneGraph& graph,
                            const Camera& camera, FrameTimeS draw_time,
                            const glm::mat4& transform) const {
+  return DrawInternal(element, graph, camera, draw_time, transform,
+                      /* in_run= */ false);
+}
+
+bool ElementRenderer::DrawInRun(ElementId element, const SceneGraph& graph,
+                                const Camera& camera,
+                                FrameTimeS draw_time) const {
+  return DrawInternal(element, graph, camera, draw_time, glm::mat4{1},
+                      /* in_run= */ true);
+}
+
+bool ElementRenderer::DrawInternal(ElementId element, const SceneGraph& graph,
+                                   const Camera& camera, FrameTimeS draw_time,
+                                   const glm::mat4& transform,
+                                   bool in_run) const {
   switch (element.Type()) {
     case POLY: {
       OptimizedMesh* m;
       if (graph.GetMesh(element, &m)) {
         m->object_matrix = transform * m->object_matrix;
 
-        const auto& metadata = graph.GetElementMetadata(element);
-        if (metadata.attributes.is_zoomable) {
+        if (graph.GetElementAttributes(element).is_zoomable) {
+          // The zoomable rect renderer uses its own shaders.
+          if (in_run) mesh_renderer_.EndRun();
           zoomable_rect_renderer_.Draw(camera, draw_time, m->WorldBounds(),
                                        m->texture->uri);
+        } else if (in_run) {
+          mesh_renderer_.DrawInRun(camera, draw_time, *m);
         } else {
           mesh_renderer_.Draw(camera, draw_time, *m);
         }
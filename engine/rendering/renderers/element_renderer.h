@@ -42,7 +42,21 @@ class ElementRenderer {
   bool Draw(ElementId element, const SceneGraph& graph, const Camera& camera,
             FrameTimeS draw_time, const glm::mat4& transform) const;
 
+  // Like Draw(), but leaves the mesh shader bound for the next element, so
+  // that a run of elements with the same kind of mesh, drawn in z-order, costs
+  // one program bind rather than one per element, and small single-color
+  // meshes of the same color share a draw call. The element may not be drawn
+  // until the next call to DrawInRun() or EndRun(). EndRun() must be called
+  // after the last element, before anything else draws.
+  bool DrawInRun(ElementId element, const SceneGraph& graph,
+                 const Camera& camera, FrameTimeS draw_time) const;
+  void EndRun() const { mesh_renderer_.EndRun(); }
+
  private:
+  bool DrawInternal(ElementId element, const SceneGraph& graph,
+                    const Camera& camera, FrameTimeS draw_time,
+                    const glm::mat4& transform, bool in_run) const;
+
   MeshRenderer mesh_renderer_;
   ZoomableRectRenderer zoomable_rect_renderer_;
 };
@@ -50,6 +50,16 @@ void MeshRenderer::Draw(const Camera& cam, FrameTimeS draw_time,
   shader.Unuse(mesh);
 }
 
+void MeshRenderer::DrawInRun(const Camera& cam, FrameTimeS draw_time,
+                             const OptimizedMesh& mesh) const {
+  mesh.Validate();
+  gl_resources_->shader_manager->PackedShader().DrawInRun(cam, mesh);
+}
+
+void MeshRenderer::EndRun() const {
+  gl_resources_->shader_manager->PackedShader().EndRun();
+}
+
 void MeshRenderer::Draw(const Camera& cam, FrameTimeS draw_time,
                         const Mesh& mesh) const {
   if (mesh.shader_metadata.IsParticle()) {
@@ -39,6 +39,13 @@ class MeshRenderer {
   void Draw(const Camera& cam, FrameTimeS draw_time,
             const OptimizedMesh& mesh) const;
 
+  // Draws consecutive OptimizedMeshes with as few state changes as possible.
+  // See PackedVertShader::DrawInRun(). EndRun() must be called before anything
+  // else draws.
+  void DrawInRun(const Camera& cam, FrameTimeS draw_time,
+                 const OptimizedMesh& mesh) const;
+  void EndRun() const;
+
  private:
   std::shared_ptr<GLResourceManager> gl_resources_;
 };
@@ -15,6 +15,7 @@
 #include "ink/engine/rendering/scene_drawable.h"
 
 #include <algorithm>
+#include <vector>
 
 #include "ink/engine/geometry/mesh/mesh.h"
 #include "ink/engine/rendering/gl_managers/mesh_vbo_provider.h"
@@ -78,6 +79,10 @@ MeshSceneDrawable::MeshSceneDrawable(
          static_cast<double>(earliest_remove_time_ -
                              frame_state_->GetFrameTime()));
   }
+  // Drawing only reads the VBOs, so release the CPU copy of the vertices, which
+  // would otherwise be held for as long as the drawable is.
+  mesh_.verts = VertexStreams();
+  std::vector<Mesh::IndexType>().swap(mesh_.idx);
   graph->SetElementRenderedByMain(id_, false);
 }
 
@@ -91,6 +91,8 @@ class MeshSceneDrawable : public SceneGraphListener,
   std::shared_ptr<FrameState> frame_state_;
   const ElementId id_;
   const GroupId group_id_;
+  // Once its VBOs are generated, mesh_ holds no vertices or indices in CPU
+  // memory.
   Mesh mesh_;
   const MeshRenderer renderer_;
   FrameTimeS earliest_remove_time_;
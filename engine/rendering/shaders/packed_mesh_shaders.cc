@@ -15,14 +15,17 @@
 #include "ink/engine/rendering/shaders/packed_mesh_shaders.h"
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 
+#include "third_party/absl/memory/memory.h"
 #include "third_party/glm/glm/gtc/type_ptr.hpp"
 #include "ink/engine/geometry/mesh/gl/indexed_vbo.h"
 #include "ink/engine/geometry/mesh/shader_type.h"
 #include "ink/engine/geometry/mesh/vertex.h"
 #include "ink/engine/gl.h"
 #include "ink/engine/rendering/gl_managers/bad_gl_handle.h"
+#include "ink/engine/rendering/gl_managers/texture.h"
 #include "ink/engine/rendering/shaders/interleaved_attribute_set.h"
 #include "ink/engine/rendering/shaders/shader_util.h"
 #include "ink/engine/util/dbg/errors.h"
@@ -45,6 +48,13 @@ constexpr char kObjectUniformName[] = "object";
 constexpr char kObjToUVUniformName[] = "objToUV";
 constexpr char kPackedUvToUvUniformName[] = "packed_uv_to_uv";
 
+// Meshes with more vertices than this are drawn from their own VBOs, as the
+// cost of transforming and uploading their vertices would outweigh that of the
+// draw call they'd save.
+constexpr uint32_t kMaxBatchedMeshVertices = 256;
+// A batch's vertices must be addressable by 16-bit indices.
+constexpr size_t kMaxBatchVertices = 1 << 16;
+
 /////////////////////////////
 
 static InterleavedAttributeSet CreatePkShaderAttribute(
@@ -93,8 +103,11 @@ const Shader* PackedVertShader::GetShader(const OptimizedMesh& mesh) const {
 }
 
 void PackedVertShader::Use(const Camera& cam, const OptimizedMesh& mesh) const {
+  EndRun();
   const Shader* shdr = GetShader(mesh);
   shdr->Use();
+  ++stats_.shader_binds;
+  bound_texture_handle_ = kBadGLHandle;
   mat4 wv = cam.WorldToDevice();
   gl_->UniformMatrix4fv(shdr->GetUniform(kViewUniformName), 1, 0,
                         value_ptr(wv));
@@ -106,11 +119,130 @@ void PackedVertShader::Use(const Camera& cam, const OptimizedMesh& mesh) const {
     gl_->UniformMatrix4fv(shdr->GetUniform(kObjToUVUniformName), 1, 0,
                           value_ptr(obj_to_uv));
     EXPECT(texture_manager_->Bind(image_background->TextureHandle()));
+    ++stats_.texture_binds;
   }
 }
 
 void PackedVertShader::Unuse(const OptimizedMesh& mesh) const {
   GetShader(mesh)->Unuse();
+  bound_texture_handle_ = kBadGLHandle;
+}
+
+void PackedVertShader::DrawInRun(const Camera& cam,
+                                 const OptimizedMesh& mesh) const {
+  mat4 world_to_device = cam.WorldToDevice();
+  if (CanBatch(mesh)) {
+    vec4 color = DrawColor(mesh);
+    size_t batch_vert_count = batch_size_ == 1 ? batch_first_->verts.size()
+                                               : batch_verts_.size();
+    if (batch_size_ > 0 &&
+        (color != batch_color_ ||
+         world_to_device != batch_world_to_device_ ||
+         batch_vert_count + mesh.verts.size() > kMaxBatchVertices)) {
+      FlushBatch();
+    }
+    if (batch_size_ == 0) {
+      batch_first_ = &mesh;
+      batch_color_ = color;
+      batch_world_to_device_ = world_to_device;
+    } else {
+      if (batch_size_ == 1) AppendToBatch(*batch_first_);
+      AppendToBatch(mesh);
+    }
+    ++batch_size_;
+    return;
+  }
+
+  FlushBatch();
+  const Shader* shdr = GetShader(mesh);
+  if (ShouldDrawAsEraserTexture(mesh)) {
+    // Use() sets the eraser's texture transform from the mesh's object
+    // matrix, so those meshes can't share it.
+    Use(cam, mesh);
+    run_shader_ = shdr;
+    run_world_to_device_ = world_to_device;
+  } else {
+    UseInRun(shdr, world_to_device);
+  }
+  Draw(mesh);
+}
+
+void PackedVertShader::EndRun() const {
+  FlushBatch();
+  if (run_shader_ == nullptr) return;
+  run_shader_->Unuse();
+  run_shader_ = nullptr;
+  bound_texture_handle_ = kBadGLHandle;
+}
+
+void PackedVertShader::UseInRun(const Shader* shdr,
+                                const mat4& world_to_device) const {
+  if (shdr == run_shader_ && world_to_device == run_world_to_device_) return;
+  if (run_shader_ != nullptr) run_shader_->Unuse();
+  shdr->Use();
+  ++stats_.shader_binds;
+  bound_texture_handle_ = kBadGLHandle;
+  gl_->UniformMatrix4fv(shdr->GetUniform(kViewUniformName), 1, 0,
+                        value_ptr(world_to_device));
+  run_shader_ = shdr;
+  run_world_to_device_ = world_to_device;
+}
+
+bool PackedVertShader::CanBatch(const OptimizedMesh& mesh) const {
+  VertFormat format = mesh.verts.GetFormat();
+  return (format == VertFormat::x12y12 || format == VertFormat::x32y32) &&
+         !mesh.texture && !ShouldDrawAsEraserTexture(mesh) &&
+         mesh.IndexSize() > 0 && !mesh.verts.empty() &&
+         mesh.verts.size() <= kMaxBatchedMeshVertices;
+}
+
+void PackedVertShader::AppendToBatch(const OptimizedMesh& mesh) const {
+  size_t base = batch_verts_.size();
+  batch_verts_.resize(base + mesh.verts.size());
+  mesh.verts.UnpackPositions(mesh.object_matrix, &batch_verts_[base]);
+  size_t index_size = mesh.IndexSize();
+  for (size_t i = 0; i < index_size; ++i) {
+    batch_indices_.push_back(static_cast<uint16_t>(base + mesh.IndexAt(i)));
+  }
+}
+
+void PackedVertShader::FlushBatch() const {
+  if (batch_size_ == 0) return;
+  const OptimizedMesh* first = batch_first_;
+  int size = batch_size_;
+  batch_first_ = nullptr;
+  batch_size_ = 0;
+  if (size == 1) {
+    UseInRun(GetShader(*first), batch_world_to_device_);
+    Draw(*first);
+    return;
+  }
+
+  // The vertices are already in world coordinates, so the batch is drawn
+  // with the x32y32 program and an identity object matrix.
+  UseInRun(&shader_x32y32_, batch_world_to_device_);
+  mat4 identity{1};
+  gl_->Uniform4fv(shader_x32y32_.GetUniform(kSourceColorUniformName), 1,
+                  value_ptr(batch_color_));
+  gl_->UniformMatrix4fv(shader_x32y32_.GetUniform(kObjectUniformName), 1, 0,
+                        value_ptr(identity));
+  if (batch_vbo_ == nullptr) {
+    batch_vbo_ = absl::make_unique<IndexedVBO>(gl_, batch_indices_,
+                                               batch_verts_, GL_STREAM_DRAW);
+  } else {
+    batch_vbo_->RemoveAll();
+    batch_vbo_->SetData(batch_indices_, batch_verts_);
+  }
+  batch_vbo_->Bind();
+  shader_x32y32_.GetAttrs().BindVBO();
+  gl_->DrawElements(GL_TRIANGLES, batch_indices_.size(), GL_UNSIGNED_SHORT,
+                    nullptr);
+  batch_vbo_->Unbind();
+  ++stats_.draw_calls;
+  stats_.meshes_drawn += size;
+  stats_.meshes_batched += size;
+  batch_verts_.clear();
+  batch_indices_.clear();
 }
 
 void PackedVertShader::Load() {
@@ -121,15 +253,19 @@ void PackedVertShader::Load() {
   shader_x11a7r6y11g7b6u12v12_.Load();
 }
 
+vec4 PackedVertShader::DrawColor(const OptimizedMesh& mesh) const {
+  if (mesh.type == EraseShader) {
+    ASSERT(!ShouldDrawAsEraserTexture(mesh));
+    return background_state_->GetColor();
+  }
+  return util::Clamp01(
+      glm::fma(mesh.color, mesh.mul_color_modifier, mesh.add_color_modifier));
+}
+
 void PackedVertShader::Draw(const OptimizedMesh& mesh) const {
   const Shader* shdr = GetShader(mesh);
   if (shdr->HasUniform(kSourceColorUniformName)) {
-    vec4 draw_color = util::Clamp01(
-        glm::fma(mesh.color, mesh.mul_color_modifier, mesh.add_color_modifier));
-    if (mesh.type == EraseShader) {
-      ASSERT(!ShouldDrawAsEraserTexture(mesh));
-      draw_color = background_state_->GetColor();
-    }
+    vec4 draw_color = DrawColor(mesh);
     gl_->Uniform4fv(shdr->GetUniform(kSourceColorUniformName), 1,
                     value_ptr(draw_color));
   }
@@ -140,9 +276,16 @@ void PackedVertShader::Draw(const OptimizedMesh& mesh) const {
   if (mesh.texture) {
     ASSERT(mesh.type == ShaderType::TexturedVertShader);
     ASSERT(mesh.verts.GetFormat() == VertFormat::x11a7r6y11g7b6u12v12);
-    if (!texture_manager_->Bind(*mesh.texture)) {
+    Texture* texture;
+    if (!texture_manager_->GetTexture(*mesh.texture, &texture)) {
+      SLOG(SLOG_DRAWING, "Texture $0 isn't ready yet.", mesh.texture->uri);
       return;
     }
+    if (texture->TextureId() != bound_texture_handle_) {
+      texture->Bind(GL_TEXTURE0);
+      bound_texture_handle_ = texture->TextureId();
+      ++stats_.texture_binds;
+    }
     if (shdr->HasUniform(kPackedUvToUvUniformName)) {
       gl_->UniformMatrix4fv(shdr->GetUniform(kPackedUvToUvUniformName), 1, 0,
                             value_ptr(mesh.verts.PackedUvToUvTransform()));
@@ -151,7 +294,9 @@ void PackedVertShader::Draw(const OptimizedMesh& mesh) const {
       return;
     }
   }
-  DrawMesh(gl_, mesh_vbo_provider_, mesh, shdr->GetAttrs());
+  stats_.draw_calls +=
+      DrawMesh(gl_, mesh_vbo_provider_, mesh, shdr->GetAttrs());
+  ++stats_.meshes_drawn;
 }
 
 ///////////////////////////////////////////////////////////////
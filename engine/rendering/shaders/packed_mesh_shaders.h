@@ -17,13 +17,19 @@
 #ifndef INK_ENGINE_RENDERING_SHADERS_PACKED_MESH_SHADERS_H_
 #define INK_ENGINE_RENDERING_SHADERS_PACKED_MESH_SHADERS_H_
 
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "geo/render/ion/gfx/graphicsmanager.h"
+#include "third_party/glm/glm/glm.hpp"
 #include "ink/engine/camera/camera.h"
+#include "ink/engine/geometry/mesh/gl/indexed_vbo.h"
 #include "ink/engine/geometry/mesh/mesh.h"
 #include "ink/engine/geometry/mesh/vertex_types.h"
+#include "ink/engine/gl.h"
 #include "ink/engine/rendering/gl_managers/background_state.h"
+#include "ink/engine/rendering/gl_managers/bad_gl_handle.h"
 #include "ink/engine/rendering/gl_managers/mesh_vbo_provider.h"
 #include "ink/engine/rendering/gl_managers/texture_manager.h"
 #include "ink/engine/rendering/shaders/shader.h"
@@ -81,6 +87,19 @@ class PackedShaderX11A7R6Y11G7B6U12V12 : public Shader {
 // above based on the OptimizedMesh data format.
 class PackedVertShader {
  public:
+  struct Stats {
+    // glDrawElements calls: one per VBO of each mesh drawn on its own, and
+    // one per batch of meshes drawn together by DrawInRun().
+    uint64_t draw_calls = 0;
+    uint64_t meshes_drawn = 0;
+    // Meshes drawn as part of a batch, rather than from their own VBOs.
+    uint64_t meshes_batched = 0;
+    // State changes: programs bound by Use(), and textures bound for textured
+    // meshes and for erasing to the background image.
+    uint64_t shader_binds = 0;
+    uint64_t texture_binds = 0;
+  };
+
   PackedVertShader(ion::gfx::GraphicsManagerPtr gl,
                    std::shared_ptr<MeshVBOProvider> mesh_vbo_provider,
                    std::shared_ptr<BackgroundState> background_state,
@@ -91,9 +110,43 @@ class PackedVertShader {
   void Use(const Camera& cam, const OptimizedMesh& mesh) const;
   void Unuse(const OptimizedMesh& mesh) const;
 
+  // Draws the mesh as Use(), Draw() and Unuse() would, except that the
+  // program is left bound afterwards. The next call to DrawInRun() skips
+  // Use() if its mesh has the same vertex format and shader type, and the
+  // camera hasn't changed, and skips binding the mesh's texture if it's
+  // already bound.
+  //
+  // Consecutive small, untextured, single-color meshes (see CanBatch()) with
+  // the same draw color are batched: their vertices are transformed to world
+  // coordinates on the CPU and streamed into one buffer, which is drawn with
+  // a single call when the batch ends. So a mesh may not have been drawn
+  // until the next call to DrawInRun() or EndRun(), and must stay alive and
+  // unmodified until then. EndRun() must be called before anything else
+  // draws.
+  void DrawInRun(const Camera& cam, const OptimizedMesh& mesh) const;
+  // Draws any pending batch, and unbinds the program bound by DrawInRun(), if
+  // any.
+  void EndRun() const;
+
+  const Stats& GetStats() const { return stats_; }
+
  private:
   const Shader* GetShader(const OptimizedMesh& mesh) const;
   bool ShouldDrawAsEraserTexture(const OptimizedMesh& mesh) const;
+  glm::vec4 DrawColor(const OptimizedMesh& mesh) const;
+
+  // Whether DrawInRun() may batch the mesh: it must be drawn with a solid
+  // color by the x12y12 or x32y32 program, must still have its vertices in
+  // CPU memory, and must be small enough that copying them is cheaper than a
+  // draw call.
+  bool CanBatch(const OptimizedMesh& mesh) const;
+  void AppendToBatch(const OptimizedMesh& mesh) const;
+  // Draws the pending batch, if any. A batch of one mesh is drawn from that
+  // mesh's own VBOs.
+  void FlushBatch() const;
+  // Binds the program for a run, unless it's already bound with the same view
+  // matrix.
+  void UseInRun(const Shader* shdr, const glm::mat4& world_to_device) const;
 
   ion::gfx::GraphicsManagerPtr gl_;
   std::shared_ptr<BackgroundState> background_state_;
@@ -104,6 +157,30 @@ class PackedVertShader {
   PackedShaderX32Y32 shader_x32y32_;
   PackedShaderX11A7R6Y11G7B6 shader_x11a7r6y11g7b6_;
   PackedShaderX11A7R6Y11G7B6U12V12 shader_x11a7r6y11g7b6u12v12_;
+
+  // The shader, and its view uniform, left bound by DrawInRun().
+  mutable const Shader* run_shader_ = nullptr;
+  mutable glm::mat4 run_world_to_device_{1};
+  // The GL handle of the texture that Draw() last bound since Use(), if any.
+  // This is keyed on the handle, rather than on the TextureInfo's uri, so
+  // that a texture that is evicted and regenerated under the same uri is
+  // rebound.
+  mutable GLuint bound_texture_handle_ = kBadGLHandle;
+
+  // The batch being built by DrawInRun(). The first mesh is kept so that it
+  // can be drawn on its own if nothing joins it; its vertices are only copied
+  // to batch_verts_ once a second mesh does.
+  mutable const OptimizedMesh* batch_first_ = nullptr;
+  mutable int batch_size_ = 0;
+  mutable glm::vec4 batch_color_{0};
+  mutable glm::mat4 batch_world_to_device_{1};
+  mutable std::vector<glm::vec2> batch_verts_;
+  mutable std::vector<uint16_t> batch_indices_;
+  // The stream buffer that batches are drawn from, created on first use and
+  // reused for every batch after that.
+  mutable std::unique_ptr<IndexedVBO> batch_vbo_;
+
+  mutable Stats stats_;
 };
 
 }  // namespace shaders
@@ -0,0 +1,239 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/rendering/shaders/packed_mesh_shaders.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "base/logging.h"
+#include "geo/render/ion/gfx/tests/fakeglcontext.h"
+#include "geo/render/ion/gfx/tests/fakegraphicsmanager.h"
+#include "geo/render/ion/portgfx/glcontext.h"
+#include "testing/base/public/benchmark.h"
+#include "third_party/absl/memory/memory.h"
+#include "ink/engine/camera/camera.h"
+#include "ink/engine/geometry/mesh/mesh.h"
+#include "ink/engine/geometry/mesh/shader_type.h"
+#include "ink/engine/geometry/mesh/shape_helpers.h"
+#include "ink/engine/geometry/primitives/rect.h"
+#include "ink/engine/gl.h"
+#include "ink/engine/public/host/host.h"
+#include "ink/engine/public/sengine.h"
+#include "ink/engine/public/types/client_bitmap.h"
+#include "ink/engine/rendering/gl_managers/gl_resource_manager.h"
+#include "ink/engine/rendering/gl_managers/ion_graphics_manager_provider.h"
+#include "ink/engine/scene/default_services.h"
+#include "ink/engine/util/funcs/rand_funcs.h"
+#include "ink/public/document/single_user_document.h"
+#include "ink/public/document/storage/in_memory_storage.h"
+
+namespace ink {
+namespace shaders {
+namespace {
+
+using benchmark::Counter;
+using benchmark::State;
+
+const int kViewportSize = 800;
+constexpr char kTextureUri[] = "sticker://benchmark";
+
+class BenchmarkHost : public Host {
+ public:
+  void BindScreen() override {}
+  bool ShouldPreloadShaders() const override { return false; }
+};
+
+class FakeGraphicsManagerProvider : public IonGraphicsManagerProvider {
+ public:
+  FakeGraphicsManagerProvider()
+      : graphics_manager_(new ion::gfx::testing::FakeGraphicsManager()) {}
+
+  ion::gfx::GraphicsManagerPtr GetGraphicsManager() override {
+    return graphics_manager_;
+  }
+
+ private:
+  ion::gfx::GraphicsManagerPtr graphics_manager_;
+};
+
+// An engine with a fake GL context, and a set of rectangle meshes, uploaded to
+// VBOs, that are drawn with the engine's PackedVertShader, either one at a
+// time, as MeshRenderer::Draw() does, or in a run, as the scene renderers do.
+class BenchmarkMeshes {
+ public:
+  BenchmarkMeshes() : gl_context_(ion::gfx::testing::FakeGlContext::Create(
+                          kViewportSize, kViewportSize)) {
+    ion::portgfx::GlContext::MakeCurrent(gl_context_);
+    auto definitions = DefaultServiceDefinitions();
+    definitions->DefineService<IonGraphicsManagerProvider,
+                               FakeGraphicsManagerProvider>();
+    proto::Viewport viewport;
+    viewport.set_width(kViewportSize);
+    viewport.set_height(kViewportSize);
+    viewport.set_ppi(132);
+    engine_ = absl::make_unique<SEngine>(
+        std::make_shared<BenchmarkHost>(), viewport, 0,
+        std::make_shared<SingleUserDocument>(
+            std::make_shared<InMemoryStorage>()),
+        std::move(definitions));
+    gl_resources_ = engine_->registry()->GetShared<GLResourceManager>();
+    gl_resources_->texture_manager->GenerateTexture(
+        kTextureUri,
+        RawClientBitmap(ImageSize(1, 1), ImageFormat::BITMAP_FORMAT_RGBA_8888));
+  }
+
+  // Adds n rectangles of random sizes at random points in
+  // [-1000, 1000] x [-1000, 1000]. Single-color rectangles all have the same
+  // color; textured rectangles all have the same texture.
+  void AddRectangles(int n, ShaderType type) {
+    for (int i = 0; i < n; ++i) {
+      Rect rect = Rect::CreateAtPoint({Drand(-1000, 1000), Drand(-1000, 1000)},
+                                      Drand(1, 20), Drand(1, 20));
+      Mesh mesh;
+      if (type == TexturedVertShader) {
+        MakeImageRectMesh(&mesh, rect, rect, kTextureUri);
+      } else {
+        MakeRectangleMesh(&mesh, rect, {0, 0, 1, 1});
+      }
+      meshes_.push_back(absl::make_unique<OptimizedMesh>(type, mesh));
+      gl_resources_->mesh_vbo_provider->GenVBOs(meshes_.back().get(),
+                                                GL_STATIC_DRAW);
+    }
+  }
+
+  void DrawIndividually() const {
+    const Camera& cam = *engine_->registry()->Get<Camera>();
+    const PackedVertShader& shader = Shader();
+    for (const auto& mesh : meshes_) {
+      shader.Use(cam, *mesh);
+      shader.Draw(*mesh);
+      shader.Unuse(*mesh);
+    }
+  }
+
+  void DrawInRun() const {
+    const Camera& cam = *engine_->registry()->Get<Camera>();
+    const PackedVertShader& shader = Shader();
+    for (const auto& mesh : meshes_) shader.DrawInRun(cam, *mesh);
+    shader.EndRun();
+  }
+
+  const PackedVertShader& Shader() const {
+    return gl_resources_->shader_manager->PackedShader();
+  }
+
+ private:
+  ion::portgfx::GlContextPtr gl_context_;
+  std::unique_ptr<SEngine> engine_;
+  std::shared_ptr<GLResourceManager> gl_resources_;
+  std::vector<std::unique_ptr<OptimizedMesh>> meshes_;
+};
+
+// The difference between two snapshots of PackedVertShader::Stats.
+PackedVertShader::Stats StatsSince(const PackedVertShader::Stats& before,
+                                   const PackedVertShader::Stats& after) {
+  PackedVertShader::Stats delta;
+  delta.draw_calls = after.draw_calls - before.draw_calls;
+  delta.meshes_drawn = after.meshes_drawn - before.meshes_drawn;
+  delta.meshes_batched = after.meshes_batched - before.meshes_batched;
+  delta.shader_binds = after.shader_binds - before.shader_binds;
+  delta.texture_binds = after.texture_binds - before.texture_binds;
+  return delta;
+}
+
+// Draws the meshes once each way, and checks that drawing them in a run
+// draws the same meshes with fewer draw calls and state changes.
+void CheckRunIsCheaper(const BenchmarkMeshes& meshes, ShaderType type) {
+  PackedVertShader::Stats start = meshes.Shader().GetStats();
+  meshes.DrawIndividually();
+  PackedVertShader::Stats individually =
+      StatsSince(start, meshes.Shader().GetStats());
+  start = meshes.Shader().GetStats();
+  meshes.DrawInRun();
+  PackedVertShader::Stats in_run =
+      StatsSince(start, meshes.Shader().GetStats());
+
+  QCHECK_EQ(in_run.meshes_drawn, individually.meshes_drawn);
+  QCHECK_LT(in_run.shader_binds, individually.shader_binds);
+  if (type == TexturedVertShader) {
+    // Textured meshes aren't batched, but share their texture binding.
+    QCHECK_EQ(in_run.draw_calls, individually.draw_calls);
+    QCHECK_LT(in_run.texture_binds, individually.texture_binds);
+  } else {
+    QCHECK_LT(in_run.draw_calls, individually.draw_calls);
+    QCHECK_EQ(in_run.meshes_batched, in_run.meshes_drawn);
+  }
+}
+
+// Runs the benchmark loop, and reports the mean number of draw calls, program
+// binds and texture binds per frame in counters.
+template <typename DrawFn>
+void RunDraws(State &state, const BenchmarkMeshes& meshes, DrawFn draw) {
+  PackedVertShader::Stats start = meshes.Shader().GetStats();
+  for (auto _ : state) draw();
+  PackedVertShader::Stats stats =
+      StatsSince(start, meshes.Shader().GetStats());
+  state.counters["draw_calls"] = Counter(static_cast<double>(stats.draw_calls),
+                                         Counter::kAvgIterations);
+  state.counters["shader_binds"] = Counter(
+      static_cast<double>(stats.shader_binds), Counter::kAvgIterations);
+  state.counters["texture_binds"] = Counter(
+      static_cast<double>(stats.texture_binds), Counter::kAvgIterations);
+}
+
+// Draws n single-color rectangles, each with its own Use() and Unuse(). The
+// argument is n.
+static void BM_DrawSingleColorIndividually(State &state) {
+  Seed_random(0);
+  BenchmarkMeshes meshes;
+  meshes.AddRectangles(state.range(0), SingleColorShader);
+  RunDraws(state, meshes, [&meshes]() { meshes.DrawIndividually(); });
+}
+BENCHMARK(BM_DrawSingleColorIndividually)->Arg(1000);
+
+// As above, but in a run, which batches them into a few draw calls.
+static void BM_DrawSingleColorInRun(State &state) {
+  Seed_random(0);
+  BenchmarkMeshes meshes;
+  meshes.AddRectangles(state.range(0), SingleColorShader);
+  CheckRunIsCheaper(meshes, SingleColorShader);
+  RunDraws(state, meshes, [&meshes]() { meshes.DrawInRun(); });
+}
+BENCHMARK(BM_DrawSingleColorInRun)->Arg(1000);
+
+// Draws n textured rectangles that share a texture, each with its own Use()
+// and Unuse().
+static void BM_DrawTexturedIndividually(State &state) {
+  Seed_random(0);
+  BenchmarkMeshes meshes;
+  meshes.AddRectangles(state.range(0), TexturedVertShader);
+  RunDraws(state, meshes, [&meshes]() { meshes.DrawIndividually(); });
+}
+BENCHMARK(BM_DrawTexturedIndividually)->Arg(1000);
+
+// As above, but in a run, which binds the program and texture once.
+static void BM_DrawTexturedInRun(State &state) {
+  Seed_random(0);
+  BenchmarkMeshes meshes;
+  meshes.AddRectangles(state.range(0), TexturedVertShader);
+  CheckRunIsCheaper(meshes, TexturedVertShader);
+  RunDraws(state, meshes, [&meshes]() { meshes.DrawInRun(); });
+}
+BENCHMARK(BM_DrawTexturedInRun)->Arg(1000);
+
+}  // namespace
+}  // namespace shaders
+}  // namespace ink
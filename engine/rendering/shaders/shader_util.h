@@ -27,14 +27,16 @@
 
 namespace ink {
 
+// Returns the number of draw calls made, which is one per non-empty VBO.
 template <typename M>
-void DrawMesh(const ion::gfx::GraphicsManagerPtr& gl,
-              const std::shared_ptr<MeshVBOProvider>& mesh_vbo_provider,
-              const M& mesh, const InterleavedAttributeSet& attrs) {
+int DrawMesh(const ion::gfx::GraphicsManagerPtr& gl,
+             const std::shared_ptr<MeshVBOProvider>& mesh_vbo_provider,
+             const M& mesh, const InterleavedAttributeSet& attrs) {
   EXPECT(mesh_vbo_provider->HasVBOs(mesh) || mesh.verts.empty());
   if (!mesh_vbo_provider->HasVBOs(mesh)) {
-    return;
+    return 0;
   }
+  int draw_calls = 0;
   auto* vbos = mesh_vbo_provider->GetVBOs(mesh);
   for (const auto& vbo : *vbos) {
     auto index_count = vbo.GetNumIndices();
@@ -43,8 +45,10 @@ void DrawMesh(const ion::gfx::GraphicsManagerPtr& gl,
       attrs.BindVBO();
       gl->DrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_SHORT, nullptr);
       vbo.Unbind();
+      ++draw_calls;
     }
   }
+  return draw_calls;
 }
 
 }  // namespace ink
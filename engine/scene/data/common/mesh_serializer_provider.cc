@@ -36,22 +36,26 @@ std::unique_ptr<IMeshReader> ReaderFor(const Stroke& stroke) {
     SLOG(SLOG_WARNING, "No LOD in stroke; returning stub reader.");
     return absl::make_unique<StubMeshReader>();
   }
+  return ReaderFor(stroke.Proto().lod(0));
+}
+
+std::unique_ptr<IMeshReader> ReaderFor(const proto::LOD& lod) {
 #if MESH_COMPRESSION_DRACO
-  if (stroke.Proto().lod(0).has_draco_blob()) {
+  if (lod.has_draco_blob()) {
     return absl::make_unique<DracoReader>();
   }
 #endif
 #if MESH_COMPRESSION_OPENCTM
-  if (stroke.Proto().lod(0).has_ctm_blob()) {
+  if (lod.has_ctm_blob()) {
     return absl::make_unique<OpenCtmReader>();
   }
 #endif
   // If the stroke was encoded with Draco or OpenCTM but we couldn't
   // deserialize the stroke due to compilation options, give a clear error.
-  if (stroke.Proto().lod(0).has_draco_blob()) {
+  if (lod.has_draco_blob()) {
     SLOG(SLOG_ERROR, "Draco reader not available; returning stub reader.");
   }
-  if (stroke.Proto().lod(0).has_ctm_blob()) {
+  if (lod.has_ctm_blob()) {
     SLOG(SLOG_ERROR, "OpenCTM reader not available; returning stub reader.");
   }
   return absl::make_unique<StubMeshReader>();
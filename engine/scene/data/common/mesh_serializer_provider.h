@@ -41,6 +41,9 @@ MeshCompressorType MeshCompressorFor(const proto::ElementBundle& bundle);
 // Provide an IMeshReader that can deserialize the meshes in given Stroke.
 std::unique_ptr<IMeshReader> ReaderFor(const Stroke& stroke);
 
+// Provide an IMeshReader that can deserialize the mesh in the given LOD.
+std::unique_ptr<IMeshReader> ReaderFor(const proto::LOD& lod);
+
 // Provide an IMeshWriter that can serialize the given mesh.
 std::unique_ptr<IMeshWriter> WriterFor(const OptimizedMesh& mesh);
 
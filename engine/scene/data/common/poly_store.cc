@@ -14,19 +14,86 @@
 
 #include "ink/engine/scene/data/common/poly_store.h"
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <utility>
 
+#include "third_party/absl/memory/memory.h"
+#include "third_party/glm/glm/glm.hpp"
+#include "ink/engine/colors/colors.h"
+#include "ink/engine/geometry/mesh/vertex_types.h"
 #include "ink/engine/rendering/gl_managers/mesh_vbo_provider.h"
+#include "ink/engine/scene/data/common/mesh_serializer_provider.h"
 #include "ink/engine/util/dbg/errors.h"
 #include "ink/engine/util/dbg/log.h"
 
 namespace ink {
 
+namespace {
+
+bool HasCompressedMesh(const proto::LOD& lod) {
+  return lod.has_draco_blob() || lod.has_ctm_blob();
+}
+
+size_t LodBytes(const proto::LOD& lod) {
+  return lod.draco_blob().size() + lod.ctm_blob().size();
+}
+
+// The size of the mesh's vertices and indices, as packed in CPU memory.
+size_t MeshBytes(const OptimizedMesh& mesh) {
+  size_t index_bytes =
+      mesh.verts.size() <= std::numeric_limits<uint16_t>::max()
+          ? sizeof(uint16_t)
+          : sizeof(uint32_t);
+  return mesh.verts.size() * mesh.verts.VertexSizeBytes() +
+         mesh.IndexSize() * index_bytes;
+}
+
+// Rebuilds a mesh that was written by IMeshWriter::MeshToLod(). The LOD holds
+// the packed positions of the vertices, which is the space that the element's
+// transform maps from, so the positions are packed again with the identity
+// transform.
+Status RebuildMesh(const proto::LOD& lod, ShaderType type,
+                   uint32_t solid_abgr, std::unique_ptr<OptimizedMesh>* out) {
+  Mesh mesh;
+  INK_RETURN_UNLESS(
+      mesh::ReaderFor(lod)->LodToMesh(lod, type, solid_abgr, &mesh));
+  if (mesh.verts.empty() || mesh.idx.empty()) {
+    return ErrorStatus(StatusCode::INVALID_ARGUMENT, "LOD has no triangles.");
+  }
+  Rect envelope = PackedVertList::CalcTargetEnvelopeForFormat(
+      OptimizedMesh::VertexFormat(type));
+  // Compression can move the vertices on the border slightly outside of it.
+  for (glm::vec2& position : *mesh.verts.MutablePositions()) {
+    position = glm::clamp(position, envelope.from, envelope.to);
+  }
+  *out = absl::make_unique<OptimizedMesh>(type, mesh, envelope);
+  return OkStatus();
+}
+
+}  // namespace
+
 PolyStore::PolyStore(std::shared_ptr<GLResourceManager> gl_resources,
-                     std::shared_ptr<settings::Flags> flags)
-    : gl_resources_(std::move(gl_resources)), flags_(std::move(flags)) {}
+                     std::shared_ptr<settings::Flags> flags,
+                     std::shared_ptr<FrameState> frame_state,
+                     std::shared_ptr<ITaskRunner> task_runner)
+    : gl_resources_(std::move(gl_resources)),
+      flags_(std::move(flags)),
+      frame_state_(std::move(frame_state)),
+      task_runner_(std::move(task_runner)),
+      dispatch_(new EventDispatch<PolyStoreListener>()) {
+  frame_state_->AddListener(this);
+}
+
+PolyStore::~PolyStore() { frame_state_->RemoveListener(this); }
 
 void PolyStore::Add(ElementId id, std::unique_ptr<OptimizedMesh> mesh) {
+  Add(id, std::move(mesh), nullptr);
+}
+
+void PolyStore::Add(ElementId id, std::unique_ptr<OptimizedMesh> mesh,
+                    const proto::LOD* lod) {
   if (id.Type() != ElementType::POLY) {
     SLOG(SLOG_WARNING, "Cannot store non-poly element in PolyStore (id: $0).",
          id);
@@ -35,41 +102,260 @@ void PolyStore::Add(ElementId id, std::unique_ptr<OptimizedMesh> mesh) {
     SLOG(SLOG_WARNING, "Cannot store null mesh in PolyStore (id: $0).", id);
     return;
   }
-  ASSERT(id_to_mesh_.find(id) == id_to_mesh_.end());
+  ASSERT(id_to_entry_.find(id) == id_to_entry_.end());
 
-  if (!flags_->GetFlag(settings::Flag::KeepMeshesInCpuMemory) ||
-      flags_->GetFlag(settings::Flag::LowMemoryMode)) {
-    gl_resources_->mesh_vbo_provider->EnsureOnlyInVBO(mesh.get(),
-                                                      GL_STATIC_DRAW);
-  } else if (!gl_resources_->mesh_vbo_provider->HasVBOs(*mesh)) {
-    gl_resources_->mesh_vbo_provider->GenVBOs(mesh.get(), GL_STATIC_DRAW);
+  Entry entry;
+  entry.last_visible_frame = frame_state_->GetFrameNumber();
+  if (memory_budget_ != 0) {
+    // The LOD has to be encoded before the vertices are cleared from CPU
+    // memory.
+    if (lod != nullptr && HasCompressedMesh(*lod)) {
+      entry.lod = std::make_shared<proto::LOD>(*lod);
+    } else {
+      auto encoded_lod = std::make_shared<proto::LOD>();
+      Status status =
+          mesh::WriterFor(*mesh)->MeshToLod(*mesh, encoded_lod.get());
+      if (status.ok() && HasCompressedMesh(*encoded_lod)) {
+        entry.lod = std::move(encoded_lod);
+      } else {
+        SLOG(SLOG_DATA_FLOW, "mesh for $0 can't be evicted: $1", id, status);
+      }
+    }
+    if (entry.lod) {
+      entry.solid_abgr = Vec4ToUintABGR(mesh->color);
+      lod_bytes_ += LodBytes(*entry.lod);
+    }
   }
-  id_to_mesh_[id] = std::move(mesh);
+  entry.mesh_bytes = UploadMesh(mesh.get());
+  entry.mesh = std::move(mesh);
+  mesh_bytes_ += entry.mesh_bytes;
+  id_to_entry_[id] = std::move(entry);
 
   SLOG(SLOG_DATA_FLOW, "polystore adding element id:$0", id);
 }
 
 void PolyStore::Remove(ElementId id) {
-  auto it = id_to_mesh_.find(id);
-  if (it == id_to_mesh_.end()) {
+  auto it = id_to_entry_.find(id);
+  if (it == id_to_entry_.end()) {
     SLOG(SLOG_WARNING, "poly store couldn't find element $0 for removal", id);
     return;
   }
-  id_to_mesh_.erase(id);
+  const Entry& entry = it->second;
+  if (entry.is_evicted) {
+    --evicted_mesh_count_;
+  } else {
+    mesh_bytes_ -= entry.mesh_bytes;
+  }
+  if (entry.lod) lod_bytes_ -= LodBytes(*entry.lod);
+  id_to_entry_.erase(it);
+}
+
+void PolyStore::SetMemoryBudget(size_t max_bytes) {
+  memory_budget_ = max_bytes;
+  SLOG(SLOG_DATA_FLOW, "polystore memory budget: $0 bytes", memory_budget_);
+}
+
+PolyStore::Stats PolyStore::GetStats() const {
+  Stats stats;
+  stats.hits = hits_;
+  stats.misses = misses_;
+  stats.evictions = evictions_;
+  stats.restores = restores_;
+  stats.mesh_count = id_to_entry_.size();
+  stats.evicted_mesh_count = evicted_mesh_count_;
+  stats.mesh_bytes = mesh_bytes_;
+  stats.lod_bytes = lod_bytes_;
+  return stats;
 }
 
 void PolyStore::OnMemoryWarning() {
+  size_t old_mesh_bytes = mesh_bytes_;
+  EvictMeshes(0);
   SLOG(SLOG_WARNING,
-       "polystore received memory warning, but is unable to help");
+       "polystore received memory warning, evicted meshes: $0 -> $1 bytes",
+       old_mesh_bytes, mesh_bytes_);
+}
+
+void PolyStore::MarkVisible(const std::vector<ElementId>& ids) {
+  const uint32_t frame = frame_state_->GetFrameNumber();
+  for (ElementId id : ids) {
+    auto it = id_to_entry_.find(id);
+    if (it == id_to_entry_.end()) continue;
+    Entry& entry = it->second;
+    entry.last_visible_frame = frame;
+    if (entry.is_evicted && !entry.is_restore_requested) {
+      entry.is_restore_requested = true;
+      ids_to_restore_.push_back(id);
+    }
+  }
+  if (!ids_to_restore_.empty()) frame_state_->RequestFrame();
+}
+
+void PolyStore::OnFrameEnd() {
+  RequestRestores();
+  if (memory_budget_ != 0) EvictMeshes(memory_budget_);
 }
 
 S_WARN_UNUSED_RESULT bool PolyStore::Get(ElementId id,
-                                         OptimizedMesh** mesh) const {
+                                         OptimizedMesh** mesh) {
   *mesh = nullptr;
-  auto it = id_to_mesh_.find(id);
-  if (it == id_to_mesh_.end()) return false;
-  ASSERT(it->second != nullptr);
-  *mesh = it->second.get();
+  auto it = id_to_entry_.find(id);
+  if (it == id_to_entry_.end()) return false;
+  Entry& entry = it->second;
+  ASSERT(entry.mesh != nullptr);
+  if (entry.is_evicted) {
+    ++misses_;
+    if (!Restore(id, &entry)) return false;
+  } else {
+    ++hits_;
+  }
+  *mesh = entry.mesh.get();
   return true;
 }
+
+S_WARN_UNUSED_RESULT bool PolyStore::GetShared(
+    ElementId id, std::shared_ptr<const OptimizedMesh>* mesh) {
+  mesh->reset();
+  auto it = id_to_entry_.find(id);
+  if (it == id_to_entry_.end()) return false;
+  Entry& entry = it->second;
+  if (entry.is_evicted && !Restore(id, &entry)) return false;
+  *mesh = entry.mesh;
+  return true;
+}
+
+S_WARN_UNUSED_RESULT bool PolyStore::GetMetadata(
+    ElementId id, const OptimizedMesh** mesh) const {
+  *mesh = nullptr;
+  auto it = id_to_entry_.find(id);
+  if (it == id_to_entry_.end()) return false;
+  ASSERT(it->second.mesh != nullptr);
+  *mesh = it->second.mesh.get();
+  return true;
+}
+
+size_t PolyStore::UploadMesh(OptimizedMesh* mesh) {
+  size_t bytes = MeshBytes(*mesh);
+  if (!flags_->GetFlag(settings::Flag::KeepMeshesInCpuMemory) ||
+      flags_->GetFlag(settings::Flag::LowMemoryMode)) {
+    gl_resources_->mesh_vbo_provider->EnsureOnlyInVBO(mesh, GL_STATIC_DRAW);
+  } else {
+    if (!gl_resources_->mesh_vbo_provider->HasVBOs(*mesh)) {
+      gl_resources_->mesh_vbo_provider->GenVBOs(mesh, GL_STATIC_DRAW);
+    }
+    // The mesh is held in both CPU and GPU memory.
+    bytes *= 2;
+  }
+  return bytes;
+}
+
+void PolyStore::EvictMeshes(size_t max_bytes) {
+  if (mesh_bytes_ <= max_bytes) return;
+
+  // Meshes that are in this frame's visible set, and meshes that are pinned,
+  // are kept.
+  const uint32_t frame = frame_state_->GetFrameNumber();
+  std::vector<Entry*> candidates;
+  for (auto& id_and_entry : id_to_entry_) {
+    Entry& entry = id_and_entry.second;
+    if (!entry.is_evicted && entry.lod && entry.last_visible_frame != frame &&
+        entry.mesh.use_count() == 1) {
+      candidates.push_back(&entry);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Entry* a, const Entry* b) {
+              return a->last_visible_frame < b->last_visible_frame;
+            });
+  for (size_t i = 0; i < candidates.size() && mesh_bytes_ > max_bytes; ++i) {
+    Evict(candidates[i]);
+  }
+  SLOG(SLOG_DATA_FLOW, "polystore holds $0 bytes of meshes, target $1",
+       mesh_bytes_, max_bytes);
+}
+
+void PolyStore::Evict(Entry* entry) {
+  ASSERT(!entry->is_evicted && entry->lod);
+  entry->mesh->ClearCpuMemoryVerts();
+  entry->mesh->backend_vert_data.reset();
+  entry->is_evicted = true;
+  mesh_bytes_ -= entry->mesh_bytes;
+  ++evicted_mesh_count_;
+  ++evictions_;
+}
+
+bool PolyStore::Restore(ElementId id, Entry* entry) {
+  ASSERT(entry->is_evicted && entry->lod);
+  std::unique_ptr<OptimizedMesh> mesh;
+  Status status = RebuildMesh(*entry->lod, entry->mesh->type,
+                              entry->solid_abgr, &mesh);
+  if (!status.ok()) {
+    SLOG(SLOG_ERROR, "evicted mesh for $0 can't be restored: $1", id, status);
+    return false;
+  }
+  SetRestoredMesh(entry, std::move(mesh));
+  return true;
+}
+
+void PolyStore::RequestRestores() {
+  if (ids_to_restore_.empty()) return;
+  std::weak_ptr<PolyStore> weak_this = shared_from_this();
+  for (ElementId id : ids_to_restore_) {
+    auto it = id_to_entry_.find(id);
+    if (it == id_to_entry_.end() || !it->second.is_evicted) continue;
+    const Entry& entry = it->second;
+    std::shared_ptr<const proto::LOD> lod = entry.lod;
+    ShaderType type = entry.mesh->type;
+    uint32_t solid_abgr = entry.solid_abgr;
+    auto rebuilt_mesh = std::make_shared<std::unique_ptr<OptimizedMesh>>();
+    task_runner_->PushTask(absl::make_unique<LambdaTask>(
+        [lod, type, solid_abgr, rebuilt_mesh]() {
+          Status status =
+              RebuildMesh(*lod, type, solid_abgr, rebuilt_mesh.get());
+          if (!status.ok()) {
+            SLOG(SLOG_ERROR, "could not rebuild mesh: $0", status);
+          }
+        },
+        [weak_this, id, lod, rebuilt_mesh]() {
+          if (auto poly_store = weak_this.lock()) {
+            poly_store->OnMeshRebuilt(id, lod.get(), std::move(*rebuilt_mesh));
+          }
+        }));
+  }
+  ids_to_restore_.clear();
+}
+
+void PolyStore::OnMeshRebuilt(ElementId id, const proto::LOD* lod,
+                              std::unique_ptr<OptimizedMesh> mesh) {
+  auto it = id_to_entry_.find(id);
+  // The element may have been removed, or removed and added again, while the
+  // mesh was being rebuilt.
+  if (it == id_to_entry_.end() || it->second.lod.get() != lod ||
+      !it->second.is_evicted) {
+    return;
+  }
+  Entry& entry = it->second;
+  if (mesh == nullptr) {
+    // The restore stays requested, so that this isn't retried on every frame.
+    SLOG(SLOG_ERROR, "evicted mesh for $0 can't be restored", id);
+    return;
+  }
+  SetRestoredMesh(&entry, std::move(mesh));
+
+  dispatch_->Send(&PolyStoreListener::OnMeshRestored, id);
+  frame_state_->RequestFrame();
+}
+
+void PolyStore::SetRestoredMesh(Entry* entry,
+                                std::unique_ptr<OptimizedMesh> mesh) {
+  mesh->object_matrix = entry->mesh->object_matrix;
+  entry->mesh_bytes = UploadMesh(mesh.get());
+  entry->mesh = std::move(mesh);
+  entry->is_evicted = false;
+  entry->is_restore_requested = false;
+  mesh_bytes_ += entry->mesh_bytes;
+  --evicted_mesh_count_;
+  ++restores_;
+}
+
 }  // namespace ink
@@ -17,38 +17,182 @@
 #ifndef INK_ENGINE_SCENE_DATA_COMMON_POLY_STORE_H_
 #define INK_ENGINE_SCENE_DATA_COMMON_POLY_STORE_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "ink/engine/geometry/mesh/mesh.h"
+#include "ink/engine/processing/runner/task_runner.h"
 #include "ink/engine/rendering/gl_managers/gl_resource_manager.h"
+#include "ink/engine/scene/frame_state/frame_state.h"
 #include "ink/engine/scene/types/element_id.h"
+#include "ink/engine/scene/types/event_dispatch.h"
 #include "ink/engine/service/dependencies.h"
 #include "ink/engine/settings/flags.h"
+#include "ink/proto/elements_portable_proto.pb.h"
 
 namespace ink {
 
-class PolyStore {
+class PolyStoreListener : public EventListener<PolyStoreListener> {
  public:
-  using SharedDeps = service::Dependencies<GLResourceManager, settings::Flags>;
+  // Called when the mesh of an element, which had been evicted to save memory,
+  // has been rebuilt in the background because the element became visible.
+  virtual void OnMeshRestored(ElementId id) = 0;
+};
+
+// Owns the meshes of the POLY elements in the scene.
+//
+// If a memory budget is set, meshes that are over budget are evicted at the
+// end of each frame, those that have been out of view the longest first. A
+// mesh can only be evicted if it is not in the visible set (see MarkVisible()),
+// if it is not pinned (see GetShared()), and if it can be rebuilt from a
+// compressed LOD. Evicted meshes that become visible are rebuilt in the
+// background, and the listeners are notified when they are available again;
+// Get() rebuilds an evicted mesh immediately.
+class PolyStore : public FrameStateListener,
+                  public std::enable_shared_from_this<PolyStore> {
+ public:
+  using SharedDeps = service::Dependencies<GLResourceManager, settings::Flags,
+                                           FrameState, ITaskRunner>;
+
+  struct Stats {
+    // Calls to Get() that found a mesh, and that found an evicted mesh.
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // Meshes rebuilt, by Get() or in the background.
+    uint64_t evictions = 0;
+    uint64_t restores = 0;
+    size_t mesh_count = 0;
+    size_t evicted_mesh_count = 0;
+    // The estimated size of the vertices and indices of the meshes that are
+    // not evicted, and the size of the LODs held to rebuild evicted meshes.
+    size_t mesh_bytes = 0;
+    size_t lod_bytes = 0;
+  };
 
   PolyStore(std::shared_ptr<GLResourceManager> gl_resources,
-            std::shared_ptr<settings::Flags> flags);
+            std::shared_ptr<settings::Flags> flags,
+            std::shared_ptr<FrameState> frame_state,
+            std::shared_ptr<ITaskRunner> task_runner);
+  ~PolyStore() override;
 
+  // Adds the mesh for the given element. If a memory budget is set, the mesh
+  // may later be evicted, and rebuilt from lod. If lod is null, or does not
+  // hold a compressed mesh, one is encoded from the mesh instead.
   void Add(ElementId id, std::unique_ptr<OptimizedMesh> mesh);
+  void Add(ElementId id, std::unique_ptr<OptimizedMesh> mesh,
+           const proto::LOD* lod);
   void Remove(ElementId id);
 
-  S_WARN_UNUSED_RESULT bool Get(ElementId id, OptimizedMesh** mesh) const;
+  // Returns false if there is no mesh for the element. If the mesh has been
+  // evicted, it is rebuilt from its LOD before this returns; this only fails if
+  // the LOD can't be decoded. The pointer is valid until the end of the frame,
+  // when the mesh may be evicted or replaced.
+  S_WARN_UNUSED_RESULT bool Get(ElementId id, OptimizedMesh** mesh);
+
+  // As Get(), but pins the mesh: it is not evicted while the returned pointer,
+  // or any copy of it, is alive, and it stays alive if the element is removed.
+  // This is intended for tasks that read the mesh on another thread. The
+  // vertices, indices, type, color, and texture do not change while the mesh
+  // is pinned, but the object matrix and color modifiers are overwritten by
+  // SceneGraph::GetMesh(), so they must be copied on the main thread. The last
+  // copy must be released on the main thread, as the mesh may own VBOs. This
+  // is not counted in the hits and misses of GetStats().
+  S_WARN_UNUSED_RESULT bool GetShared(
+      ElementId id, std::shared_ptr<const OptimizedMesh>* mesh);
+
+  // As Get(), but also returns evicted meshes, whose vertices and indices are
+  // not available. This is intended for reading the mesh's type, color, and
+  // texture. This does not count as a use of the mesh.
+  S_WARN_UNUSED_RESULT bool GetMetadata(ElementId id,
+                                        const OptimizedMesh** mesh) const;
+
+  // Sets the target for the size of the meshes that are not evicted. As with
+  // TilePolicy::max_tile_ram, this is a "best effort" target: meshes that are
+  // visible, pinned, or that cannot be rebuilt are never evicted. Only meshes
+  // that are added while a budget is set can be evicted, so the host should
+  // set it before loading a document (see SEngine::setMeshMemoryBudget()). A
+  // value of 0 means that there is no budget, and nothing is evicted.
+  void SetMemoryBudget(size_t max_bytes);
+  size_t MemoryBudget() const { return memory_budget_; }
+
+  // Marks the elements' meshes as visible during the current frame.
+  // SceneGraph::Update() calls this with the elements in and around the
+  // camera's window while a budget is set. Visible meshes are not evicted, and
+  // evicted ones are rebuilt in the background.
+  void MarkVisible(const std::vector<ElementId>& ids);
+
+  Stats GetStats() const;
 
+  // Evicts every mesh that can be evicted.
   void OnMemoryWarning();
 
+  void OnFrameEnd() override;
+
+  void AddListener(PolyStoreListener* listener) {
+    listener->RegisterOnDispatch(dispatch_);
+  }
+  void RemoveListener(PolyStoreListener* listener) {
+    listener->Unregister(dispatch_);
+  }
+
  private:
+  struct Entry {
+    // This is never null. Once evicted, the mesh keeps its type, color, and
+    // texture, but not its vertices, indices, or VBOs. It is shared with the
+    // holders of pins, and is only evicted while there are none.
+    std::shared_ptr<OptimizedMesh> mesh;
+    // The compressed mesh that the mesh is rebuilt from, or null if the mesh
+    // can't be evicted.
+    std::shared_ptr<const proto::LOD> lod;
+    uint32_t solid_abgr = 0;
+    size_t mesh_bytes = 0;
+    bool is_evicted = false;
+    bool is_restore_requested = false;
+    // The frame in which the mesh was last in the visible set, or was added.
+    uint32_t last_visible_frame = 0;
+  };
+
+  // Generates the VBOs for the mesh, and clears the vertices from CPU memory
+  // unless the flags ask to keep them. Returns the estimated size of the mesh
+  // in CPU and GPU memory.
+  size_t UploadMesh(OptimizedMesh* mesh);
+
+  // Evicts the meshes that have been out of the visible set the longest, until
+  // the mesh bytes are no more than max_bytes.
+  void EvictMeshes(size_t max_bytes);
+  void Evict(Entry* entry);
+
+  // Rebuilds the evicted mesh from its LOD immediately. Returns false if the
+  // LOD can't be decoded.
+  bool Restore(ElementId id, Entry* entry);
+  void RequestRestores();
+  void OnMeshRebuilt(ElementId id, const proto::LOD* lod,
+                     std::unique_ptr<OptimizedMesh> mesh);
+  // Replaces the evicted entry's mesh with the rebuilt one.
+  void SetRestoredMesh(Entry* entry, std::unique_ptr<OptimizedMesh> mesh);
+
   std::shared_ptr<GLResourceManager> gl_resources_;
   std::shared_ptr<settings::Flags> flags_;
+  std::shared_ptr<FrameState> frame_state_;
+  std::shared_ptr<ITaskRunner> task_runner_;
+  std::shared_ptr<EventDispatch<PolyStoreListener>> dispatch_;
+
+  std::unordered_map<ElementId, Entry, ElementIdHasher> id_to_entry_;
+
+  size_t memory_budget_ = 0;
+  size_t mesh_bytes_ = 0;
+  size_t lod_bytes_ = 0;
+  size_t evicted_mesh_count_ = 0;
+  uint64_t evictions_ = 0;
+  uint64_t restores_ = 0;
 
-  std::unordered_map<ElementId, std::unique_ptr<OptimizedMesh>, ElementIdHasher>
-      id_to_mesh_;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  // The evicted meshes that became visible during this frame.
+  std::vector<ElementId> ids_to_restore_;
 };
 
 }  // namespace ink
@@ -61,9 +61,8 @@ SceneGraph::SceneGraph(
       update_dispatch_(new EventDispatch<UpdateListener>()) {
   // Instantiate the root.
   per_group_id_index_[kInvalidElementId] = std::make_shared<ElementIdIndex>();
+  group_bounds_[kInvalidElementId];
   sticker_spatial_index_factory_->SetSceneGraph(this);
-  mbr_listener_ = absl::make_unique<MbrListener>();
-  mbr_listener_->RegisterOnDispatch(sgl_dispatch_);
 }
 
 SceneGraph::~SceneGraph() {
@@ -71,8 +70,8 @@ SceneGraph::~SceneGraph() {
   SLOG(SLOG_OBJ_LIFETIME, "sceneGraph dtor");
 }
 
-bool SceneGraph::AssociateElementId(const UUID& uuid, ElementId* result,
-                                    const ElementId& id) {
+bool SceneGraph::AssociateElementId(const InternedUUID& uuid,
+                                    ElementId* result, const ElementId& id) {
   *result = kInvalidElementId;
   if (id_bimap_.Contains(uuid)) {
     SLOG(SLOG_ERROR, "attempting to remap uuid $0 to a new element $1", uuid,
@@ -87,19 +86,33 @@ bool SceneGraph::AssociateElementId(const UUID& uuid, ElementId* result,
 }
 
 bool SceneGraph::GetNextPolyId(const UUID& uuid, ElementId* result) {
+  return GetNextPolyId(InternedUUID(uuid), result);
+}
+
+bool SceneGraph::GetNextPolyId(const InternedUUID& uuid, ElementId* result) {
   return AssociateElementId(uuid, result, element_id_source_->CreatePolyId());
 }
 
 bool SceneGraph::GetNextGroupId(const UUID& uuid, GroupId* result) {
+  return GetNextGroupId(InternedUUID(uuid), result);
+}
+
+bool SceneGraph::GetNextGroupId(const InternedUUID& uuid, GroupId* result) {
   return AssociateElementId(uuid, result, element_id_source_->CreateGroupId());
 }
 
-Status SceneGraph::AreIdsOkForAdd(ElementId id, const UUID& uuid) const {
+void SceneGraph::ReleaseUnusedPolyId(ElementId id) {
+  if (ElementExists(id) || !id_bimap_.Contains(id)) return;
+  id_bimap_.Remove(id);
+}
+
+Status SceneGraph::AreIdsOkForAdd(ElementId id,
+                                  const InternedUUID& uuid) const {
   if (ElementExists(id)) {
     return ErrorStatus(StatusCode::ALREADY_EXISTS,
                        "Got a repeat add for the same UUID = $0", uuid);
   }
-  if (id == kInvalidElementId || uuid == kInvalidUUID) {
+  if (id == kInvalidElementId || !uuid.IsValid()) {
     return ErrorStatus(StatusCode::INVALID_ARGUMENT,
                        "Attempting to add an invalid id!");
   }
@@ -108,7 +121,8 @@ Status SceneGraph::AreIdsOkForAdd(ElementId id, const UUID& uuid) const {
         StatusCode::INVALID_ARGUMENT,
         "Attempting to remap id $0 to uuid $1! (id already mapped)", id, uuid);
   }
-  if (id_bimap_.Contains(uuid) && id_bimap_.GetElementId(uuid) != id) {
+  ElementId mapped_id;
+  if (id_bimap_.FindElementId(uuid, &mapped_id) && mapped_id != id) {
     return ErrorStatus(
         StatusCode::INVALID_ARGUMENT,
         "Attempting to remap id $0 to uuid $1! (uuid already mapped)", id,
@@ -146,13 +160,13 @@ Status SceneGraph::AddSingleStrokeBelow(ElementAdd* element_to_add) {
   }
 
   auto processed_element = std::move(element_to_add->processed_element);
-  const UUID& uuid = element_to_add->serialized_element->uuid;
+  // The uuid is hashed once here, and only its InternedUUID is used below.
+  InternedUUID uuid(element_to_add->serialized_element->uuid);
   ElementId id = processed_element->id;
   INK_RETURN_UNLESS(AreIdsOkForAdd(id, uuid));
 
   GroupId group = processed_element->group;
-  auto id_from_uuid =
-      ElementIdFromUUID(element_to_add->serialized_element->uuid);
+  auto id_from_uuid = ElementIdFromUUID(uuid);
   if (id != id_from_uuid) {
     return ErrorStatus(
         StatusCode::INVALID_ARGUMENT,
@@ -176,18 +190,30 @@ Status SceneGraph::AddSingleStrokeBelow(ElementAdd* element_to_add) {
 
   sgl_dispatch_->Send(&SceneGraphListener::PreElementAdded,
                       processed_element.get(), transforms_.ObjToWorld(id));
+  ElementState& state = element_state_[id];
   if (processed_element->attributes.is_sticker) {
-    element_id_to_bounds_[id] =
+    state.spatial_index =
         sticker_spatial_index_factory_->CreateSpatialIndex(*processed_element);
   } else {
-    element_id_to_bounds_[id] = std::move(processed_element->spatial_index);
+    state.spatial_index = std::move(processed_element->spatial_index);
   }
+  state.world_mbr_version = 0;
+  state.visible = true;
+  state.opacity = 255;
 
-  ASSERT(element_id_to_bounds_[id]->Mbr(glm::mat4(1)).Area() > 0);
+  ASSERT(state.spatial_index->Mbr(glm::mat4(1)).Area() > 0);
   id_bimap_.Insert(uuid, id);
+  UpdateSceneSpatialIndex(id);
+  UpdateElementBounds(id);
   attributes_[id] = processed_element->attributes;
-  element_properties_[id] = ElementProperties{};
-  poly_store_->Add(id, std::move(processed_element->mesh));
+  // The mesh can be rebuilt from the compressed mesh in the bundle, if the
+  // poly store evicts it.
+  const proto::LOD* lod = nullptr;
+  const auto& bundle = element_to_add->serialized_element->bundle;
+  if (bundle && bundle->element().stroke().lod_size() > 0) {
+    lod = &bundle->element().stroke().lod(0);
+  }
+  poly_store_->Add(id, std::move(processed_element->mesh), lod);
   if (element_to_add->id_to_add_below == kInvalidElementId ||
       !TryAddElementBelow(id, group, element_to_add->id_to_add_below)) {
     per_group_id_index_[group]->AddToTop(id);
@@ -260,6 +286,7 @@ void SceneGraph::AddOrUpdateGroup(GroupId group_id,
                                   SourceDetails source_details) {
   ASSERT(group_id.Type() == GROUP);
   bool added_new = false;
+  bool changed = false;
   if (per_group_id_index_.count(group_id) == 0) {
     added_new = true;
     per_group_id_index_[kInvalidElementId]->AddToTop(group_id);
@@ -267,8 +294,9 @@ void SceneGraph::AddOrUpdateGroup(GroupId group_id,
     ++num_elements_;
     Mesh group_mesh;
     MakeRectangleMesh(&group_mesh, bounds);
-    element_id_to_bounds_[group_id] =
-        absl::make_unique<spatial::MeshRTree>(group_mesh);
+    ElementState& state = element_state_[group_id];
+    state.spatial_index = absl::make_unique<spatial::MeshRTree>(group_mesh);
+    state.world_mbr_version = 0;
     transforms_.Set(group_id, kInvalidElementId, group_to_world_transform);
   } else {
     if (!transforms_.Contains(group_id) ||
@@ -276,18 +304,22 @@ void SceneGraph::AddOrUpdateGroup(GroupId group_id,
       TransformElement(group_id, group_to_world_transform,
                        SourceDetails::FromEngine());
     }
-    auto bounds_it = element_id_to_bounds_.find(group_id);
-    if (bounds_it == element_id_to_bounds_.end() ||
-        bounds_it->second->Mbr(group_to_world_transform) != bounds) {
+    ElementState& state = element_state_[group_id];
+    if (state.spatial_index == nullptr ||
+        state.spatial_index->Mbr(group_to_world_transform) != bounds) {
       Mesh group_mesh;
       MakeRectangleMesh(&group_mesh, bounds);
-      element_id_to_bounds_[group_id] =
-          absl::make_unique<spatial::MeshRTree>(group_mesh);
+      state.spatial_index = absl::make_unique<spatial::MeshRTree>(group_mesh);
+      state.world_mbr_version = 0;
+      changed = true;
     }
+    changed = changed || clippable != IsClippableGroup(group_id);
   }
+  UpdateElementBounds(group_id);
 
-  attributes_[group_id].group_type = group_type;
-  attributes_[group_id].selectable = false;
+  ElementAttributes& attributes = attributes_[group_id];
+  attributes.group_type = group_type;
+  attributes.selectable = false;
 
   if (clippable) {
     clippable_groups_.insert(group_id);
@@ -306,6 +338,9 @@ void SceneGraph::AddOrUpdateGroup(GroupId group_id,
     groups.push_back(std::move(serialized_group));
     element_notifier_.OnElementsAdded(groups, kInvalidUUID,
                                       groups[0].source_details);
+  } else if (changed) {
+    sgl_dispatch_->Send(&SceneGraphListener::OnElementsChanged, this,
+                        std::vector<ElementId>{group_id});
   }
 }
 
@@ -325,6 +360,8 @@ void SceneGraph::MoveGroup(GroupId group_id, GroupId before_group) {
   } else {
     root_index->AddBelow(group_id, before_group);
   }
+  sgl_dispatch_->Send(&SceneGraphListener::OnElementsChanged, this,
+                      std::vector<ElementId>{group_id});
 }
 
 void SceneGraph::SetParent(ElementId element_id, GroupId group_id) {
@@ -337,12 +374,17 @@ void SceneGraph::SetParent(ElementId element_id, GroupId group_id) {
   auto last_group_id = GetParentGroupId(element_id);
   auto obj_to_world = transforms_.ObjToWorld(element_id);
   per_group_id_index_[last_group_id]->Remove(element_id);
+  RemoveElementBounds(element_id, last_group_id);
 
   auto group_to_world = transforms_.ObjToWorld(group_id);
   auto obj_to_group = glm::inverse(group_to_world) * obj_to_world;
   // Preserve the last obj-to-world transform.
   transforms_.Set(element_id, group_id, obj_to_group);
   per_group_id_index_[group_id]->AddToTop(element_id);
+  UpdateSceneSpatialIndex(element_id);
+  UpdateElementBounds(element_id);
+  sgl_dispatch_->Send(&SceneGraphListener::OnElementsChanged, this,
+                      std::vector<ElementId>{element_id});
 }
 
 void SceneGraph::RemoveElement(ElementId id, SourceDetails source) {
@@ -370,8 +412,8 @@ void SceneGraph::RemoveAllSelectableElements() {
   std::vector<ElementId> to_remove;
   ElementsInScene([](const GroupId& any) { return true; },
                   [this](const ElementId& id) {
-                    auto a = attributes_.find(id);
-                    return a != attributes_.end() && a->second.selectable;
+                    const ElementAttributes* a = attributes_.Find(id);
+                    return a != nullptr && a->selectable;
                   },
                   std::back_inserter(to_remove));
   RemoveElements(to_remove.begin(), to_remove.end(),
@@ -398,15 +440,21 @@ void SceneGraph::RemoveElementInternal(ElementId id,
       UNHANDLED_ELEMENT_TYPE(id);
   }
   auto parent = GetParentGroupId(id);
+  RemoveElementBounds(id, parent);
   transforms_.Remove(id);
   id_bimap_.Remove(id);
-  element_id_to_bounds_.erase(id);
-  color_modifier_.erase(id);
+  if (ElementState* state = element_state_.Find(id)) {
+    state->spatial_index = nullptr;
+    state->has_color_modifier = false;
+    state->color_modifier = ColorModifier();
+  }
+  scene_spatial_index_.Remove(id);
   per_group_id_index_[parent]->Remove(id);
   --num_elements_;
   if (id.Type() == GROUP) {
     clippable_groups_.erase(id);
     per_group_id_index_.erase(id);
+    scene_spatial_index_.RemoveGroup(id);
   }
 }
 
@@ -501,18 +549,20 @@ ElementMetadata SceneGraph::GetElementMetadata(ElementId id) const {
                          ? glm::mat4(1)
                          : transforms_.ObjToWorld(group_id);
   }
-  auto a = attributes_.find(id);
-  auto attributes = (a != attributes_.end()) ? a->second : ElementAttributes();
-  auto c = color_modifier_.find(id);
-  auto color_modifier =
-      c != color_modifier_.end() ? c->second : ColorModifier();
-  auto p = element_properties_.find(id);
-  auto properties =
-      (p != element_properties_.end()) ? p->second : ElementProperties{};
-  return ElementMetadata(id, id_bimap_.GetUUID(id), obj_to_world, obj_to_group,
-                         group_to_world, RenderedByMain(id), attributes,
-                         color_modifier, transforms_.GetGroup(id),
-                         properties.visible, properties.opacity);
+  const ElementAttributes* a = attributes_.Find(id);
+  auto attributes = a != nullptr ? *a : ElementAttributes();
+  const ElementState* s = element_state_.Find(id);
+  ElementState state = s != nullptr ? *s : ElementState();
+  return ElementMetadata(id, id_bimap_.GetUUID(id).str(), obj_to_world,
+                         obj_to_group, group_to_world, state.rendered_by_main,
+                         attributes, state.color_modifier,
+                         transforms_.GetGroup(id), state.visible,
+                         state.opacity);
+}
+
+ElementAttributes SceneGraph::GetElementAttributes(ElementId id) const {
+  const ElementAttributes* a = attributes_.Find(id);
+  return a != nullptr ? *a : ElementAttributes();
 }
 
 GroupId SceneGraph::GetParentGroupId(ElementId id) const {
@@ -524,9 +574,9 @@ GroupId SceneGraph::GetParentGroupId(ElementId id) const {
 
 glm::vec4 SceneGraph::GetColor(ElementId id) {
   ASSERT(id.Type() == POLY);
-  auto c = color_modifier_.find(id);
+  const ElementState* state = element_state_.Find(id);
   auto color_modifier =
-      c != color_modifier_.end() ? c->second : ColorModifier();
+      state != nullptr ? state->color_modifier : ColorModifier();
 
   // If the ColorModifier is a replacement modifier (multiplying the base
   // color by 0) then we can return the add part as the final color without
@@ -539,8 +589,8 @@ glm::vec4 SceneGraph::GetColor(ElementId id) {
   // optmesh to compute the color.
   if (!ElementExists(id, true)) return glm::vec4{0, 0, 0, 0};
 
-  OptimizedMesh* mesh;
-  if (!poly_store_->Get(id, &mesh)) {
+  const OptimizedMesh* mesh;
+  if (!poly_store_->GetMetadata(id, &mesh)) {
     return glm::vec4{0, 0, 0, 0};
   }
 
@@ -552,8 +602,8 @@ bool SceneGraph::GetTextureUri(ElementId id, std::string* uri) {
     // Non-POLYs don't have a texture.
     return false;
   }
-  OptimizedMesh* mesh;
-  if (ElementExists(id, true) && poly_store_->Get(id, &mesh) &&
+  const OptimizedMesh* mesh;
+  if (ElementExists(id, true) && poly_store_->GetMetadata(id, &mesh) &&
       mesh->type == ShaderType::TexturedVertShader) {
     ASSERT(mesh->texture != nullptr);
     *uri = mesh->texture->uri;
@@ -567,13 +617,23 @@ void SceneGraph::SetColor(ElementId id, glm::vec4 rgba, SourceDetails source) {
   MutateElements(
       &id, &id + 1,
       [this, rgba](ElementId id, size_t i) {
-        color_modifier_[id] = ColorModifier(glm::vec4(0, 0, 0, 0), rgba);
+        ElementState& state = element_state_[id];
+        state.color_modifier = ColorModifier(glm::vec4(0, 0, 0, 0), rgba);
+        state.has_color_modifier = true;
         return ElementMutationType::kColorMutation;
       },
       source);
 }
 
 void SceneGraph::Update(const Camera& cam) {
+  if (poly_store_->MemoryBudget() != 0) {
+    // The meshes of the elements within half a window of the camera's window
+    // are kept, so that a short pan or zoom doesn't need to rebuild them.
+    visible_mesh_ids_.clear();
+    ElementsInRegion(RegionQuery(cam.WorldWindow().Scale(2)),
+                     std::back_inserter(visible_mesh_ids_));
+    poly_store_->MarkVisible(visible_mesh_ids_);
+  }
   update_dispatch_->Send(&UpdateListener::Update, cam);
 }
 
@@ -612,20 +672,37 @@ const std::vector<std::shared_ptr<IDrawable>>& SceneGraph::GetDrawables()
   return drawables_;
 }
 
+void SceneGraph::PolyCandidatesInRegion(
+    const Rect& world_region, std::vector<ElementId>* candidates) const {
+  for (const auto& kv : per_group_id_index_) {
+    GroupId group_id = kv.first;
+    Rect region_in_group =
+        group_id == kInvalidElementId
+            ? world_region
+            : geometry::Transform(world_region,
+                                  transforms_.WorldToObj(group_id));
+    scene_spatial_index_.FindCandidates(group_id, region_in_group,
+                                        std::back_inserter(*candidates));
+  }
+}
+
 bool SceneGraph::TopElementInRegion(const RegionQuery& query,
                                     ElementId* out) const {
+  Rect world_region = geometry::Transform(query.Region(), query.Transform());
+  std::vector<ElementId> candidates;
   std::queue<GroupId> to_process;
   to_process.emplace(kInvalidElementId);  // root.
   while (!to_process.empty()) {
     auto group_id = to_process.front();
     to_process.pop();
-    auto group_iter = per_group_id_index_.find(group_id);
-    if (group_iter == per_group_id_index_.end()) {
+    if (per_group_id_index_.find(group_id) == per_group_id_index_.end()) {
       SLOG(SLOG_ERROR, "Found group $0 but no per group index", group_id);
       continue;
     }
-    const auto& group = group_iter->second;
-    for (auto id : group->ReverseSortedElements()) {
+    candidates.clear();
+    CandidatesInRegion(group_id, world_region, &candidates);
+    for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+      auto id = *it;
       if (IsElementInRegion(id, query)) {
         *out = id;
         return true;
@@ -641,7 +718,9 @@ bool SceneGraph::TopElementInRegion(const RegionQuery& query,
 bool SceneGraph::IsElementInRegion(const ElementId& id,
                                    const RegionQuery& query) const {
   ASSERT(IsKnownId(id, true));
-  if (!RenderedByMain(id) || !Visible(id)) {
+  // A single lookup for everything that is needed from the element's state.
+  const ElementState* state = element_state_.Find(id);
+  if (state != nullptr && (!state->rendered_by_main || !state->visible)) {
     return false;
   }
   const auto& filter = query.CustomFilter();
@@ -662,7 +741,8 @@ bool SceneGraph::IsElementInRegion(const ElementId& id,
     return false;
   }
 
-  const spatial::SpatialIndex& spi = *(element_id_to_bounds_.find(id)->second);
+  ASSERT(state != nullptr && state->spatial_index != nullptr);
+  const spatial::SpatialIndex& spi = *state->spatial_index;
   if (id.Type() == GROUP && spi.Mbr(transforms_.WorldToObj(id)).Area() == 0) {
     // Zero-area groups are Layers and always pass the intersection test.
     return true;
@@ -673,21 +753,20 @@ bool SceneGraph::IsElementInRegion(const ElementId& id,
 
 bool SceneGraph::RenderedByMain(ElementId id) const {
   ASSERT(IsKnownId(id, true));
-  auto ai = rendered_by_main_map_.find(id);
-  if (ai == rendered_by_main_map_.end()) return true;
-  return ai->second;
+  const ElementState* state = element_state_.Find(id);
+  return state == nullptr || state->rendered_by_main;
 }
 
 bool SceneGraph::Visible(ElementId id) const {
   ASSERT(IsKnownId(id, true));
-  auto p = element_properties_.find(id);
-  return (p == element_properties_.end()) ? true : p->second.visible;
+  const ElementState* state = element_state_.Find(id);
+  return state == nullptr || state->visible;
 }
 
 int SceneGraph::Opacity(ElementId id) const {
   ASSERT(IsKnownId(id, true));
-  auto p = element_properties_.find(id);
-  return (p == element_properties_.end()) ? 255 : p->second.opacity;
+  const ElementState* state = element_state_.Find(id);
+  return state == nullptr ? 255 : state->opacity;
 }
 
 bool SceneGraph::GetMesh(ElementId id, OptimizedMesh** mesh) const {
@@ -696,24 +775,30 @@ bool SceneGraph::GetMesh(ElementId id, OptimizedMesh** mesh) const {
 
   if (poly_store_->Get(id, mesh)) {
     (*mesh)->object_matrix = transforms_.ObjToWorld(id);
-    auto c = color_modifier_.find(id);
-    if (c != color_modifier_.end()) {
-      (*mesh)->mul_color_modifier = c->second.mul;
-      (*mesh)->add_color_modifier = c->second.add;
+    const ElementState* state = element_state_.Find(id);
+    if (state != nullptr && state->has_color_modifier) {
+      (*mesh)->mul_color_modifier = state->color_modifier.mul;
+      (*mesh)->add_color_modifier = state->color_modifier.add;
     }
     return true;
   }
   return false;
 }
 
+bool SceneGraph::GetSharedMesh(
+    ElementId id, std::shared_ptr<const OptimizedMesh>* mesh) const {
+  OptimizedMesh* unused;
+  return GetMesh(id, &unused) && poly_store_->GetShared(id, mesh);
+}
+
 std::shared_ptr<const spatial::SpatialIndex> SceneGraph::GetSpatialIndex(
     ElementId id) const {
-  auto iter = element_id_to_bounds_.find(id);
-  if (iter == element_id_to_bounds_.end()) {
+  const ElementState* state = element_state_.Find(id);
+  if (state == nullptr) {
     return nullptr;
   }
 
-  return iter->second;
+  return state->spatial_index;
 }
 
 void SceneGraph::SetSpatialIndex(ElementId id,
@@ -728,7 +813,7 @@ Rect SceneGraph::MbrForRange(
   Rect res;
   bool found_any = false;
   for (auto el = start; el != end; ++el) {
-    auto mbr = ElementMbr(*el, transforms_.ObjToWorld(*el));
+    auto mbr = WorldMbr(*el);
     if (found_any) {
       res = res.Join(mbr);
     } else {
@@ -744,15 +829,23 @@ Rect SceneGraph::Mbr(const std::vector<ElementId>& elements) const {
 }
 
 Rect SceneGraph::MbrForGroup(GroupId group_id) const {
-  auto group_iter = per_group_id_index_.find(group_id);
-  if (group_iter == per_group_id_index_.end()) {
+  if (per_group_id_index_.find(group_id) == per_group_id_index_.end()) {
     SLOG(SLOG_WARNING, "computing Mbr for group $0, but it was not found",
          group_id);
     return Rect();
   }
 
-  auto element_ids = group_iter->second->SortedElements();
-  return MbrForRange(element_ids.begin(), element_ids.end());
+  auto bounds_it = group_bounds_.find(group_id);
+  if (bounds_it == group_bounds_.end()) return Rect();
+  const OptRect& bounds = bounds_it->second.all.Bounds();
+  if (!bounds) return Rect();
+  return GroupToWorld(group_id, *bounds);
+}
+
+Rect SceneGraph::GroupToWorld(GroupId group_id, const Rect& group_rect) const {
+  if (group_id == kInvalidElementId || !transforms_.Contains(group_id))
+    return group_rect;
+  return geometry::Transform(group_rect, transforms_.ObjToWorld(group_id));
 }
 
 Rect SceneGraph::MbrObjCoords(ElementId element) const {
@@ -760,24 +853,97 @@ Rect SceneGraph::MbrObjCoords(ElementId element) const {
 }
 
 Rect SceneGraph::ElementMbr(ElementId id, const glm::mat4& obj_to_world) const {
-  const auto& br = element_id_to_bounds_.find(id);
-  ASSERT(br != element_id_to_bounds_.end());
-  return br->second->Mbr(obj_to_world);
+  const ElementState* state = element_state_.Find(id);
+  ASSERT(state != nullptr && state->spatial_index != nullptr);
+  return state->spatial_index->Mbr(obj_to_world);
 }
 
-Rect SceneGraph::Mbr() const {
-  if (!cached_mbr_) {
-    std::vector<ElementId> all_ids;
-    ElementsInScene(std::back_inserter(all_ids));
-    cached_mbr_ = Mbr(all_ids);
+Rect SceneGraph::WorldMbr(ElementId id) const {
+  ElementState* state = element_state_.Find(id);
+  ASSERT(state != nullptr && state->spatial_index != nullptr);
+  uint64_t version = transforms_.WorldTransformVersion(id);
+  if (state->world_mbr_version != version) {
+    state->world_mbr = state->spatial_index->Mbr(transforms_.ObjToWorld(id));
+    state->world_mbr_version = version;
   }
-  return *cached_mbr_;
+  return state->world_mbr;
+}
+
+void SceneGraph::UpdateSceneSpatialIndex(ElementId id) {
+  // Groups are not indexed -- there are few of them, and zero-area groups
+  // (layers) must always pass the region test.
+  if (id.Type() != POLY) return;
+  const ElementState* state = element_state_.Find(id);
+  if (state == nullptr || state->spatial_index == nullptr ||
+      !transforms_.Contains(id))
+    return;
+  scene_spatial_index_.Set(
+      id, transforms_.GetGroup(id),
+      state->spatial_index->Mbr(transforms_.ObjToGroup(id)));
+}
+
+void SceneGraph::UpdateElementBounds(ElementId id) {
+  const ElementState* state = element_state_.Find(id);
+  if (state == nullptr || state->spatial_index == nullptr ||
+      !transforms_.Contains(id))
+    return;
+  GroupId parent = transforms_.GetGroup(id);
+  Rect mbr = parent == kInvalidElementId
+                 ? WorldMbr(id)
+                 : ElementMbr(id, transforms_.ObjToGroup(id));
+  GroupBounds& bounds = group_bounds_[parent];
+  bounds.all.Set(id, mbr);
+  if (id.Type() == GROUP) {
+    // The children's bounds are in the group's coordinates, so they don't
+    // change when the group moves.
+    UpdateRenderedGroupBounds(id);
+    return;
+  }
+  if (state->rendered_by_main) {
+    bounds.rendered.Set(id, mbr);
+  } else {
+    bounds.rendered.Remove(id);
+  }
+  if (parent != kInvalidElementId) UpdateRenderedGroupBounds(parent);
+}
+
+void SceneGraph::UpdateRenderedGroupBounds(GroupId group_id) {
+  ElementBoundsTree& root_rendered = group_bounds_[kInvalidElementId].rendered;
+  const ElementState* state = element_state_.Find(group_id);
+  if (state == nullptr || state->spatial_index == nullptr ||
+      !transforms_.Contains(group_id) || !state->rendered_by_main) {
+    root_rendered.Remove(group_id);
+    return;
+  }
+  Rect mbr = WorldMbr(group_id);
+  auto bounds_it = group_bounds_.find(group_id);
+  if (bounds_it != group_bounds_.end()) {
+    const OptRect& children = bounds_it->second.rendered.Bounds();
+    if (children) mbr = mbr.Join(GroupToWorld(group_id, *children));
+  }
+  root_rendered.Set(group_id, mbr);
+}
+
+void SceneGraph::RemoveElementBounds(ElementId id, GroupId parent) {
+  auto bounds_it = group_bounds_.find(parent);
+  if (bounds_it != group_bounds_.end()) {
+    bounds_it->second.all.Remove(id);
+    bounds_it->second.rendered.Remove(id);
+  }
+  if (id.Type() == GROUP) {
+    group_bounds_.erase(id);
+  } else if (parent != kInvalidElementId) {
+    UpdateRenderedGroupBounds(parent);
+  }
+}
+
+Rect SceneGraph::Mbr() const {
+  const OptRect& bounds = group_bounds_.at(kInvalidElementId).rendered.Bounds();
+  return bounds ? *bounds : Rect();
 }
 
 float SceneGraph::Coverage(const Camera& cam, ElementId line_id) const {
-  return cam.Coverage(element_id_to_bounds_.at(line_id)
-                          ->Mbr(transforms_.ObjToWorld(line_id))
-                          .Width());
+  return cam.Coverage(WorldMbr(line_id).Width());
 }
 
 void SceneGraph::AddListener(SceneGraphListener* listener) {
@@ -806,13 +972,12 @@ bool SceneGraph::IsKnownId(const ElementId& id, bool log_on_unknown_id) const {
 
 bool SceneGraph::ElementExists(const ElementId& id,
                                bool log_on_no_element) const {
-  const auto& ai = element_id_to_bounds_.find(id);
-  bool has_bounds = ai != element_id_to_bounds_.end();
+  const ElementState* state = element_state_.Find(id);
+  bool has_bounds = state != nullptr && state->spatial_index != nullptr;
   auto group = GetParentGroupId(id);
   auto group_iter = per_group_id_index_.find(group);
   bool in_group = group_iter != per_group_id_index_.end() &&
                   group_iter->second->Contains(id);
-  ASSERT(!has_bounds || ai->second != nullptr);
   ASSERT(!has_bounds || transforms_.Contains(id));
   ASSERT(!has_bounds || id_bimap_.Contains(id));
   ASSERT(!has_bounds || in_group);
@@ -826,17 +991,31 @@ bool SceneGraph::ElementExists(const ElementId& id,
 }
 
 ElementId SceneGraph::ElementIdFromUUID(const UUID& id) const {
-  if (!id_bimap_.Contains(id)) {
+  InternedUUID interned;
+  // A uuid that isn't in the pool can't be mapped; that case is logged below.
+  InternedUUID::Find(id, &interned);
+  return ElementIdFromUUID(interned);
+}
+
+ElementId SceneGraph::ElementIdFromUUID(const InternedUUID& id) const {
+  ElementId element_id;
+  if (!id_bimap_.FindElementId(id, &element_id)) {
     SLOG(SLOG_WARNING,
          "Attempting to find the ElementId corresponding to uuid $0, but no "
          "mapping was found. (Did you call getNext*Id(uuid)?",
          id);
     return kInvalidElementId;
   }
-  return id_bimap_.GetElementId(id);
+  return element_id;
 }
 
 ElementId SceneGraph::PolyIdFromUUID(const UUID& id) const {
+  InternedUUID interned;
+  InternedUUID::Find(id, &interned);
+  return PolyIdFromUUID(interned);
+}
+
+ElementId SceneGraph::PolyIdFromUUID(const InternedUUID& id) const {
   auto elem = ElementIdFromUUID(id);
   if (elem == kInvalidElementId) {
     return elem;
@@ -849,6 +1028,12 @@ ElementId SceneGraph::PolyIdFromUUID(const UUID& id) const {
 }
 
 ElementId SceneGraph::GroupIdFromUUID(const UUID& id) const {
+  InternedUUID interned;
+  InternedUUID::Find(id, &interned);
+  return GroupIdFromUUID(interned);
+}
+
+ElementId SceneGraph::GroupIdFromUUID(const InternedUUID& id) const {
   auto elem = ElementIdFromUUID(id);
   if (elem == kInvalidElementId) {
     return elem;
@@ -860,16 +1045,22 @@ ElementId SceneGraph::GroupIdFromUUID(const UUID& id) const {
   return elem;
 }
 
-UUID SceneGraph::UUIDFromElementId(const ElementId& id) const {
+const UUID& SceneGraph::UUIDFromElementId(const ElementId& id) const {
+  return InternedUUIDFromElementId(id).str();
+}
+
+const InternedUUID& SceneGraph::InternedUUIDFromElementId(
+    const ElementId& id) const {
+  static const InternedUUID* kInvalidInternedUUID = new InternedUUID();
   if (id == kInvalidElementId) {
-    return kInvalidUUID;
+    return *kInvalidInternedUUID;
   }
   if (!id_bimap_.Contains(id)) {
     SLOG(SLOG_WARNING,
          "Attempting to find the uuid corresponding to ElementId $0, but no "
          "mapping was found.",
          id);
-    return kInvalidUUID;
+    return *kInvalidInternedUUID;
   }
   return id_bimap_.GetUUID(id);
 }
@@ -913,34 +1104,104 @@ void SceneGraph::WalkElementsInScene(GroupFilter expand_filter,
   }
 }
 
+void SceneGraph::CandidatesInRegion(GroupId group_id, const Rect& world_region,
+                                    std::vector<ElementId>* candidates) const {
+  auto group_iter = per_group_id_index_.find(group_id);
+  ASSERT(group_iter != per_group_id_index_.end());
+  const auto& group = group_iter->second;
+
+  Rect region_in_group =
+      group_id == kInvalidElementId
+          ? world_region
+          : geometry::Transform(world_region, transforms_.WorldToObj(group_id));
+  auto begin_size = candidates->size();
+  scene_spatial_index_.FindCandidates(group_id, region_in_group,
+                                      std::back_inserter(*candidates));
+
+  // Child groups aren't in the spatial index. As of now, only the root may
+  // have child groups.
+  if (group_id == kInvalidElementId) {
+    for (const auto& kv : per_group_id_index_) {
+      if (kv.first != kInvalidElementId) candidates->push_back(kv.first);
+    }
+  }
+
+  auto begin = candidates->begin() + begin_size;
+  if (2 * static_cast<size_t>(std::distance(begin, candidates->end())) >=
+      group->size()) {
+    // Most of the group is a candidate, so it's cheaper to take the group's
+    // (already sorted) elements than to sort the candidates.
+    candidates->erase(begin, candidates->end());
+    auto sorted = group->SortedElements();
+    candidates->insert(candidates->end(), sorted.begin(), sorted.end());
+  } else {
+    group->Sort(begin, candidates->end());
+  }
+}
+
+void SceneGraph::WalkElementsInRegion(const RegionQuery& query,
+                                      GroupFilter expand_filter,
+                                      ElementVisitor visit_element) const {
+  Rect world_region = geometry::Transform(query.Region(), query.Transform());
+  std::vector<ElementId> candidates;
+  CandidatesInRegion(kInvalidElementId, world_region, &candidates);
+  std::stack<std::pair<GroupId, ElementId>> to_process;
+  // See WalkElementsInScene() for why the elements are pushed in reverse.
+  for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+    to_process.emplace(std::make_pair(kInvalidElementId, *it));
+  }
+  while (!to_process.empty()) {
+    auto parent = to_process.top().first;
+    auto id = to_process.top().second;
+    to_process.pop();
+    visit_element(parent, id);
+    if (id.Type() == GROUP && expand_filter(id)) {
+      if (per_group_id_index_.find(id) == per_group_id_index_.end()) {
+        SLOG(SLOG_ERROR, "Found group $0 but no per group index", id);
+        continue;
+      }
+      candidates.clear();
+      CandidatesInRegion(id, world_region, &candidates);
+      for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+        to_process.emplace(std::make_pair(id, *it));
+      }
+    }
+  }
+}
+
 SceneGraph::GroupedElementsList SceneGraph::GroupElementsInSceneByWalk(
-    GroupFilter expand_filter, ElementFilter accept_element) const {
+    GroupFilter expand_filter, ElementFilter accept_element,
+    const RegionQuery* prune_query) const {
   GroupedElementsList result;
   GroupedElements grouped_elements;
   grouped_elements.group_id = kInvalidElementId;
-  WalkElementsInScene(
-      expand_filter, [this, &accept_element, &result, &grouped_elements](
-                         const GroupId& parent, const ElementId& id) {
-        if (id.Type() != POLY) {
-          return;
-        }
-        if (!accept_element(id)) {
-          return;
-        }
-        if (parent != grouped_elements.group_id) {
-          if (!grouped_elements.poly_ids.empty()) {
-            result.emplace_back(grouped_elements);
-          }
-          grouped_elements.group_id = parent;
-          if (parent != kInvalidElementId && IsClippableGroup(parent)) {
-            grouped_elements.bounds = Mbr({parent});
-          } else {
-            grouped_elements.bounds = Rect(0, 0, 0, 0);
-          }
-          grouped_elements.poly_ids.clear();
-        }
-        grouped_elements.poly_ids.emplace_back(id);
-      });
+  ElementVisitor visitor = [this, &accept_element, &result, &grouped_elements](
+                               const GroupId& parent, const ElementId& id) {
+    if (id.Type() != POLY) {
+      return;
+    }
+    if (!accept_element(id)) {
+      return;
+    }
+    if (parent != grouped_elements.group_id) {
+      if (!grouped_elements.poly_ids.empty()) {
+        result.emplace_back(grouped_elements);
+      }
+      grouped_elements.group_id = parent;
+      if (parent != kInvalidElementId && IsClippableGroup(parent)) {
+        grouped_elements.bounds = Mbr({parent});
+      } else {
+        grouped_elements.bounds = Rect(0, 0, 0, 0);
+      }
+      grouped_elements.poly_ids.clear();
+    }
+    grouped_elements.poly_ids.emplace_back(id);
+  };
+  if (prune_query == nullptr) {
+    WalkElementsInScene(expand_filter, visitor);
+  } else {
+    WalkElementsInRegion(*prune_query, expand_filter, visitor);
+  }
   // Insert the last grouped elements found.
   if (!grouped_elements.poly_ids.empty()) {
     result.emplace_back(std::move(grouped_elements));
@@ -959,17 +1220,25 @@ SceneGraph::GroupedElementsList SceneGraph::ElementsInRegionByGroup(
       },
       [this, &query](const ElementId& id) {
         return IsElementInRegion(id, query);
-      });
+      },
+      &query);
 }
 
 const SceneGraph::GroupElementIdIndexMap& SceneGraph::GetElementIndex() const {
   return per_group_id_index_;
 }
 
-SceneGraph::IdToZIndexPerGroup SceneGraph::CopyZIndex() const {
+SceneGraph::IdToZIndexPerGroup SceneGraph::ZIndexesOf(
+    const GroupedElementsList& elements) const {
   IdToZIndexPerGroup ret;
-  for (auto group : per_group_id_index_) {
-    ret[group.first] = group.second->IdToZIndexMap();
+  for (const auto& group : elements) {
+    auto index_it = per_group_id_index_.find(group.group_id);
+    ASSERT(index_it != per_group_id_index_.end());
+    if (index_it == per_group_id_index_.end()) continue;
+    IdToZIndex& id_to_zindex = ret[group.group_id];
+    id_to_zindex.reserve(id_to_zindex.size() + group.poly_ids.size());
+    for (ElementId id : group.poly_ids)
+      id_to_zindex[id] = index_it->second->ZIndexOf(id);
   }
   return ret;
 }
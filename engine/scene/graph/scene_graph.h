@@ -31,6 +31,7 @@
 #include "ink/engine/geometry/spatial/spatial_index.h"
 #include "ink/engine/geometry/spatial/sticker_spatial_index_factory_interface.h"
 #include "ink/engine/public/host/ielement_listener.h"
+#include "ink/engine/public/types/interned_uuid.h"
 #include "ink/engine/public/types/status.h"
 #include "ink/engine/public/types/uuid.h"
 #include "ink/engine/scene/data/common/poly_store.h"
@@ -38,11 +39,14 @@
 #include "ink/engine/scene/graph/element_notifier.h"
 #include "ink/engine/scene/graph/region_query.h"
 #include "ink/engine/scene/graph/scene_graph_listener.h"
+#include "ink/engine/scene/graph/scene_spatial_index.h"
 #include "ink/engine/scene/types/drawable.h"
 #include "ink/engine/scene/types/element_attributes.h"
+#include "ink/engine/scene/types/element_bounds_tree.h"
 #include "ink/engine/scene/types/element_id.h"
 #include "ink/engine/scene/types/element_index.h"
 #include "ink/engine/scene/types/element_metadata.h"
+#include "ink/engine/scene/types/element_slot_map.h"
 #include "ink/engine/scene/types/event_dispatch.h"
 #include "ink/engine/scene/types/id_map.h"
 #include "ink/engine/scene/types/source_details.h"
@@ -131,23 +135,41 @@ class SceneGraph {
                  sticker_spatial_index_factory);
   ~SceneGraph();
 
+  // The functions below that take a UUID string hash it to find its
+  // InternedUUID, and forward to the InternedUUID overloads. Code that looks up
+  // the same uuid more than once should intern it once, and pass that on.
   bool GetNextPolyId(const UUID& uuid, ElementId* result);
+  bool GetNextPolyId(const InternedUUID& uuid, ElementId* result);
   bool GetNextGroupId(const UUID& uuid, GroupId* result);
+  bool GetNextGroupId(const InternedUUID& uuid, GroupId* result);
+  // Releases the mapping of a uuid to an id from GetNextPolyId(), whose element
+  // was never added (e.g. because its conversion failed), so that the uuid may
+  // be added again. Does nothing if the element exists, or the mapping has
+  // already been removed.
+  void ReleaseUnusedPolyId(ElementId id);
   UUID GenerateUUID() { return uuid_generator_.GenerateUUID(); }
 
   // Returns the element id corresponding to a uuid.
   // If the uuid is not known, returns kInvalidElementId.
   ElementId ElementIdFromUUID(const UUID& id) const;
+  ElementId ElementIdFromUUID(const InternedUUID& id) const;
   // The following functions call ElementIdFromUUID but asserts that the type
   // is as expected. These should be preferred over ElementIdFromUUID.
   ElementId PolyIdFromUUID(const UUID& id) const;
+  ElementId PolyIdFromUUID(const InternedUUID& id) const;
   GroupId GroupIdFromUUID(const UUID& id) const;
+  GroupId GroupIdFromUUID(const InternedUUID& id) const;
   // Returns the uuid corresponding to an element id.
-  // If the element id is not known, returns kInvalidUUID.
-  UUID UUIDFromElementId(const ElementId& id) const;
+  // If the element id is not known, returns kInvalidUUID. The reference is
+  // valid until the element is removed.
+  const UUID& UUIDFromElementId(const ElementId& id) const;
+  const InternedUUID& InternedUUIDFromElementId(const ElementId& id) const;
   // If the element id is not known, returns an ElementMetadata whose id is
   // kInvalidUUID.
   ElementMetadata GetElementMetadata(ElementId id) const;
+  // Returns the element's attributes, or default attributes if the element id
+  // is not known. Cheaper than GetElementMetadata(id).attributes.
+  ElementAttributes GetElementAttributes(ElementId id) const;
   // Return the element's group id.
   GroupId GetParentGroupId(ElementId id) const;
 
@@ -293,7 +315,13 @@ class SceneGraph {
   void RemoveDrawable(IDrawable* drawable);
   const std::vector<std::shared_ptr<IDrawable>>& GetDrawables() const;
 
+  // If the element's mesh has been evicted to save memory, it is rebuilt before
+  // this returns (see PolyStore::Get()).
   bool GetMesh(ElementId id, OptimizedMesh** mesh) const;
+  // As GetMesh(), but pins the mesh for use by a task (see
+  // PolyStore::GetShared()).
+  bool GetSharedMesh(ElementId id,
+                     std::shared_ptr<const OptimizedMesh>* mesh) const;
 
   // Note that a sticker element's spatial index may change once the texture
   // has loaded.
@@ -314,7 +342,8 @@ class SceneGraph {
   Rect Mbr() const;
 
   // returns the minimum bounding Rect of all elements that are children of the
-  // group.
+  // group. If the group is rotated, this is the bounding Rect of the rotated
+  // bounds of its children in its own coordinates, and so may be larger.
   Rect MbrForGroup(GroupId group_id) const;
 
   // Returns the minimum bounding Rect of element
@@ -359,6 +388,9 @@ class SceneGraph {
   // Fetches the elements that match the provided query.
   // output is an output_iterator<element_id>. Groups are only
   // expanded if their spatial index matches the bounds of the query.
+  //
+  // Elements are sorted by z-index, back to front. Only the elements whose
+  // MBR intersects the query region are tested against the query.
   template <typename OutputIt>
   void ElementsInRegion(const RegionQuery& query, OutputIt output) const;
 
@@ -384,6 +416,12 @@ class SceneGraph {
   template <typename Container>
   GroupedElementsList GroupifyElements(const Container& elements);
 
+  // Appends to "candidates" the POLYs, in any group, whose MBRs may intersect
+  // world_region. They are in no particular order, and are neither tested
+  // against the region nor filtered by their groups' visibility.
+  void PolyCandidatesInRegion(const Rect& world_region,
+                              std::vector<ElementId>* candidates) const;
+
   bool TopElementInRegion(const RegionQuery& query, ElementId* out) const;
   bool IsElementInRegion(const ElementId& id, const RegionQuery& query) const;
 
@@ -411,10 +449,12 @@ class SceneGraph {
   // Returns a raw view of the current per group element index.
   const GroupElementIdIndexMap& GetElementIndex() const;
 
-  // CopyZIndex is used to snap the zindex state per group.
+  // Returns a snapshot of the z-indexes, within their groups, of the given
+  // elements, e.g. those returned by ElementsInRegionByGroup(). This is
+  // O(k log N) for k elements, rather than O(N) for the whole scene.
   using IdToZIndex = ElementIdHashMap<uint32_t>;
   using IdToZIndexPerGroup = ElementIdHashMap<IdToZIndex>;
-  IdToZIndexPerGroup CopyZIndex() const;
+  IdToZIndexPerGroup ZIndexesOf(const GroupedElementsList& elements) const;
 
   // Populates id_above with the ID of the element above id, within the same
   // group. If id is at the top of its group, id_above will be
@@ -438,7 +478,7 @@ class SceneGraph {
   // but will not dispatch any events to the IElementListeners.
   ABSL_MUST_USE_RESULT Status AddSingleStrokeBelow(ElementAdd* element_to_add);
 
-  bool AssociateElementId(const UUID& uuid, ElementId* result,
+  bool AssociateElementId(const InternedUUID& uuid, ElementId* result,
                           const ElementId& id);
 
   Rect MbrForRange(const std::vector<ElementId>::const_iterator start,
@@ -451,8 +491,30 @@ class SceneGraph {
   bool IsKnownId(const ElementId& id, bool log_on_unknown_id) const;
   void RemoveElementInternal(ElementId id, const SourceDetails source);
   ABSL_MUST_USE_RESULT Status AreIdsOkForAdd(ElementId id,
-                                             const UUID& uuid) const;
+                                             const InternedUUID& uuid) const;
   Rect ElementMbr(ElementId id, const glm::mat4& obj_to_world) const;
+  // Equivalent to ElementMbr(id, transforms_.ObjToWorld(id)), but cached until
+  // the element's transform or spatial index changes.
+  Rect WorldMbr(ElementId id) const;
+
+  // Updates the element's entry in scene_spatial_index_ to match its current
+  // group, transform, and spatial index. Does nothing for groups, or for
+  // elements that have not been fully added.
+  void UpdateSceneSpatialIndex(ElementId id);
+
+  // Updates the element's entries in group_bounds_ to match its current
+  // group, transform, spatial index, and rendered-by-main state. This is
+  // O(log N), even for a group, as its children's entries don't depend on its
+  // transform. Does nothing for elements that have not been fully added.
+  void UpdateElementBounds(ElementId id);
+  // Updates the root's rendered bounds entry for the group, which covers the
+  // group and its rendered children if the group is rendered by main.
+  void UpdateRenderedGroupBounds(GroupId group_id);
+  // Removes the element from the bounds of parent, its group.
+  void RemoveElementBounds(ElementId id, GroupId parent);
+  // Returns the bounding Rect, in world coordinates, of a Rect in the group's
+  // coordinates.
+  Rect GroupToWorld(GroupId group_id, const Rect& group_rect) const;
 
   // Walks over the specified elements and mutates them, tracking deltas for
   // modified getElementMetadata() and notifying SceneGraphListeners if
@@ -476,27 +538,66 @@ class SceneGraph {
   void WalkElementsInScene(GroupFilter expand_filter,
                            ElementVisitor visit_element) const;
 
+  // Like WalkElementsInScene, but only visits those elements that may
+  // intersect the query region, according to scene_spatial_index_. Child
+  // groups are always visited.
+  void WalkElementsInRegion(const RegionQuery& query,
+                            GroupFilter expand_filter,
+                            ElementVisitor visit_element) const;
+
+  // Populates "candidates" with the children of the group that may intersect
+  // world_region, sorted by z-index, back to front. Child groups are always
+  // included.
+  void CandidatesInRegion(GroupId group_id, const Rect& world_region,
+                          std::vector<ElementId>* candidates) const;
+
   // Walk over all the elements in the scene with respect to z-order.
   // For each poly (in z-order), calls accept_element with the id of the poly
   // element. If that returns true, will add that poly to the grouped elements
   // list (in the correct grouped elements). For any group, call expand filter
   // with the group id to decide of the group should be expanded into.
+  // If prune_query is not null, only the elements that may intersect its
+  // region are walked (see WalkElementsInRegion()).
   GroupedElementsList GroupElementsInSceneByWalk(
-      GroupFilter expand_filter, ElementFilter accept_element) const;
+      GroupFilter expand_filter, ElementFilter accept_element,
+      const RegionQuery* prune_query = nullptr) const;
 
   std::shared_ptr<spatial::StickerSpatialIndexFactoryInterface>
       sticker_spatial_index_factory_;
   std::unique_ptr<ElementIdSource> element_id_source_;
   std::shared_ptr<PolyStore> poly_store_;
+  // The elements whose meshes Update() last marked as visible; this is only
+  // kept to reuse its allocation.
+  std::vector<ElementId> visible_mesh_ids_;
   ElementNotifier element_notifier_;
   std::vector<std::shared_ptr<IDrawable>> drawables_;
   TransformMap transforms_;
-  // LF depends on this const to maintain thread-correctness.
-  ElementIdHashMap<std::shared_ptr<const spatial::SpatialIndex>>
-      element_id_to_bounds_;
-  ElementIdHashMap<bool> rendered_by_main_map_;
-  ElementIdHashMap<ElementAttributes> attributes_;
-  ElementIdHashMap<ColorModifier> color_modifier_;
+
+  // The per-element state that is read for each element by region queries
+  // and by the renderers, kept together so that a walk over the scene reads
+  // one slot per element, rather than one hash map entry per field.
+  struct ElementState {
+    // LF depends on this const to maintain thread-correctness. Only set while
+    // the element is in the scene.
+    std::shared_ptr<const spatial::SpatialIndex> spatial_index;
+    bool rendered_by_main = true;
+    // Unlike ElementAttributes (which are intended to be immutable qualities
+    // of an Element), these may change at runtime.
+    bool visible = true;
+    int opacity = 255;
+    bool has_color_modifier = false;
+    ColorModifier color_modifier;
+    // The MBR of spatial_index in world coordinates, valid while
+    // world_mbr_version matches the element's WorldTransformVersion().
+    Rect world_mbr;
+    uint64_t world_mbr_version = 0;
+  };
+  // The state may outlive the element: rendered_by_main is kept for an
+  // element that is removed and added again.
+  mutable ElementSlotMap<ElementState> element_state_;
+  ElementSlotMap<ElementAttributes> attributes_;
+  // Per-group R-Trees over the elements' MBRs, used to prune region queries.
+  SceneSpatialIndex scene_spatial_index_;
 
   UUIDGenerator uuid_generator_;
   IdMap id_bimap_;  // maps element_id <-> UUID
@@ -506,57 +607,25 @@ class SceneGraph {
   GroupElementIdIndexMap per_group_id_index_;
   GroupIdHashSet clippable_groups_;
 
-  // Unlike ElementAttributes (which are intended to be immutable qualities of
-  // an Element), the ElementProperties may change at runtime.
-  struct ElementProperties {
-    bool visible = true;
-    int opacity = 255;
-  };
-  ElementIdHashMap<ElementProperties> element_properties_;
-
   std::shared_ptr<EventDispatch<SceneGraphListener>> sgl_dispatch_;
   std::shared_ptr<EventDispatch<UpdateListener>> update_dispatch_;
 
-  // The cached_mbr is only set when the MBR is valid (no updates since
-  // the last call).
-  mutable absl::optional<Rect> cached_mbr_;
+  // The MBRs of each group's children, in the group's coordinates, kept up to
+  // date as elements are added, transformed and removed, so that Mbr() and
+  // MbrForGroup() don't walk the scene. The root's entry (kInvalidElementId)
+  // holds the root-level elements and groups, in world coordinates.
+  struct GroupBounds {
+    // Every child, for MbrForGroup().
+    ElementBoundsTree all;
+    // The children that Mbr() includes, i.e. those that are rendered by main.
+    // In the root, a group's entry also covers its rendered children, in world
+    // coordinates (see GroupToWorld()).
+    ElementBoundsTree rendered;
+  };
+  GroupIdHashMap<GroupBounds> group_bounds_;
 
   bool is_bulk_loading_{false};
 
-  /**
-   * Listens for scene graph events and updates the cached MBR as needed.
-   */
-  class MbrListener : public SceneGraphListener {
-   public:
-    MbrListener() {}
-    void OnElementAdded(SceneGraph* graph, ElementId id) override {
-      // Greedily update the cached mbr if one exists.
-      // MBR can only expand, no need to recompute the whole thing.
-      if (graph->cached_mbr_) {
-        Rect element_mbr = graph->Mbr({id});
-        graph->cached_mbr_ = graph->cached_mbr_->Join(element_mbr);
-      }
-    }
-    void OnElementsRemoved(
-        SceneGraph* graph,
-        const std::vector<SceneGraphRemoval>& removed_elements) override {
-      // Invalidate the cached mbr.
-      graph->cached_mbr_ = absl::nullopt;
-    }
-    void OnElementsMutated(
-        SceneGraph* graph,
-        const std::vector<ElementMutationData>& mutation_data) override {
-      // Invalidate the cached mbr.
-      graph->cached_mbr_ = absl::nullopt;
-    }
-
-   private:
-    std::function<void()> callback_;
-  };
-
-  // Whenever the scene graph change, this listener will ensure the cached MBR
-  // is recomputed.
-  std::unique_ptr<MbrListener> mbr_listener_;
 
   friend class SEngineTestEnvWithHelpers;
   friend class MagicEraserTest;
@@ -605,9 +674,9 @@ void SceneGraph::RemoveElements(ElementInputIt begin_elements,
       SLOG(SLOG_WARNING, "$0 is NOT a known id", id);
       continue;
     }
-    UUID uuid = UUIDFromElementId(id);
+    const UUID& uuid = UUIDFromElementId(id);
     GroupId parent = GetParentGroupId(id);
-    UUID parent_uuid =
+    const UUID& parent_uuid =
         parent == kInvalidElementId ? kInvalidUUID : UUIDFromElementId(parent);
     erased.emplace_back(SceneGraphRemoval{id, uuid, parent_uuid});
     erased_uuids.emplace_back(uuid);
@@ -631,6 +700,8 @@ void SceneGraph::TransformElements(ElementInputIt begin_elements,
       begin_elements, end_elements,
       [this, begin_transforms](ElementId id, size_t i) {
         transforms_.Set(id, begin_transforms[i]);
+        UpdateSceneSpatialIndex(id);
+        UpdateElementBounds(id);
         return ElementMutationType::kTransformMutation;
       },
       source);
@@ -647,7 +718,7 @@ void SceneGraph::SetVisibilities(ElementInputIt begin_elements,
   MutateElements(
       begin_elements, end_elements,
       [this, begin_visibilities](ElementId id, size_t i) {
-        this->element_properties_[id].visible = begin_visibilities[i];
+        this->element_state_[id].visible = begin_visibilities[i];
         return ElementMutationType::kVisibilityMutation;
       },
       source_details);
@@ -664,7 +735,7 @@ void SceneGraph::SetOpacities(ElementInputIt begin_elements,
   MutateElements(
       begin_elements, end_elements,
       [this, begin_opacities](ElementId id, size_t i) {
-        this->element_properties_[id].opacity = begin_opacities[i];
+        this->element_state_[id].opacity = begin_opacities[i];
         return ElementMutationType::kOpacityMutation;
       },
       source_details);
@@ -694,16 +765,23 @@ void SceneGraph::SetSpatialIndices(ElementIter element_begin,
                                    SpatialIndexIter index_end) {
   ASSERT(std::distance(element_begin, element_end) ==
          std::distance(index_begin, index_end));
-  // We likely about to invalidate the cached mbr.
-  cached_mbr_ = absl::nullopt;
+  std::vector<ElementId> changed;
   MutateElements(
       element_begin, element_end,
-      [this, &index_begin](ElementId id, size_t i) {
+      [this, &index_begin, &changed](ElementId id, size_t i) {
         ASSERT(index_begin[i] != nullptr);
-        element_id_to_bounds_[id] = std::move(index_begin[i]);
+        ElementState& state = element_state_[id];
+        state.spatial_index = std::move(index_begin[i]);
+        state.world_mbr_version = 0;
+        UpdateSceneSpatialIndex(id);
+        UpdateElementBounds(id);
+        changed.push_back(id);
         return ElementMutationType::kNone;
       },
       SourceDetails::EngineInternal(), /* log_unknown_id */ false);
+  if (!changed.empty()) {
+    sgl_dispatch_->Send(&SceneGraphListener::OnElementsChanged, this, changed);
+  }
 }
 
 template <typename InputIt>
@@ -713,7 +791,8 @@ void SceneGraph::SetElementRenderedByMain(InputIt begin_elements,
   MutateElements(
       begin_elements, end_elements,
       [this, rendered_by_main](ElementId id, size_t i) {
-        rendered_by_main_map_[id] = rendered_by_main;
+        element_state_[id].rendered_by_main = rendered_by_main;
+        UpdateElementBounds(id);
         return ElementMutationType::kRenderedByMainMutation;
       },
       SourceDetails::EngineInternal());
@@ -744,14 +823,16 @@ void SceneGraph::ElementsInRegion(const RegionQuery& query,
                                   OutputIt output) const {
   auto group_query = query;
   group_query.SetAllowedTypes({GROUP});
-  ElementsInScene(
+  WalkElementsInRegion(
+      query,
       [this, &group_query](const GroupId& id) {
         return IsElementInRegion(id, group_query);
       },
-      [this, &query](const ElementId& id) {
-        return IsElementInRegion(id, query);
-      },
-      output);
+      [this, &query, &output](const GroupId& parent, const ElementId& id) {
+        if (IsElementInRegion(id, query)) {
+          *output++ = id;
+        }
+      });
 }
 
 template <typename Container>
@@ -0,0 +1,179 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/scene/graph/scene_graph.h"
+
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "geo/render/ion/gfx/tests/fakeglcontext.h"
+#include "geo/render/ion/gfx/tests/fakegraphicsmanager.h"
+#include "geo/render/ion/portgfx/glcontext.h"
+#include "testing/base/public/benchmark.h"
+#include "third_party/absl/memory/memory.h"
+#include "ink/engine/geometry/mesh/mesh.h"
+#include "ink/engine/geometry/mesh/shader_type.h"
+#include "ink/engine/geometry/mesh/shape_helpers.h"
+#include "ink/engine/geometry/primitives/rect.h"
+#include "ink/engine/public/host/host.h"
+#include "ink/engine/public/sengine.h"
+#include "ink/engine/rendering/gl_managers/ion_graphics_manager_provider.h"
+#include "ink/engine/scene/data/common/processed_element.h"
+#include "ink/engine/scene/data/common/serialized_element.h"
+#include "ink/engine/scene/default_services.h"
+#include "ink/engine/scene/graph/region_query.h"
+#include "ink/engine/scene/types/element_id.h"
+#include "ink/engine/scene/types/source_details.h"
+#include "ink/engine/util/funcs/rand_funcs.h"
+#include "ink/public/document/single_user_document.h"
+#include "ink/public/document/storage/in_memory_storage.h"
+
+namespace ink {
+namespace {
+
+using benchmark::State;
+
+const int kViewportSize = 800;
+
+class BenchmarkHost : public Host {
+ public:
+  void BindScreen() override {}
+  bool ShouldPreloadShaders() const override { return false; }
+};
+
+class FakeGraphicsManagerProvider : public IonGraphicsManagerProvider {
+ public:
+  FakeGraphicsManagerProvider()
+      : graphics_manager_(new ion::gfx::testing::FakeGraphicsManager()) {}
+
+  ion::gfx::GraphicsManagerPtr GetGraphicsManager() override {
+    return graphics_manager_;
+  }
+
+ private:
+  ion::gfx::GraphicsManagerPtr graphics_manager_;
+};
+
+// An engine with a fake GL context, whose scene graph is filled directly with
+// rectangles, so that the scene graph is set up and listened to as it is in an
+// app.
+class BenchmarkScene {
+ public:
+  BenchmarkScene() : gl_context_(ion::gfx::testing::FakeGlContext::Create(
+                         kViewportSize, kViewportSize)) {
+    ion::portgfx::GlContext::MakeCurrent(gl_context_);
+    auto definitions = DefaultServiceDefinitions();
+    definitions->DefineService<IonGraphicsManagerProvider,
+                               FakeGraphicsManagerProvider>();
+    proto::Viewport viewport;
+    viewport.set_width(kViewportSize);
+    viewport.set_height(kViewportSize);
+    viewport.set_ppi(132);
+    engine_ = absl::make_unique<SEngine>(
+        std::make_shared<BenchmarkHost>(), viewport, 0,
+        std::make_shared<SingleUserDocument>(
+            std::make_shared<InMemoryStorage>()),
+        std::move(definitions));
+    graph_ = engine_->registry()->GetShared<SceneGraph>();
+  }
+
+  // Adds n rectangles of random sizes at random points in
+  // [-1000, 1000] x [-1000, 1000], and returns their ids.
+  std::vector<ElementId> AddRectangles(int n) {
+    std::vector<SceneGraph::ElementAdd> adds;
+    std::vector<ElementId> ids;
+    adds.reserve(n);
+    ids.reserve(n);
+    for (int i = 0; i < n; ++i) {
+      UUID uuid = graph_->GenerateUUID();
+      ElementId id;
+      graph_->GetNextPolyId(uuid, &id);
+      Mesh mesh;
+      MakeRectangleMesh(&mesh,
+                        Rect::CreateAtPoint({Drand(-1000, 1000),
+                                             Drand(-1000, 1000)},
+                                            Drand(1, 20), Drand(1, 20)));
+      adds.emplace_back(
+          absl::make_unique<ProcessedElement>(id, mesh, ColoredVertShader,
+                                              false),
+          absl::make_unique<SerializedElement>(
+              uuid, kInvalidUUID, SourceDetails::EngineInternal(),
+              CallbackFlags()));
+      ids.push_back(id);
+    }
+    graph_->AddStrokes(std::move(adds));
+    return ids;
+  }
+
+  void RemoveElements(const std::vector<ElementId>& ids) {
+    graph_->RemoveElements(ids.begin(), ids.end(),
+                           SourceDetails::EngineInternal());
+  }
+
+  const SceneGraph& graph() const { return *graph_; }
+
+ private:
+  ion::portgfx::GlContextPtr gl_context_;
+  std::unique_ptr<SEngine> engine_;
+  std::shared_ptr<SceneGraph> graph_;
+};
+
+void QueryRegion(const SceneGraph& graph, const Rect& region, State* state) {
+  std::vector<ElementId> result;
+  while (state->KeepRunning()) {
+    result.clear();
+    graph.ElementsInRegion(RegionQuery(region), std::back_inserter(result));
+    testing::DoNotOptimize(result.data());
+  }
+}
+
+const Rect kSmallRegion(-25, -25, 25, 25);
+const Rect kWholeScene(-1100, -1100, 1100, 1100);
+
+// Queries a small region, and so a few dozen elements, of a scene of n
+// elements. The argument is n.
+static void BM_ElementsInSmallRegion(State &state) {
+  Seed_random(0);
+  BenchmarkScene scene;
+  scene.AddRectangles(state.range(0));
+  QueryRegion(scene.graph(), kSmallRegion, &state);
+}
+BENCHMARK(BM_ElementsInSmallRegion)->Arg(100000);
+
+// As above, but querying the whole scene, so that every element's state is
+// read.
+static void BM_ElementsInWholeScene(State &state) {
+  Seed_random(0);
+  BenchmarkScene scene;
+  scene.AddRectangles(state.range(0));
+  QueryRegion(scene.graph(), kWholeScene, &state);
+}
+BENCHMARK(BM_ElementsInWholeScene)->Arg(100000);
+
+// As above, but after n elements have been added to and removed from the
+// scene, as happens over an editing session, so the live elements' handles
+// are not the first ones handed out.
+static void BM_ElementsInWholeSceneAfterChurn(State &state) {
+  Seed_random(0);
+  BenchmarkScene scene;
+  scene.RemoveElements(scene.AddRectangles(state.range(0)));
+  scene.AddRectangles(state.range(0));
+  QueryRegion(scene.graph(), kWholeScene, &state);
+}
+BENCHMARK(BM_ElementsInWholeSceneAfterChurn)->Arg(100000);
+
+}  // namespace
+}  // namespace ink
@@ -52,6 +52,13 @@ class SceneGraphListener : public EventListener<SceneGraphListener> {
       SceneGraph* graph,
       const std::vector<ElementMutationData>& mutation_data) = 0;
 
+  // Called for changes that aren't reported by OnElementsMutated(), and so
+  // aren't seen by hosts, but that can change which elements a region query
+  // finds, or their order: an element's spatial index was replaced, a POLY
+  // moved to another group, or a group was reordered or given new bounds.
+  virtual void OnElementsChanged(SceneGraph* graph,
+                                 const std::vector<ElementId>& ids) {}
+
   // Longform support. Can be removed only iff Longform stops using it.
   virtual void PreElementAdded(ProcessedElement* line, glm::mat4 obj_to_world) {
   }
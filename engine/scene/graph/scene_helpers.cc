@@ -64,9 +64,9 @@ void AddRectsToSceneGraph(const std::vector<Rect>& rects, glm::vec4 color,
     // Invert that matrix to get object-local outline coordinates.
     glm::mat4 page_to_object_transform = glm::inverse(pe->obj_to_group);
     pe->outline.reserve(m.verts.size());
-    for (const auto& v : m.verts) {
+    for (const auto& position : m.verts.Positions()) {
       pe->outline.emplace_back(
-          geometry::Transform(v.position, page_to_object_transform));
+          geometry::Transform(position, page_to_object_transform));
     }
 
     auto se = absl::make_unique<SerializedElement>(
@@ -0,0 +1,84 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/scene/graph/scene_spatial_index.h"
+
+#include "third_party/absl/memory/memory.h"
+#include "ink/engine/util/dbg/errors.h"
+
+namespace ink {
+
+void SceneSpatialIndex::Set(ElementId id, GroupId group,
+                            const Rect& mbr_in_group) {
+  auto it = indexed_elements_.find(id);
+  if (it != indexed_elements_.end()) {
+    if (it->second.group == group && it->second.mbr_in_group == mbr_in_group)
+      return;
+    Remove(id);
+  }
+
+  // The entry must exist before inserting, as the R-Tree's bounds function
+  // reads it.
+  indexed_elements_[id] = IndexedElement{group, mbr_in_group};
+  GetOrCreateGroupRTree(group)->Insert(id);
+}
+
+void SceneSpatialIndex::Remove(ElementId id) {
+  auto it = indexed_elements_.find(id);
+  if (it == indexed_elements_.end()) return;
+
+  auto rtree_it = per_group_rtree_.find(it->second.group);
+  ASSERT(rtree_it != per_group_rtree_.end());
+  if (rtree_it != per_group_rtree_.end()) {
+    auto removed = rtree_it->second->Remove(
+        it->second.mbr_in_group,
+        [id](const ElementId& candidate) { return candidate == id; });
+    ASSERT(removed.has_value());
+  }
+  indexed_elements_.erase(it);
+}
+
+void SceneSpatialIndex::RemoveGroup(GroupId group) {
+  auto rtree_it = per_group_rtree_.find(group);
+  if (rtree_it == per_group_rtree_.end()) return;
+
+  for (auto it = indexed_elements_.begin(); it != indexed_elements_.end();) {
+    if (it->second.group == group) {
+      indexed_elements_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  per_group_rtree_.erase(rtree_it);
+}
+
+void SceneSpatialIndex::Clear() {
+  per_group_rtree_.clear();
+  indexed_elements_.clear();
+}
+
+SceneSpatialIndex::ElementRTree* SceneSpatialIndex::GetOrCreateGroupRTree(
+    GroupId group) {
+  auto& rtree = per_group_rtree_[group];
+  if (rtree == nullptr) {
+    rtree = absl::make_unique<ElementRTree>([this](const ElementId& id) {
+      auto it = indexed_elements_.find(id);
+      ASSERT(it != indexed_elements_.end());
+      return it->second.mbr_in_group;
+    });
+  }
+  return rtree.get();
+}
+
+}  // namespace ink
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INK_ENGINE_SCENE_GRAPH_SCENE_SPATIAL_INDEX_H_
+#define INK_ENGINE_SCENE_GRAPH_SCENE_SPATIAL_INDEX_H_
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "ink/engine/geometry/primitives/rect.h"
+#include "ink/engine/geometry/spatial/rtree.h"
+#include "ink/engine/scene/types/element_id.h"
+
+namespace ink {
+
+// A scene-level spatial index, used by the SceneGraph to find the candidate
+// elements for a region query without visiting every element in the scene.
+//
+// Each group (including the root, kInvalidElementId) has its own R-Tree,
+// holding the MBRs of its child elements in *group* coordinates. This means
+// that transforming a group does not require re-indexing its children; the
+// query region is instead transformed into each group's coordinate space.
+//
+// The index is conservative: any element whose indexed MBR intersects the
+// query region is reported as a candidate, and it is up to the caller to
+// perform the exact intersection test.
+//
+// This class is NOT thread safe.
+class SceneSpatialIndex {
+ public:
+  SceneSpatialIndex() {}
+
+  // Disallow copy and assign, the R-Trees' bounds functions refer back to
+  // this instance.
+  SceneSpatialIndex(const SceneSpatialIndex&) = delete;
+  SceneSpatialIndex& operator=(const SceneSpatialIndex&) = delete;
+
+  // Inserts the element into the given group's index with the given MBR, in
+  // group coordinates. If the element is already indexed (in this or any other
+  // group), its old entry is replaced.
+  void Set(ElementId id, GroupId group, const Rect& mbr_in_group);
+
+  // Removes the element from the index. Does nothing if the element is not
+  // indexed.
+  void Remove(ElementId id);
+
+  // Removes the group's index, and all elements in it.
+  void RemoveGroup(GroupId group);
+
+  // Returns true if the element is indexed.
+  bool Contains(ElementId id) const {
+    return indexed_elements_.find(id) != indexed_elements_.end();
+  }
+
+  // Appends to "output" the ids of the elements in the given group whose
+  // indexed MBR intersects region_in_group. The output is in no particular
+  // order. Returns the number of elements found.
+  //
+  // output is an output_iterator<ElementId>
+  template <typename OutputIt>
+  int FindCandidates(GroupId group, const Rect& region_in_group,
+                     OutputIt output) const;
+
+  // Returns the number of elements indexed across all groups.
+  size_t Size() const { return indexed_elements_.size(); }
+
+  void Clear();
+
+ private:
+  using ElementRTree = spatial::RTree<ElementId>;
+
+  struct IndexedElement {
+    GroupId group;
+    Rect mbr_in_group;
+  };
+
+  ElementRTree* GetOrCreateGroupRTree(GroupId group);
+
+  GroupIdHashMap<std::unique_ptr<ElementRTree>> per_group_rtree_;
+
+  // The group and MBR that each element was indexed with. The MBR is needed to
+  // find the element in the R-Tree when it is removed or updated, since its
+  // transform or spatial index may already have changed by then.
+  ElementIdHashMap<IndexedElement> indexed_elements_;
+};
+
+template <typename OutputIt>
+int SceneSpatialIndex::FindCandidates(GroupId group,
+                                      const Rect& region_in_group,
+                                      OutputIt output) const {
+  auto it = per_group_rtree_.find(group);
+  if (it == per_group_rtree_.end()) return 0;
+  return it->second->FindAll(region_in_group, output);
+}
+
+}  // namespace ink
+
+#endif  // INK_ENGINE_SCENE_GRAPH_SCENE_SPATIAL_INDEX_H_
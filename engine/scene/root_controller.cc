@@ -31,6 +31,7 @@
 #include "ink/engine/gl.h"
 #include "ink/engine/input/cursor_manager.h"
 #include "ink/engine/processing/element_converters/bezier_path_converter.h"
+#include "ink/engine/processing/element_converters/bulk_element_adder.h"
 #include "ink/engine/processing/element_converters/bundle_proto_converter.h"
 #include "ink/engine/processing/element_converters/element_converter.h"
 #include "ink/engine/processing/element_converters/mesh_converter.h"
@@ -63,6 +64,7 @@
 #include "ink/engine/util/dbg/glerrors.h"
 #include "ink/engine/util/dbg/log.h"
 #include "ink/engine/util/dbg/log_levels.h"
+#include "ink/engine/util/dbg/trace.h"
 #include "ink/engine/util/funcs/step_utils.h"
 #include "ink/engine/util/funcs/utils.h"
 #include "ink/engine/util/security.h"
@@ -82,6 +84,19 @@ using std::unique_ptr;
 namespace ink {
 namespace {
 
+// The number of elements in the first batch of a bulk load, and in each
+// subsequent batch. Each batch is a task, so when the task runner executes
+// tasks in parallel, the batches are converted on its worker threads.
+constexpr size_t kFirstBulkLoadBatchSize = 64;
+constexpr size_t kBulkLoadBatchSize = 512;
+
+// A step of RootController::BulkLoadElements(): either a batch of strokes and
+// paths, or a single text element.
+struct BulkLoadStep {
+  bool is_text = false;
+  std::vector<proto::ElementBundle> bundles;
+};
+
 class ReplaceTask : public Task {
  public:
   ReplaceTask(std::weak_ptr<SceneGraph> weak_scene_graph,
@@ -149,6 +164,8 @@ class ReplaceTask : public Task {
                                     scene_ids_[i].id_to_add_below);
     }
   }
+  // Execute() only converts the task's own bundles.
+  bool CanExecuteInParallel() const override { return true; }
   void OnPostExecute() override {
     if (auto scene_graph = weak_scene_graph_.lock())
       scene_graph->ReplaceElements(std::move(elements_to_add_),
@@ -211,6 +228,7 @@ RootController::RootController(
   cursor_manager_ = registry_->GetShared<input::CursorManager>();
   flags_ = registry_->GetShared<settings::Flags>();
   flags_->AddListener(this);
+  trace::SetCurrentThreadName("Engine");
 
   root_renderer_->AddDrawable(registry_->GetShared<DebugView>().get());
 
@@ -374,10 +392,13 @@ void RootController::OnFlagChanged(settings::Flag which, bool new_value) {
     if (tools_->GetTool(Tools::ToolType::Line, &line_tool)) {
       line_tool->EnableDebugMesh(new_value);
     }
+  } else if (which == settings::Flag::EnableTracing) {
+    trace::SetEnabled(new_value);
   }
 }
 
 void RootController::Draw(FrameTimeS draw_time) {
+  INK_TRACE_EVENT("frame", "RootController::Draw");
   SLOG(SLOG_DRAWING, "rootcontroller draw started");
   // NOTE(mrcasey): Camera and page bounds should not be modified during
   // drawing, as engine state has already been cached for this frame.
@@ -392,7 +413,10 @@ void RootController::Draw(FrameTimeS draw_time) {
 
   // blit (draw to screen)
   blit_timer_->Begin();
-  root_renderer_->Draw(draw_time);
+  {
+    INK_TRACE_EVENT("frame", "RootRenderer::Draw");
+    root_renderer_->Draw(draw_time);
+  }
   blit_timer_->End();
 
   frame_state_->FrameEnd();
@@ -539,6 +563,41 @@ void RootController::ReplaceElements(const proto::ElementBundleReplace& replace,
       scene_graph_, replace, source_details, *flags_));
 }
 
+void RootController::BulkLoadElements(
+    std::vector<proto::ElementBundle> unsafe_bundles,
+    const SourceDetails& source_details) {
+  // Split the bundles into batches. Text is added individually, so it also ends
+  // the current batch; as the tasks are run in order, this keeps the elements
+  // in the same order as the bundles.
+  std::vector<BulkLoadStep> steps;
+  size_t n_batches = 0;
+  size_t batch_size = kFirstBulkLoadBatchSize;
+  for (auto& bundle : unsafe_bundles) {
+    bool is_text = bundle.element().has_text();
+    if (is_text || steps.empty() || steps.back().is_text ||
+        steps.back().bundles.size() >= batch_size) {
+      if (!is_text && n_batches++ > 0) batch_size = kBulkLoadBatchSize;
+      steps.emplace_back();
+      steps.back().is_text = is_text;
+    }
+    steps.back().bundles.push_back(std::move(bundle));
+  }
+  SLOG(SLOG_DOCUMENT, "bulk loading $0 elements in $1 batches",
+       unsafe_bundles.size(), n_batches);
+
+  bulk_load_metrics_ =
+      std::make_shared<BulkLoadMetrics>(wall_clock_, n_batches);
+  for (auto& step : steps) {
+    if (step.is_text) {
+      AddElement(step.bundles[0], source_details).IgnoreError();
+    } else {
+      task_runner_->PushTask(absl::make_unique<BulkElementAdder>(
+          std::move(step.bundles), scene_graph_, *flags_, source_details,
+          bulk_load_metrics_));
+    }
+  }
+}
+
 UUID RootController::AddPath(const ink::proto::Path& unsafe_path,
                              const GroupId& group,
                              const SourceDetails& source_details) {
@@ -573,9 +632,9 @@ UUID RootController::AddImageRect(const Rect& rectangle, float rotation,
   // Invert that matrix to get object-local outline coordinates.
   glm::mat4 page_to_object_transform = glm::inverse(pe->obj_to_group);
   pe->outline.reserve(mesh.verts.size());
-  for (const auto& v : mesh.verts) {
+  for (const auto& position : mesh.verts.Positions()) {
     pe->outline.emplace_back(
-        geometry::Transform(v.position, page_to_object_transform));
+        geometry::Transform(position, page_to_object_transform));
   }
 
   auto se = absl::make_unique<SerializedElement>(
@@ -738,30 +797,46 @@ void RootController::SetColor(const UUID& uuid, glm::vec4 rgba,
   scene_graph_->SetColor(id, rgba, source);
 }
 
-void RootController::Render(uint32_t max_dimension_px,
-                            bool should_draw_background, const Rect& world_rect,
-                            GroupId render_only_group, ExportedImage* out) {
+Rect RootController::ImageExportBounds(const Rect& world_rect) const {
+  if (!world_rect.Empty()) return world_rect;
+
   Rect image_export_bounds;
-  if (!world_rect.Empty()) {
-    image_export_bounds = world_rect;
+  if (page_bounds_->HasBounds()) {
+    image_export_bounds = page_bounds_->Bounds();
   } else {
-    if (page_bounds_->HasBounds()) {
-      image_export_bounds = page_bounds_->Bounds();
-    } else {
-      // Use the scene mbr if we have no page bounds and any elements.
-      image_export_bounds = scene_graph_->Mbr();
-    }
-    if (image_export_bounds.Area() == 0) {
-      // If we have no elements AND no page bounds, use the current camera.
-      image_export_bounds = camera_->WorldWindow();
-    }
+    // Use the scene mbr if we have no page bounds and any elements.
+    image_export_bounds = scene_graph_->Mbr();
+  }
+  if (image_export_bounds.Area() == 0) {
+    // If we have no elements AND no page bounds, use the current camera.
+    image_export_bounds = camera_->WorldWindow();
   }
+  return image_export_bounds;
+}
 
-  image_exporter_->Render(max_dimension_px, image_export_bounds,
+void RootController::Render(uint32_t max_dimension_px,
+                            bool should_draw_background, const Rect& world_rect,
+                            GroupId render_only_group,
+                            ImageExporter::BackendOptions backend_options,
+                            ExportedImage* out) {
+  image_exporter_->Render(max_dimension_px, ImageExportBounds(world_rect),
                           ImageExporter::BackgroundOptions::kDraw,
                           ImageExporter::CurrentToolOptions::kDraw,
                           ImageExporter::DrawablesOptions::kDraw,
-                          render_only_group, out);
+                          backend_options, render_only_group, out);
+}
+
+void RootController::RenderTiled(uint32_t max_dimension_px,
+                                 bool should_draw_background,
+                                 const Rect& world_rect,
+                                 GroupId render_only_group,
+                                 ImageExporter::BackendOptions backend_options,
+                                 ImageExportSink* sink) {
+  image_exporter_->RenderTiled(
+      max_dimension_px, ImageExportBounds(world_rect),
+      should_draw_background ? ImageExporter::BackgroundOptions::kDraw
+                             : ImageExporter::BackgroundOptions::kSkip,
+      backend_options, render_only_group, sink);
 }
 
 void RootController::AddSequencePoint(int32_t id) {
@@ -29,6 +29,7 @@
 #include "ink/engine/geometry/primitives/rect.h"
 #include "ink/engine/input/cursor_manager.h"
 #include "ink/engine/input/input_dispatch.h"
+#include "ink/engine/processing/element_converters/bulk_element_adder.h"
 #include "ink/engine/public/host/iplatform.h"
 #include "ink/engine/public/types/exported_image.h"
 #include "ink/engine/public/types/iselection_provider.h"
@@ -89,6 +90,21 @@ class RootController : public settings::FlagListener {
   void ReplaceElements(const proto::ElementBundleReplace& replace,
                        const SourceDetails& source_details);
 
+  // Adds the given bundles to the scene when loading a document. Strokes and
+  // paths are converted in parallel, in batches, and each batch is added to the
+  // scene graph at once. The first batch is kept small, so that part of the
+  // document is drawn as soon as possible. Text is added as by AddElement().
+  // This may only be called while the scene graph is bulk loading. Groups must
+  // be added with AddElement() beforehand.
+  void BulkLoadElements(std::vector<proto::ElementBundle> unsafe_bundles,
+                        const SourceDetails& source_details);
+
+  // Returns the metrics for the most recent call to BulkLoadElements(), or
+  // null if it has never been called.
+  std::shared_ptr<const BulkLoadMetrics> LastBulkLoadMetrics() const {
+    return bulk_load_metrics_;
+  }
+
   UUID AddPath(const proto::Path& unsafe_path, const GroupId& group,
                const SourceDetails& source_details);
   UUID AddImageRect(const Rect& rectangle, float rotation,
@@ -138,10 +154,22 @@ class RootController : public settings::FlagListener {
   // aspect ratio.
   // If render_only_group != kInvalidElementId, then only render elements which
   // are descendents of that group.
+  // backend_options selects whether the bitmap is rasterized with GL or on the
+  // CPU (see ImageExporter::BackendOptions).
   void Render(uint32_t max_dimension_px, bool should_draw_background,
               const Rect& world_rect, GroupId render_only_group,
+              ImageExporter::BackendOptions backend_options,
               ExportedImage* out);
 
+  // Creates a bitmap of the Scene contents as Render() does, but without
+  // limiting its size to the maximum texture size. The bitmap is rendered in
+  // tiles and written to sink one band of rows at a time (see
+  // ImageExporter::RenderTiled()).
+  void RenderTiled(uint32_t max_dimension_px, bool should_draw_background,
+                   const Rect& world_rect, GroupId render_only_group,
+                   ImageExporter::BackendOptions backend_options,
+                   ImageExportSink* sink);
+
   void AddSequencePoint(int32_t id);
 
   // If an element with the given UUID exists, switches to the
@@ -166,6 +194,10 @@ class RootController : public settings::FlagListener {
  private:
   void SetupTools();
 
+  // Returns world_rect if it is non-empty, otherwise the document bounds, or
+  // the current screen view if document bounds are not set.
+  Rect ImageExportBounds(const Rect& world_rect) const;
+
  public:
   std::unique_ptr<UnsafeSceneHelper> unsafe_helper_;
 
@@ -185,6 +217,8 @@ class RootController : public settings::FlagListener {
 
   std::shared_ptr<ISelectionProvider> selection_provider_;
 
+  std::shared_ptr<BulkLoadMetrics> bulk_load_metrics_;
+
   // Pointers to registry.
   std::shared_ptr<input::InputDispatch> input_;
   std::shared_ptr<ToolController> tools_;
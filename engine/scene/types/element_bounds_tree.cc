@@ -0,0 +1,96 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/scene/types/element_bounds_tree.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace ink {
+namespace {
+
+OptRect JoinOpt(const OptRect& a, const OptRect& b) {
+  OptRect result = a;
+  util::AssignOrJoinTo(b, &result);
+  return result;
+}
+
+}  // namespace
+
+void ElementBoundsTree::Set(ElementId id, const Rect& bounds) {
+  auto it = slots_.find(id);
+  uint32_t slot;
+  if (it != slots_.end()) {
+    slot = it->second;
+  } else {
+    if (!free_slots_.empty()) {
+      slot = free_slots_.back();
+      free_slots_.pop_back();
+    } else {
+      if (next_slot_ == capacity_) Grow();
+      slot = next_slot_++;
+    }
+    slots_.emplace(id, slot);
+  }
+  uint32_t node = capacity_ + slot;
+  nodes_[node] = bounds;
+  UpdateAncestors(node);
+}
+
+void ElementBoundsTree::Remove(ElementId id) {
+  auto it = slots_.find(id);
+  if (it == slots_.end()) return;
+  uint32_t slot = it->second;
+  slots_.erase(it);
+  if (slots_.empty()) {
+    // Nothing is left to keep the tree's size for.
+    Clear();
+    return;
+  }
+  free_slots_.push_back(slot);
+  uint32_t node = capacity_ + slot;
+  nodes_[node] = absl::nullopt;
+  UpdateAncestors(node);
+}
+
+const OptRect& ElementBoundsTree::Bounds() const {
+  static const OptRect* empty = new OptRect();
+  return nodes_.size() > 1 ? nodes_[1] : *empty;
+}
+
+void ElementBoundsTree::Clear() {
+  slots_.clear();
+  free_slots_.clear();
+  next_slot_ = 0;
+  capacity_ = 0;
+  nodes_.clear();
+}
+
+void ElementBoundsTree::UpdateAncestors(uint32_t node) {
+  for (node /= 2; node > 0; node /= 2)
+    nodes_[node] = JoinOpt(nodes_[2 * node], nodes_[2 * node + 1]);
+}
+
+void ElementBoundsTree::Grow() {
+  uint32_t new_capacity = std::max<uint32_t>(1, 2 * capacity_);
+  std::vector<OptRect> new_nodes(2 * new_capacity);
+  std::copy(nodes_.begin() + capacity_, nodes_.begin() + 2 * capacity_,
+            new_nodes.begin() + new_capacity);
+  for (uint32_t node = new_capacity - 1; node > 0; --node)
+    new_nodes[node] = JoinOpt(new_nodes[2 * node], new_nodes[2 * node + 1]);
+  nodes_ = std::move(new_nodes);
+  capacity_ = new_capacity;
+}
+
+}  // namespace ink
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INK_ENGINE_SCENE_TYPES_ELEMENT_BOUNDS_TREE_H_
+#define INK_ENGINE_SCENE_TYPES_ELEMENT_BOUNDS_TREE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ink/engine/geometry/primitives/rect.h"
+#include "ink/engine/scene/types/element_id.h"
+
+namespace ink {
+
+// Maintains the union of a set of elements' bounds as they are added, moved
+// and removed.
+//
+// Rect::Join can't be undone, so the bounds are kept in the leaves of a
+// complete binary tree, each of whose nodes holds the union of its children's.
+// Setting or removing an element's bounds updates its leaf's ancestors, which
+// is O(log N), and the union is the root, which is O(1).
+class ElementBoundsTree {
+ public:
+  // Sets the element's bounds, adding the element if it's not in the tree.
+  void Set(ElementId id, const Rect& bounds);
+  // Does nothing if the element is not in the tree.
+  void Remove(ElementId id);
+  bool Contains(ElementId id) const { return slots_.count(id) > 0; }
+  size_t size() const { return slots_.size(); }
+
+  // Returns the union of the elements' bounds, or absl::nullopt if the tree is
+  // empty.
+  const OptRect& Bounds() const;
+
+  void Clear();
+
+ private:
+  void UpdateAncestors(uint32_t node);
+  void Grow();
+
+  // The leaf index of each element.
+  ElementIdHashMap<uint32_t> slots_;
+  // Leaves below next_slot_ that have been freed by Remove().
+  std::vector<uint32_t> free_slots_;
+  uint32_t next_slot_ = 0;
+  // The number of leaves, which is a power of two (or zero).
+  uint32_t capacity_ = 0;
+  // nodes_[1] is the root, the children of nodes_[i] are nodes_[2i] and
+  // nodes_[2i + 1], and the leaf for slot s is nodes_[capacity_ + s].
+  std::vector<OptRect> nodes_;
+};
+
+}  // namespace ink
+
+#endif  // INK_ENGINE_SCENE_TYPES_ELEMENT_BOUNDS_TREE_H_
@@ -20,7 +20,8 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
-#include <list>
+#include <iterator>
+#include <limits>
 #include <utility>
 #include <vector>
 
@@ -34,37 +35,71 @@
 
 namespace ink {
 
-template <typename T, typename H>
-class ElementIndex;
-
-// This class is a closure over ElementIndex state for use in std::sort, etc
-// from ElementIndex within the context of a single function call.
-//
-// WARNING -- Do not keep a reference to this class any longer than the
-// duration of the sort call or it may blow up!
-template <typename IdType, typename Hasher>
-class ZIndexSort {
- public:
-  bool operator()(const IdType& ei1, const IdType& ei2);
-
- private:
-  explicit ZIndexSort(const ElementIndex<IdType, Hasher>* index);
-  const ElementIndex<IdType, Hasher>* index_;
-
-  template <typename T, typename H>
-  friend class ElementIndex;
-};
-
 // Helper for maintaining a sorting on elements
 //
-// Mutations are lazy-evaluated. If possible, don't interleave updates/reads
+// The ordering is stored in an order-statistic tree (a treap, in which each
+// node also knows the size of its subtree), so every mutation, z-index lookup,
+// and step of iteration is O(log N), and interleaving updates and reads is
+// cheap.
 template <typename IdType,
           typename Hasher = typename absl::flat_hash_set<IdType>::hasher>
 class ElementIndex {
+ private:
+  using NodeIndex = uint32_t;
+  static constexpr NodeIndex kNoNode = std::numeric_limits<NodeIndex>::max();
+
  public:
-  typedef Range<typename std::vector<IdType>::const_iterator> const_iterator;
-  typedef Range<typename std::vector<IdType>::const_reverse_iterator>
-      const_reverse_iterator;
+  // Iterates over the ids in z-order, from bottom to top.
+  class Iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = IdType;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const IdType*;
+    using reference = const IdType&;
+
+    Iterator() : index_(nullptr), node_(kNoNode) {}
+
+    reference operator*() const { return index_->nodes_[node_].id; }
+    pointer operator->() const { return &index_->nodes_[node_].id; }
+
+    Iterator& operator++() {
+      node_ = index_->Successor(node_);
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+    Iterator& operator--() {
+      node_ = node_ == kNoNode ? index_->Rightmost(index_->root_)
+                               : index_->Predecessor(node_);
+      return *this;
+    }
+    Iterator operator--(int) {
+      Iterator tmp = *this;
+      --*this;
+      return tmp;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return node_ == other.node_;
+    }
+    bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+   private:
+    Iterator(const ElementIndex* index, NodeIndex node)
+        : index_(index), node_(node) {}
+
+    const ElementIndex* index_;
+    NodeIndex node_;
+
+    friend class ElementIndex;
+  };
+
+  typedef Range<Iterator> const_iterator;
+  typedef Range<std::reverse_iterator<Iterator>> const_reverse_iterator;
 
  public:
   void AddToTop(IdType id);
@@ -85,91 +120,100 @@ class ElementIndex {
   size_t size() const;
 
   void Clear() {
-    id_list_.clear();
-    id_to_list_itr_.clear();
-    is_dense_id_list_dirty_ = false;
-    dense_id_list_cache_.clear();
-    is_id_to_zindex_dirty_ = false;
-    id_to_zindex_cache_.clear();
+    nodes_.clear();
+    free_nodes_.clear();
+    root_ = kNoNode;
+    id_to_node_.clear();
   }
 
   // Iterators are invalid after any non-const call into ElementIndex!
   const_iterator SortedElements() const;
   const_reverse_iterator ReverseSortedElements() const;
 
+  // Sorts the given ids by z-index. All of the ids must be in the index.
   template <class RandomIt>
   void Sort(RandomIt first, RandomIt last) const {
-    EnsureDenseIdCache();
-    ZIndexSort<IdType, Hasher> sorter(this);
-    std::sort(first, last, sorter);
+    std::vector<std::pair<uint32_t, IdType>> z_and_id;
+    z_and_id.reserve(std::distance(first, last));
+    for (auto it = first; it != last; ++it)
+      z_and_id.emplace_back(ZIndexOf(*it), *it);
+    std::sort(z_and_id.begin(), z_and_id.end(),
+              [](const std::pair<uint32_t, IdType>& lhs,
+                 const std::pair<uint32_t, IdType>& rhs) {
+                return lhs.first < rhs.first;
+              });
+    for (const auto& entry : z_and_id) *first++ = entry.second;
   }
 
-  const absl::flat_hash_map<IdType, uint32_t, Hasher>& IdToZIndexMap() const;
+  // Returns the number of ids below the given one. This is O(log N).
   uint32_t ZIndexOf(IdType id) const;
 
  private:
-  void MarkCacheDirty();
-  void EnsureDenseIdCache() const;
-  void EnsureIdToZIndexCache() const;
+  struct Node {
+    IdType id;
+    // The treap is a max-heap on priority.
+    uint32_t priority;
+    // The number of nodes in the subtree rooted at this node.
+    uint32_t size;
+    NodeIndex parent;
+    NodeIndex left;
+    NodeIndex right;
+  };
+
+  NodeIndex NewNode(IdType id);
+  uint32_t SubtreeSize(NodeIndex node) const {
+    return node == kNoNode ? 0 : nodes_[node].size;
+  }
+  void UpdateSize(NodeIndex node) {
+    nodes_[node].size =
+        1 + SubtreeSize(nodes_[node].left) + SubtreeSize(nodes_[node].right);
+  }
+  NodeIndex Leftmost(NodeIndex node) const;
+  NodeIndex Rightmost(NodeIndex node) const;
+  NodeIndex Successor(NodeIndex node) const;
+  NodeIndex Predecessor(NodeIndex node) const;
+
+  // Replaces the link from node's parent (or the root) to node with a link to
+  // replacement.
+  void ReplaceChild(NodeIndex node, NodeIndex replacement);
+  // Rotates node above its parent, preserving the in-order sequence.
+  void RotateUp(NodeIndex node);
+  // Links the new node as the given child of parent (or as the root, if parent
+  // is kNoNode), then restores the heap property.
+  void Attach(NodeIndex node, NodeIndex parent, bool as_left_child);
+  // Inserts the id immediately before the given node, or at the top if node is
+  // kNoNode.
+  void InsertBefore(IdType id, NodeIndex node);
 
  private:
-  // element ids, ordered by z index. Source of truth for ordering
-  std::list<IdType> id_list_;
-
-  // element -> idList_ iterator
-  absl::flat_hash_map<IdType, typename std::list<IdType>::iterator, Hasher>
-      id_to_list_itr_;
-
-  // More efficient, cached versions of "idList_" are lazy updated to avoid
-  // n^2 behavior on multiple adds. isDirty[...]_ tracks the cache state
-  mutable bool is_dense_id_list_dirty_ = false;
-  mutable std::vector<IdType> dense_id_list_cache_;
-  mutable bool is_id_to_zindex_dirty_ = false;
-  mutable absl::flat_hash_map<IdType, uint32_t, Hasher> id_to_zindex_cache_;
-
-  template <typename T, typename H>
-  friend class ZIndexSort;
-};
+  std::vector<Node> nodes_;
+  std::vector<NodeIndex> free_nodes_;
+  NodeIndex root_ = kNoNode;
 
-template <typename IdType, typename Hasher>
-bool ZIndexSort<IdType, Hasher>::operator()(const IdType& ei1,
-                                            const IdType& ei2) {
-  ASSERT(index_->id_to_zindex_cache_.count(ei1) > 0);
-  ASSERT(index_->id_to_zindex_cache_.count(ei2) > 0);
-  return index_->id_to_zindex_cache_[ei1] < index_->id_to_zindex_cache_[ei2];
-}
+  // element -> node in nodes_
+  absl::flat_hash_map<IdType, NodeIndex, Hasher> id_to_node_;
 
-template <typename IdType, typename Hasher>
-ZIndexSort<IdType, Hasher>::ZIndexSort(
-    const ElementIndex<IdType, Hasher>* index)
-    : index_(index) {
-  index_->EnsureIdToZIndexCache();
-}
+  // State of the xorshift generator used to pick node priorities. It is
+  // deterministic, so that the shape of the tree is reproducible.
+  uint32_t priority_state_ = 0x9E3779B9u;
+};
 
 ///////////////////////////////////////////////////////////////////////////////
 
+template <typename IdType, typename Hasher>
+constexpr typename ElementIndex<IdType, Hasher>::NodeIndex
+    ElementIndex<IdType, Hasher>::kNoNode;
+
 template <typename IdType, typename Hasher>
 void ElementIndex<IdType, Hasher>::AddToTop(IdType id) {
   EXPECT(!Contains(id));
-
-  id_list_.push_back(id);
-  id_to_list_itr_[id] =
-      (--id_list_.end());  // iter to the element we just added
-
-  // Special case -- we don't need to dirty our cache, just add this
-  // id to the back of each structure
-  dense_id_list_cache_.push_back(id);
-  id_to_zindex_cache_[id] = dense_id_list_cache_.size() - 1;
+  InsertBefore(id, kNoNode);
 }
 
 template <typename IdType, typename Hasher>
 void ElementIndex<IdType, Hasher>::AddToBottom(IdType id) {
   EXPECT(!Contains(id));
-
-  id_list_.push_front(id);
-  id_to_list_itr_[id] = id_list_.begin();  // iter to the element we just added
-
-  MarkCacheDirty();
+  InsertBefore(id, Leftmost(root_));
 }
 
 template <typename IdType, typename Hasher>
@@ -177,15 +221,12 @@ void ElementIndex<IdType, Hasher>::AddBelow(IdType id_to_add,
                                             IdType add_below_id) {
   EXPECT(!Contains(id_to_add));
 
-  auto itritr = id_to_list_itr_.find(add_below_id);
-  if (itritr == id_to_list_itr_.end()) {
+  auto it = id_to_node_.find(add_below_id);
+  if (it == id_to_node_.end()) {
     RUNTIME_ERROR("attempting to add id $0 below unmapped id: $0!", id_to_add,
                   add_below_id);
   }
-
-  auto new_itr = id_list_.insert(itritr->second, id_to_add);
-  id_to_list_itr_[id_to_add] = new_itr;
-  MarkCacheDirty();
+  InsertBefore(id_to_add, it->second);
 }
 
 template <typename IdType, typename Hasher>
@@ -197,95 +238,216 @@ void ElementIndex<IdType, Hasher>::SetBelow(IdType id_to_modify,
 
 template <typename IdType, typename Hasher>
 void ElementIndex<IdType, Hasher>::Remove(IdType id) {
-  auto itritr = id_to_list_itr_.find(id);
-  if (itritr == id_to_list_itr_.end()) {
+  auto it = id_to_node_.find(id);
+  if (it == id_to_node_.end()) {
     SLOG(SLOG_ERROR, "removing unmapped id: $0!", id);
     return;
   }
+  NodeIndex node = it->second;
+  id_to_node_.erase(it);
+
+  // Rotate the node down until it is a leaf, then unlink it.
+  while (nodes_[node].left != kNoNode || nodes_[node].right != kNoNode) {
+    NodeIndex left = nodes_[node].left;
+    NodeIndex right = nodes_[node].right;
+    if (right == kNoNode ||
+        (left != kNoNode && nodes_[left].priority > nodes_[right].priority)) {
+      RotateUp(left);
+    } else {
+      RotateUp(right);
+    }
+  }
+  NodeIndex parent = nodes_[node].parent;
+  ReplaceChild(node, kNoNode);
+  for (; parent != kNoNode; parent = nodes_[parent].parent)
+    --nodes_[parent].size;
 
-  id_list_.erase(itritr->second);
-  id_to_list_itr_.erase(itritr);
-  MarkCacheDirty();
+  free_nodes_.push_back(node);
 }
 
 template <typename IdType, typename Hasher>
 bool ElementIndex<IdType, Hasher>::Contains(IdType id) const {
-  return id_to_list_itr_.find(id) != id_to_list_itr_.end();
+  return id_to_node_.find(id) != id_to_node_.end();
 }
 
 template <typename IdType, typename Hasher>
 absl::optional<IdType> ElementIndex<IdType, Hasher>::GetIdAbove(
     IdType id) const {
-  auto map_it = id_to_list_itr_.find(id);
-  EXPECT(map_it != id_to_list_itr_.end());
-  auto list_it = map_it->second;
-  ASSERT(list_it != id_list_.end());
-  ++list_it;
-  if (list_it == id_list_.end()) return absl::nullopt;
-  return *list_it;
+  auto it = id_to_node_.find(id);
+  EXPECT(it != id_to_node_.end());
+  NodeIndex above = Successor(it->second);
+  if (above == kNoNode) return absl::nullopt;
+  return nodes_[above].id;
 }
 
 template <typename IdType, typename Hasher>
 size_t ElementIndex<IdType, Hasher>::size() const {
-  return id_list_.size();
+  return id_to_node_.size();
 }
 
 template <typename IdType, typename Hasher>
 typename ElementIndex<IdType, Hasher>::const_iterator
 ElementIndex<IdType, Hasher>::SortedElements() const {
-  EnsureDenseIdCache();
-  return const_iterator(dense_id_list_cache_.begin(),
-                        dense_id_list_cache_.end());
+  return const_iterator(Iterator(this, Leftmost(root_)),
+                        Iterator(this, kNoNode));
 }
 
 template <typename IdType, typename Hasher>
 typename ElementIndex<IdType, Hasher>::const_reverse_iterator
 ElementIndex<IdType, Hasher>::ReverseSortedElements() const {
-  EnsureDenseIdCache();
-  return const_reverse_iterator(dense_id_list_cache_.rbegin(),
-                                dense_id_list_cache_.rend());
+  return const_reverse_iterator(
+      std::reverse_iterator<Iterator>(Iterator(this, kNoNode)),
+      std::reverse_iterator<Iterator>(Iterator(this, Leftmost(root_))));
 }
 
 template <typename IdType, typename Hasher>
-void ElementIndex<IdType, Hasher>::MarkCacheDirty() {
-  is_dense_id_list_dirty_ = true;
-  is_id_to_zindex_dirty_ = true;
+uint32_t ElementIndex<IdType, Hasher>::ZIndexOf(IdType id) const {
+  auto it = id_to_node_.find(id);
+  if (it == id_to_node_.end()) {
+    RUNTIME_ERROR("zindex lookup of unmapped id $0", id);
+  }
+  // The z-index is the number of nodes that precede this one in-order.
+  NodeIndex node = it->second;
+  uint32_t z_index = SubtreeSize(nodes_[node].left);
+  for (NodeIndex parent = nodes_[node].parent; parent != kNoNode;
+       node = parent, parent = nodes_[parent].parent) {
+    if (nodes_[parent].right == node)
+      z_index += SubtreeSize(nodes_[parent].left) + 1;
+  }
+  return z_index;
+}
+
+template <typename IdType, typename Hasher>
+typename ElementIndex<IdType, Hasher>::NodeIndex
+ElementIndex<IdType, Hasher>::NewNode(IdType id) {
+  // xorshift32
+  priority_state_ ^= priority_state_ << 13;
+  priority_state_ ^= priority_state_ >> 17;
+  priority_state_ ^= priority_state_ << 5;
+  Node node{id, priority_state_, 1, kNoNode, kNoNode, kNoNode};
+
+  NodeIndex index;
+  if (free_nodes_.empty()) {
+    index = nodes_.size();
+    nodes_.push_back(node);
+  } else {
+    index = free_nodes_.back();
+    free_nodes_.pop_back();
+    nodes_[index] = node;
+  }
+  return index;
 }
 
 template <typename IdType, typename Hasher>
-void ElementIndex<IdType, Hasher>::EnsureDenseIdCache() const {
-  if (!is_dense_id_list_dirty_) return;
-  dense_id_list_cache_.resize(id_list_.size());
-  std::copy(id_list_.begin(), id_list_.end(), dense_id_list_cache_.begin());
-  is_dense_id_list_dirty_ = false;
+typename ElementIndex<IdType, Hasher>::NodeIndex
+ElementIndex<IdType, Hasher>::Leftmost(NodeIndex node) const {
+  if (node == kNoNode) return kNoNode;
+  while (nodes_[node].left != kNoNode) node = nodes_[node].left;
+  return node;
 }
 
 template <typename IdType, typename Hasher>
-void ElementIndex<IdType, Hasher>::EnsureIdToZIndexCache() const {
-  if (!is_id_to_zindex_dirty_) return;
-  EnsureDenseIdCache();
-  id_to_zindex_cache_.clear();
-  for (size_t i = 0; i < dense_id_list_cache_.size(); i++) {
-    id_to_zindex_cache_[dense_id_list_cache_[i]] = i;
+typename ElementIndex<IdType, Hasher>::NodeIndex
+ElementIndex<IdType, Hasher>::Rightmost(NodeIndex node) const {
+  if (node == kNoNode) return kNoNode;
+  while (nodes_[node].right != kNoNode) node = nodes_[node].right;
+  return node;
+}
+
+template <typename IdType, typename Hasher>
+typename ElementIndex<IdType, Hasher>::NodeIndex
+ElementIndex<IdType, Hasher>::Successor(NodeIndex node) const {
+  if (nodes_[node].right != kNoNode) return Leftmost(nodes_[node].right);
+  NodeIndex parent = nodes_[node].parent;
+  while (parent != kNoNode && nodes_[parent].right == node) {
+    node = parent;
+    parent = nodes_[parent].parent;
   }
-  is_id_to_zindex_dirty_ = false;
+  return parent;
 }
 
 template <typename IdType, typename Hasher>
-const absl::flat_hash_map<IdType, uint32_t, Hasher>&
-ElementIndex<IdType, Hasher>::IdToZIndexMap() const {
-  EnsureIdToZIndexCache();
-  return id_to_zindex_cache_;
+typename ElementIndex<IdType, Hasher>::NodeIndex
+ElementIndex<IdType, Hasher>::Predecessor(NodeIndex node) const {
+  if (nodes_[node].left != kNoNode) return Rightmost(nodes_[node].left);
+  NodeIndex parent = nodes_[node].parent;
+  while (parent != kNoNode && nodes_[parent].left == node) {
+    node = parent;
+    parent = nodes_[parent].parent;
+  }
+  return parent;
 }
 
 template <typename IdType, typename Hasher>
-uint32_t ElementIndex<IdType, Hasher>::ZIndexOf(IdType id) const {
-  EnsureIdToZIndexCache();
-  auto itr = id_to_zindex_cache_.find(id);
-  if (itr == id_to_zindex_cache_.end()) {
-    RUNTIME_ERROR("zindex lookup of unmapped id $0", id);
+void ElementIndex<IdType, Hasher>::ReplaceChild(NodeIndex node,
+                                                NodeIndex replacement) {
+  NodeIndex parent = nodes_[node].parent;
+  if (parent == kNoNode) {
+    root_ = replacement;
+  } else if (nodes_[parent].left == node) {
+    nodes_[parent].left = replacement;
+  } else {
+    nodes_[parent].right = replacement;
+  }
+  if (replacement != kNoNode) nodes_[replacement].parent = parent;
+}
+
+template <typename IdType, typename Hasher>
+void ElementIndex<IdType, Hasher>::RotateUp(NodeIndex node) {
+  NodeIndex parent = nodes_[node].parent;
+  ASSERT(parent != kNoNode);
+  ReplaceChild(parent, node);
+  if (nodes_[parent].left == node) {
+    NodeIndex moved = nodes_[node].right;
+    nodes_[parent].left = moved;
+    if (moved != kNoNode) nodes_[moved].parent = parent;
+    nodes_[node].right = parent;
+  } else {
+    NodeIndex moved = nodes_[node].left;
+    nodes_[parent].right = moved;
+    if (moved != kNoNode) nodes_[moved].parent = parent;
+    nodes_[node].left = parent;
+  }
+  nodes_[parent].parent = node;
+  UpdateSize(parent);
+  UpdateSize(node);
+}
+
+template <typename IdType, typename Hasher>
+void ElementIndex<IdType, Hasher>::Attach(NodeIndex node, NodeIndex parent,
+                                          bool as_left_child) {
+  nodes_[node].parent = parent;
+  if (parent == kNoNode) {
+    root_ = node;
+  } else if (as_left_child) {
+    nodes_[parent].left = node;
+  } else {
+    nodes_[parent].right = node;
+  }
+  for (NodeIndex ancestor = parent; ancestor != kNoNode;
+       ancestor = nodes_[ancestor].parent) {
+    ++nodes_[ancestor].size;
+  }
+  while (nodes_[node].parent != kNoNode &&
+         nodes_[nodes_[node].parent].priority < nodes_[node].priority) {
+    RotateUp(node);
+  }
+}
+
+template <typename IdType, typename Hasher>
+void ElementIndex<IdType, Hasher>::InsertBefore(IdType id, NodeIndex node) {
+  NodeIndex new_node = NewNode(id);
+  id_to_node_[id] = new_node;
+
+  if (node == kNoNode) {
+    // Insert at the top, i.e. as the right child of the rightmost node.
+    NodeIndex rightmost = Rightmost(root_);
+    Attach(new_node, rightmost, false);
+  } else if (nodes_[node].left == kNoNode) {
+    Attach(new_node, node, true);
+  } else {
+    Attach(new_node, Rightmost(nodes_[node].left), false);
   }
-  return itr->second;
 }
 
 }  // namespace ink
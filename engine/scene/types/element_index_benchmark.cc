@@ -0,0 +1,79 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "ink/engine/scene/types/element_index.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "testing/base/public/benchmark.h"
+#include "ink/engine/scene/types/element_id.h"
+
+namespace ink {
+namespace {
+
+// Builds an index of n elements, with z-indices in order of their ids.
+ElementIndex<ElementId, ElementIdHasher> MakeIndex(uint32_t n) {
+  ElementIndex<ElementId, ElementIdHasher> index;
+  for (uint32_t i = 1; i <= n; ++i)
+    index.AddToTop(ElementId(POLY, i));
+  return index;
+}
+
+// Emulates dragging a layer through the z-order: each iteration moves one
+// element, then asks for its new z-index, as the TripleBufferedRenderer does
+// when deciding whether it can draw an element on top of the scene.
+// The argument is the number of elements.
+static void BM_SetBelowThenZIndexOf(benchmark::State &state) {
+  uint32_t n = state.range(0);
+  auto index = MakeIndex(n);
+  ElementId moving(POLY, 1);
+  uint32_t target = 2;
+  while (state.KeepRunning()) {
+    index.SetBelow(moving, ElementId(POLY, target));
+    testing::DoNotOptimize(index.ZIndexOf(moving));
+    target = target == n ? 2 : target + 1;
+  }
+}
+BENCHMARK(BM_SetBelowThenZIndexOf)->Range(1 << 10, 1 << 16);
+
+// As above, but reading back the element above the moved one.
+// The argument is the number of elements.
+static void BM_SetBelowThenGetIdAbove(benchmark::State &state) {
+  uint32_t n = state.range(0);
+  auto index = MakeIndex(n);
+  ElementId moving(POLY, 1);
+  uint32_t target = 2;
+  while (state.KeepRunning()) {
+    index.SetBelow(moving, ElementId(POLY, target));
+    testing::DoNotOptimize(index.GetIdAbove(moving));
+    target = target == n ? 2 : target + 1;
+  }
+}
+BENCHMARK(BM_SetBelowThenGetIdAbove)->Range(1 << 10, 1 << 16);
+
+// Iterates over the whole index in z-order.
+// The argument is the number of elements.
+static void BM_SortedElements(benchmark::State &state) {
+  auto index = MakeIndex(state.range(0));
+  while (state.KeepRunning()) {
+    for (ElementId id : index.SortedElements()) testing::DoNotOptimize(id);
+  }
+  state.SetItemsProcessed(state.iterations() * index.size());
+}
+BENCHMARK(BM_SortedElements)->Range(1 << 10, 1 << 16);
+
+}  // namespace
+}  // namespace ink
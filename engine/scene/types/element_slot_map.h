@@ -0,0 +1,175 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INK_ENGINE_SCENE_TYPES_ELEMENT_SLOT_MAP_H_
+#define INK_ENGINE_SCENE_TYPES_ELEMENT_SLOT_MAP_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ink/engine/scene/types/element_id.h"
+#include "ink/engine/util/dbg/errors.h"
+
+namespace ink {
+
+namespace element_slot_map_internal {
+
+// The number of handles that a page of the handle-to-slot index covers.
+static const uint32_t kPageSize = 1024;
+// Marks a handle that is not in the map.
+static const uint32_t kNoSlot = UINT32_MAX;
+
+}  // namespace element_slot_map_internal
+
+// A map from ElementId to T, for per-element state that is read on hot paths.
+//
+// A lookup indexes a page of the handle-to-slot index by the id's handle, and
+// then the slot, rather than hashing and probing, and values that are read
+// together for one element share a slot, and so a cache line, rather than each
+// living in its own hash map. The root group, kInvalidElementId, has handle 0,
+// and may be stored like any other id.
+//
+// ElementIdSource never reuses handles, so a scene's handles keep growing as
+// elements are added and removed. The map stays compact regardless:
+// - The values live in slots that are recycled through a free list, so there
+//   are only as many slots as the most ids that the map has held at once.
+// - The index is split into pages of kPageSize handles, and a page is released
+//   once none of its handles are in the map. As handles are handed out in
+//   increasing order, the pages of long-removed elements are released, leaving
+//   a null pointer per page.
+//
+// Each slot records the id it holds: a lookup only succeeds if both the handle
+// and the type match.
+//
+// Pointers and references to values are invalidated by inserting an id when
+// there is no free slot.
+template <typename T>
+class ElementSlotMap {
+ public:
+  // Returns the value for the id, or nullptr if it is not in the map.
+  const T* Find(ElementId id) const {
+    uint32_t slot = SlotIndex(id.Handle());
+    if (slot == element_slot_map_internal::kNoSlot || slots_[slot].id != id)
+      return nullptr;
+    return &slots_[slot].value;
+  }
+  T* Find(ElementId id) {
+    return const_cast<T*>(static_cast<const ElementSlotMap*>(this)->Find(id));
+  }
+
+  bool Contains(ElementId id) const { return Find(id) != nullptr; }
+
+  // Returns the value for the id, inserting a default-constructed value if it
+  // is not in the map. If the id's handle is in the map with a different type,
+  // that value is replaced.
+  T& operator[](ElementId id) {
+    using element_slot_map_internal::kNoSlot;
+    using element_slot_map_internal::kPageSize;
+    uint32_t handle = id.Handle();
+    uint32_t slot = SlotIndex(handle);
+    if (slot != kNoSlot) {
+      Slot& existing = slots_[slot];
+      if (existing.id != id) {
+        existing.id = id;
+        existing.value = T();
+      }
+      return existing.value;
+    }
+
+    if (free_slots_.empty()) {
+      slot = slots_.size();
+      slots_.emplace_back();
+    } else {
+      slot = free_slots_.back();
+      free_slots_.pop_back();
+    }
+    slots_[slot].id = id;
+
+    size_t page_index = handle / kPageSize;
+    if (page_index >= pages_.size()) pages_.resize(page_index + 1);
+    if (!pages_[page_index]) pages_[page_index].reset(new Page());
+    Page& page = *pages_[page_index];
+    page.slots[handle % kPageSize] = slot;
+    ++page.size;
+    ++size_;
+    return slots_[slot].value;
+  }
+
+  // Removes the id's value, releasing anything that it owns. Returns false if
+  // the id was not in the map.
+  bool Erase(ElementId id) {
+    using element_slot_map_internal::kNoSlot;
+    using element_slot_map_internal::kPageSize;
+    if (Find(id) == nullptr) return false;
+    uint32_t handle = id.Handle();
+    std::unique_ptr<Page>& page = pages_[handle / kPageSize];
+    uint32_t& slot = page->slots[handle % kPageSize];
+    slots_[slot].value = T();
+    free_slots_.push_back(slot);
+    slot = kNoSlot;
+    ASSERT(page->size > 0);
+    if (--page->size == 0) page.reset();
+    ASSERT(size_ > 0);
+    --size_;
+    return true;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  void Clear() {
+    pages_.clear();
+    slots_.clear();
+    free_slots_.clear();
+    size_ = 0;
+  }
+
+ private:
+  struct Page {
+    Page() { slots.fill(element_slot_map_internal::kNoSlot); }
+
+    // The slot of each handle in the page, or kNoSlot.
+    std::array<uint32_t, element_slot_map_internal::kPageSize> slots;
+    // The number of handles in the page that are in the map.
+    uint32_t size = 0;
+  };
+
+  struct Slot {
+    T value;
+    ElementId id = kInvalidElementId;
+  };
+
+  // Returns the slot of the handle, or kNoSlot.
+  uint32_t SlotIndex(uint32_t handle) const {
+    using element_slot_map_internal::kPageSize;
+    size_t page_index = handle / kPageSize;
+    if (page_index >= pages_.size() || !pages_[page_index])
+      return element_slot_map_internal::kNoSlot;
+    return pages_[page_index]->slots[handle % kPageSize];
+  }
+
+  std::vector<std::unique_ptr<Page>> pages_;
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_slots_;
+  size_t size_ = 0;
+};
+
+}  // namespace ink
+
+#endif  // INK_ENGINE_SCENE_TYPES_ELEMENT_SLOT_MAP_H_
@@ -19,7 +19,7 @@
 
 namespace ink {
 
-bool IdMap::Contains(const UUID& uuid) const {
+bool IdMap::Contains(const InternedUUID& uuid) const {
   return uuid_to_element_.count(uuid) > 0;
 }
 
@@ -27,22 +27,33 @@ bool IdMap::Contains(const ElementId& el_id) const {
   return element_to_uuid_.count(el_id) > 0;
 }
 
-void IdMap::Insert(const UUID& uuid, const ElementId& el_id) {
-  uuid_to_element_.insert(std::pair<UUID, ElementId>(uuid, el_id));
-  element_to_uuid_.insert(std::pair<ElementId, UUID>(el_id, uuid));
+void IdMap::Insert(const InternedUUID& uuid, const ElementId& el_id) {
+  uuid_to_element_.emplace(uuid, el_id);
+  element_to_uuid_.emplace(el_id, uuid);
 }
 
-ElementId IdMap::GetElementId(const UUID& uuid) const {
-  return uuid_to_element_.at(uuid);
+ElementId IdMap::GetElementId(const InternedUUID& uuid) const {
+  ElementId el_id;
+  bool found = FindElementId(uuid, &el_id);
+  ASSERT(found);
+  return found ? el_id : kInvalidElementId;
 }
-UUID IdMap::GetUUID(const ElementId& el_id) const {
+
+bool IdMap::FindElementId(const InternedUUID& uuid, ElementId* el_id) const {
+  auto it = uuid_to_element_.find(uuid);
+  if (it == uuid_to_element_.end()) return false;
+  *el_id = it->second;
+  return true;
+}
+
+const InternedUUID& IdMap::GetUUID(const ElementId& el_id) const {
   return element_to_uuid_.at(el_id);
 }
 
 // Pass copies to avoid erasing refs into our maps while we're using them
-void IdMap::Remove(UUID uuid, ElementId el_id) {
+void IdMap::Remove(InternedUUID uuid, ElementId el_id) {
   ASSERT(Contains(el_id));
-  ASSERT(Contains(uuid));
+  ASSERT(uuid_to_element_.count(uuid) > 0);
   element_to_uuid_.erase(el_id);
   uuid_to_element_.erase(uuid);
 }
@@ -52,7 +63,7 @@ void IdMap::Remove(const ElementId& el_id) {
   Remove(element_to_uuid_.at(el_id), el_id);
 }
 
-void IdMap::Remove(const UUID& uuid) {
+void IdMap::Remove(const InternedUUID& uuid) {
   ASSERT(Contains(uuid));
   Remove(uuid, uuid_to_element_.at(uuid));
 }
@@ -17,38 +17,40 @@
 #ifndef INK_ENGINE_SCENE_TYPES_ID_MAP_H_
 #define INK_ENGINE_SCENE_TYPES_ID_MAP_H_
 
-#include <unordered_map>
-
-#include "ink/engine/public/types/uuid.h"
+#include "ink/engine/public/types/interned_uuid.h"
 #include "ink/engine/scene/types/element_id.h"
 
 namespace ink {
 
-// A bidirectional map between element ids and uuids.
+// A bidirectional map between element ids and uuids. The uuids are interned,
+// so that looking up or copying a uuid doesn't hash or copy its string; the
+// caller interns a uuid once, where it enters the engine (see SceneGraph).
 class IdMap {
  public:
-  bool Contains(const UUID& uuid) const;
+  bool Contains(const InternedUUID& uuid) const;
   bool Contains(const ElementId& el_id) const;
-  void Insert(const UUID& uuid, const ElementId& el_id);
-  ElementId GetElementId(const UUID& uuid) const;
-  UUID GetUUID(const ElementId& el_id) const;
+  void Insert(const InternedUUID& uuid, const ElementId& el_id);
+  ElementId GetElementId(const InternedUUID& uuid) const;
+  // If the uuid is in the map, sets *el_id and returns true. Cheaper than
+  // Contains() followed by GetElementId().
+  bool FindElementId(const InternedUUID& uuid, ElementId* el_id) const;
+  // The returned reference is valid until the element id is removed.
+  const InternedUUID& GetUUID(const ElementId& el_id) const;
   void Remove(const ElementId& el_id);
-  void Remove(const UUID& uuid);
+  void Remove(const InternedUUID& uuid);
 
   // Make IdMap iterable with a for range loop.
-  std::unordered_map<ElementId, UUID, ElementIdHasher>::const_iterator begin()
-      const {
+  ElementIdHashMap<InternedUUID>::const_iterator begin() const {
     return element_to_uuid_.begin();
   }
-  std::unordered_map<ElementId, UUID, ElementIdHasher>::const_iterator end()
-      const {
+  ElementIdHashMap<InternedUUID>::const_iterator end() const {
     return element_to_uuid_.end();
   }
 
  private:
-  void Remove(UUID uuid, ElementId el_id);
-  std::unordered_map<UUID, ElementId> uuid_to_element_;
-  std::unordered_map<ElementId, UUID, ElementIdHasher> element_to_uuid_;
+  void Remove(InternedUUID uuid, ElementId el_id);
+  InternedUUIDHashMap<ElementId> uuid_to_element_;
+  ElementIdHashMap<InternedUUID> element_to_uuid_;
 };
 
 }  // namespace ink
@@ -23,51 +23,49 @@
 namespace ink {
 
 TransformMap::TransformMap() {
-  glm::mat4 identity{1};  // being explicit.
   // Make an "invalid" group. This represents the root.
-  // It should never change. Touch the various data maps
-  // to ensure that it looks like a group.
-  obj_to_group_[kInvalidElementId] = identity;
-  obj_to_world_[kInvalidElementId] = identity;
-  world_to_obj_[kInvalidElementId] = identity;
+  // It should never change, so its transforms stay the identity. Touch
+  // group_to_ids_ to ensure that it looks like a group.
+  entries_[kInvalidElementId].world_version = next_world_version_++;
   group_to_ids_[kInvalidElementId];
-  group_generation_[kInvalidElementId] = 0;
-  last_group_generation_[kInvalidElementId] = 0;
 }
 
-void TransformMap::MaybeRecompute(ElementId id) const {
-  auto group = GetGroup(id);
+TransformMap::Entry& TransformMap::MaybeRecompute(ElementId id) const {
+  Entry* entry = entries_.Find(id);
+  ASSERT(entry != nullptr);
+  const Entry* group = entries_.Find(entry->group);
+  ASSERT(group != nullptr);
   // This is called on every drawing frame for each element to
   // check if it's in the view. We generally shouldn't have to recompute since
   // most elements are static.
-  ASSERT(last_group_generation_.count(id) > 0);
-  ASSERT(group_generation_.count(group) > 0);
-  if (ABSL_PREDICT_TRUE(last_group_generation_[id] ==
-                        group_generation_[group])) {
-    return;
+  if (ABSL_PREDICT_TRUE(entry->group_generation == group->generation)) {
+    return *entry;
   }
-  ASSERT(obj_to_group_.count(id) > 0);
-  auto& local_xform = obj_to_group_.find(id)->second;
-  obj_to_world_[id] = ObjToWorld(group) * local_xform;
-  world_to_obj_[id] = glm::inverse(obj_to_world_[id]);
-  last_group_generation_[id] = group_generation_[group];
+  // Groups only belong to the root, which never changes, so the group's own
+  // transform is already up to date.
+  entry->obj_to_world = group->obj_to_world * entry->obj_to_group;
+  entry->world_to_obj = glm::inverse(entry->obj_to_world);
+  entry->group_generation = group->generation;
+  entry->world_version = next_world_version_++;
+  return *entry;
 }
 
 const glm::mat4& TransformMap::ObjToWorld(ElementId id) const {
-  MaybeRecompute(id);
-  ASSERT(obj_to_world_.count(id) > 0);
-  return obj_to_world_.find(id)->second;
+  return MaybeRecompute(id).obj_to_world;
 }
 
 const glm::mat4& TransformMap::ObjToGroup(ElementId id) const {
-  ASSERT(obj_to_group_.count(id) > 0);
-  return obj_to_group_.find(id)->second;
+  const Entry* entry = entries_.Find(id);
+  ASSERT(entry != nullptr);
+  return entry->obj_to_group;
 }
 
 const glm::mat4& TransformMap::WorldToObj(ElementId id) const {
-  MaybeRecompute(id);
-  ASSERT(world_to_obj_.count(id) > 0);
-  return world_to_obj_.find(id)->second;
+  return MaybeRecompute(id).world_to_obj;
+}
+
+uint64_t TransformMap::WorldTransformVersion(ElementId id) const {
+  return MaybeRecompute(id).world_version;
 }
 
 void TransformMap::Set(ElementId id, glm::mat4 obj_to_group) {
@@ -77,74 +75,72 @@ void TransformMap::Set(ElementId id, glm::mat4 obj_to_group) {
 void TransformMap::Set(ElementId id, GroupId group, glm::mat4 obj_to_group) {
   ASSERT(id != kInvalidElementId);
 
-  obj_to_group_[id] = obj_to_group;
+  // Note: root = kInvalidElementId
+  // non-GROUPs can group to GROUPs or the root.
+  // GROUPs can only group to the root.
+  ASSERT(group == kInvalidElementId || group.Type() == GROUP);
+  // Ensure that the group is defined.
+  ASSERT(Contains(group));
+
+  // Inserting the entry may move the others, so the group's entry is only
+  // looked up afterwards.
+  Entry& entry = entries_[id];
+  const Entry& group_entry = *entries_.Find(group);
+  entry.obj_to_group = obj_to_group;
 
   if (id.Type() == GROUP) {
     // Defers updating children until necessary. Over optimized? Just update
     // all children? That defeats the purpose of group translations...
-    group_generation_[id]++;
+    entry.generation++;
     // Touch group_to_ids_ such that it exists.
     group_to_ids_[id];
   }
 
-  // Note: root = kInvalidElementId
-  // non-GROUPs can group to GROUPs or the root.
-  // GROUPs can only group to the root.
-  ASSERT(group == kInvalidElementId || group.Type() == GROUP);
-  // Ensure that the group is defined.
-  ASSERT(Contains(group) > 0);
-
-  // Handle potential regrouping.
-  auto old_group = id_to_group_.find(id);
-  if (old_group != id_to_group_.end() && old_group->second != group) {
+  // Handle potential regrouping. A new entry starts out in the root, without
+  // being in the root's list, so erasing it from there is harmless.
+  if (entry.group != group) {
     // We had an old group. Erase this id from its old group's list.
-    group_to_ids_[id_to_group_[id]].erase(id);
+    group_to_ids_[entry.group].erase(id);
   }
   // Set the new group information.
-  id_to_group_[id] = group;
+  entry.group = group;
   group_to_ids_[group].insert(id);
 
   // Generate the new ObjToWorld immediately.
-  obj_to_world_[id] = ObjToWorld(group) * obj_to_group_[id];
-  world_to_obj_[id] = glm::inverse(obj_to_world_[id]);
+  entry.obj_to_world = group_entry.obj_to_world * entry.obj_to_group;
+  entry.world_to_obj = glm::inverse(entry.obj_to_world);
+  entry.world_version = next_world_version_++;
 
   // Store the generation we have of the group. We've already stored the
   // current value of the transform so we don't need to recalculate it until
   // the group changes.
-  last_group_generation_[id] = group_generation_[group];
+  entry.group_generation = group_entry.generation;
 }
 
 GroupId TransformMap::GetGroup(ElementId id) const {
-  auto it = id_to_group_.find(id);
-  if (it == id_to_group_.end()) {
+  const Entry* entry = entries_.Find(id);
+  if (entry == nullptr) {
     return kInvalidElementId;
   }
-  return it->second;
+  return entry->group;
 }
 
 void TransformMap::Remove(ElementId id) {
-  world_to_obj_.erase(id);
-  obj_to_world_.erase(id);
-  obj_to_group_.erase(id);
-  if (id_to_group_.count(id) > 0) {
-    group_to_ids_[id_to_group_[id]].erase(id);
+  const Entry* entry = entries_.Find(id);
+  if (entry != nullptr) {
+    group_to_ids_[entry->group].erase(id);
   }
-  id_to_group_.erase(id);
   if (id.Type() == GROUP) {
     // There better be no elements that depend on us
     // as a group...
     ASSERT(group_to_ids_[id].empty());
     group_to_ids_.erase(id);
   }
-  last_group_generation_.erase(id);
+  entries_.Erase(id);
 }
 
 bool TransformMap::Contains(ElementId id) const {
-  bool res = obj_to_world_.count(id) > 0;
-  // The inverse and the obj to group should always be present.
-  ASSERT((world_to_obj_.count(id) > 0) == res);
-  ASSERT((obj_to_group_.count(id) > 0) == res);
-  return res;
+  return entries_.Contains(id);
 }
 
 const absl::flat_hash_set<ElementId, ElementIdHasher>&
@@ -23,6 +23,7 @@
 #include "third_party/absl/container/flat_hash_set.h"
 #include "third_party/glm/glm/glm.hpp"
 #include "ink/engine/scene/types/element_id.h"
+#include "ink/engine/scene/types/element_slot_map.h"
 
 namespace ink {
 
@@ -55,6 +56,10 @@ class TransformMap {
   const glm::mat4& WorldToObj(ElementId id) const;
   // Returns if we have a transform associated with this element or group.
   bool Contains(ElementId id) const;
+  // Returns a value that changes whenever the element's ObjToWorld transform
+  // does, whether the element or its group was moved, so that values derived
+  // from ObjToWorld can be cached. Versions are never 0.
+  uint64_t WorldTransformVersion(ElementId id) const;
 
   // Set the element's object to group transform, keeping its current group.
   // Just a short hand for Set(id, transform_map.GetGroup(id), obj_to_group);
@@ -80,33 +85,37 @@ class TransformMap {
       GroupId group) const;
 
  private:
-  // Potentially recompute the objtoworld transform for the given element.
-  // The const-ness is a lie. It will work on the mutable attributes below.
-  // Called by ObjToWorld and WorldToObj.
-  void MaybeRecompute(ElementId id) const;
+  struct Entry {
+    // object to world transform, and its inverse. These may be recomputed on
+    // the fly if the generation of the element's group changed.
+    glm::mat4 obj_to_world{1};
+    glm::mat4 world_to_obj{1};
+    // object to group transform. All elements have a group, though in
+    // the "non-group" case, that group can be kInvalidElementId, which will
+    // have an identity transform. In that case, objtogroup == objtoworld.
+    glm::mat4 obj_to_group{1};
+    // All elements have a group, though that group may be kInvalidElementId
+    // to indicate the group is the root.
+    GroupId group = kInvalidElementId;
+    // For groups, the latest generation, which is incremented whenever the
+    // group's transform changes. Used to invalidate the children's
+    // obj_to_world.
+    uint64_t generation = 0;
+    // The generation of the group when obj_to_world was computed.
+    uint64_t group_generation = 0;
+    // See WorldTransformVersion().
+    uint64_t world_version = 0;
+  };
 
-  // Map of group group -> latest generation id. Used to invalidate
-  // the obj to world map.
-  mutable GroupIdHashMap<uint64_t> group_generation_;
-  // Map of the element id -> group generation stored. Used to invalidate
-  // the obj to world map.
-  mutable ElementIdHashMap<uint64_t> last_group_generation_;
-  // object to world transform. This may be computed on the fly if
-  // the group generation changed for the group of a given element.
-  // mutable because we're treating this as a cache.
-  mutable ElementIdHashMap<glm::mat4> obj_to_world_;
-  // world to object trasnsform. This may be computed on the fly if
-  // the group generation changed for the group of a given element.
-  // mutable because we're treating this as a cache.
-  mutable ElementIdHashMap<glm::mat4> world_to_obj_;
+  // Potentially recompute the objtoworld transform for the given element.
+  // The const-ness is a lie. It will work on the mutable entries below.
+  // Called by ObjToWorld and WorldToObj. Returns the element's entry.
+  Entry& MaybeRecompute(ElementId id) const;
 
-  // object to group transform. All elements have a group, though in
-  // the "non-group" case, that group can be kInvalidElementId, which will
-  // have an identity transform. In that case, objtogroup == objtoworld.
-  ElementIdHashMap<glm::mat4> obj_to_group_;
-  // element id to group group id. All elements have a group, though
-  // that group may be kInvalidElementId to indicate the group is the root.
-  ElementIdHashMap<GroupId> id_to_group_;
+  // The transforms and groups of every element, and of the root. The entries
+  // are mutable because obj_to_world and world_to_obj are treated as a cache.
+  mutable ElementSlotMap<Entry> entries_;
+  mutable uint64_t next_world_version_ = 1;
   // This lets us quickly find out the set of elements for a given group.
   GroupIdHashMap<absl::flat_hash_set<ElementId, ElementIdHasher>> group_to_ids_;
 };
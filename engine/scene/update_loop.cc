@@ -14,6 +14,8 @@
 
 #include "ink/engine/scene/update_loop.h"
 
+#include "ink/engine/util/dbg/trace.h"
+
 namespace ink {
 
 DefaultUpdateLoop::DefaultUpdateLoop(
@@ -37,13 +39,23 @@ void DefaultUpdateLoop::Update(float target_fps, FrameTimeS t) {
   target_update_time = std::max(target_update_time, 1.0 / 1000);
   Timer update_timer(clock_, target_update_time);
 
+  INK_TRACE_EVENT("frame", "DefaultUpdateLoop::Update");
   logging_timer_->Begin();
   anim_->UpdateAnimations();
-  tasks_->ServiceMainThreadTasks();
+  {
+    INK_TRACE_EVENT("frame", "ITaskRunner::ServiceMainThreadTasks");
+    tasks_->ServiceMainThreadTasks();
+  }
   graph_->Update(*cam_);
-  tools_->Update(*cam_, t);
+  {
+    INK_TRACE_EVENT("frame", "ToolController::Update");
+    tools_->Update(*cam_, t);
+  }
   particle_manager_->Update(t);
-  graph_renderer_->Update(update_timer, *cam_, t);
+  {
+    INK_TRACE_EVENT("frame", "LiveRenderer::Update");
+    graph_renderer_->Update(update_timer, *cam_, t);
+  }
   crop_mode_->Update(*cam_);
   cursor_manager_->Update(*cam_);
   debug_view_->Update(t);
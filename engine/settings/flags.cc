@@ -91,6 +91,18 @@ void Flags::SetFlag(proto::Flag proto_flag, bool value) {
     case proto::Flag::ENABLE_PARTIAL_DRAW:
       flag = settings::Flag::EnablePartialDraw;
       break;
+    case proto::Flag::ENABLE_PARALLEL_TASK_EXECUTION:
+      flag = settings::Flag::EnableParallelTaskExecution;
+      break;
+    case proto::Flag::KEEP_TEXTURES_IN_CPU_MEMORY:
+      flag = settings::Flag::KeepTexturesInCpuMemory;
+      break;
+    case proto::Flag::ENABLE_TRACING:
+      flag = settings::Flag::EnableTracing;
+      break;
+    case proto::Flag::ENABLE_INCREMENTAL_TESSELLATION:
+      flag = settings::Flag::EnableIncrementalTessellation;
+      break;
     case proto::Flag::UNKNOWN:
       SLOG(SLOG_ERROR, "Unknown flag.");
       return;
@@ -152,6 +164,18 @@ proto::Flag Flags::GetProtoFlag(settings::Flag which) {
     case settings::Flag::EnablePartialDraw:
       flag = proto::Flag::ENABLE_PARTIAL_DRAW;
       break;
+    case settings::Flag::EnableParallelTaskExecution:
+      flag = proto::Flag::ENABLE_PARALLEL_TASK_EXECUTION;
+      break;
+    case settings::Flag::KeepTexturesInCpuMemory:
+      flag = proto::Flag::KEEP_TEXTURES_IN_CPU_MEMORY;
+      break;
+    case settings::Flag::EnableTracing:
+      flag = proto::Flag::ENABLE_TRACING;
+      break;
+    case settings::Flag::EnableIncrementalTessellation:
+      flag = proto::Flag::ENABLE_INCREMENTAL_TESSELLATION;
+      break;
   }
   return flag;
 }
@@ -52,6 +52,10 @@ enum class Flag : uint32_t {
   EnableMotionBlur,
   EnableSelectionBoxHandles,
   EnablePartialDraw,
+  EnableParallelTaskExecution,
+  KeepTexturesInCpuMemory,
+  EnableTracing,
+  EnableIncrementalTessellation,
 };
 //     ../../proto/sengine.proto,
 //     flags.cc)
@@ -0,0 +1,235 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/engine/util/dbg/trace.h"
+
+#include <chrono>  // NOLINT
+#include <memory>
+#include <vector>
+
+#include "third_party/absl/strings/str_format.h"
+#include "third_party/absl/strings/substitute.h"
+#include "third_party/absl/synchronization/mutex.h"
+
+namespace ink {
+namespace trace {
+namespace {
+
+struct Event {
+  const char* category;
+  const char* name;
+  int64_t start_ns;
+  int64_t duration_ns;
+  int tid;
+};
+
+// The events recorded by one thread. Only that thread writes to the buffer, so
+// the mutex is only contended while the trace is exported or cleared.
+//
+// When a thread exits, its buffer is returned to the registry, and given to
+// the next new thread, so that threads that come and go don't each keep a
+// buffer. Each event remembers the thread that recorded it.
+struct ThreadBuffer {
+  absl::Mutex mutex;
+  std::vector<Event> events GUARDED_BY(mutex);
+  // The index at which the next event is written, once the buffer is full.
+  size_t next GUARDED_BY(mutex) = 0;
+};
+
+struct ThreadName {
+  int tid;
+  const char* name;
+};
+
+class Registry {
+ public:
+  std::shared_ptr<ThreadBuffer> AcquireBuffer() {
+    absl::MutexLock lock(&mutex_);
+    if (!free_buffers_.empty()) {
+      auto buffer = std::move(free_buffers_.back());
+      free_buffers_.pop_back();
+      return buffer;
+    }
+    buffers_.push_back(std::make_shared<ThreadBuffer>());
+    return buffers_.back();
+  }
+
+  void ReleaseBuffer(std::shared_ptr<ThreadBuffer> buffer) {
+    absl::MutexLock lock(&mutex_);
+    free_buffers_.push_back(std::move(buffer));
+  }
+
+  int NewThreadId() {
+    absl::MutexLock lock(&mutex_);
+    return next_tid_++;
+  }
+
+  void SetThreadName(int tid, const char* name) {
+    absl::MutexLock lock(&mutex_);
+    for (auto& thread_name : thread_names_) {
+      if (thread_name.tid == tid) {
+        thread_name.name = name;
+        return;
+      }
+    }
+    thread_names_.push_back({tid, name});
+  }
+
+  std::vector<std::shared_ptr<ThreadBuffer>> Buffers() const {
+    absl::MutexLock lock(&mutex_);
+    return buffers_;
+  }
+
+  std::vector<ThreadName> ThreadNames() const {
+    absl::MutexLock lock(&mutex_);
+    return thread_names_;
+  }
+
+ private:
+  mutable absl::Mutex mutex_;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_ GUARDED_BY(mutex_);
+  std::vector<std::shared_ptr<ThreadBuffer>> free_buffers_ GUARDED_BY(mutex_);
+  std::vector<ThreadName> thread_names_ GUARDED_BY(mutex_);
+  int next_tid_ GUARDED_BY(mutex_) = 1;
+};
+
+Registry* GetRegistry() {
+  // Never destroyed, so that threads may record events during static
+  // destruction.
+  static Registry* registry = new Registry();
+  return registry;
+}
+
+// The calling thread's id and buffer. The buffer is only acquired once the
+// thread records an event, and is released when the thread exits.
+class CurrentThread {
+ public:
+  CurrentThread() : tid_(GetRegistry()->NewThreadId()) {}
+  ~CurrentThread() {
+    if (buffer_) GetRegistry()->ReleaseBuffer(std::move(buffer_));
+  }
+
+  int Tid() const { return tid_; }
+
+  ThreadBuffer* Buffer() {
+    if (!buffer_) buffer_ = GetRegistry()->AcquireBuffer();
+    return buffer_.get();
+  }
+
+ private:
+  int tid_;
+  std::shared_ptr<ThreadBuffer> buffer_;
+};
+
+CurrentThread& GetCurrentThread() {
+  static thread_local CurrentThread current_thread;
+  return current_thread;
+}
+
+using Clock = std::chrono::steady_clock;
+
+Clock::time_point Epoch() {
+  static const Clock::time_point epoch = Clock::now();
+  return epoch;
+}
+
+}  // namespace
+
+namespace internal {
+
+std::atomic<bool> enabled(false);
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                              Epoch())
+      .count();
+}
+
+void Record(const char* category, const char* name, int64_t start_ns,
+            int64_t end_ns) {
+  CurrentThread& thread = GetCurrentThread();
+  ThreadBuffer* buffer = thread.Buffer();
+  Event event{category, name, start_ns, end_ns - start_ns, thread.Tid()};
+  absl::MutexLock lock(&buffer->mutex);
+  if (buffer->events.size() < static_cast<size_t>(kEventsPerThread)) {
+    buffer->events.push_back(event);
+  } else {
+    buffer->events[buffer->next] = event;
+    buffer->next = (buffer->next + 1) % buffer->events.size();
+  }
+}
+
+}  // namespace internal
+
+void SetEnabled(bool enabled) {
+  // Fix the epoch before any event starts.
+  Epoch();
+  internal::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void SetCurrentThreadName(const char* name) {
+  GetRegistry()->SetThreadName(GetCurrentThread().Tid(), name);
+}
+
+void Clear() {
+  for (const auto& buffer : GetRegistry()->Buffers()) {
+    absl::MutexLock lock(&buffer->mutex);
+    buffer->events.clear();
+    buffer->next = 0;
+  }
+}
+
+std::string ExportChromeTraceJson() {
+  std::string json = "{\"traceEvents\": [";
+  bool first = true;
+  auto separate = [&json, &first]() {
+    json.append(first ? "\n" : ",\n");
+    first = false;
+  };
+
+  for (const auto& thread_name : GetRegistry()->ThreadNames()) {
+    separate();
+    absl::SubstituteAndAppend(
+        &json,
+        R"({"name": "thread_name", "ph": "M", "pid": 1, "tid": $0, )"
+        R"("args": {"name": "$1"}})",
+        thread_name.tid, thread_name.name);
+  }
+
+  std::vector<Event> events;
+  for (const auto& buffer : GetRegistry()->Buffers()) {
+    absl::MutexLock lock(&buffer->mutex);
+    // Oldest first.
+    events.insert(events.end(), buffer->events.begin() + buffer->next,
+                  buffer->events.end());
+    events.insert(events.end(), buffer->events.begin(),
+                  buffer->events.begin() + buffer->next);
+  }
+  for (const Event& event : events) {
+    separate();
+    // Substitute() would round the timestamps to six significant digits.
+    absl::StrAppendFormat(
+        &json,
+        R"({"name": "%s", "cat": "%s", "ph": "X", "ts": %.3f, "dur": %.3f, )"
+        R"("pid": 1, "tid": %d})",
+        event.name, event.category, event.start_ns / 1e3,
+        event.duration_ns / 1e3, event.tid);
+  }
+
+  json.append("\n], \"displayTimeUnit\": \"ms\"}\n");
+  return json;
+}
+
+}  // namespace trace
+}  // namespace ink
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INK_ENGINE_UTIL_DBG_TRACE_H_
+#define INK_ENGINE_UTIL_DBG_TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Records a trace event that covers the rest of the enclosing scope. category
+// and name must be string literals (or otherwise outlive the trace), and
+// should not need escaping in JSON, e.g.:
+//   INK_TRACE_EVENT("render", "TripleBufferedRenderer::DrawToBack");
+// When tracing is disabled, this costs a relaxed atomic load.
+#define INK_TRACE_EVENT(category, name)                                  \
+  ::ink::trace::ScopedEvent INK_TRACE_CONCAT_(ink_trace_event_, __LINE__)( \
+      category, name)
+
+#define INK_TRACE_CONCAT_INNER_(x, y) x##y
+#define INK_TRACE_CONCAT_(x, y) INK_TRACE_CONCAT_INNER_(x, y)
+
+namespace ink {
+namespace trace {
+
+namespace internal {
+extern std::atomic<bool> enabled;
+
+// Returns the time, in nanoseconds, since tracing was first used.
+int64_t NowNs();
+
+void Record(const char* category, const char* name, int64_t start_ns,
+            int64_t end_ns);
+}  // namespace internal
+
+// The most recent events that each thread keeps. Older events are overwritten.
+constexpr int kEventsPerThread = 16384;
+
+// Tracing is process-wide, and is disabled until this is called. It is usually
+// toggled with the ENABLE_TRACING flag. Disabling tracing keeps the events
+// recorded so far, and events that began while tracing was enabled are still
+// recorded when they end.
+void SetEnabled(bool enabled);
+
+inline bool IsEnabled() {
+  return internal::enabled.load(std::memory_order_relaxed);
+}
+
+// Names the calling thread in exported traces. name must outlive the trace.
+void SetCurrentThreadName(const char* name);
+
+// Discards all recorded events.
+void Clear();
+
+// Returns the recorded events, from every thread, in Chrome's trace event
+// format, which can be loaded by chrome://tracing or Perfetto. Timestamps are
+// in microseconds.
+std::string ExportChromeTraceJson();
+
+// Records a "complete" event from construction to destruction, if tracing was
+// enabled when it was constructed. Prefer INK_TRACE_EVENT.
+class ScopedEvent {
+ public:
+  ScopedEvent(const char* category, const char* name)
+      : category_(category),
+        name_(name),
+        start_ns_(IsEnabled() ? internal::NowNs() : -1) {}
+  ~ScopedEvent() {
+    if (start_ns_ >= 0)
+      internal::Record(category_, name_, start_ns_, internal::NowNs());
+  }
+
+  // Disallow copy and assign.
+  ScopedEvent(const ScopedEvent&) = delete;
+  ScopedEvent& operator=(const ScopedEvent&) = delete;
+
+ private:
+  const char* category_;
+  const char* name_;
+  int64_t start_ns_;
+};
+
+}  // namespace trace
+}  // namespace ink
+
+#endif  // INK_ENGINE_UTIL_DBG_TRACE_H_
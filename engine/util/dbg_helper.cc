@@ -127,8 +127,8 @@ void DbgHelper::DrawSkeleton(const Camera& cam, FrameTimeS draw_time,
   if (point_color.a > 0) {
     float width_world =
         cam.ConvertDistance(4.0f, DistanceType::kDp, DistanceType::kWorld);
-    for (const auto& vertex : mesh.verts) {
-      DrawPoint(cam, draw_time, vertex.position, point_color, width_world);
+    for (const auto& position : mesh.verts.Positions()) {
+      DrawPoint(cam, draw_time, position, point_color, width_world);
     }
   }
 }
@@ -181,8 +181,8 @@ void DbgHelper::AddMeshSkeleton(const Mesh& m, glm::vec4 edge_color,
   skeleton.mesh = m;
   skeleton.edge_color = edge_color;
   skeleton.point_color = point_color;
-  for (auto& vertex : skeleton.mesh.verts)
-    vertex.position = geometry::Transform(vertex.position, m.object_matrix);
+  for (auto& position : *skeleton.mesh.verts.MutablePositions())
+    position = geometry::Transform(position, m.object_matrix);
   skeleton.mesh.object_matrix = glm::mat4{1};
   skeletons_.insert(std::make_pair(id, skeleton));
 }
@@ -202,8 +202,8 @@ void DbgHelper::Remove(uint32_t id) {
 void DbgHelper::AddMesh(const Mesh& m, glm::vec4 color, uint32_t id) {
   auto pair = meshes_.emplace(id, Mesh());
   pair->second = m;
-  for (auto& v : pair->second.verts) {
-    v.color = color;
+  for (auto& c : *pair->second.verts.MutableColors()) {
+    c = color;
   }
   gl_resources_->mesh_vbo_provider->GenVBOs(&pair->second, GL_DYNAMIC_DRAW);
 }
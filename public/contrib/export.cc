@@ -44,8 +44,8 @@ bool ink::contrib::ExtractTextBox(const ink::proto::ElementBundle& bundle,
   float min_y = std::numeric_limits<float>::max();
   float max_x = std::numeric_limits<float>::lowest();
   float max_y = std::numeric_limits<float>::lowest();
-  for (const auto& vert : mesh.verts) {
-    auto pt = ink::geometry::Transform(vert.position, transform);
+  for (const auto& position : mesh.verts.Positions()) {
+    auto pt = ink::geometry::Transform(position, transform);
     min_x = std::min(min_x, pt.x);
     min_y = std::min(min_y, pt.y);
     max_x = std::max(max_x, pt.x);
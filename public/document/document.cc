@@ -616,6 +616,7 @@ size_t Document::GetElementCount() const {
 
 void Document::SetPreferredThread() { _thread_validator.Reset(); }
 
+// Subclasses that can maintain an IncrementalFingerprint override this.
 uint64_t Document::GetFingerprint() const {
   return ink::GetFingerprint(
       GetSnapshot(SnapshotQuery::DO_NOT_INCLUDE_UNDO_STACK));
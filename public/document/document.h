@@ -17,6 +17,7 @@
 #ifndef INK_PUBLIC_DOCUMENT_DOCUMENT_H_
 #define INK_PUBLIC_DOCUMENT_DOCUMENT_H_
 
+#include <atomic>
 #include <cstdint>  // uint64_t
 #include <memory>
 #include <utility>  // std::pair
@@ -174,9 +175,29 @@ class Document : public IElementListener,
   virtual bool SupportsQuerying() { return false; }
   virtual proto::PageProperties GetPageProperties() const;
 
-  // Retrieves a 64-bit (MD5-based) fingerprint of this document.
-  // This is compatible with the fingerprint generated by the SEngine's
-  // image export.
+  // Determines how GetFingerprint() is computed. The default is kLegacy, so
+  // that hosts that compare fingerprints with stored or exported ones keep
+  // working; hosts that only compare fingerprints of the same document over
+  // time may opt in to kIncremental. The engine itself never calls
+  // GetFingerprint(); web hosts opt in through the JS bindings, with
+  // document.SetFingerprintMode(FingerprintMode.INCREMENTAL).
+  enum class FingerprintMode {
+    // An order-independent fingerprint of the live elements (see
+    // IncrementalFingerprint), which Documents whose storage supports it keep
+    // up to date as the document changes, so that it is retrieved in O(1).
+    // Documents that cannot do so fall back to kLegacy. The values differ
+    // from kLegacy's.
+    kIncremental,
+    // The MD5-based fingerprint that is stored in Snapshots. This is compatible
+    // with the fingerprint generated by the SEngine's image export, but
+    // computing it requires building a Snapshot of the document.
+    kLegacy,
+  };
+  void SetFingerprintMode(FingerprintMode mode) { fingerprint_mode_ = mode; }
+  FingerprintMode GetFingerprintMode() const { return fingerprint_mode_; }
+
+  // Retrieves a 64-bit fingerprint of this document, as determined by the
+  // FingerprintMode.
   virtual uint64_t GetFingerprint() const;
 
   // GetSnapshot builds a proto representation of the contents of this Document,
@@ -397,6 +418,7 @@ class Document : public IElementListener,
   std::shared_ptr<EventDispatch<IMutationListener>> mutation_dispatch_;
   std::shared_ptr<EventDispatch<IActiveLayerListener>> active_layer_dispatch_;
   CurrentThreadValidator _thread_validator;
+  std::atomic<FingerprintMode> fingerprint_mode_{FingerprintMode::kLegacy};
 
   // Make ProtoTraits a friend so that it can call the various SetElement*Impl
   // protected methods.
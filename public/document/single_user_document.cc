@@ -18,6 +18,7 @@
 #include "third_party/absl/memory/memory.h"
 #include "third_party/absl/strings/substitute.h"
 #include "ink/engine/public/types/status.h"
+#include "ink/engine/util/dbg/trace.h"
 #include "ink/engine/util/proto/serialize.h"
 #include "ink/public/document/storage/document_storage.h"
 
@@ -45,6 +46,7 @@ SingleUserDocument::CreateWithPageProperties(
     return ErrorStatus(StatusCode::INVALID_ARGUMENT,
                        "$0 does not support Snapshot load", *storage);
   }
+  INK_TRACE_EVENT("document", "SingleUserDocument::CreateFromSnapshot");
   auto doc = absl::make_unique<SingleUserDocument>(std::move(storage));
   INK_RETURN_UNLESS(doc->storage_->ReadFromProto(snapshot));
   doc->undo_.ReadFromProto(snapshot);
@@ -52,6 +54,24 @@ SingleUserDocument::CreateWithPageProperties(
   return OkStatus();
 }
 
+/* static */ S_WARN_UNUSED_RESULT Status
+SingleUserDocument::CreateFromSnapshotReader(
+    std::shared_ptr<DocumentStorage> storage, const SnapshotReader& reader,
+    std::unique_ptr<Document>* out) {
+  if (!storage->SupportsSnapshot()) {
+    return ErrorStatus(StatusCode::INVALID_ARGUMENT,
+                       "$0 does not support Snapshot load", *storage);
+  }
+  INK_TRACE_EVENT("document",
+                  "SingleUserDocument::CreateFromSnapshotReader");
+  auto doc = absl::make_unique<SingleUserDocument>(std::move(storage));
+  INK_RETURN_UNLESS(doc->storage_->ReadFromSnapshotReader(reader));
+  // The undo and redo stacks are in the header.
+  doc->undo_.ReadFromProto(reader.Header());
+  *out = std::move(doc);
+  return OkStatus();
+}
+
 void SingleUserDocument::MaybeNotifyEmptyStateChanged() {
   bool empty = storage_->IsEmpty();
   if (last_reported_empty_state_ != empty) {
@@ -61,6 +81,7 @@ void SingleUserDocument::MaybeNotifyEmptyStateChanged() {
 }
 
 void SingleUserDocument::Undo() {
+  INK_TRACE_EVENT("document", "SingleUserDocument::Undo");
   absl::MutexLock lock(&mutex_);
   if (!UnsafeCanUndo()) {
     SLOG(SLOG_ERROR, "cannot undo");
@@ -71,6 +92,7 @@ void SingleUserDocument::Undo() {
 }
 
 void SingleUserDocument::Redo() {
+  INK_TRACE_EVENT("document", "SingleUserDocument::Redo");
   absl::MutexLock lock(&mutex_);
   if (!UnsafeCanRedo()) {
     SLOG(SLOG_ERROR, "cannot redo");
@@ -96,13 +118,43 @@ void SingleUserDocument::SetUndoEnabled(bool enabled) {
   undo_.SetEnabled(enabled);
 }
 
+void SingleUserDocument::SetUndoHistoryPolicy(
+    const UndoManager::HistoryPolicy& policy) {
+  absl::MutexLock lock(&mutex_);
+  undo_.SetHistoryPolicy(policy);
+}
+
+size_t SingleUserDocument::UndoHistoryBytes() const {
+  absl::MutexLock lock(&mutex_);
+  return undo_.MemoryBytes();
+}
+
 bool SingleUserDocument::UnsafeCanUndo() const { return undo_.CanUndo(); }
 
 bool SingleUserDocument::UnsafeCanRedo() const { return undo_.CanRedo(); }
 
+uint64_t SingleUserDocument::GetFingerprint() const {
+  if (GetFingerprintMode() == FingerprintMode::kIncremental) {
+    absl::MutexLock lock(&mutex_);
+    if (storage_->SupportsLiveElementStats())
+      return storage_->LiveElementFingerprint();
+  }
+  return Document::GetFingerprint();
+}
+
+size_t SingleUserDocument::GetElementCount() const {
+  {
+    absl::MutexLock lock(&mutex_);
+    if (storage_->SupportsLiveElementStats())
+      return storage_->LiveElementCount();
+  }
+  return Document::GetElementCount();
+}
+
 ink::proto::Snapshot SingleUserDocument::GetSnapshot(
     SnapshotQuery query) const {
   const bool include_undo = query == INCLUDE_UNDO_STACK;
+  INK_TRACE_EVENT("document", "SingleUserDocument::GetSnapshot");
   absl::MutexLock lock(&mutex_);
   if (include_undo) {
     if (!storage_->RemoveDeadElements(
@@ -125,11 +177,13 @@ ink::proto::Snapshot SingleUserDocument::GetSnapshot(
 
 Status SingleUserDocument::AddPageImpl(
     const ink::proto::PerPageProperties& page) {
+  INK_TRACE_EVENT("document", "SingleUserDocument::AddPage");
   absl::MutexLock lock(&mutex_);
   return storage_->AddPage(page);
 }
 
 Status SingleUserDocument::ClearPagesImpl() {
+  INK_TRACE_EVENT("document", "SingleUserDocument::ClearPages");
   absl::MutexLock lock(&mutex_);
   return storage_->ClearPages();
 }
@@ -137,6 +191,7 @@ Status SingleUserDocument::ClearPagesImpl() {
 Status SingleUserDocument::SetPagePropertiesImpl(
     const proto::PageProperties& page_properties,
     const proto::SourceDetails& source_details) {
+  INK_TRACE_EVENT("document", "SingleUserDocument::SetPageProperties");
   absl::MutexLock lock(&mutex_);
   return storage_->SetPageProperties(page_properties);
 }
@@ -144,6 +199,7 @@ Status SingleUserDocument::SetPagePropertiesImpl(
 Status SingleUserDocument::UndoableSetPageBoundsImpl(
     const ink::proto::Rect& bounds,
     const proto::SourceDetails& source_details) {
+  INK_TRACE_EVENT("document", "SingleUserDocument::UndoableSetPageBounds");
   absl::MutexLock lock(&mutex_);
   std::unique_ptr<SetPageBoundsAction> action(
       new SetPageBoundsAction(storage_, ElementDispatch(), MutationDispatch(),
@@ -162,11 +218,12 @@ Status SingleUserDocument::AddBelowImpl(
     const std::vector<ink::proto::ElementBundle>& elements,
     const UUID& below_element_with_uuid,
     const proto::SourceDetails& source_details) {
+  INK_TRACE_EVENT("document", "SingleUserDocument::AddBelow");
   absl::MutexLock lock(&mutex_);
   std::unique_ptr<AddAction> a(
       new AddAction(storage_, ElementDispatch(), MutationDispatch()));
-  INK_RETURN_UNLESS(
-      a->Apply(elements, below_element_with_uuid, source_details));
+  INK_RETURN_UNLESS(a->Apply(elements, InternedUUID(below_element_with_uuid),
+                             source_details));
   undo_.Push(std::move(a));
   MaybeNotifyEmptyStateChanged();
   return OkStatus();
@@ -175,10 +232,11 @@ Status SingleUserDocument::AddBelowImpl(
 Status SingleUserDocument::RemoveImpl(
     const std::vector<UUID>& uuids,
     const proto::SourceDetails& source_details) {
+  INK_TRACE_EVENT("document", "SingleUserDocument::Remove");
   absl::MutexLock lock(&mutex_);
   std::unique_ptr<RemoveAction> a(
       new RemoveAction(storage_, ElementDispatch(), MutationDispatch()));
-  auto status = a->Apply(uuids, source_details);
+  auto status = a->Apply(InternUUIDs(uuids), source_details);
   if (status.ok() || status::IsIncomplete(status)) {
     undo_.Push(std::move(a));
     MaybeNotifyEmptyStateChanged();
@@ -189,13 +247,14 @@ Status SingleUserDocument::RemoveImpl(
 Status SingleUserDocument::RemoveAllImpl(
     ink::proto::ElementIdList* removed,
     const proto::SourceDetails& source_details) {
+  INK_TRACE_EVENT("document", "SingleUserDocument::RemoveAll");
   absl::MutexLock lock(&mutex_);
   std::unique_ptr<ClearAction> a(
       new ClearAction(storage_, ElementDispatch(), MutationDispatch()));
   INK_RETURN_UNLESS(a->Apply(source_details));
   auto ids = a->AffectedUUIDs();
   for (const auto& id : ids) {
-    removed->add_uuid(id);
+    removed->add_uuid(id.str());
   }
   undo_.Push(std::move(a));
   MaybeNotifyEmptyStateChanged();
@@ -207,11 +266,14 @@ Status SingleUserDocument::ReplaceImpl(
     const std::vector<UUID>& uuids_to_add_below,
     const std::vector<UUID>& uuids_to_remove,
     const proto::SourceDetails& source_details) {
+  INK_TRACE_EVENT("document", "SingleUserDocument::Replace");
   absl::MutexLock lock(&mutex_);
   auto action = absl::make_unique<ReplaceAction>(storage_, ElementDispatch(),
                                                  MutationDispatch());
-  INK_RETURN_UNLESS(action->Apply(elements_to_add, uuids_to_add_below,
-                                  uuids_to_remove, source_details));
+  INK_RETURN_UNLESS(action->Apply(elements_to_add,
+                                  InternUUIDs(uuids_to_add_below),
+                                  InternUUIDs(uuids_to_remove),
+                                  source_details));
   undo_.Push(std::move(action));
   MaybeNotifyEmptyStateChanged();
   return OkStatus();
@@ -221,11 +283,12 @@ Status SingleUserDocument::SetElementTransformsImpl(
     const std::vector<UUID> uuids,
     const std::vector<proto::AffineTransform> transforms,
     const proto::SourceDetails& source_details) {
+  INK_TRACE_EVENT("document", "SingleUserDocument::SetElementTransforms");
   absl::MutexLock lock(&mutex_);
   std::unique_ptr<SetTransformAction> a(
       new SetTransformAction(storage_, ElementDispatch(), MutationDispatch()));
 
-  Status status = a->Apply(uuids, transforms, source_details);
+  Status status = a->Apply(InternUUIDs(uuids), transforms, source_details);
   if (status.ok() || status::IsIncomplete(status)) {
     undo_.Push(std::move(a));
     MaybeNotifyEmptyStateChanged();
@@ -242,9 +305,10 @@ Status SingleUserDocument::SetElementTransformsImpl(
 // Status.
 template <typename ActionType>
 Status SingleUserDocument::ApplyRepeatedStorageAction(
-    const std::vector<UUID> uuids,
+    const std::vector<InternedUUID>& uuids,
     const std::vector<typename ActionType::ValueType> values,
     const proto::SourceDetails& source_details) {
+  INK_TRACE_EVENT("document", "SingleUserDocument::ApplyRepeatedStorageAction");
   absl::MutexLock lock(&mutex_);
   auto a = absl::make_unique<ActionType>(storage_, ElementDispatch(),
                                          MutationDispatch());
@@ -260,26 +324,27 @@ Status SingleUserDocument::ApplyRepeatedStorageAction(
 Status SingleUserDocument::SetElementVisibilityImpl(
     const std::vector<UUID> uuids, const std::vector<bool> visibilities,
     const proto::SourceDetails& source_details) {
-  return ApplyRepeatedStorageAction<SetVisibilityAction>(uuids, visibilities,
-                                                         source_details);
+  return ApplyRepeatedStorageAction<SetVisibilityAction>(
+      InternUUIDs(uuids), visibilities, source_details);
 }
 
 Status SingleUserDocument::SetElementOpacityImpl(
     const std::vector<UUID> uuids, const std::vector<int32> opacities,
     const proto::SourceDetails& source_details) {
-  return ApplyRepeatedStorageAction<SetOpacityAction>(uuids, opacities,
-                                                      source_details);
+  return ApplyRepeatedStorageAction<SetOpacityAction>(
+      InternUUIDs(uuids), opacities, source_details);
 }
 
 Status SingleUserDocument::ChangeZOrderImpl(
     const std::vector<UUID> uuids, const std::vector<UUID> below_uuids,
     const proto::SourceDetails& source_details) {
-  return ApplyRepeatedStorageAction<ChangeZOrderAction>(uuids, below_uuids,
-                                                        source_details);
+  return ApplyRepeatedStorageAction<ChangeZOrderAction>(
+      InternUUIDs(uuids), InternUUIDs(below_uuids), source_details);
 }
 
 Status SingleUserDocument::ActiveLayerChangedImpl(
     const UUID& uuid, const proto::SourceDetails& source_details) {
+  INK_TRACE_EVENT("document", "SingleUserDocument::ActiveLayerChanged");
   absl::MutexLock lock(&mutex_);
   auto a = absl::make_unique<SetActiveLayerAction>(
       storage_, ElementDispatch(), MutationDispatch(), ActiveLayerDispatch());
@@ -21,11 +21,13 @@
 #include <string>
 
 #include "third_party/absl/synchronization/mutex.h"
+#include "ink/engine/public/types/interned_uuid.h"
 #include "ink/engine/public/types/status.h"
 #include "ink/engine/public/types/status_or.h"
 #include "ink/engine/public/types/uuid.h"
 #include "ink/public/document/document.h"
 #include "ink/public/document/storage/document_storage.h"
+#include "ink/public/document/storage/snapshot_reader.h"
 #include "ink/public/document/storage/storage_action.h"
 #include "ink/public/document/storage/undo_manager.h"
 
@@ -44,6 +46,12 @@ class SingleUserDocument : public Document {
       std::shared_ptr<DocumentStorage> storage,
       const ink::proto::Snapshot& snapshot, std::unique_ptr<Document>* out);
 
+  // As CreateFromSnapshot(), but reads the elements from the reader one at a
+  // time. The reader may be destroyed once this returns.
+  static S_WARN_UNUSED_RESULT Status CreateFromSnapshotReader(
+      std::shared_ptr<DocumentStorage> storage, const SnapshotReader& reader,
+      std::unique_ptr<Document>* out);
+
   bool SupportsUndo() const override { return true; }
   void Undo() override;
   void Redo() override;
@@ -51,6 +59,12 @@ class SingleUserDocument : public Document {
   bool CanRedo() const override;
   void SetUndoEnabled(bool enabled) override;
 
+  // See UndoManager::HistoryPolicy.
+  void SetUndoHistoryPolicy(const UndoManager::HistoryPolicy& policy);
+
+  // The approximate number of bytes held by the undo and redo stacks.
+  size_t UndoHistoryBytes() const;
+
   bool SupportsQuerying() override { return true; }
 
   bool SupportsPaging() override { return true; }
@@ -62,6 +76,10 @@ class SingleUserDocument : public Document {
 
   bool IsEmpty() override { return storage_->IsEmpty(); }
 
+  // These are O(1) if the storage supports live element stats.
+  uint64_t GetFingerprint() const override;
+  size_t GetElementCount() const override;
+
   std::string ToString() const override;
 
  protected:
@@ -113,9 +131,10 @@ class SingleUserDocument : public Document {
   S_WARN_UNUSED_RESULT Status ClearPagesImpl() override;
 
  private:
+  // The uuids are interned once, here, where they enter the document.
   template <typename ActionType>
   Status ApplyRepeatedStorageAction(
-      const std::vector<UUID> uuids,
+      const std::vector<InternedUUID>& uuids,
       const std::vector<typename ActionType::ValueType> values,
       const proto::SourceDetails& source_details);
 
@@ -21,6 +21,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "ink/engine/public/types/interned_uuid.h"
 #include "ink/engine/public/types/status.h"
 #include "ink/engine/public/types/uuid.h"
 #include "ink/engine/util/dbg/errors.h"
@@ -31,6 +32,7 @@
 #include "ink/proto/document_portable_proto.pb.h"
 #include "ink/proto/elements_portable_proto.pb.h"
 #include "ink/public/document/bundle_data_attachments.h"
+#include "ink/public/document/storage/snapshot_reader.h"
 
 // Interface definitions for the document storage API
 
@@ -111,6 +113,11 @@ enum class LivenessFilter { kOnlyAlive, kOnlyDead, kDeadOrAlive };
 // - Supports data compaction of non-referenced elements (ex under memory
 //   pressure) See RemoveDeadElements.
 // - Consistency of multi-element error handling. (eg transactions)
+//
+// The UUIDs may be given as UUID strings or as InternedUUIDs, and are passed to
+// the implementation as InternedUUIDs. Callers that hold on to UUIDs, such as
+// StorageActions, should hold InternedUUIDs, so that the strings are hashed
+// once, rather than on every call.
 class DocumentStorage {
  public:
   virtual ~DocumentStorage() {}
@@ -145,7 +152,12 @@ class DocumentStorage {
   S_WARN_UNUSED_RESULT Status
   Add(TBundleRange bundles, /* Range<proto::ElementBundle> */
       const UUID& below_element_with_uuid) {
-    std::vector<UUID> add_below = {below_element_with_uuid};
+    return Add(bundles, InternedUUID(below_element_with_uuid));
+  }
+  template <typename TBundleRange>
+  S_WARN_UNUSED_RESULT Status Add(TBundleRange bundles,
+                                  const InternedUUID& below_element_with_uuid) {
+    std::vector<InternedUUID> add_below = {below_element_with_uuid};
     INK_RETURN_UNLESS(ValidateBundlesForAdd(bundles, add_below));
     return AddImpl(bundles.template AsPointerVector<proto::ElementBundle>(),
                    add_below);
@@ -158,6 +170,11 @@ class DocumentStorage {
   template <typename TBundleRange>
   S_WARN_UNUSED_RESULT Status Add(TBundleRange bundles,
                                   const std::vector<UUID>& add_below_uuids) {
+    return Add(bundles, InternUUIDs(add_below_uuids));
+  }
+  template <typename TBundleRange>
+  S_WARN_UNUSED_RESULT Status
+  Add(TBundleRange bundles, const std::vector<InternedUUID>& add_below_uuids) {
     if (bundles.size() != add_below_uuids.size()) {
       return ErrorStatus(StatusCode::INVALID_ARGUMENT,
                          "Cannot add, size mismatch between bundle list and "
@@ -176,7 +193,7 @@ class DocumentStorage {
   //   - false: an error occurred removing an element
   template <typename TUUIDRange>
   S_WARN_UNUSED_RESULT Status Remove(TUUIDRange uuids) {
-    return RemoveImpl(uuids.template AsPointerVector<UUID>());
+    return RemoveImpl(ToInternedUUIDs(uuids));
   }
 
   // Set liveness all uuids in the range, if they exist.
@@ -186,7 +203,7 @@ class DocumentStorage {
   //   - false: an error occurred.
   template <typename TUUIDRange>
   S_WARN_UNUSED_RESULT Status SetLiveness(TUUIDRange uuids, Liveness liveness) {
-    return SetLivenessImpl(uuids.template AsPointerVector<UUID>(), liveness);
+    return SetLivenessImpl(ToInternedUUIDs(uuids), liveness);
   }
 
   // Set transforms for all uuids in the range, if they exist.
@@ -199,7 +216,7 @@ class DocumentStorage {
                                             TTransformRange transforms) {
     ASSERT(uuids.size() == transforms.size());
     return SetTransformsImpl(
-        uuids.template AsPointerVector<UUID>(),
+        ToInternedUUIDs(uuids),
         transforms.template AsPointerVector<ink::proto::AffineTransform>());
   }
 
@@ -224,8 +241,8 @@ class DocumentStorage {
   GetBundles(TUUIDRange uuids, BundleDataAttachments data_attachments,
              LivenessFilter liveness_filter,
              std::vector<proto::ElementBundle>* result) const {
-    return GetBundlesImpl(uuids.template AsPointerVector<UUID>(),
-                          data_attachments, liveness_filter, result);
+    return GetBundlesImpl(ToInternedUUIDs(uuids), data_attachments,
+                          liveness_filter, result);
   }
 
   // Same as GetBundles over all uuids known to the storage
@@ -234,7 +251,11 @@ class DocumentStorage {
       std::vector<proto::ElementBundle>* result) const = 0;
 
   // Returns true if an element with the given UUID exists and is alive.
-  virtual S_WARN_UNUSED_RESULT bool IsAlive(const UUID& uuid) const = 0;
+  S_WARN_UNUSED_RESULT bool IsAlive(const UUID& uuid) const {
+    InternedUUID id;
+    return InternedUUID::Find(uuid, &id) && id.IsValid() && IsAlive(id);
+  }
+  virtual S_WARN_UNUSED_RESULT bool IsAlive(const InternedUUID& uuid) const = 0;
 
   // Remove all elements that are:
   //  - Not in "keep_alive"
@@ -251,7 +272,7 @@ class DocumentStorage {
   //   - false: an error occurred.
   template <typename TUUIDRange>
   S_WARN_UNUSED_RESULT Status RemoveDeadElements(TUUIDRange keep_alive) {
-    return RemoveDeadElementsImpl(keep_alive.template AsPointerVector<UUID>());
+    return RemoveDeadElementsImpl(ToInternedUUIDs(keep_alive));
   }
 
   // Get transforms for all uuids in the range, if they exist.
@@ -300,6 +321,24 @@ class DocumentStorage {
   ReadFromProto(const ink::proto::Snapshot& proto) {
     RUNTIME_ERROR("This DocumentStorage does not know how to read a snapshot.");
   }
+  // As ReadFromProto(), but reads the elements from the reader one at a time,
+  // without first parsing the whole snapshot.
+  virtual S_WARN_UNUSED_RESULT Status
+  ReadFromSnapshotReader(const SnapshotReader& reader) {
+    RUNTIME_ERROR("This DocumentStorage does not know how to read a snapshot.");
+  }
+
+  // Storages that keep a running count and IncrementalFingerprint of their
+  // live elements return true here, and implement LiveElementCount() and
+  // LiveElementFingerprint() in O(1).
+  virtual bool SupportsLiveElementStats() const { return false; }
+  virtual size_t LiveElementCount() const {
+    RUNTIME_ERROR("This DocumentStorage does not count its live elements.");
+  }
+  virtual uint64_t LiveElementFingerprint() const {
+    RUNTIME_ERROR(
+        "This DocumentStorage does not fingerprint its live elements.");
+  }
 
   virtual std::string ToString() const = 0;
 
@@ -311,10 +350,11 @@ class DocumentStorage {
   virtual bool IsEmpty() const = 0;
 
   virtual S_WARN_UNUSED_RESULT Status
-  SetVisibilities(const std::vector<UUID>& uuids,
+  SetVisibilities(const std::vector<InternedUUID>& uuids,
                   const std::vector<bool>& visibilities) = 0;
-  virtual S_WARN_UNUSED_RESULT Status SetOpacities(
-      const std::vector<UUID>& uuids, const std::vector<int>& opacities) = 0;
+  virtual S_WARN_UNUSED_RESULT Status
+  SetOpacities(const std::vector<InternedUUID>& uuids,
+               const std::vector<int>& opacities) = 0;
 
   // Returns the old "below uuids" in old_below_uuids. This is necessary in
   // order to implement Undo.
@@ -322,31 +362,46 @@ class DocumentStorage {
   // The old below_uuids values will be emplaced_back
   // into old_below_uuids. old_below_uuids will not be cleared.
   // old_below_uuids may be nullptr.
-  virtual S_WARN_UNUSED_RESULT Status ChangeZOrders(
-      const std::vector<UUID>& uuids, const std::vector<UUID>& below_uuids,
-      std::vector<UUID>* old_below_uuids) = 0;
+  virtual S_WARN_UNUSED_RESULT Status
+  ChangeZOrders(const std::vector<InternedUUID>& uuids,
+                const std::vector<InternedUUID>& below_uuids,
+                std::vector<InternedUUID>* old_below_uuids) = 0;
   virtual S_WARN_UNUSED_RESULT Status FindBundleAboveUUID(const UUID& uuid,
                                                           UUID* above_uuid) = 0;
 
  protected:
   virtual S_WARN_UNUSED_RESULT Status
   AddImpl(const std::vector<const ink::proto::ElementBundle*>& bundles,
-          const std::vector<UUID>& add_below_uuids) = 0;
+          const std::vector<InternedUUID>& add_below_uuids) = 0;
   virtual S_WARN_UNUSED_RESULT Status
-  RemoveImpl(const std::vector<const UUID*>& uuids) = 0;
-  virtual S_WARN_UNUSED_RESULT Status
-  SetLivenessImpl(const std::vector<const UUID*>& uuids, Liveness liveness) = 0;
+  RemoveImpl(const std::vector<InternedUUID>& uuids) = 0;
+  virtual S_WARN_UNUSED_RESULT Status SetLivenessImpl(
+      const std::vector<InternedUUID>& uuids, Liveness liveness) = 0;
   virtual S_WARN_UNUSED_RESULT Status SetTransformsImpl(
-      const std::vector<const UUID*>& uuids,
+      const std::vector<InternedUUID>& uuids,
       const std::vector<const ink::proto::AffineTransform*>& transforms) = 0;
   virtual S_WARN_UNUSED_RESULT Status GetBundlesImpl(
-      const std::vector<const UUID*>& uuids,
+      const std::vector<InternedUUID>& uuids,
       BundleDataAttachments data_attachments, LivenessFilter liveness_filter,
       std::vector<proto::ElementBundle>* result) const = 0;
   virtual S_WARN_UNUSED_RESULT Status
-  RemoveDeadElementsImpl(const std::vector<const UUID*>& keep_alive) = 0;
+  RemoveDeadElementsImpl(const std::vector<InternedUUID>& keep_alive) = 0;
 
  private:
+  // Collapses a range of UUIDs or InternedUUIDs to a vector of InternedUUIDs.
+  // UUID strings are interned; if an element has the UUID, the storage holds
+  // it, so the string only needs to be hashed once, here.
+  template <typename TUUIDRange>
+  static std::vector<InternedUUID> ToInternedUUIDs(const TUUIDRange& uuids) {
+    std::vector<InternedUUID> result;
+    for (const auto& uuid : uuids) result.emplace_back(ToInternedUUID(uuid));
+    return result;
+  }
+  static InternedUUID ToInternedUUID(const InternedUUID& uuid) { return uuid; }
+  static InternedUUID ToInternedUUID(const UUID& uuid) {
+    return InternedUUID(uuid);
+  }
+
   // Performs safety checks on the elements to be added. This must be called
   // before AddImpl(). Returns an error if any of the bundles share a UUID, or
   // if any of the add-below UUIDs belong to any of the bundles.
@@ -354,11 +409,9 @@ class DocumentStorage {
   // already exist in the scene, and the add-below UUIDs do exist.
   // Type parameter TBundleRange is expected to be an ink::Range that iterates
   // over proto::ElementBundles.
-  // Type parameter TUuidRange is expected to be an ink::Range that iterates
-  // over UUIDs.
   template <typename TBundleRange>
   S_WARN_UNUSED_RESULT Status ValidateBundlesForAdd(
-      TBundleRange bundles, const std::vector<UUID>& add_below_uuids) {
+      TBundleRange bundles, const std::vector<InternedUUID>& add_below_uuids) {
     std::unordered_set<UUID> id_set;
     size_t n_bundles = 0;
     for (const auto& bundle : bundles) {
@@ -370,7 +423,7 @@ class DocumentStorage {
                          "Cannot add, not all ids are unique.");
     }
     for (const auto& add_below_uuid : add_below_uuids) {
-      if (id_set.count(add_below_uuid) > 0) {
+      if (id_set.count(add_below_uuid.str()) > 0) {
         return ErrorStatus(
             StatusCode::INVALID_ARGUMENT,
             "Cannot add, below_id cannot refer to an element in bundles.");
@@ -26,34 +26,53 @@ namespace ink {
 
 InMemoryStorage::InMemoryStorage() {}
 
-bool InMemoryStorage::IsKnownId(const UUID& id) const {
-  bool res = uuids_.Contains(id);
-  ASSERT(res == (uuid_to_bundle_.find(id) != uuid_to_bundle_.end()));
-  ASSERT(res == (uuid_to_liveness_.find(id) != uuid_to_liveness_.end()));
-  return res;
+bool InMemoryStorage::IsKnownId(const InternedUUID& id) const {
+  return FindElement(id) != nullptr;
 }
 
-bool InMemoryStorage::IsAlive(const UUID& uuid) const {
-  return IsKnownId(uuid) && (uuid_to_liveness_.at(uuid) == Liveness::kAlive);
+const InMemoryStorage::StoredElement* InMemoryStorage::FindElement(
+    const InternedUUID& id) const {
+  auto it = elements_.find(id);
+  ASSERT((it != elements_.end()) == uuids_.Contains(id));
+  return it == elements_.end() ? nullptr : &it->second;
 }
 
-bool InMemoryStorage::IsEmpty() const {
-  return std::none_of(uuid_to_liveness_.begin(), uuid_to_liveness_.end(),
-                      [](const std::pair<UUID, Liveness>& kv) {
-                        return kv.second == Liveness::kAlive;
-                      });
+InMemoryStorage::StoredElement* InMemoryStorage::FindElement(
+    const InternedUUID& id) {
+  return const_cast<StoredElement*>(
+      static_cast<const InMemoryStorage*>(this)->FindElement(id));
 }
 
-Status InMemoryStorage::GetBundle(const UUID& id,
+bool InMemoryStorage::IsAlive(const InternedUUID& uuid) const {
+  const StoredElement* element = FindElement(uuid);
+  return element && element->liveness == Liveness::kAlive;
+}
+
+void InMemoryStorage::NoteLive(const proto::ElementBundle& bundle) {
+  ++live_element_count_;
+  live_element_fingerprint_.Add(IncrementalFingerprint::ElementHash(bundle));
+}
+
+void InMemoryStorage::NoteNotLive(const proto::ElementBundle& bundle) {
+  ASSERT(live_element_count_ > 0);
+  --live_element_count_;
+  live_element_fingerprint_.Remove(
+      IncrementalFingerprint::ElementHash(bundle));
+}
+
+bool InMemoryStorage::IsEmpty() const { return live_element_count_ == 0; }
+
+Status InMemoryStorage::GetBundle(InternedUUID id,
                                   BundleDataAttachments data_attachments,
                                   proto::ElementBundle* result) const {
-  if (!IsKnownId(id)) {
+  auto it = elements_.find(id);
+  if (it == elements_.end()) {
     return ErrorStatus(StatusCode::NOT_FOUND,
                        "not attaching bundle for id $0, id not found", id);
   }
 
-  result->set_uuid(id);
-  const auto& bundle = uuid_to_bundle_.at(id);
+  result->set_uuid(id.str());
+  const auto& bundle = it->second.bundle;
 
   bool missing_transform = false;
   if (bundle.has_transform()) {
@@ -118,7 +137,7 @@ S_WARN_UNUSED_RESULT Status InMemoryStorage::ClearPages() {
 
 S_WARN_UNUSED_RESULT Status InMemoryStorage::AddImpl(
     const std::vector<const ink::proto::ElementBundle*>& bundles,
-    const std::vector<UUID>& add_below_uuids) {
+    const std::vector<InternedUUID>& add_below_uuids) {
   // We should either have a single add_below_uuid (in the case of adding
   // multiple elements in the same place), or the same number as the number of
   // elements (in the case of adding elements in arbitrary locations). This
@@ -128,20 +147,24 @@ S_WARN_UNUSED_RESULT Status InMemoryStorage::AddImpl(
 
   // check that all bundle ids are not already stored
   bool already_exists = false;
+  std::vector<InternedUUID> ids;
+  ids.reserve(bundles.size());
   for (const auto& bundle : bundles) {
-    if (IsKnownId(bundle->uuid())) {
-      if (uuid_to_liveness_[bundle->uuid()] == Liveness::kAlive) {
+    ids.emplace_back(bundle->uuid());
+    auto it = elements_.find(ids.back());
+    if (it != elements_.end()) {
+      if (it->second.liveness == Liveness::kAlive) {
         already_exists = true;
         continue;
       }
       ASSERT(bundle->element().SerializeAsString() ==
-             uuid_to_bundle_[bundle->uuid()].element().SerializeAsString());
+             it->second.bundle.element().SerializeAsString());
     }
   }
 
   // check that below_element_with_uuid refers to a known id
   for (const auto& add_below_uuid : add_below_uuids) {
-    if (add_below_uuid != kInvalidUUID && !uuids_.Contains(add_below_uuid)) {
+    if (add_below_uuid.IsValid() && !IsKnownId(add_below_uuid)) {
       return ErrorStatus(StatusCode::FAILED_PRECONDITION,
                          "cannot add below unknown id $0", add_below_uuid);
     }
@@ -150,20 +173,25 @@ S_WARN_UNUSED_RESULT Status InMemoryStorage::AddImpl(
   // add
   for (size_t i = 0; i < bundles.size(); i++) {
     const auto& bundle = *bundles[i];
-    const auto& add_below_uuid =
+    InternedUUID id = ids[i];
+    const InternedUUID& add_below_id =
         add_below_uuids[add_below_uuids.size() == 1 ? 0 : i];
 
-    if (IsKnownId(bundle.uuid())) {
-      uuid_to_liveness_[bundle.uuid()] = Liveness::kAlive;
-      uuids_.Remove(bundle.uuid());  // Re-added at correct z-index below.
+    auto it = elements_.find(id);
+    if (it != elements_.end()) {
+      if (it->second.liveness != Liveness::kAlive) {
+        it->second.liveness = Liveness::kAlive;
+        NoteLive(it->second.bundle);
+      }
+      uuids_.Remove(id);  // Re-added at correct z-index below.
     } else {
-      uuid_to_bundle_.emplace(bundle.uuid(), bundle);
-      uuid_to_liveness_.emplace(bundle.uuid(), Liveness::kAlive);
+      elements_.emplace(id, StoredElement{bundle, Liveness::kAlive});
+      NoteLive(bundle);
     }
-    if (add_below_uuid == kInvalidUUID) {
-      uuids_.AddToTop(bundle.uuid());
+    if (!add_below_id.IsValid()) {
+      uuids_.AddToTop(id);
     } else {
-      uuids_.AddBelow(bundle.uuid(), add_below_uuid);
+      uuids_.AddBelow(id, add_below_id);
     }
   }
 
@@ -173,39 +201,54 @@ S_WARN_UNUSED_RESULT Status InMemoryStorage::AddImpl(
 }
 
 S_WARN_UNUSED_RESULT Status
-InMemoryStorage::RemoveImpl(const std::vector<const UUID*>& uuids) {
+InMemoryStorage::RemoveImpl(const std::vector<InternedUUID>& uuids) {
   for (const auto& id : uuids) {
-    uuids_.Remove(*id);
-    uuid_to_bundle_.erase(*id);
-    uuid_to_liveness_.erase(*id);
+    const StoredElement* element = FindElement(id);
+    if (!element) continue;
+    if (element->liveness == Liveness::kAlive) NoteNotLive(element->bundle);
+    uuids_.Remove(id);
+    elements_.erase(id);
   }
   return OkStatus();
 }
 
 S_WARN_UNUSED_RESULT Status InMemoryStorage::SetLivenessImpl(
-    const std::vector<const UUID*>& uuids, Liveness liveness) {
+    const std::vector<InternedUUID>& uuids, Liveness liveness) {
   for (const auto& id : uuids) {
-    if (!IsKnownId(*id)) {
-      SLOG(SLOG_WARNING, "cannot set liveness for unknown id $0", *id);
+    StoredElement* element = FindElement(id);
+    if (!element) {
+      SLOG(SLOG_WARNING, "cannot set liveness for unknown id $0", id);
       continue;
     }
-    uuid_to_liveness_[*id] = liveness;
+    if (element->liveness != liveness) {
+      if (liveness == Liveness::kAlive) {
+        NoteLive(element->bundle);
+      } else {
+        NoteNotLive(element->bundle);
+      }
+      element->liveness = liveness;
+    }
   }
   return OkStatus();
 }
 
 S_WARN_UNUSED_RESULT Status InMemoryStorage::SetTransformsImpl(
-    const std::vector<const UUID*>& uuids,
+    const std::vector<InternedUUID>& uuids,
     const std::vector<const proto::AffineTransform*>& transforms) {
   size_t num_successes = 0;
   for (size_t i = 0; i < uuids.size(); i++) {
-    const auto& id = *uuids[i];
+    const auto& id = uuids[i];
     const auto& transform = *transforms[i];
-    if (!IsKnownId(id)) {
+    StoredElement* element = FindElement(id);
+    if (!element) {
       SLOG(SLOG_WARNING, "cannot set transform for unknown id $0", id);
       continue;
     }
-    *uuid_to_bundle_[id].mutable_transform() = transform;
+    auto& bundle = element->bundle;
+    bool is_alive = element->liveness == Liveness::kAlive;
+    if (is_alive) NoteNotLive(bundle);
+    *bundle.mutable_transform() = transform;
+    if (is_alive) NoteLive(bundle);
     num_successes++;
   }
   if (num_successes < uuids.size()) {
@@ -218,12 +261,12 @@ S_WARN_UNUSED_RESULT Status InMemoryStorage::SetTransformsImpl(
 }
 
 Status InMemoryStorage::GetBundles(
-    const std::vector<UUID>& uuids, BundleDataAttachments data_attachments,
-    LivenessFilter liveness_filter,
+    const std::vector<InternedUUID>& ids,
+    BundleDataAttachments data_attachments, LivenessFilter liveness_filter,
     std::vector<proto::ElementBundle>* result) const {
-  for (const auto& id : uuids) {
-    ASSERT(IsKnownId(id));
-    auto liveness = uuid_to_liveness_.at(id);
+  for (InternedUUID id : ids) {
+    ASSERT(uuids_.Contains(id));
+    auto liveness = elements_.at(id).liveness;
     bool liveness_filter_passes = false;
     switch (liveness_filter) {
       case LivenessFilter::kOnlyAlive:
@@ -247,17 +290,15 @@ Status InMemoryStorage::GetBundles(
 }
 
 Status InMemoryStorage::GetBundlesImpl(
-    const std::vector<const UUID*>& uuids,
+    const std::vector<InternedUUID>& uuids,
     BundleDataAttachments data_attachments, LivenessFilter liveness_filter,
     std::vector<proto::ElementBundle>* result) const {
   result->clear();
 
-  std::vector<UUID> sorted_ids;
+  std::vector<InternedUUID> sorted_ids;
   sorted_ids.reserve(uuids.size());
   for (const auto& id : uuids) {
-    if (IsKnownId(*id)) {
-      sorted_ids.emplace_back(*id);
-    }
+    if (IsKnownId(id)) sorted_ids.emplace_back(id);
   }
   uuids_.Sort(sorted_ids.begin(), sorted_ids.end());
 
@@ -268,25 +309,23 @@ Status InMemoryStorage::GetAllBundles(
     BundleDataAttachments data_attachments, LivenessFilter liveness_filter,
     std::vector<proto::ElementBundle>* result) const {
   result->clear();
-  return GetBundles(uuids_.SortedElements().AsValueVector<UUID>(),
+  return GetBundles(uuids_.SortedElements().AsValueVector<InternedUUID>(),
                     data_attachments, liveness_filter, result);
 }
 
 S_WARN_UNUSED_RESULT Status InMemoryStorage::RemoveDeadElementsImpl(
-    const std::vector<const UUID*>& keep_alive) {
-  std::unordered_set<UUID> keep_alive_set;
-  for (const auto& id : keep_alive) {
-    keep_alive_set.emplace(*id);
-  }
-
-  std::unordered_set<UUID> dead_elements;
-  for (const auto& ai : uuid_to_liveness_) {
-    if (ai.second == Liveness::kDead && keep_alive_set.count(ai.first) == 0) {
-      dead_elements.emplace(ai.first);
+    const std::vector<InternedUUID>& keep_alive) {
+  InternedUUIDHashSet keep_alive_set(keep_alive.begin(), keep_alive.end());
+
+  std::vector<InternedUUID> dead_elements;
+  for (const auto& ai : elements_) {
+    if (ai.second.liveness == Liveness::kDead &&
+        keep_alive_set.count(ai.first) == 0) {
+      dead_elements.emplace_back(ai.first);
     }
   }
 
-  return Remove(MakeSTLRange(dead_elements));
+  return RemoveImpl(dead_elements);
 }
 
 S_WARN_UNUSED_RESULT Status InMemoryStorage::SetPageProperties(
@@ -316,10 +355,10 @@ void InMemoryStorage::WriteToProto(ink::proto::Snapshot* proto,
     proto->set_active_layer_uuid(active_layer_);
   }
   Fingerprinter fingerprinter;
-  for (const auto& id : uuids_.SortedElements().AsValueVector<UUID>()) {
-    ASSERT(IsKnownId(id));
+  for (InternedUUID id : uuids_.SortedElements()) {
+    const StoredElement& element = elements_.at(id);
     proto::ElementBundle* bundleProto;
-    bool is_alive = uuid_to_liveness_.at(id) == Liveness::kAlive;
+    bool is_alive = element.liveness == Liveness::kAlive;
     if (is_alive) {
       bundleProto = proto->add_element();
       proto->add_element_state_index(ink::proto::ElementState::ALIVE);
@@ -329,9 +368,8 @@ void InMemoryStorage::WriteToProto(ink::proto::Snapshot* proto,
     } else {
       continue;
     }
-    const auto& bundle = uuid_to_bundle_.at(id);
-    *bundleProto = bundle;
-    bundleProto->set_uuid(id);
+    *bundleProto = element.bundle;
+    bundleProto->set_uuid(id.str());
     if (is_alive) {
       fingerprinter.Note(*bundleProto);
     }
@@ -340,22 +378,59 @@ void InMemoryStorage::WriteToProto(ink::proto::Snapshot* proto,
 }
 
 Status InMemoryStorage::ReadFromProto(const ink::proto::Snapshot& proto) {
+  return ReadSnapshot(
+      proto, proto.element_size(), proto.dead_element_size(),
+      [&proto](int i, ink::proto::ElementBundle* scratch,
+               const ink::proto::ElementBundle** bundle) {
+        *bundle = &proto.element(i);
+        return OkStatus();
+      },
+      [&proto](int i, ink::proto::ElementBundle* scratch,
+               const ink::proto::ElementBundle** bundle) {
+        *bundle = &proto.dead_element(i);
+        return OkStatus();
+      });
+}
+
+Status InMemoryStorage::ReadFromSnapshotReader(const SnapshotReader& reader) {
+  // Each bundle is parsed into the scratch bundle just before it is added, so
+  // only one bundle is held outside of elements_ at a time.
+  return ReadSnapshot(
+      reader.Header(), reader.ElementCount(), reader.DeadElementCount(),
+      [&reader](int i, proto::ElementBundle* scratch,
+                const proto::ElementBundle** bundle) {
+        *bundle = scratch;
+        return SnapshotReader::ParseBundle(reader.ElementBytes(i), scratch);
+      },
+      [&reader](int i, proto::ElementBundle* scratch,
+                const proto::ElementBundle** bundle) {
+        *bundle = scratch;
+        return SnapshotReader::ParseBundle(reader.DeadElementBytes(i),
+                                           scratch);
+      });
+}
+
+Status InMemoryStorage::ReadSnapshot(const ink::proto::Snapshot& header,
+                                     int element_count, int dead_element_count,
+                                     const BundleGetter& get_element,
+                                     const BundleGetter& get_dead_element) {
   uuids_.Clear();
-  uuid_to_bundle_.clear();
-  uuid_to_liveness_.clear();
-  page_properties_ = proto.page_properties();
+  elements_.clear();
+  live_element_count_ = 0;
+  live_element_fingerprint_.Clear();
+  page_properties_ = header.page_properties();
   INK_RETURN_UNLESS(ClearPages());
-  for (auto& page : proto.per_page_properties()) {
+  for (auto& page : header.per_page_properties()) {
     INK_RETURN_UNLESS(AddPage(page));
   }
 
   active_layer_ = kInvalidUUID;
-  if (proto.has_active_layer_uuid()) {
-    active_layer_ = proto.active_layer_uuid();
+  if (header.has_active_layer_uuid()) {
+    active_layer_ = header.active_layer_uuid();
   }
 
-  const bool has_state_index = proto.element_state_index_size() > 0;
-  const auto& state_index = proto.element_state_index();
+  const bool has_state_index = header.element_state_index_size() > 0;
+  const auto& state_index = header.element_state_index();
   const int expected_dead_element_count = std::count_if(
       state_index.begin(), state_index.end(),
       [](int state) { return state == ink::proto::ElementState::DEAD; });
@@ -363,64 +438,67 @@ Status InMemoryStorage::ReadFromProto(const ink::proto::Snapshot& proto) {
       state_index.begin(), state_index.end(),
       [](int state) { return state == ink::proto::ElementState::ALIVE; });
 
-  if (has_state_index &&
-      expected_dead_element_count != proto.dead_element_size()) {
+  if (has_state_index && expected_dead_element_count != dead_element_count) {
     // This is a WARNING, because it reflects the state created due to a bug
     // prior to the CL that created this comment. The state is recoverable and
     // consistent, so not an ERROR. (See  b/111655675.)
     SLOG(SLOG_WARNING,
          "Index refers to $0 dead elements, but $1 are present. Ignoring "
          "index.",
-         expected_dead_element_count, proto.dead_element_size());
+         expected_dead_element_count, dead_element_count);
   }
-  if (has_state_index && expected_live_element_count != proto.element_size()) {
+  if (has_state_index && expected_live_element_count != element_count) {
     // This state is not known to exist, and we need to know about it.
     SLOG(SLOG_ERROR,
          "Index refers to $0 live elements, but $1 are present. Ignoring "
          "index.",
-         expected_live_element_count, proto.element_size());
+         expected_live_element_count, element_count);
   }
-  if (has_state_index &&
-      expected_dead_element_count == proto.dead_element_size() &&
-      expected_live_element_count == proto.element_size()) {
+  proto::ElementBundle scratch;
+  const proto::ElementBundle* element;
+  if (has_state_index && expected_dead_element_count == dead_element_count &&
+      expected_live_element_count == element_count) {
     int alive_index = 0;
     int dead_index = 0;
-    for (const auto& state : proto.element_state_index()) {
+    for (const auto& state : header.element_state_index()) {
       if (state == ink::proto::ElementState::ALIVE) {
-        const auto& element = proto.element(alive_index++);
-        SLOG(SLOG_DOCUMENT, "Adding live element $0", element.uuid());
-        INK_RETURN_UNLESS(Add(MakePointerRange(&element), kInvalidUUID));
+        INK_RETURN_UNLESS(get_element(alive_index++, &scratch, &element));
+        SLOG(SLOG_DOCUMENT, "Adding live element $0", element->uuid());
+        INK_RETURN_UNLESS(Add(MakePointerRange(element), kInvalidUUID));
       } else if (state == ink::proto::ElementState::DEAD) {
-        const auto& element = proto.dead_element(dead_index++);
-        SLOG(SLOG_DOCUMENT, "Adding dead element $0", element.uuid());
-        uuid_to_bundle_.emplace(element.uuid(), element);
-        uuid_to_liveness_.emplace(element.uuid(), Liveness::kDead);
-        uuids_.AddToTop(element.uuid());
+        INK_RETURN_UNLESS(get_dead_element(dead_index++, &scratch, &element));
+        SLOG(SLOG_DOCUMENT, "Adding dead element $0", element->uuid());
+        InternedUUID id(element->uuid());
+        elements_.emplace(id, StoredElement{*element, Liveness::kDead});
+        uuids_.AddToTop(id);
       } else {
         return ErrorStatus(StatusCode::INTERNAL,
                            "Encountered unknown liveness state $0.", state);
       }
     }
   } else {
-    for (const auto& element : proto.element()) {
-      SLOG(SLOG_DOCUMENT, "Adding live element $0", element.uuid());
-      INK_RETURN_UNLESS(Add(MakePointerRange(&element), kInvalidUUID));
+    for (int i = 0; i < element_count; ++i) {
+      INK_RETURN_UNLESS(get_element(i, &scratch, &element));
+      SLOG(SLOG_DOCUMENT, "Adding live element $0", element->uuid());
+      INK_RETURN_UNLESS(Add(MakePointerRange(element), kInvalidUUID));
     }
   }
   return OkStatus();
 }
 
 S_WARN_UNUSED_RESULT Status InMemoryStorage::SetVisibilities(
-    const std::vector<UUID>& uuids, const std::vector<bool>& visibilities) {
+    const std::vector<InternedUUID>& uuids,
+    const std::vector<bool>& visibilities) {
   EXPECT(uuids.size() == visibilities.size());
   int num_successes = 0;
   for (int i = 0; i < uuids.size(); ++i) {
     const auto& uuid = uuids[i];
-    if (!IsKnownId(uuid)) {
+    StoredElement* element = FindElement(uuid);
+    if (!element) {
       SLOG(SLOG_WARNING, "cannot set visibility for unknown id $0", uuid);
       continue;
     }
-    uuid_to_bundle_[uuid].set_visibility(visibilities[i]);
+    element->bundle.set_visibility(visibilities[i]);
     num_successes++;
   }
   if (num_successes < uuids.size()) {
@@ -433,16 +511,17 @@ S_WARN_UNUSED_RESULT Status InMemoryStorage::SetVisibilities(
 }
 
 S_WARN_UNUSED_RESULT Status InMemoryStorage::SetOpacities(
-    const std::vector<UUID>& uuids, const std::vector<int>& opacities) {
+    const std::vector<InternedUUID>& uuids, const std::vector<int>& opacities) {
   EXPECT(uuids.size() == opacities.size());
   int num_successes = 0;
   for (int i = 0; i < uuids.size(); ++i) {
     const auto& uuid = uuids[i];
-    if (!IsKnownId(uuid)) {
+    StoredElement* element = FindElement(uuid);
+    if (!element) {
       SLOG(SLOG_WARNING, "cannot set opacity for unknown id $0", uuid);
       continue;
     }
-    uuid_to_bundle_[uuid].set_opacity(util::Clamp(0, 255, opacities[i]));
+    element->bundle.set_opacity(util::Clamp(0, 255, opacities[i]));
     num_successes++;
   }
   if (num_successes < uuids.size()) {
@@ -455,38 +534,35 @@ S_WARN_UNUSED_RESULT Status InMemoryStorage::SetOpacities(
 }
 
 S_WARN_UNUSED_RESULT Status InMemoryStorage::ChangeZOrders(
-    const std::vector<UUID>& uuids, const std::vector<UUID>& below_uuids,
-    std::vector<UUID>* old_below_uuids) {
+    const std::vector<InternedUUID>& uuids,
+    const std::vector<InternedUUID>& below_uuids,
+    std::vector<InternedUUID>* old_below_uuids) {
   EXPECT(uuids.size() == below_uuids.size());
 
   int num_successes = 0;
   for (int i = 0; i < uuids.size(); ++i) {
-    const auto& uuid = uuids[i];
-    if (!IsKnownId(uuid)) {
-      SLOG(SLOG_WARNING, "cannot set z-order for unknown uuid, $0", uuid);
+    const auto& id = uuids[i];
+    if (!IsKnownId(id)) {
+      SLOG(SLOG_WARNING, "cannot set z-order for unknown uuid, $0", id);
       continue;
     }
-    const auto& below_uuid = below_uuids[i];
-    if (below_uuid != kInvalidUUID && !IsKnownId(below_uuid)) {
+    const auto& below_id = below_uuids[i];
+    if (below_id.IsValid() && !IsKnownId(below_id)) {
       SLOG(SLOG_WARNING, "cannot set z-order below unknown uuid: $0",
-           below_uuid);
+           below_id);
       continue;
     }
 
     // NOTE: this does exactly what ElementIndex warns us not to do: we are
     // alternating reads and writes.
-    UUID old_below_id;
-    Status st = FindBundleAboveUUID(uuid, &old_below_id);
-    if (!st) {
-      SLOG(SLOG_WARNING, "cannot find old z-order for $0: $1", uuid, st);
-      continue;
-    }
+    auto above_id = uuids_.GetIdAbove(id);
+    InternedUUID old_below_id = above_id ? *above_id : InternedUUID();
 
-    uuids_.Remove(uuid);
-    if (below_uuid == kInvalidUUID) {
-      uuids_.AddToTop(uuid);
+    uuids_.Remove(id);
+    if (!below_id.IsValid()) {
+      uuids_.AddToTop(id);
     } else {
-      uuids_.AddBelow(uuid, below_uuid);
+      uuids_.AddBelow(id, below_id);
     }
     if (old_below_uuids) {
       old_below_uuids->emplace_back(old_below_id);
@@ -504,13 +580,12 @@ S_WARN_UNUSED_RESULT Status InMemoryStorage::ChangeZOrders(
 
 Status InMemoryStorage::FindBundleAboveUUID(const UUID& uuid,
                                             UUID* above_uuid) {
-  if (!IsKnownId(uuid)) {
+  InternedUUID id;
+  if (!InternedUUID::Find(uuid, &id) || !IsKnownId(id)) {
     return ErrorStatus(StatusCode::NOT_FOUND, "Unknown UUID: $0", uuid);
   }
-  auto old_z_index = uuids_.ZIndexOf(uuid);
-  auto elsrng = uuids_.SortedElements();
-  auto next_itr = elsrng.begin() + old_z_index + 1;
-  *above_uuid = next_itr == elsrng.end() ? kInvalidUUID : *next_itr;
+  auto above_id = uuids_.GetIdAbove(id);
+  *above_uuid = above_id ? above_id->str() : kInvalidUUID;
 
   return OkStatus();
 }
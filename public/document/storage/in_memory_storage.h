@@ -17,15 +17,19 @@
 #ifndef INK_PUBLIC_DOCUMENT_STORAGE_IN_MEMORY_STORAGE_H_
 #define INK_PUBLIC_DOCUMENT_STORAGE_IN_MEMORY_STORAGE_H_
 
+#include <functional>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
+#include "ink/engine/public/types/interned_uuid.h"
 #include "ink/engine/public/types/status.h"
 #include "ink/engine/scene/types/element_index.h"
 #include "ink/engine/util/security.h"
 #include "ink/proto/document_portable_proto.pb.h"
 #include "ink/proto/elements_portable_proto.pb.h"
 #include "ink/public/document/storage/document_storage.h"
+#include "ink/public/document/storage/snapshot_reader.h"
+#include "ink/public/fingerprint/fingerprint.h"
 
 namespace ink {
 
@@ -36,9 +40,15 @@ class InMemoryStorage : public DocumentStorage {
   std::string ToString() const override { return "<InMemoryStorage>"; }
 
   bool SupportsSnapshot() const override { return true; }
+  bool SupportsLiveElementStats() const override { return true; }
+  size_t LiveElementCount() const override { return live_element_count_; }
+  uint64_t LiveElementFingerprint() const override {
+    return live_element_fingerprint_.GetFingerprint();
+  }
   void WriteToProto(ink::proto::Snapshot* proto,
                     SnapshotQuery q) const override;
   Status ReadFromProto(const ink::proto::Snapshot& proto) override;
+  Status ReadFromSnapshotReader(const SnapshotReader& reader) override;
 
  protected:
   S_WARN_UNUSED_RESULT Status
@@ -46,25 +56,26 @@ class InMemoryStorage : public DocumentStorage {
   S_WARN_UNUSED_RESULT Status ClearPages() override;
   S_WARN_UNUSED_RESULT Status
   AddImpl(const std::vector<const ink::proto::ElementBundle*>& bundles,
-          const std::vector<UUID>& add_below_uuids) override;
+          const std::vector<InternedUUID>& add_below_uuids) override;
   S_WARN_UNUSED_RESULT Status
-  RemoveImpl(const std::vector<const UUID*>& uuids) override;
+  RemoveImpl(const std::vector<InternedUUID>& uuids) override;
   S_WARN_UNUSED_RESULT Status SetLivenessImpl(
-      const std::vector<const UUID*>& uuids, Liveness liveness) override;
+      const std::vector<InternedUUID>& uuids, Liveness liveness) override;
   S_WARN_UNUSED_RESULT Status SetTransformsImpl(
-      const std::vector<const UUID*>& uuids,
+      const std::vector<InternedUUID>& uuids,
       const std::vector<const proto::AffineTransform*>& transforms) override;
   S_WARN_UNUSED_RESULT Status GetBundlesImpl(
-      const std::vector<const UUID*>& uuids,
+      const std::vector<InternedUUID>& uuids,
       BundleDataAttachments data_attachments, LivenessFilter liveness_filter,
       std::vector<proto::ElementBundle>* result) const override;
   S_WARN_UNUSED_RESULT Status GetAllBundles(
       BundleDataAttachments data_attachments, LivenessFilter liveness_filter,
       std::vector<proto::ElementBundle>* result) const override;
-  S_WARN_UNUSED_RESULT Status
-  RemoveDeadElementsImpl(const std::vector<const UUID*>& keep_alive) override;
+  S_WARN_UNUSED_RESULT Status RemoveDeadElementsImpl(
+      const std::vector<InternedUUID>& keep_alive) override;
 
-  S_WARN_UNUSED_RESULT bool IsAlive(const UUID& uuid) const override;
+  using DocumentStorage::IsAlive;
+  S_WARN_UNUSED_RESULT bool IsAlive(const InternedUUID& uuid) const override;
   S_WARN_UNUSED_RESULT bool IsEmpty() const override;
 
   S_WARN_UNUSED_RESULT Status
@@ -72,14 +83,15 @@ class InMemoryStorage : public DocumentStorage {
   proto::PageProperties GetPageProperties() const override;
 
   S_WARN_UNUSED_RESULT Status
-  SetVisibilities(const std::vector<UUID>& uuids,
+  SetVisibilities(const std::vector<InternedUUID>& uuids,
                   const std::vector<bool>& visibilities) override;
   S_WARN_UNUSED_RESULT Status
-  SetOpacities(const std::vector<UUID>& uuids,
+  SetOpacities(const std::vector<InternedUUID>& uuids,
                const std::vector<int>& opacities) override;
-  S_WARN_UNUSED_RESULT Status ChangeZOrders(
-      const std::vector<UUID>& uuids, const std::vector<UUID>& below_uuids,
-      std::vector<UUID>* old_below_uuids) override;
+  S_WARN_UNUSED_RESULT Status
+  ChangeZOrders(const std::vector<InternedUUID>& uuids,
+                const std::vector<InternedUUID>& below_uuids,
+                std::vector<InternedUUID>* old_below_uuids) override;
   S_WARN_UNUSED_RESULT Status FindBundleAboveUUID(const UUID& uuid,
                                                   UUID* above_uuid) override;
 
@@ -87,18 +99,47 @@ class InMemoryStorage : public DocumentStorage {
   S_WARN_UNUSED_RESULT UUID GetActiveLayer() const override;
 
  private:
-  Status GetBundles(const std::vector<UUID>& uuids,
+  // Fetches the bundle at the given index. If the bundle has to be parsed, it
+  // is parsed into scratch, and *bundle points to scratch.
+  using BundleGetter =
+      std::function<Status(int index, proto::ElementBundle* scratch,
+                           const proto::ElementBundle** bundle)>;
+
+  // Replaces the contents of this storage with a snapshot, whose elements and
+  // dead elements are fetched with the given getters. The element and
+  // dead_element fields of the header are ignored.
+  Status ReadSnapshot(const ink::proto::Snapshot& header, int element_count,
+                      int dead_element_count, const BundleGetter& get_element,
+                      const BundleGetter& get_dead_element);
+
+  // The elements are keyed by InternedUUID, which DocumentStorage passes to
+  // the Impl methods, so that lookups hash a pointer rather than a string.
+  struct StoredElement {
+    proto::ElementBundle bundle;
+    Liveness liveness;
+  };
+
+  Status GetBundles(const std::vector<InternedUUID>& ids,
                     BundleDataAttachments data_attachments,
                     LivenessFilter liveness_filter,
                     std::vector<proto::ElementBundle>* result) const;
-  Status GetBundle(const UUID& id, BundleDataAttachments data_attachments,
+  Status GetBundle(InternedUUID id, BundleDataAttachments data_attachments,
                    proto::ElementBundle* result) const;
-  bool IsKnownId(const UUID& id) const;
+  bool IsKnownId(const InternedUUID& id) const;
+  // Returns the element with the given uuid, or nullptr if it is not known.
+  const StoredElement* FindElement(const InternedUUID& id) const;
+  StoredElement* FindElement(const InternedUUID& id);
+
+  // Update the live element count and fingerprint when the given element
+  // becomes live or stops being live.
+  void NoteLive(const proto::ElementBundle& bundle);
+  void NoteNotLive(const proto::ElementBundle& bundle);
 
  private:
-  ElementIndex<UUID> uuids_;
-  std::unordered_map<UUID, proto::ElementBundle> uuid_to_bundle_;
-  std::unordered_map<UUID, Liveness> uuid_to_liveness_;
+  ElementIndex<InternedUUID> uuids_;
+  InternedUUIDHashMap<StoredElement> elements_;
+  size_t live_element_count_ = 0;
+  IncrementalFingerprint live_element_fingerprint_;
   proto::PageProperties page_properties_;
   std::vector<ink::proto::PerPageProperties> pages_;
 
@@ -31,7 +31,7 @@ class MockStorageAction : public StorageAction {
       std::shared_ptr<EventDispatch<IElementListener>> dispatch,
       std::shared_ptr<EventDispatch<IMutationListener>> mutation_dispatch)
       : StorageAction(storage, dispatch, mutation_dispatch) {}
-  MOCK_CONST_METHOD0(AffectedUUIDs, std::vector<UUID>());
+  MOCK_CONST_METHOD0(AffectedUUIDs, std::vector<InternedUUID>());
   MOCK_METHOD0(UndoImpl, Status());
   MOCK_METHOD0(RedoImpl, Status());
 
@@ -0,0 +1,235 @@
+// Copyright 2018 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ink/public/document/storage/snapshot_reader.h"
+
+// Files are memory-mapped on the POSIX platforms that support it. Elsewhere
+// (e.g. the web, where mmap() is emulated by copying the file, and NaCl), they
+// are read into a buffer.
+#if defined(__linux__) || defined(__ANDROID__) || defined(__APPLE__)
+#define INK_SNAPSHOT_READER_HAS_MMAP 1
+#else
+#define INK_SNAPSHOT_READER_HAS_MMAP 0
+#endif
+
+#if INK_SNAPSHOT_READER_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "ink/engine/util/dbg/log.h"
+
+namespace ink {
+namespace {
+
+// Protocol buffer wire types. Groups (3 and 4) are deprecated, and are not used
+// by Snapshot.
+enum WireType {
+  kVarint = 0,
+  kFixed64 = 1,
+  kLengthDelimited = 2,
+  kFixed32 = 5,
+};
+
+// Reads a base-128 varint starting at *pos, and advances *pos past it. Returns
+// false if the varint is malformed or runs past end.
+bool ReadVarint(const char** pos, const char* end, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && *pos < end; shift += 7) {
+    uint8_t byte = static_cast<uint8_t>(*(*pos)++);
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+#if INK_SNAPSHOT_READER_HAS_MMAP
+
+/* static */ Status SnapshotReader::OpenFile(
+    const std::string& path, std::unique_ptr<SnapshotReader>* out) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return ErrorStatus(StatusCode::NOT_FOUND, "Could not open $0: $1", path,
+                       std::strerror(errno));
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    int stat_errno = errno;
+    close(fd);
+    return ErrorStatus(StatusCode::INTERNAL, "Could not stat $0: $1", path,
+                       std::strerror(stat_errno));
+  }
+
+  std::unique_ptr<SnapshotReader> reader(new SnapshotReader());
+  size_t size = file_stat.st_size;
+  // An empty file is an empty snapshot; mmap() does not accept a zero length.
+  if (size > 0) {
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      int mmap_errno = errno;
+      close(fd);
+      return ErrorStatus(StatusCode::INTERNAL, "Could not map $0: $1", path,
+                         std::strerror(mmap_errno));
+    }
+    // The bundles are visited in order, so let the kernel read ahead.
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    reader->mapped_data_ = mapped;
+    reader->mapped_size_ = size;
+    reader->data_ = absl::string_view(static_cast<const char*>(mapped), size);
+  }
+  // The mapping holds its own reference to the file.
+  close(fd);
+
+  INK_RETURN_UNLESS(reader->Index());
+  *out = std::move(reader);
+  return OkStatus();
+}
+
+#else  // INK_SNAPSHOT_READER_HAS_MMAP
+
+/* static */ Status SnapshotReader::OpenFile(
+    const std::string& path, std::unique_ptr<SnapshotReader>* out) {
+  std::FILE* file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return ErrorStatus(StatusCode::NOT_FOUND, "Could not open $0: $1", path,
+                       std::strerror(errno));
+  }
+  std::unique_ptr<SnapshotReader> reader(new SnapshotReader());
+  char chunk[64 * 1024];
+  size_t n_read;
+  while ((n_read = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+    reader->file_contents_.append(chunk, n_read);
+  bool read_failed = std::ferror(file) != 0;
+  std::fclose(file);
+  if (read_failed) {
+    return ErrorStatus(StatusCode::INTERNAL, "Could not read $0", path);
+  }
+  // From here on, this is the same as FromBuffer(), with a buffer that the
+  // reader owns.
+  reader->data_ = reader->file_contents_;
+
+  INK_RETURN_UNLESS(reader->Index());
+  *out = std::move(reader);
+  return OkStatus();
+}
+
+#endif  // INK_SNAPSHOT_READER_HAS_MMAP
+
+/* static */ Status SnapshotReader::FromBuffer(
+    absl::string_view serialized, std::unique_ptr<SnapshotReader>* out) {
+  std::unique_ptr<SnapshotReader> reader(new SnapshotReader());
+  reader->data_ = serialized;
+  INK_RETURN_UNLESS(reader->Index());
+  *out = std::move(reader);
+  return OkStatus();
+}
+
+/* static */ Status SnapshotReader::ParseBundle(absl::string_view bytes,
+                                                proto::ElementBundle* bundle) {
+  if (!bundle->ParseFromArray(bytes.data(), bytes.size())) {
+    return ErrorStatus(StatusCode::INVALID_ARGUMENT,
+                       "Could not parse ElementBundle ($0 bytes)",
+                       bytes.size());
+  }
+  return OkStatus();
+}
+
+SnapshotReader::~SnapshotReader() {
+#if INK_SNAPSHOT_READER_HAS_MMAP
+  if (mapped_data_ != nullptr) munmap(mapped_data_, mapped_size_);
+#endif
+}
+
+Status SnapshotReader::Index() {
+  // The fields other than element and dead_element are copied, still
+  // serialized, into header_bytes. Because concatenating serialized messages
+  // merges them, parsing header_bytes gives the snapshot without its bundles.
+  std::string header_bytes;
+  const char* pos = data_.data();
+  const char* end = data_.data() + data_.size();
+  while (pos < end) {
+    const char* field_start = pos;
+    uint64_t tag;
+    if (!ReadVarint(&pos, end, &tag) || (tag >> 3) == 0) {
+      return ErrorStatus(StatusCode::INVALID_ARGUMENT,
+                         "Malformed tag at offset $0 of Snapshot",
+                         field_start - data_.data());
+    }
+    int field_number = tag >> 3;
+    uint64_t unused_varint;
+    switch (tag & 7) {
+      case kVarint:
+        if (!ReadVarint(&pos, end, &unused_varint)) {
+          return ErrorStatus(StatusCode::INVALID_ARGUMENT,
+                             "Malformed varint in field $0 of Snapshot",
+                             field_number);
+        }
+        break;
+      case kFixed64:
+      case kFixed32: {
+        size_t size = (tag & 7) == kFixed64 ? 8 : 4;
+        if (static_cast<size_t>(end - pos) < size) {
+          return ErrorStatus(StatusCode::INVALID_ARGUMENT,
+                             "Truncated field $0 of Snapshot", field_number);
+        }
+        pos += size;
+        break;
+      }
+      case kLengthDelimited: {
+        uint64_t length;
+        if (!ReadVarint(&pos, end, &length) ||
+            length > static_cast<uint64_t>(end - pos)) {
+          return ErrorStatus(StatusCode::INVALID_ARGUMENT,
+                             "Truncated field $0 of Snapshot", field_number);
+        }
+        absl::string_view payload(pos, length);
+        pos += length;
+        if (field_number == proto::Snapshot::kElementFieldNumber) {
+          elements_.push_back(payload);
+          continue;
+        }
+        if (field_number == proto::Snapshot::kDeadElementFieldNumber) {
+          dead_elements_.push_back(payload);
+          continue;
+        }
+        break;
+      }
+      default:
+        return ErrorStatus(StatusCode::INVALID_ARGUMENT,
+                           "Unsupported wire type $0 in field $1 of Snapshot",
+                           tag & 7, field_number);
+    }
+    header_bytes.append(field_start, pos - field_start);
+  }
+
+  if (!header_.ParseFromString(header_bytes)) {
+    return ErrorStatus(StatusCode::INVALID_ARGUMENT,
+                       "Could not parse Snapshot header");
+  }
+  SLOG(SLOG_DOCUMENT, "indexed snapshot: $0 elements, $1 dead elements",
+       elements_.size(), dead_elements_.size());
+  return OkStatus();
+}
+
+}  // namespace ink
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef INK_PUBLIC_DOCUMENT_STORAGE_SNAPSHOT_READER_H_
+#define INK_PUBLIC_DOCUMENT_STORAGE_SNAPSHOT_READER_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "third_party/absl/strings/string_view.h"
+#include "ink/engine/public/types/status.h"
+#include "ink/proto/document_portable_proto.pb.h"
+#include "ink/proto/elements_portable_proto.pb.h"
+
+namespace ink {
+
+// SnapshotReader gives access to a serialized proto::Snapshot without parsing
+// it into a single proto. The serialized snapshot is either read from a file
+// (which is memory-mapped where mmap() is available) or borrowed from a
+// caller-owned buffer.
+//
+// When the reader is created, it walks the top-level fields of the snapshot,
+// reading only their tags and lengths. The element and dead_element bundles
+// are not parsed; instead, the reader keeps zero-copy views of their bytes,
+// which can be parsed one at a time with ParseBundle(). This means that the
+// bundles (and their mesh blobs) need never be held in memory all at once, and
+// that a caller can start using the first bundles before it has parsed the
+// rest. All other fields are small, and are parsed eagerly into Header().
+//
+// SnapshotReader is not thread-safe, but its const methods may be called
+// concurrently.
+class SnapshotReader {
+ public:
+  // Memory-maps the file at the given path. The mapping is read-only, and
+  // remains valid until the reader is destroyed. On platforms without mmap()
+  // (see snapshot_reader.cc), the file is instead read into a buffer that the
+  // reader owns.
+  static S_WARN_UNUSED_RESULT Status
+  OpenFile(const std::string& path, std::unique_ptr<SnapshotReader>* out);
+
+  // Reads from the given buffer, which must outlive the reader.
+  static S_WARN_UNUSED_RESULT Status FromBuffer(
+      absl::string_view serialized, std::unique_ptr<SnapshotReader>* out);
+
+  // Parses the serialized bytes of an ElementBundle, as returned by
+  // ElementBytes() or DeadElementBytes(), into bundle.
+  static S_WARN_UNUSED_RESULT Status ParseBundle(absl::string_view bytes,
+                                                 proto::ElementBundle* bundle);
+
+  ~SnapshotReader();
+
+  // Disallow copy and assign.
+  SnapshotReader(const SnapshotReader&) = delete;
+  SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+  // The snapshot, with the element and dead_element fields left empty.
+  const proto::Snapshot& Header() const { return header_; }
+
+  size_t ElementCount() const { return elements_.size(); }
+  size_t DeadElementCount() const { return dead_elements_.size(); }
+
+  // The serialized bytes of snapshot.element(i) and snapshot.dead_element(i).
+  // These views are valid until the reader is destroyed.
+  absl::string_view ElementBytes(size_t i) const { return elements_[i]; }
+  absl::string_view DeadElementBytes(size_t i) const {
+    return dead_elements_[i];
+  }
+
+ private:
+  SnapshotReader() {}
+
+  // Walks the top-level fields of data_, populating the element views and
+  // parsing the remaining fields into header_.
+  Status Index();
+
+  absl::string_view data_;
+
+  // The memory-mapped file, if this reader was created with OpenFile().
+  void* mapped_data_ = nullptr;
+  size_t mapped_size_ = 0;
+  // The contents of the file, if this reader was created with OpenFile() on a
+  // platform without mmap().
+  std::string file_contents_;
+
+  proto::Snapshot header_;
+  std::vector<absl::string_view> elements_;
+  std::vector<absl::string_view> dead_elements_;
+};
+
+}  // namespace ink
+
+#endif  // INK_PUBLIC_DOCUMENT_STORAGE_SNAPSHOT_READER_H_
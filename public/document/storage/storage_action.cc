@@ -17,6 +17,8 @@
 #include <algorithm>
 #include <iterator>
 
+#include "third_party/absl/container/flat_hash_map.h"
+#include "third_party/absl/strings/string_view.h"
 #include "ink/engine/scene/types/element_metadata.h"
 #include "ink/engine/util/dbg/errors.h"
 #include "ink/engine/util/dbg/log.h"
@@ -49,19 +51,30 @@ namespace {
 // Given a z-ordered list of UUIDs, return a vector of pairs {uuid[N],
 // uuid[N+1]}, where the last pair is {uuid[uuids.size()-1], below}.
 template <typename T>
-StorageAction::UUIDOrder OrderedElementPairs(const T& uuids, UUID below) {
+StorageAction::UUIDOrder OrderedElementPairs(const T& uuids,
+                                             const InternedUUID& below) {
   StorageAction::UUIDOrder uuid_order;
   for (int i = uuids.size() - 1; i >= 0; i--) {
-    const UUID below_uuid = (i == uuids.size() - 1) ? below : uuids[i + 1];
+    const InternedUUID& below_uuid =
+        (i == uuids.size() - 1) ? below : uuids[i + 1];
     uuid_order.emplace_back(uuids[i], below_uuid);
   }
   return uuid_order;
 }
 
+// Interns the UUIDs of a repeated proto field.
+template <typename RepeatedPtrField>
+std::vector<InternedUUID> InternProtoUUIDs(const RepeatedPtrField& uuids) {
+  std::vector<InternedUUID> result;
+  result.reserve(uuids.size());
+  for (const auto& uuid : uuids) result.emplace_back(uuid);
+  return result;
+}
+
 // Returns the list of UUIDs to be removed from a list of UUID orders.
-std::vector<UUID> GetUUIDsFromUUIDOrder(
+std::vector<InternedUUID> GetUUIDsFromUUIDOrder(
     const StorageAction::UUIDOrder& uuid_order) {
-  std::vector<UUID> uuids;
+  std::vector<InternedUUID> uuids;
   uuids.reserve(uuid_order.size());
   for (const auto& remove_order : uuid_order)
     uuids.push_back(remove_order.uuid);
@@ -70,14 +83,17 @@ std::vector<UUID> GetUUIDsFromUUIDOrder(
 
 // This helper function removes the given UUIDs from storage, and populates the
 // UUIDOrder with the removed UUIDs and UUIDs of the element above them.
-Status RemoveHelper(const std::vector<UUID>& uuids, DocumentStorage* storage,
+Status RemoveHelper(const std::vector<InternedUUID>& uuids,
+                    DocumentStorage* storage,
                     StorageAction::UUIDOrder* uuid_order) {
   // Don't remove something that's already gone; it will create a bogus
   // action on the undo stack. (b/30693520)
-  std::unordered_set<UUID> live_uuids;
-  for (const UUID& uuid : uuids) {
+  // The bundles below are returned with string UUIDs, so the live uuids are
+  // keyed by their strings, which the InternedUUIDs hold.
+  absl::flat_hash_map<absl::string_view, InternedUUID> live_uuids;
+  for (const InternedUUID& uuid : uuids) {
     if (storage->IsAlive(uuid)) {
-      live_uuids.emplace(uuid);
+      live_uuids.emplace(uuid.str(), uuid);
     } else {
       SLOG(SLOG_WARNING, "skipping already-dead $0", uuid);
     }
@@ -96,18 +112,43 @@ Status RemoveHelper(const std::vector<UUID>& uuids, DocumentStorage* storage,
   for (int i = 0; i < all_bundles.size(); ++i) {
     auto live_uuid_it = live_uuids.find(all_bundles[i].uuid());
     if (live_uuid_it != live_uuids.end()) {
-      UUID uuid_above = kInvalidUUID;
-      if (i != all_bundles.size() - 1) uuid_above = all_bundles[i + 1].uuid();
-      uuid_order->emplace_back(*live_uuid_it, uuid_above);
+      InternedUUID uuid_above;
+      if (i != all_bundles.size() - 1) {
+        uuid_above = InternedUUID(all_bundles[i + 1].uuid());
+      }
+      uuid_order->emplace_back(live_uuid_it->second, uuid_above);
 
       // If we've already found all of the elements we're looking for, we don't
       // need to iterate over the remaining ones.
       if (uuid_order->size() == live_uuids.size()) break;
     }
   }
-  return storage->SetLiveness(MakeSTLRange(live_uuids), Liveness::kDead);
+  std::vector<InternedUUID> live_uuid_list;
+  live_uuid_list.reserve(live_uuids.size());
+  for (const auto& live_uuid : live_uuids) {
+    live_uuid_list.push_back(live_uuid.second);
+  }
+  return storage->SetLiveness(MakeSTLRange(live_uuid_list), Liveness::kDead);
+}
+
+// The UUID strings are held by the InternedUUID pool, and shared with the
+// storage, so only the handles are counted.
+size_t UUIDBytes(const std::vector<InternedUUID>& uuids) {
+  return uuids.capacity() * sizeof(InternedUUID);
 }
 
+size_t UUIDOrderBytes(const StorageAction::UUIDOrder& uuid_order) {
+  return uuid_order.capacity() * sizeof(RemovedUUID);
+}
+
+template <typename T>
+size_t VectorBytes(const std::vector<T>& v) {
+  return v.capacity() * sizeof(T);
+}
+
+// std::vector<bool> is packed.
+size_t VectorBytes(const std::vector<bool>& v) { return v.capacity() / 8; }
+
 }  // namespace
 
 proto::SourceDetails HostSource() {
@@ -118,11 +159,14 @@ proto::SourceDetails HostSource() {
 
 void StorageAction::NotifyHostAdd(UUIDOrder uuid_order,
                                   const proto::SourceDetails& source) {
-  std::vector<UUID> keys;
-  std::unordered_map<UUID, UUID> uuid_to_below_uuid;
+  std::vector<InternedUUID> keys;
+  // GetBundles returns the bundles with string UUIDs.
+  absl::flat_hash_map<absl::string_view, const InternedUUID*>
+      uuid_to_below_uuid;
   for (const auto& removed_uuid : uuid_order) {
     keys.push_back(removed_uuid.uuid);
-    uuid_to_below_uuid.emplace(removed_uuid.uuid, removed_uuid.was_below_uuid);
+    uuid_to_below_uuid.emplace(removed_uuid.uuid.str(),
+                               &removed_uuid.was_below_uuid);
   }
 
   std::vector<proto::ElementBundle> bundles;
@@ -137,7 +181,7 @@ void StorageAction::NotifyHostAdd(UUIDOrder uuid_order,
     // them.
     for (auto bi = bundles.rbegin(); bi != bundles.rend(); bi++) {
       const auto& bundle = *bi;
-      const auto& below_uuid = uuid_to_below_uuid.at(bundle.uuid());
+      const UUID& below_uuid = uuid_to_below_uuid.at(bundle.uuid())->str();
 
       auto* mutation_element = mutation.add_chunk()->mutable_add_element();
       *(mutation_element->mutable_element()) = bundle;
@@ -152,13 +196,14 @@ void StorageAction::NotifyHostAdd(UUIDOrder uuid_order,
   }
 }
 
-void StorageAction::NotifyHostRemove(std::vector<UUID> removed_uuids,
-                                     const proto::SourceDetails& source) {
+void StorageAction::NotifyHostRemove(
+    const std::vector<InternedUUID>& removed_uuids,
+    const proto::SourceDetails& source) {
   proto::ElementIdList removed_ids;
   proto::mutations::Mutation mutation;
   for (const auto& uuid : removed_uuids) {
-    *removed_ids.add_uuid() = uuid;
-    mutation.add_chunk()->mutable_remove_element()->set_uuid(uuid);
+    *removed_ids.add_uuid() = uuid.str();
+    mutation.add_chunk()->mutable_remove_element()->set_uuid(uuid.str());
   }
   element_dispatch_->Send(&IElementListener::ElementsRemoved, removed_ids,
                           source);
@@ -166,7 +211,8 @@ void StorageAction::NotifyHostRemove(std::vector<UUID> removed_uuids,
 }
 
 void SetTransformAction::NotifyHost(
-    std::vector<UUID> uuids, std::vector<proto::AffineTransform> transforms,
+    const std::vector<InternedUUID>& uuids,
+    const std::vector<proto::AffineTransform>& transforms,
     const proto::SourceDetails& source) {
   EXPECT(uuids.size() == transforms.size());
 
@@ -174,12 +220,12 @@ void SetTransformAction::NotifyHost(
   proto::ElementTransformMutations element_mutations;
   for (size_t i = 0; i < uuids.size(); i++) {
     auto* element_mutation = element_mutations.add_mutation();
-    element_mutation->set_uuid(uuids[i]);
+    element_mutation->set_uuid(uuids[i].str());
     *element_mutation->mutable_transform() = transforms[i];
 
     auto* mu_set_transform =
         mutation.add_chunk()->mutable_set_element_transform();
-    mu_set_transform->set_uuid(uuids[i]);
+    mu_set_transform->set_uuid(uuids[i].str());
     *mu_set_transform->mutable_transform() = transforms[i];
   }
 
@@ -240,6 +286,10 @@ void StorageAction::WriteToProto(proto::StorageAction* proto) {
 
 StorageAction::State StorageAction::state() const { return state_; }
 
+size_t StorageAction::MemoryBytes() const {
+  return sizeof(StorageAction) + UUIDBytes(AffectedUUIDs());
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -250,15 +300,15 @@ AddAction::AddAction(
     : StorageAction(storage, element_dispatch, mutation_dispatch) {}
 
 Status AddAction::Apply(const std::vector<ink::proto::ElementBundle>& bundles,
-                        const UUID& below_element_with_uuid,
+                        const InternedUUID& below_element_with_uuid,
                         const proto::SourceDetails& source) {
   for (int i = 0; i < bundles.size(); ++i) {
-    uuids_.push_back(bundles[i].uuid());
+    uuids_.emplace_back(bundles[i].uuid());
   }
 
   below_element_with_uuid_ = below_element_with_uuid;
   INK_RETURN_UNLESS(
-      storage_->Add(MakeSTLRange(bundles), below_element_with_uuid));
+      storage_->Add(MakeSTLRange(bundles), below_element_with_uuid_));
   state_ = State::kApplied;
   NotifyHostAdd(OrderedElementPairs(uuids_, below_element_with_uuid_), source);
   return OkStatus();
@@ -267,7 +317,7 @@ Status AddAction::Apply(const std::vector<ink::proto::ElementBundle>& bundles,
 Status AddAction::UndoImpl() {
   INK_RETURN_UNLESS(
       storage_->SetLiveness(MakeSTLRange(uuids_), Liveness::kDead));
-  NotifyHostRemove({uuids_}, HostSource());
+  NotifyHostRemove(uuids_, HostSource());
   return OkStatus();
 }
 
@@ -280,35 +330,37 @@ Status AddAction::RedoImpl() {
   return OkStatus();
 }
 
-std::vector<UUID> AddAction::AffectedUUIDs() const { return uuids_; }
+std::vector<InternedUUID> AddAction::AffectedUUIDs() const {
+  return uuids_;
+}
 
 void AddAction::RestoreFieldsFromProto(const proto::StorageAction& proto) {
   uuids_.clear();
   if (proto.has_add_action()) {
     const auto& add = proto.add_action();
     uuids_.emplace_back(add.uuid());
-    below_element_with_uuid_ = add.below_element_with_uuid();
+    below_element_with_uuid_ = InternedUUID(add.below_element_with_uuid());
   } else {
     const auto& add = proto.add_multiple_action();
     for (int i = 0; i < add.uuid_size(); i++) {
       uuids_.emplace_back(add.uuid(i));
     }
-    below_element_with_uuid_ = add.below_element_with_uuid();
+    below_element_with_uuid_ = InternedUUID(add.below_element_with_uuid());
   }
 }
 
 void AddAction::WriteFieldsToProto(proto::StorageAction* proto) const {
   if (uuids_.size() == 1) {
     // Use old Add proto to remain compatible with Keep server.
-    proto->mutable_add_action()->set_uuid(uuids_[0]);
+    proto->mutable_add_action()->set_uuid(uuids_[0].str());
     proto->mutable_add_action()->set_below_element_with_uuid(
-        below_element_with_uuid_);
+        below_element_with_uuid_.str());
   } else {
     for (auto& uuid : uuids_) {
-      proto->mutable_add_multiple_action()->add_uuid(uuid);
+      proto->mutable_add_multiple_action()->add_uuid(uuid.str());
     }
     proto->mutable_add_multiple_action()->set_below_element_with_uuid(
-        below_element_with_uuid_);
+        below_element_with_uuid_.str());
   }
 }
 
@@ -321,7 +373,7 @@ RemoveAction::RemoveAction(
     std::shared_ptr<EventDispatch<IMutationListener>> mutation_dispatch)
     : StorageAction(storage, element_dispatch, mutation_dispatch) {}
 
-Status RemoveAction::Apply(const std::vector<UUID>& uuids,
+Status RemoveAction::Apply(const std::vector<InternedUUID>& uuids,
                            const proto::SourceDetails& source) {
   INK_RETURN_UNLESS(RemoveHelper(uuids, storage_.get(), &uuid_order_));
   NotifyHostRemove(uuids, source);
@@ -334,7 +386,7 @@ Status RemoveAction::Apply(const std::vector<UUID>& uuids,
 }
 
 Status RemoveAction::UndoImpl() {
-  std::vector<UUID> uuids = GetUUIDsFromUUIDOrder(uuid_order_);
+  std::vector<InternedUUID> uuids = GetUUIDsFromUUIDOrder(uuid_order_);
   INK_RETURN_UNLESS(
       storage_->SetLiveness(MakeSTLRange(uuids), Liveness::kAlive));
   NotifyHostAdd(uuid_order_, HostSource());
@@ -342,7 +394,7 @@ Status RemoveAction::UndoImpl() {
 }
 
 Status RemoveAction::RedoImpl() {
-  std::vector<UUID> uuids = AffectedUUIDs();
+  std::vector<InternedUUID> uuids = AffectedUUIDs();
   INK_RETURN_UNLESS(
       storage_->SetLiveness(MakeSTLRange(uuids), Liveness::kDead));
   NotifyHostRemove(uuids, HostSource());
@@ -351,9 +403,9 @@ Status RemoveAction::RedoImpl() {
 
 void RemoveAction::WriteFieldsToProto(proto::StorageAction* proto) const {
   for (const RemovedUUID& removed_uuid : uuid_order_) {
-    proto->mutable_remove_action()->add_uuid(removed_uuid.uuid);
+    proto->mutable_remove_action()->add_uuid(removed_uuid.uuid.str());
     proto->mutable_remove_action()->add_was_below_uuid(
-        removed_uuid.was_below_uuid);
+        removed_uuid.was_below_uuid.str());
   }
 }
 
@@ -368,8 +420,9 @@ void RemoveAction::RestoreFieldsFromProto(const proto::StorageAction& proto) {
     return;
   }
   for (int i = 0, n = remove.uuid_size(); i < n; i++) {
-    uuid_order_.emplace_back(proto.remove_action().uuid(i),
-                             proto.remove_action().was_below_uuid(i));
+    uuid_order_.emplace_back(
+        InternedUUID(proto.remove_action().uuid(i)),
+        InternedUUID(proto.remove_action().was_below_uuid(i)));
   }
   if (CheckLevel(SLOG_DOCUMENT)) {
     SLOG(SLOG_DOCUMENT, "Remove action restored with:");
@@ -380,10 +433,14 @@ void RemoveAction::RestoreFieldsFromProto(const proto::StorageAction& proto) {
   }
 }
 
-std::vector<UUID> RemoveAction::AffectedUUIDs() const {
+std::vector<InternedUUID> RemoveAction::AffectedUUIDs() const {
   return GetUUIDsFromUUIDOrder(uuid_order_);
 }  // namespace ink
 
+size_t RemoveAction::MemoryBytes() const {
+  return sizeof(RemoveAction) + UUIDOrderBytes(uuid_order_);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -395,8 +452,8 @@ ReplaceAction::ReplaceAction(
 
 Status ReplaceAction::Apply(
     const std::vector<proto::ElementBundle>& elements_to_add,
-    const std::vector<UUID>& uuids_to_add_below,
-    const std::vector<UUID>& uuids_to_remove,
+    const std::vector<InternedUUID>& uuids_to_add_below,
+    const std::vector<InternedUUID>& uuids_to_remove,
     const proto::SourceDetails& source) {
   if (elements_to_add.size() != uuids_to_add_below.size())
     return ErrorStatus(
@@ -407,7 +464,7 @@ Status ReplaceAction::Apply(
   // we might be replacing sequential elements.
   added_uuid_order_.reserve(elements_to_add.size());
   for (int i = 0; i < elements_to_add.size(); ++i)
-    added_uuid_order_.emplace_back(elements_to_add[i].uuid(),
+    added_uuid_order_.emplace_back(InternedUUID(elements_to_add[i].uuid()),
                                    uuids_to_add_below[i]);
   INK_RETURN_UNLESS(
       storage_->Add(MakeSTLRange(elements_to_add), uuids_to_add_below));
@@ -419,21 +476,28 @@ Status ReplaceAction::Apply(
   return OkStatus();
 }
 
-std::vector<UUID> ReplaceAction::AffectedUUIDs() const {
-  std::vector<UUID> uuids;
+std::vector<InternedUUID> ReplaceAction::AffectedUUIDs() const {
+  std::vector<InternedUUID> uuids;
   uuids.reserve(removed_uuid_order_.size() + added_uuid_order_.size());
-  for (const auto uuid_pair : removed_uuid_order_)
+  for (const auto& uuid_pair : removed_uuid_order_)
     uuids.emplace_back(uuid_pair.uuid);
-  for (const auto uuid_pair : added_uuid_order_)
+  for (const auto& uuid_pair : added_uuid_order_)
     uuids.emplace_back(uuid_pair.uuid);
   return uuids;
 }
 
+size_t ReplaceAction::MemoryBytes() const {
+  return sizeof(ReplaceAction) + UUIDOrderBytes(removed_uuid_order_) +
+         UUIDOrderBytes(added_uuid_order_);
+}
+
 Status ReplaceAction::UndoImpl() {
-  std::vector<UUID> removed_uuids = GetUUIDsFromUUIDOrder(removed_uuid_order_);
+  std::vector<InternedUUID> removed_uuids =
+      GetUUIDsFromUUIDOrder(removed_uuid_order_);
   INK_RETURN_UNLESS(
       storage_->SetLiveness(MakeSTLRange(removed_uuids), Liveness::kAlive));
-  std::vector<UUID> added_uuids = GetUUIDsFromUUIDOrder(added_uuid_order_);
+  std::vector<InternedUUID> added_uuids =
+      GetUUIDsFromUUIDOrder(added_uuid_order_);
   INK_RETURN_UNLESS(
       storage_->SetLiveness(MakeSTLRange(added_uuids), Liveness::kDead));
 
@@ -443,10 +507,12 @@ Status ReplaceAction::UndoImpl() {
 }
 
 Status ReplaceAction::RedoImpl() {
-  std::vector<UUID> removed_uuids = GetUUIDsFromUUIDOrder(removed_uuid_order_);
+  std::vector<InternedUUID> removed_uuids =
+      GetUUIDsFromUUIDOrder(removed_uuid_order_);
   INK_RETURN_UNLESS(
       storage_->SetLiveness(MakeSTLRange(removed_uuids), Liveness::kDead));
-  std::vector<UUID> added_uuids = GetUUIDsFromUUIDOrder(added_uuid_order_);
+  std::vector<InternedUUID> added_uuids =
+      GetUUIDsFromUUIDOrder(added_uuid_order_);
   INK_RETURN_UNLESS(
       storage_->SetLiveness(MakeSTLRange(added_uuids), Liveness::kAlive));
 
@@ -479,37 +545,41 @@ void ReplaceAction::RestoreFieldsFromProto(
     return;
   }
   for (int i = 0, n = replace_proto.removed_uuid_size(); i < n; i++) {
-    removed_uuid_order_.emplace_back(replace_proto.removed_uuid(i),
-                                     replace_proto.removed_was_below_uuid(i));
+    removed_uuid_order_.emplace_back(
+        InternedUUID(replace_proto.removed_uuid(i)),
+        InternedUUID(replace_proto.removed_was_below_uuid(i)));
   }
   for (int i = 0, n = replace_proto.added_uuid_size(); i < n; i++) {
-    added_uuid_order_.emplace_back(replace_proto.added_uuid(i),
-                                   replace_proto.added_was_below_uuid(i));
+    added_uuid_order_.emplace_back(
+        InternedUUID(replace_proto.added_uuid(i)),
+        InternedUUID(replace_proto.added_was_below_uuid(i)));
   }
 }
 
 void ReplaceAction::WriteFieldsToProto(ink::proto::StorageAction* proto) const {
   for (const auto& uuid_pair : removed_uuid_order_) {
-    proto->mutable_replace_action()->add_removed_uuid(uuid_pair.uuid);
+    proto->mutable_replace_action()->add_removed_uuid(uuid_pair.uuid.str());
     proto->mutable_replace_action()->add_removed_was_below_uuid(
-        uuid_pair.was_below_uuid);
+        uuid_pair.was_below_uuid.str());
   }
   for (const auto& uuid_pair : removed_uuid_order_) {
-    proto->mutable_replace_action()->add_added_uuid(uuid_pair.uuid);
+    proto->mutable_replace_action()->add_added_uuid(uuid_pair.uuid.str());
     proto->mutable_replace_action()->add_added_was_below_uuid(
-        uuid_pair.was_below_uuid);
+        uuid_pair.was_below_uuid.str());
   }
 }
 
 void ReplaceAction::NotifyHost(
     const UUIDOrder& removed_uuids, const UUIDOrder& added_uuids,
     const proto::SourceDetails& source_details) const {
-  std::vector<UUID> bundles_to_fetch;
+  std::vector<InternedUUID> bundles_to_fetch;
   bundles_to_fetch.reserve(added_uuids.size());
-  std::unordered_map<UUID, UUID> added_uuid_to_below_uuid;
+  // GetBundles returns the bundles with string UUIDs.
+  absl::flat_hash_map<absl::string_view, const InternedUUID*>
+      added_uuid_to_below_uuid;
   for (const auto& uuid_pair : added_uuids) {
     bundles_to_fetch.emplace_back(uuid_pair.uuid);
-    added_uuid_to_below_uuid[uuid_pair.uuid] = uuid_pair.was_below_uuid;
+    added_uuid_to_below_uuid[uuid_pair.uuid.str()] = &uuid_pair.was_below_uuid;
   }
 
   std::vector<proto::ElementBundle> bundles;
@@ -523,7 +593,8 @@ void ReplaceAction::NotifyHost(
     for (auto it = bundles.rbegin(); it != bundles.rend(); ++it) {
       const auto& bundle = *it;
       ASSERT(added_uuid_to_below_uuid.count(bundle.uuid()) > 0);
-      UUID add_below_uuid = added_uuid_to_below_uuid[bundle.uuid()];
+      const UUID& add_below_uuid =
+          added_uuid_to_below_uuid[bundle.uuid()]->str();
       ProtoHelpers::AddElementBundleAdd(bundle, add_below_uuid,
                                         replace.mutable_elements_to_add());
       auto* add_element = mutation.add_chunk()->mutable_add_element();
@@ -531,8 +602,9 @@ void ReplaceAction::NotifyHost(
       add_element->set_below_element_with_uuid(add_below_uuid);
     }
     for (const auto& uuid_pair : removed_uuids) {
-      replace.mutable_elements_to_remove()->add_uuid(uuid_pair.uuid);
-      mutation.add_chunk()->mutable_remove_element()->set_uuid(uuid_pair.uuid);
+      replace.mutable_elements_to_remove()->add_uuid(uuid_pair.uuid.str());
+      mutation.add_chunk()->mutable_remove_element()->set_uuid(
+          uuid_pair.uuid.str());
     }
 
     element_dispatch_->Send(&IElementListener::ElementsReplaced, replace,
@@ -580,7 +652,7 @@ Status ClearAction::Apply(const proto::SourceDetails& source) {
 Status ClearAction::UndoImpl() {
   INK_RETURN_UNLESS(
       storage_->SetLiveness(MakeSTLRange(uuids_), Liveness::kAlive));
-  NotifyHostAdd(OrderedElementPairs(uuids_, kInvalidUUID), HostSource());
+  NotifyHostAdd(OrderedElementPairs(uuids_, InternedUUID()), HostSource());
   return OkStatus();
 }
 
@@ -591,14 +663,17 @@ Status ClearAction::RedoImpl() {
   return OkStatus();
 }
 
-std::vector<UUID> ClearAction::AffectedUUIDs() const { return uuids_; }
+std::vector<InternedUUID> ClearAction::AffectedUUIDs() const {
+  return uuids_;
+}
 
 void ClearAction::WriteFieldsToProto(proto::StorageAction* proto) const {
-  CopyToProto(uuids_, proto->mutable_clear_action()->mutable_uuid());
+  CopyToProto(UUIDStrings(uuids_),
+              proto->mutable_clear_action()->mutable_uuid());
 }
 
 void ClearAction::RestoreFieldsFromProto(const proto::StorageAction& proto) {
-  CopyToVector(proto.clear_action().uuid(), &uuids_);
+  uuids_ = InternProtoUUIDs(proto.clear_action().uuid());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -611,14 +686,10 @@ SetTransformAction::SetTransformAction(
     : StorageAction(storage, element_dispatch, mutation_dispatch) {}
 
 Status SetTransformAction::Apply(
-    const std::vector<UUID>& uuids,
+    const std::vector<InternedUUID>& uuids,
     const std::vector<proto::AffineTransform>& new_transforms,
     const proto::SourceDetails& source) {
   EXPECT(uuids.size() == new_transforms.size());
-  std::unordered_map<UUID, proto::AffineTransform> uuid_to_new_transform;
-  for (size_t i = 0; i < uuids.size(); i++) {
-    uuid_to_new_transform.emplace(uuids[i], new_transforms[i]);
-  }
 
   // Get a list of what's currently set
   std::unordered_map<UUID, proto::AffineTransform> uuid_to_current_transform;
@@ -638,25 +709,32 @@ Status SetTransformAction::Apply(
 
   // Initialize our member vars based on what we could read and what we're
   // trying to set.
-  uuids_.reserve(uuid_to_current_transform.size());
-  from_transforms_.reserve(uuid_to_current_transform.size());
-  to_transforms_.reserve(uuid_to_current_transform.size());
+  std::vector<InternedUUID> found_uuids;
+  std::vector<proto::AffineTransform> from_transforms;
+  std::vector<proto::AffineTransform> to_transforms;
+  found_uuids.reserve(uuid_to_current_transform.size());
+  from_transforms.reserve(uuid_to_current_transform.size());
+  to_transforms.reserve(uuid_to_current_transform.size());
   // Iterate over the given uuids in given order.
-  for (const auto& uuid : uuids) {
+  for (size_t i = 0; i < uuids.size(); i++) {
     // But skip invalid ones.
-    const auto& current_transform_it = uuid_to_current_transform.find(uuid);
+    const auto& current_transform_it =
+        uuid_to_current_transform.find(uuids[i].str());
     if (current_transform_it == uuid_to_current_transform.end()) continue;
-    uuids_.emplace_back(uuid);
-    from_transforms_.emplace_back(uuid_to_current_transform[uuid]);
-    to_transforms_.emplace_back(uuid_to_new_transform[uuid]);
+    found_uuids.emplace_back(uuids[i]);
+    from_transforms.emplace_back(current_transform_it->second);
+    to_transforms.emplace_back(new_transforms[i]);
   }
 
   // Apply the transform
-  INK_RETURN_UNLESS(storage_->SetTransforms(MakeSTLRange(uuids_),
-                                            MakeSTLRange(to_transforms_)));
+  INK_RETURN_UNLESS(storage_->SetTransforms(MakeSTLRange(found_uuids),
+                                            MakeSTLRange(to_transforms)));
 
-  NotifyHost(uuids_, to_transforms_, source);
+  NotifyHost(found_uuids, to_transforms, source);
 
+  uuids_ = std::make_shared<const std::vector<InternedUUID>>(
+      std::move(found_uuids));
+  SetTransforms(from_transforms, to_transforms);
   state_ = State::kApplied;
   return uuid_to_current_transform.size() == uuids.size()
              ? OkStatus()
@@ -667,34 +745,144 @@ Status SetTransformAction::Apply(
 }
 
 Status SetTransformAction::UndoImpl() {
-  INK_RETURN_UNLESS(storage_->SetTransforms(MakeSTLRange(uuids_),
-                                            MakeSTLRange(from_transforms_)));
-  NotifyHost(uuids_, from_transforms_, HostSource());
+  auto from_transforms = FromTransforms();
+  INK_RETURN_UNLESS(storage_->SetTransforms(MakeSTLRange(*uuids_),
+                                            MakeSTLRange(from_transforms)));
+  NotifyHost(*uuids_, from_transforms, HostSource());
   return OkStatus();
 }
 
 Status SetTransformAction::RedoImpl() {
-  INK_RETURN_UNLESS(storage_->SetTransforms(MakeSTLRange(uuids_),
-                                            MakeSTLRange(to_transforms_)));
-  NotifyHost(uuids_, to_transforms_, HostSource());
+  auto to_transforms = ToTransforms();
+  INK_RETURN_UNLESS(storage_->SetTransforms(MakeSTLRange(*uuids_),
+                                            MakeSTLRange(to_transforms)));
+  NotifyHost(*uuids_, to_transforms, HostSource());
   return OkStatus();
 }
 
-std::vector<UUID> SetTransformAction::AffectedUUIDs() const { return uuids_; }
+std::vector<InternedUUID> SetTransformAction::AffectedUUIDs() const {
+  return *uuids_;
+}
+
+size_t SetTransformAction::MemoryBytes() const {
+  return sizeof(SetTransformAction) + (counts_uuids_ ? UUIDBytes(*uuids_) : 0) +
+         VectorBytes(from_transforms_) + VectorBytes(to_transforms_);
+}
+
+void SetTransformAction::ShareUUIDsWith(const SetTransformAction& previous) {
+  if (uuids_ != previous.uuids_ && *uuids_ == *previous.uuids_) {
+    uuids_ = previous.uuids_;
+    counts_uuids_ = false;
+  }
+}
+
+void SetTransformAction::TakeOverUUIDsFrom(const SetTransformAction& dropped) {
+  if (uuids_ == dropped.uuids_ && dropped.counts_uuids_) counts_uuids_ = true;
+}
+
+bool SetTransformAction::Coalesce(const SetTransformAction& next) {
+  if (state_ != State::kApplied || next.state_ != State::kApplied ||
+      (uuids_ != next.uuids_ && *uuids_ != *next.uuids_)) {
+    return false;
+  }
+  for (size_t i = 0; i < from_transforms_.size(); ++i) {
+    if (!(next.from_transforms_[i] == ToTransform(i))) return false;
+  }
+  SetTransforms(FromTransforms(), next.ToTransforms());
+  return true;
+}
+
+SetTransformAction::Transform SetTransformAction::Transform::FromProto(
+    const proto::AffineTransform& proto) {
+  return Transform{proto.tx(), proto.ty(), proto.scale_x(), proto.scale_y(),
+                   proto.rotation_radians()};
+}
+
+void SetTransformAction::Transform::ToProto(
+    proto::AffineTransform* proto) const {
+  proto->set_tx(tx);
+  proto->set_ty(ty);
+  proto->set_scale_x(scale_x);
+  proto->set_scale_y(scale_y);
+  proto->set_rotation_radians(rotation_radians);
+}
+
+bool SetTransformAction::Transform::operator==(const Transform& other) const {
+  return tx == other.tx && ty == other.ty && scale_x == other.scale_x &&
+         scale_y == other.scale_y && rotation_radians == other.rotation_radians;
+}
+
+void SetTransformAction::SetTransforms(
+    const std::vector<proto::AffineTransform>& from,
+    const std::vector<proto::AffineTransform>& to) {
+  ASSERT(from.size() == to.size());
+  from_transforms_.clear();
+  from_transforms_.reserve(from.size());
+  for (const auto& t : from) {
+    from_transforms_.push_back(Transform::FromProto(t));
+  }
+
+  // Moving a selection translates every element by the same offset, in which
+  // case only the offset is kept. It is only used if it reproduces every
+  // transform exactly.
+  to_transforms_.clear();
+  to_offset_x_ = to.empty() ? 0 : to[0].tx() - from[0].tx();
+  to_offset_y_ = to.empty() ? 0 : to[0].ty() - from[0].ty();
+  for (size_t i = 0; i < to.size(); ++i) {
+    if (!(ToTransform(i) == Transform::FromProto(to[i]))) {
+      to_offset_x_ = to_offset_y_ = 0;
+      to_transforms_.reserve(to.size());
+      for (const auto& t : to) {
+        to_transforms_.push_back(Transform::FromProto(t));
+      }
+      break;
+    }
+  }
+}
+
+SetTransformAction::Transform SetTransformAction::ToTransform(size_t i) const {
+  if (!to_transforms_.empty()) return to_transforms_[i];
+  Transform t = from_transforms_[i];
+  t.tx += to_offset_x_;
+  t.ty += to_offset_y_;
+  return t;
+}
+
+std::vector<proto::AffineTransform> SetTransformAction::FromTransforms()
+    const {
+  std::vector<proto::AffineTransform> transforms(from_transforms_.size());
+  for (size_t i = 0; i < transforms.size(); ++i) {
+    from_transforms_[i].ToProto(&transforms[i]);
+  }
+  return transforms;
+}
+
+std::vector<proto::AffineTransform> SetTransformAction::ToTransforms() const {
+  std::vector<proto::AffineTransform> transforms(from_transforms_.size());
+  for (size_t i = 0; i < transforms.size(); ++i) {
+    ToTransform(i).ToProto(&transforms[i]);
+  }
+  return transforms;
+}
 
 void SetTransformAction::WriteFieldsToProto(proto::StorageAction* proto) const {
   auto* action = proto->mutable_set_transform_action();
-  CopyToProto(uuids_, action->mutable_uuid());
-  CopyToProto(from_transforms_, action->mutable_from_transform());
-  CopyToProto(to_transforms_, action->mutable_to_transform());
+  CopyToProto(UUIDStrings(*uuids_), action->mutable_uuid());
+  CopyToProto(FromTransforms(), action->mutable_from_transform());
+  CopyToProto(ToTransforms(), action->mutable_to_transform());
 }
 
 void SetTransformAction::RestoreFieldsFromProto(
     const proto::StorageAction& proto) {
   auto action = proto.set_transform_action();
-  CopyToVector(action.uuid(), &uuids_);
-  CopyToVector(action.from_transform(), &from_transforms_);
-  CopyToVector(action.to_transform(), &to_transforms_);
+  auto uuids = std::make_shared<std::vector<InternedUUID>>(
+      InternProtoUUIDs(action.uuid()));
+  std::vector<proto::AffineTransform> from_transforms;
+  std::vector<proto::AffineTransform> to_transforms;
+  CopyToVector(action.from_transform(), &from_transforms);
+  CopyToVector(action.to_transform(), &to_transforms);
+  uuids_ = std::move(uuids);
+  SetTransforms(from_transforms, to_transforms);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -770,8 +958,8 @@ SetActiveLayerAction::SetActiveLayerAction(
 
 Status SetActiveLayerAction::Apply(const UUID& uuid,
                                    const proto::SourceDetails& source) {
-  new_uuid_ = uuid;
-  old_uuid_ = storage_->GetActiveLayer();
+  new_uuid_ = InternedUUID(uuid);
+  old_uuid_ = InternedUUID(storage_->GetActiveLayer());
 
   INK_RETURN_UNLESS(SetActiveLayerAndNotify(new_uuid_, source));
   state_ = State::kApplied;
@@ -789,21 +977,21 @@ Status SetActiveLayerAction::RedoImpl() {
 
 void SetActiveLayerAction::WriteFieldsToProto(
     proto::StorageAction* proto) const {
-  proto->mutable_set_active_layer_action()->set_from_uuid(old_uuid_);
-  proto->mutable_set_active_layer_action()->set_to_uuid(new_uuid_);
+  proto->mutable_set_active_layer_action()->set_from_uuid(old_uuid_.str());
+  proto->mutable_set_active_layer_action()->set_to_uuid(new_uuid_.str());
 }
 
 void SetActiveLayerAction::RestoreFieldsFromProto(
     const proto::StorageAction& proto) {
-  old_uuid_ = proto.set_active_layer_action().from_uuid();
-  new_uuid_ = proto.set_active_layer_action().to_uuid();
+  old_uuid_ = InternedUUID(proto.set_active_layer_action().from_uuid());
+  new_uuid_ = InternedUUID(proto.set_active_layer_action().to_uuid());
 }
 
 Status SetActiveLayerAction::SetActiveLayerAndNotify(
-    const UUID& uuid, const proto::SourceDetails& source) {
-  INK_RETURN_UNLESS(storage_->SetActiveLayer(uuid));
-  active_layer_dispatch_->Send(&IActiveLayerListener::ActiveLayerChanged, uuid,
-                               source);
+    const InternedUUID& uuid, const proto::SourceDetails& source) {
+  INK_RETURN_UNLESS(storage_->SetActiveLayer(uuid.str()));
+  active_layer_dispatch_->Send(&IActiveLayerListener::ActiveLayerChanged,
+                               uuid.str(), source);
 
   return OkStatus();
 }
@@ -836,23 +1024,25 @@ Status SetActiveLayerAction::SetActiveLayerAndNotify(
 template <typename T, T (proto::ElementBundle::*MEMFUNC)() const>
 absl::enable_if_t<std::is_fundamental<T>::value> PruneToExistingBundles(
     const std::vector<proto::ElementBundle>& bundles,
-    const std::vector<UUID>& requested_uuids,
-    const std::vector<T>& requested_values, std::vector<UUID>* uuids_out,
-    std::vector<T>* from_values_out, std::vector<T>* to_values_out) {
-  // Map from requested UUID to requested value.
-  std::unordered_map<UUID, T> uuids_to_value;
+    const std::vector<InternedUUID>& requested_uuids,
+    const std::vector<T>& requested_values,
+    std::vector<InternedUUID>* uuids_out, std::vector<T>* from_values_out,
+    std::vector<T>* to_values_out) {
+  // Map from requested UUID string, as the bundles have, to its index.
+  absl::flat_hash_map<absl::string_view, int> uuid_to_index;
   for (int i = 0; i < requested_uuids.size(); ++i) {
-    uuids_to_value[requested_uuids[i]] = requested_values[i];
+    uuid_to_index[requested_uuids[i].str()] = i;
   }
 
   for (const auto& bundle : bundles) {
-    uuids_out->emplace_back(bundle.uuid());
+    int i = uuid_to_index.at(bundle.uuid());
+    uuids_out->emplace_back(requested_uuids[i]);
     from_values_out->push_back((bundle.*MEMFUNC)());
-    to_values_out->push_back(uuids_to_value[bundle.uuid()]);
+    to_values_out->push_back(requested_values[i]);
   }
 }
 
-Status SetVisibilityAction::Apply(const std::vector<UUID>& uuids_in,
+Status SetVisibilityAction::Apply(const std::vector<InternedUUID>& uuids_in,
                                   const std::vector<bool>& visibilities_in,
                                   const proto::SourceDetails& source) {
   EXPECT(uuids_in.size() == visibilities_in.size());
@@ -895,6 +1085,11 @@ Status SetVisibilityAction::Apply(const std::vector<UUID>& uuids_in,
                    uuids_in.size() - uuids_.size(), uuids_in.size());
 }
 
+size_t SetVisibilityAction::MemoryBytes() const {
+  return sizeof(SetVisibilityAction) + UUIDBytes(uuids_) +
+         VectorBytes(from_visibilities_) + VectorBytes(to_visibilities_);
+}
+
 Status SetVisibilityAction::UndoImpl() {
   INK_RETURN_UNLESS(storage_->SetVisibilities(uuids_, from_visibilities_));
   state_ = State::kUndone;
@@ -909,18 +1104,18 @@ Status SetVisibilityAction::RedoImpl() {
   return OkStatus();
 }
 
-void SetVisibilityAction::NotifyHost(const std::vector<UUID>& uuids,
+void SetVisibilityAction::NotifyHost(const std::vector<InternedUUID>& uuids,
                                      const std::vector<bool>& visibilities,
                                      const proto::SourceDetails& source) {
   proto::mutations::Mutation mutation;
   proto::ElementVisibilityMutations element_mutations;
   for (int i = 0; i < uuids.size(); ++i) {
     auto* set_visibility = mutation.add_chunk()->mutable_set_visibility();
-    set_visibility->set_uuid(uuids[i]);
+    set_visibility->set_uuid(uuids[i].str());
     set_visibility->set_visibility(visibilities[i]);
 
     auto visibility_mutation = element_mutations.add_mutation();
-    visibility_mutation->set_uuid(uuids[i]);
+    visibility_mutation->set_uuid(uuids[i].str());
     visibility_mutation->set_visibility(visibilities[i]);
   }
 
@@ -934,7 +1129,7 @@ void SetVisibilityAction::WriteFieldsToProto(
   auto* action = proto->mutable_set_visibility_action();
 
   for (int i = 0; i < uuids_.size(); ++i) {
-    action->add_uuid(uuids_[i]);
+    action->add_uuid(uuids_[i].str());
     action->add_to_visibility(to_visibilities_[i]);
     action->add_from_visibility(from_visibilities_[i]);
   }
@@ -957,13 +1152,13 @@ void SetVisibilityAction::RestoreFieldsFromProto(
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
-Status SetOpacityAction::Apply(const std::vector<UUID>& uuids_in,
+Status SetOpacityAction::Apply(const std::vector<InternedUUID>& uuids_in,
                                const std::vector<int32>& opacities_in,
                                const proto::SourceDetails& source) {
   EXPECT(uuids_in.size() == opacities_in.size());
 
   std::vector<proto::ElementBundle> bundles;
-  Status st = storage_->GetBundles(MakeSTLRange<std::vector<UUID>>(uuids_in),
+  Status st = storage_->GetBundles(MakeSTLRange(uuids_in),
                                    BundleDataAttachments::None(),
                                    LivenessFilter::kOnlyAlive, &bundles);
   if (!st.ok()) return st;
@@ -1000,6 +1195,11 @@ Status SetOpacityAction::Apply(const std::vector<UUID>& uuids_in,
                    uuids_in.size() - uuids_.size(), uuids_in.size());
 }
 
+size_t SetOpacityAction::MemoryBytes() const {
+  return sizeof(SetOpacityAction) + UUIDBytes(uuids_) +
+         VectorBytes(from_opacities_) + VectorBytes(to_opacities_);
+}
+
 Status SetOpacityAction::UndoImpl() {
   INK_RETURN_UNLESS(storage_->SetOpacities(uuids_, from_opacities_));
   state_ = State::kUndone;
@@ -1019,7 +1219,7 @@ void SetOpacityAction::WriteFieldsToProto(
   auto* action = proto->mutable_set_opacity_action();
 
   for (int i = 0; i < uuids_.size(); ++i) {
-    action->add_uuid(uuids_[i]);
+    action->add_uuid(uuids_[i].str());
     action->add_from_opacity(from_opacities_[i]);
     action->add_to_opacity(to_opacities_[i]);
   }
@@ -1039,18 +1239,18 @@ void SetOpacityAction::RestoreFieldsFromProto(
   }
 }
 
-void SetOpacityAction::NotifyHost(const std::vector<UUID>& uuids,
+void SetOpacityAction::NotifyHost(const std::vector<InternedUUID>& uuids,
                                   const std::vector<int32>& opacities,
                                   const proto::SourceDetails& source) {
   proto::mutations::Mutation mutation;
   proto::ElementOpacityMutations element_mutations;
   for (int i = 0; i < uuids.size(); ++i) {
     auto* set_opacity = mutation.add_chunk()->mutable_set_opacity();
-    set_opacity->set_uuid(uuids[i]);
+    set_opacity->set_uuid(uuids[i].str());
     set_opacity->set_opacity(opacities[i]);
 
     auto* opacity_mutation = element_mutations.add_mutation();
-    opacity_mutation->set_uuid(uuids[i]);
+    opacity_mutation->set_uuid(uuids[i].str());
     opacity_mutation->set_opacity(opacities[i]);
   }
 
@@ -1062,9 +1262,10 @@ void SetOpacityAction::NotifyHost(const std::vector<UUID>& uuids,
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
-Status ChangeZOrderAction::Apply(const std::vector<UUID>& uuids_in,
-                                 const std::vector<UUID>& below_uuids_in,
-                                 const proto::SourceDetails& source) {
+Status ChangeZOrderAction::Apply(
+    const std::vector<InternedUUID>& uuids_in,
+    const std::vector<InternedUUID>& below_uuids_in,
+    const proto::SourceDetails& source) {
   EXPECT(uuids_in.size() == below_uuids_in.size());
 
   uuids_.reserve(uuids_in.size());
@@ -1072,7 +1273,7 @@ Status ChangeZOrderAction::Apply(const std::vector<UUID>& uuids_in,
 
   for (int i = 0; i < uuids_in.size(); ++i) {
     if (!storage_->IsAlive(uuids_in[i]) ||
-        (below_uuids_in[i] != kInvalidUUID &&
+        (below_uuids_in[i].IsValid() &&
          !storage_->IsAlive(below_uuids_in[i]))) {
       continue;
     }
@@ -1086,7 +1287,7 @@ Status ChangeZOrderAction::Apply(const std::vector<UUID>& uuids_in,
         "ChangeZOrderAction failed. No elements found to transform.");
   }
 
-  std::vector<UUID> old_below_uuids;
+  std::vector<InternedUUID> old_below_uuids;
   INK_RETURN_UNLESS(
       storage_->ChangeZOrders(uuids_, to_below_uuids_, &old_below_uuids));
   state_ = State::kApplied;
@@ -1107,21 +1308,26 @@ Status ChangeZOrderAction::Apply(const std::vector<UUID>& uuids_in,
                    uuids_in.size() - uuids_.size(), uuids_in.size());
 }
 
-std::vector<UUID> ChangeZOrderAction::AffectedUUIDs() const {
+std::vector<InternedUUID> ChangeZOrderAction::AffectedUUIDs() const {
   // The affected UUIDs is the union of all of uuids_, to_below_uuids_, and
   // from_below_uuids_reversed_.
-  std::unordered_set<UUID> affected_uuids(uuids_.begin(), uuids_.end());
-  copy(to_below_uuids_.begin(), to_below_uuids_.end(),
-       std::inserter(affected_uuids, std::next(affected_uuids.begin())));
-  copy(from_below_uuids_reversed_.begin(), from_below_uuids_reversed_.end(),
-       std::inserter(affected_uuids, std::next(affected_uuids.begin())));
-  return std::vector<UUID>(affected_uuids.begin(), affected_uuids.end());
+  InternedUUIDHashSet affected_uuids(uuids_.begin(), uuids_.end());
+  affected_uuids.insert(to_below_uuids_.begin(), to_below_uuids_.end());
+  affected_uuids.insert(from_below_uuids_reversed_.begin(),
+                        from_below_uuids_reversed_.end());
+  return std::vector<InternedUUID>(affected_uuids.begin(),
+                                   affected_uuids.end());
+}
+
+size_t ChangeZOrderAction::MemoryBytes() const {
+  return sizeof(ChangeZOrderAction) + UUIDBytes(uuids_) +
+         UUIDBytes(to_below_uuids_) + UUIDBytes(from_below_uuids_reversed_);
 }
 
 Status ChangeZOrderAction::UndoImpl() {
   // We have to apply the undo actions in reverse.
   // (The from_uuids are already reversed.)
-  std::vector<UUID> ruuids;
+  std::vector<InternedUUID> ruuids;
   copy(uuids_.crbegin(), uuids_.crend(), back_inserter(ruuids));
 
   INK_RETURN_UNLESS(
@@ -1143,9 +1349,9 @@ void ChangeZOrderAction::WriteFieldsToProto(
   auto* action = proto->mutable_change_z_order_action();
 
   for (int i = 0; i < uuids_.size(); ++i) {
-    action->add_uuid(uuids_[i]);
-    action->add_from_below_uuid(from_below_uuids_reversed_[i]);
-    action->add_to_below_uuid(to_below_uuids_[i]);
+    action->add_uuid(uuids_[i].str());
+    action->add_from_below_uuid(from_below_uuids_reversed_[i].str());
+    action->add_to_below_uuid(to_below_uuids_[i].str());
   }
 }
 
@@ -1163,19 +1369,20 @@ void ChangeZOrderAction::RestoreFieldsFromProto(
   }
 }
 
-void ChangeZOrderAction::NotifyHost(const std::vector<UUID>& uuids,
-                                    const std::vector<UUID>& below_uuids,
-                                    const proto::SourceDetails& source) {
+void ChangeZOrderAction::NotifyHost(
+    const std::vector<InternedUUID>& uuids,
+    const std::vector<InternedUUID>& below_uuids,
+    const proto::SourceDetails& source) {
   proto::mutations::Mutation mutation;
   proto::ElementZOrderMutations element_mutations;
   for (int i = 0; i < uuids.size(); ++i) {
     auto* change_z_order = mutation.add_chunk()->mutable_change_z_order();
-    change_z_order->set_uuid(uuids[i]);
-    change_z_order->set_below_uuid(below_uuids[i]);
+    change_z_order->set_uuid(uuids[i].str());
+    change_z_order->set_below_uuid(below_uuids[i].str());
 
     auto* z_order_mutation = element_mutations.add_mutation();
-    z_order_mutation->set_uuid(uuids[i]);
-    z_order_mutation->set_below_uuid(below_uuids[i]);
+    z_order_mutation->set_uuid(uuids[i].str());
+    z_order_mutation->set_below_uuid(below_uuids[i].str());
   }
 
   element_dispatch_->Send(&IElementListener::ElementsZOrderMutated,
@@ -24,6 +24,7 @@
 #include "ink/engine/public/host/ielement_listener.h"
 #include "ink/engine/public/host/imutation_listener.h"
 #include "ink/engine/public/host/ipage_properties_listener.h"
+#include "ink/engine/public/types/interned_uuid.h"
 #include "ink/engine/public/types/status.h"
 #include "ink/engine/public/types/uuid.h"
 #include "ink/engine/util/security.h"
@@ -34,9 +35,9 @@
 namespace ink {
 
 struct RemovedUUID {
-  const UUID uuid;
-  const UUID was_below_uuid;
-  RemovedUUID(const UUID& uuid, const UUID& was_below_uuid)
+  const InternedUUID uuid;
+  const InternedUUID was_below_uuid;
+  RemovedUUID(const InternedUUID& uuid, const InternedUUID& was_below_uuid)
       : uuid(uuid), was_below_uuid(was_below_uuid) {}
 };
 
@@ -66,6 +67,9 @@ struct RemovedUUID {
 // If you want to mutate the store anyways (ex for storage compaction under
 // memory pressure) you can determine which individual elements should not be
 // mutated through the call StorageAction::AffectedUUIDs.
+//
+// Actions take and hold InternedUUIDs, which the caller interns once, so that
+// undoing and redoing them never hashes the UUID strings.
 class StorageAction {
  public:
   enum class State { kUninitialized, kApplied, kUndone };
@@ -90,7 +94,7 @@ class StorageAction {
 
   S_WARN_UNUSED_RESULT Status Undo();
   S_WARN_UNUSED_RESULT Status Redo();
-  virtual std::vector<UUID> AffectedUUIDs() const = 0;
+  virtual std::vector<InternedUUID> AffectedUUIDs() const = 0;
   State state() const;
 
   void WriteToProto(ink::proto::StorageAction* proto);
@@ -98,12 +102,16 @@ class StorageAction {
 
   virtual std::string ToString() const { return "<Abstract StorageAction>"; }
 
+  // An estimate of the memory held by the action, in bytes. This does not
+  // include the elements in the storage that the action refers to.
+  virtual size_t MemoryBytes() const;
+
  protected:
   virtual S_WARN_UNUSED_RESULT Status UndoImpl() = 0;
   virtual S_WARN_UNUSED_RESULT Status RedoImpl() = 0;
 
   void NotifyHostAdd(UUIDOrder uuid_order, const proto::SourceDetails& source);
-  void NotifyHostRemove(std::vector<UUID> removed_uuids,
+  void NotifyHostRemove(const std::vector<InternedUUID>& removed_uuids,
                         const proto::SourceDetails& source);
 
   virtual void WriteFieldsToProto(ink::proto::StorageAction* proto) const = 0;
@@ -125,10 +133,11 @@ class AddAction : public StorageAction {
       std::shared_ptr<DocumentStorage> storage,
       std::shared_ptr<EventDispatch<IElementListener>> element_dispatch,
       std::shared_ptr<EventDispatch<IMutationListener>> mutation_dispatch);
-  S_WARN_UNUSED_RESULT Status Apply(
-      const std::vector<ink::proto::ElementBundle>& bundles,
-      const UUID& below_element_with_uuid, const proto::SourceDetails& source);
-  std::vector<UUID> AffectedUUIDs() const override;
+  S_WARN_UNUSED_RESULT Status
+  Apply(const std::vector<ink::proto::ElementBundle>& bundles,
+        const InternedUUID& below_element_with_uuid,
+        const proto::SourceDetails& source);
+  std::vector<InternedUUID> AffectedUUIDs() const override;
 
   std::string ToString() const override { return "<AddAction>"; }
 
@@ -143,8 +152,8 @@ class AddAction : public StorageAction {
   // for undo/redo.
   UUIDOrder GetUUIDOrder() const;
 
-  std::vector<UUID> uuids_;
-  UUID below_element_with_uuid_;
+  std::vector<InternedUUID> uuids_;
+  InternedUUID below_element_with_uuid_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -158,12 +167,13 @@ class RemoveAction : public StorageAction {
       std::shared_ptr<EventDispatch<IMutationListener>> mutation_dispatch);
 
   // Returns true if any of the given UUIDs were successfully removed.
-  S_WARN_UNUSED_RESULT Status Apply(const std::vector<UUID>& uuids,
+  S_WARN_UNUSED_RESULT Status Apply(const std::vector<InternedUUID>& uuids,
                                     const proto::SourceDetails& source);
 
-  std::vector<UUID> AffectedUUIDs() const override;
+  std::vector<InternedUUID> AffectedUUIDs() const override;
 
   std::string ToString() const override { return "<RemoveAction>"; }
+  size_t MemoryBytes() const override;
 
  protected:
   S_WARN_UNUSED_RESULT Status UndoImpl() override;
@@ -188,13 +198,14 @@ class ReplaceAction : public StorageAction {
 
   S_WARN_UNUSED_RESULT Status
   Apply(const std::vector<proto::ElementBundle>& elements_to_add,
-        const std::vector<UUID>& uuids_to_add_below,
-        const std::vector<UUID>& uuids_to_remove,
+        const std::vector<InternedUUID>& uuids_to_add_below,
+        const std::vector<InternedUUID>& uuids_to_remove,
         const proto::SourceDetails& source);
 
-  std::vector<UUID> AffectedUUIDs() const override;
+  std::vector<InternedUUID> AffectedUUIDs() const override;
 
   std::string ToString() const override { return "<ReplaceAction>"; }
+  size_t MemoryBytes() const override;
 
  protected:
   S_WARN_UNUSED_RESULT Status UndoImpl() override;
@@ -220,7 +231,7 @@ class ClearAction : public StorageAction {
       std::shared_ptr<EventDispatch<IElementListener>> element_dispatch,
       std::shared_ptr<EventDispatch<IMutationListener>> mutation_dispatch);
   S_WARN_UNUSED_RESULT Status Apply(const proto::SourceDetails& source);
-  std::vector<UUID> AffectedUUIDs() const override;
+  std::vector<InternedUUID> AffectedUUIDs() const override;
 
   std::string ToString() const override { return "<ClearAction>"; }
 
@@ -231,12 +242,19 @@ class ClearAction : public StorageAction {
   void WriteFieldsToProto(ink::proto::StorageAction* proto) const override;
 
  private:
-  std::vector<UUID> uuids_;
+  std::vector<InternedUUID> uuids_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 
 // Set the transform for a list of elements in the storage.
+//
+// The transforms are held in a compact form: if every element is translated by
+// the same offset, and not otherwise changed (e.g. when dragging a selection),
+// only the offset is kept for the new transforms. The list of UUIDs may be
+// shared with later actions that transform the same elements; its size is only
+// counted in the MemoryBytes() of the action that holds it that was pushed
+// first, so that the sizes of the actions in an undo stack add up.
 class SetTransformAction : public StorageAction {
  public:
   explicit SetTransformAction(
@@ -244,12 +262,27 @@ class SetTransformAction : public StorageAction {
       std::shared_ptr<EventDispatch<IElementListener>> element_dispatch,
       std::shared_ptr<EventDispatch<IMutationListener>> mutation_dispatch);
   S_WARN_UNUSED_RESULT Status
-  Apply(const std::vector<UUID>& uuids,
+  Apply(const std::vector<InternedUUID>& uuids,
         const std::vector<proto::AffineTransform>& new_transforms,
         const proto::SourceDetails& source);
-  std::vector<UUID> AffectedUUIDs() const override;
+  std::vector<InternedUUID> AffectedUUIDs() const override;
 
   std::string ToString() const override { return "<SetTransformAction>"; }
+  size_t MemoryBytes() const override;
+
+  // If "previous" transforms the same elements, shares its list of UUIDs,
+  // which "previous" keeps counting in its MemoryBytes().
+  void ShareUUIDsWith(const SetTransformAction& previous);
+
+  // Called before "dropped", the action pushed before this one, is destroyed:
+  // if they share a list of UUIDs that "dropped" counted in its MemoryBytes(),
+  // this action counts it from now on.
+  void TakeOverUUIDsFrom(const SetTransformAction& dropped);
+
+  // If "next" transforms the same elements, starting from the transforms that
+  // this action set, merges it into this action, so that undoing this action
+  // undoes both, and returns true. Both actions must be applied.
+  bool Coalesce(const SetTransformAction& next);
 
  protected:
   S_WARN_UNUSED_RESULT Status UndoImpl() override;
@@ -258,13 +291,40 @@ class SetTransformAction : public StorageAction {
   void WriteFieldsToProto(ink::proto::StorageAction* proto) const override;
 
  private:
-  void NotifyHost(std::vector<UUID> uuids,
-                  std::vector<proto::AffineTransform> transforms,
+  // The fields of a proto::AffineTransform.
+  struct Transform {
+    float tx;
+    float ty;
+    float scale_x;
+    float scale_y;
+    float rotation_radians;
+
+    static Transform FromProto(const proto::AffineTransform& proto);
+    void ToProto(proto::AffineTransform* proto) const;
+    bool operator==(const Transform& other) const;
+  };
+
+  void NotifyHost(const std::vector<InternedUUID>& uuids,
+                  const std::vector<proto::AffineTransform>& transforms,
                   const proto::SourceDetails& source);
 
-  std::vector<UUID> uuids_;
-  std::vector<proto::AffineTransform> from_transforms_;
-  std::vector<proto::AffineTransform> to_transforms_;
+  // Sets the compact representation of the given transforms.
+  void SetTransforms(const std::vector<proto::AffineTransform>& from,
+                     const std::vector<proto::AffineTransform>& to);
+  std::vector<proto::AffineTransform> FromTransforms() const;
+  std::vector<proto::AffineTransform> ToTransforms() const;
+  // The transform that this action sets on the i-th element.
+  Transform ToTransform(size_t i) const;
+
+  std::shared_ptr<const std::vector<InternedUUID>> uuids_;
+  // Whether MemoryBytes() includes the size of uuids_, i.e. whether this action
+  // did not get uuids_ from ShareUUIDsWith().
+  bool counts_uuids_ = true;
+  std::vector<Transform> from_transforms_;
+  // Empty if every element is only translated by to_offset_.
+  std::vector<Transform> to_transforms_;
+  float to_offset_x_ = 0;
+  float to_offset_y_ = 0;
 };
 
 template <>
@@ -292,7 +352,7 @@ class SetPageBoundsAction : public StorageAction {
   S_WARN_UNUSED_RESULT Status Apply(const proto::Rect& bounds,
                                     const proto::SourceDetails& source);
 
-  std::vector<UUID> AffectedUUIDs() const override { return {}; }
+  std::vector<InternedUUID> AffectedUUIDs() const override { return {}; }
 
   std::string ToString() const override { return "<SetPageBoundsAction>"; }
 
@@ -326,7 +386,7 @@ class SetActiveLayerAction : public StorageAction {
   S_WARN_UNUSED_RESULT Status Apply(const UUID& uuid,
                                     const proto::SourceDetails& source);
 
-  std::vector<UUID> AffectedUUIDs() const override {
+  std::vector<InternedUUID> AffectedUUIDs() const override {
     return {old_uuid_, new_uuid_};
   }
 
@@ -340,11 +400,11 @@ class SetActiveLayerAction : public StorageAction {
   void RestoreFieldsFromProto(const proto::StorageAction& proto) override;
 
  private:
-  Status SetActiveLayerAndNotify(const UUID& uuid,
+  Status SetActiveLayerAndNotify(const InternedUUID& uuid,
                                  const proto::SourceDetails& source);
 
-  UUID old_uuid_;
-  UUID new_uuid_;
+  InternedUUID old_uuid_;
+  InternedUUID new_uuid_;
 
   std::shared_ptr<EventDispatch<IActiveLayerListener>> active_layer_dispatch_;
 };
@@ -359,12 +419,13 @@ class SetVisibilityAction : public StorageAction {
       std::shared_ptr<EventDispatch<IMutationListener>> mutation_dispatch)
       : StorageAction(storage, element_dispatch, mutation_dispatch) {}
 
-  S_WARN_UNUSED_RESULT Status Apply(const std::vector<UUID>& uuids,
+  S_WARN_UNUSED_RESULT Status Apply(const std::vector<InternedUUID>& uuids,
                                     const std::vector<bool>& visibilities,
                                     const proto::SourceDetails& source);
 
-  std::vector<UUID> AffectedUUIDs() const override { return uuids_; }
+  std::vector<InternedUUID> AffectedUUIDs() const override { return uuids_; }
   std::string ToString() const override { return "<SetVisibilityAction>"; }
+  size_t MemoryBytes() const override;
 
   // Used by ApplyRepeatedStorageAction
   using ValueType = bool;
@@ -381,11 +442,11 @@ class SetVisibilityAction : public StorageAction {
   void RestoreFieldsFromProto(const ink::proto::StorageAction& proto) override;
 
  private:
-  void NotifyHost(const std::vector<UUID>& uuids,
+  void NotifyHost(const std::vector<InternedUUID>& uuids,
                   const std::vector<bool>& visibilities,
                   const proto::SourceDetails& source);
 
-  std::vector<UUID> uuids_;
+  std::vector<InternedUUID> uuids_;
   std::vector<bool> from_visibilities_;
   std::vector<bool> to_visibilities_;
 };
@@ -398,12 +459,13 @@ class SetOpacityAction : public StorageAction {
       std::shared_ptr<EventDispatch<IMutationListener>> mutation_dispatch)
       : StorageAction(storage, element_dispatch, mutation_dispatch) {}
 
-  S_WARN_UNUSED_RESULT Status Apply(const std::vector<UUID>& uuids,
+  S_WARN_UNUSED_RESULT Status Apply(const std::vector<InternedUUID>& uuids,
                                     const std::vector<int32>& opacities,
                                     const proto::SourceDetails& source);
 
-  std::vector<UUID> AffectedUUIDs() const override { return uuids_; }
+  std::vector<InternedUUID> AffectedUUIDs() const override { return uuids_; }
   std::string ToString() const override { return "<SetOpacityAction>"; }
+  size_t MemoryBytes() const override;
 
   // Used by ApplyRepeatedStorageAction
   using ValueType = int32;
@@ -420,11 +482,11 @@ class SetOpacityAction : public StorageAction {
   void RestoreFieldsFromProto(const ink::proto::StorageAction& proto) override;
 
  private:
-  void NotifyHost(const std::vector<UUID>& uuids,
+  void NotifyHost(const std::vector<InternedUUID>& uuids,
                   const std::vector<int32>& opacities,
                   const proto::SourceDetails& source);
 
-  std::vector<UUID> uuids_;
+  std::vector<InternedUUID> uuids_;
   std::vector<int32> from_opacities_;
   std::vector<int32> to_opacities_;
 };
@@ -437,17 +499,19 @@ class ChangeZOrderAction : public StorageAction {
       std::shared_ptr<EventDispatch<IMutationListener>> mutation_dispatch)
       : StorageAction(storage, element_dispatch, mutation_dispatch) {}
 
-  S_WARN_UNUSED_RESULT Status Apply(const std::vector<UUID>& uuids,
-                                    const std::vector<UUID>& below_uuids,
-                                    const proto::SourceDetails& source);
-  std::vector<UUID> AffectedUUIDs() const override;
+  S_WARN_UNUSED_RESULT Status
+  Apply(const std::vector<InternedUUID>& uuids,
+        const std::vector<InternedUUID>& below_uuids,
+        const proto::SourceDetails& source);
+  std::vector<InternedUUID> AffectedUUIDs() const override;
   std::string ToString() const override { return "<ChangeZOrderAction>"; }
+  size_t MemoryBytes() const override;
 
   // Used by ApplyRepeatedStorageAction
-  using ValueType = UUID;
+  using ValueType = InternedUUID;
   ValueType GetValueFromMutation(
       const proto::ElementZOrderMutations::Mutation& mutation) {
-    return mutation.below_uuid();
+    return InternedUUID(mutation.below_uuid());
   }
 
  protected:
@@ -458,15 +522,15 @@ class ChangeZOrderAction : public StorageAction {
   void RestoreFieldsFromProto(const ink::proto::StorageAction& proto) override;
 
  private:
-  void NotifyHost(const std::vector<UUID>& uuids,
-                  const std::vector<UUID>& below_uuids,
+  void NotifyHost(const std::vector<InternedUUID>& uuids,
+                  const std::vector<InternedUUID>& below_uuids,
                   const proto::SourceDetails& source);
 
-  std::vector<UUID> uuids_;
-  std::vector<UUID> to_below_uuids_;
+  std::vector<InternedUUID> uuids_;
+  std::vector<InternedUUID> to_below_uuids_;
   // Undo actions need to be applied in reverse, so we store the from values
   // reversed.
-  std::vector<UUID> from_below_uuids_reversed_;
+  std::vector<InternedUUID> from_below_uuids_reversed_;
 };
 
 }  // namespace ink
@@ -13,9 +13,28 @@
 // limitations under the License.
 
 #include "ink/public/document/storage/undo_manager.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "ink/engine/util/dbg/errors.h"
 #include "ink/public/document/storage/storage_action.h"
 
 namespace ink {
+namespace {
+
+void SubtractBytes(size_t bytes, size_t* total) {
+  *total -= std::min(*total, bytes);
+}
+
+size_t SumOfMemoryBytes(
+    const std::deque<std::unique_ptr<StorageAction>>& actions) {
+  size_t bytes = 0;
+  for (const auto& action : actions) bytes += action->MemoryBytes();
+  return bytes;
+}
+
+}  // namespace
 
 UndoManager::UndoManager(
     std::shared_ptr<EventDispatch<IDocumentListener>> document_dispatch,
@@ -48,20 +67,60 @@ void UndoManager::MaybeNotifyUndoRedoStateChanged() {
 void UndoManager::Push(std::unique_ptr<StorageAction> action) {
   if (!enabled_) return;
   redoables_.clear();
+  redo_bytes_ = 0;
+  auto* transform = dynamic_cast<SetTransformAction*>(action.get());
+  auto* previous_transform =
+      undoables_.empty()
+          ? nullptr
+          : dynamic_cast<SetTransformAction*>(undoables_.back().get());
+  if (transform && previous_transform) {
+    if (policy_.coalesce_transforms) {
+      // Coalescing may change the size of the previous action.
+      size_t previous_bytes = previous_transform->MemoryBytes();
+      if (previous_transform->Coalesce(*transform)) {
+        SubtractBytes(previous_bytes, &undo_bytes_);
+        undo_bytes_ += previous_transform->MemoryBytes();
+        SLOG(SLOG_DOCUMENT,
+             "coalesced $0 into the previous action, now $1 bytes", *transform,
+             previous_transform->MemoryBytes());
+        ASSERT(undo_bytes_ == SumOfMemoryBytes(undoables_));
+        MaybeNotifyUndoRedoStateChanged();
+        return;
+      }
+    }
+    // Sharing saves memory whether or not transforms are coalesced, e.g. when
+    // an element is moved and then scaled. The previous action keeps counting
+    // the shared UUIDs, so its size doesn't change.
+    transform->ShareUUIDsWith(*previous_transform);
+  }
+  size_t bytes = action->MemoryBytes();
+  SLOG(SLOG_DOCUMENT, "pushing $0, $1 bytes", *action, bytes);
   undoables_.emplace_back(std::move(action));
+  undo_bytes_ += bytes;
+  TrimToPolicy();
+  ASSERT(undo_bytes_ == SumOfMemoryBytes(undoables_));
   MaybeNotifyUndoRedoStateChanged();
 }
 
 bool UndoManager::Undo() {
   if (!CanUndo()) return false;
 
+  SubtractBytes(undoables_.back()->MemoryBytes(), &undo_bytes_);
   auto success = undoables_.back()->Undo();
   if (success) {
+    redo_bytes_ += undoables_.back()->MemoryBytes();
     redoables_.emplace_back(std::move(undoables_.back()));
   } else {
     SLOG(SLOG_ERROR, "$0", success.error_message());
+    // The action is dropped. The next action in the history is the last one
+    // that was undone.
+    HandOverSharedBytes(*undoables_.back(),
+                        redoables_.empty() ? nullptr : redoables_.back().get(),
+                        &redo_bytes_);
   }
   undoables_.pop_back();
+  ASSERT(undo_bytes_ == SumOfMemoryBytes(undoables_));
+  ASSERT(redo_bytes_ == SumOfMemoryBytes(redoables_));
   MaybeNotifyUndoRedoStateChanged();
   return success.ok();
 }
@@ -69,13 +128,23 @@ bool UndoManager::Undo() {
 bool UndoManager::Redo() {
   if (!CanRedo()) return false;
 
+  SubtractBytes(redoables_.back()->MemoryBytes(), &redo_bytes_);
   auto success = redoables_.back()->Redo();
   if (success) {
+    undo_bytes_ += redoables_.back()->MemoryBytes();
     undoables_.emplace_back(std::move(redoables_.back()));
   } else {
     SLOG(SLOG_ERROR, "$0", success.error_message());
+    // The action is dropped. The next action in the history is the one below
+    // it on the redo stack.
+    size_t n = redoables_.size();
+    HandOverSharedBytes(*redoables_.back(),
+                        n < 2 ? nullptr : redoables_[n - 2].get(),
+                        &redo_bytes_);
   }
   redoables_.pop_back();
+  ASSERT(undo_bytes_ == SumOfMemoryBytes(undoables_));
+  ASSERT(redo_bytes_ == SumOfMemoryBytes(redoables_));
   MaybeNotifyUndoRedoStateChanged();
   return success.ok();
 }
@@ -84,8 +153,8 @@ bool UndoManager::CanUndo() const { return enabled_ && !undoables_.empty(); }
 
 bool UndoManager::CanRedo() const { return enabled_ && !redoables_.empty(); }
 
-std::vector<UUID> UndoManager::ReferencedElements() const {
-  std::unordered_set<UUID> ids;
+std::vector<InternedUUID> UndoManager::ReferencedElements() const {
+  InternedUUIDHashSet ids;
 
   for (const auto& u : undoables_) {
     auto affected = u->AffectedUUIDs();
@@ -96,7 +165,7 @@ std::vector<UUID> UndoManager::ReferencedElements() const {
     ids.insert(affected.begin(), affected.end());
   }
 
-  return std::vector<UUID>(ids.begin(), ids.end());
+  return std::vector<InternedUUID>(ids.begin(), ids.end());
 }
 
 void UndoManager::WriteToProto(ink::proto::Snapshot* snapshot) const {
@@ -159,11 +228,14 @@ std::unique_ptr<StorageAction> UndoManager::StorageActionFromProto(
 void UndoManager::ReadFromProto(const ink::proto::Snapshot& snapshot) {
   undoables_.clear();
   redoables_.clear();
+  undo_bytes_ = 0;
+  redo_bytes_ = 0;
   for (const auto& undo_action : snapshot.undo_action()) {
     SLOG(SLOG_DOCUMENT, "Pushing something onto undo stack");
     auto action = StorageActionFromProto(undo_action);
     if (action) {
       action->RestoreFromProto(undo_action, StorageAction::State::kApplied);
+      undo_bytes_ += action->MemoryBytes();
       undoables_.emplace_back(std::move(action));
     }
   }
@@ -172,6 +244,7 @@ void UndoManager::ReadFromProto(const ink::proto::Snapshot& snapshot) {
     auto action = StorageActionFromProto(redo_action);
     if (action) {
       action->RestoreFromProto(redo_action, StorageAction::State::kUndone);
+      redo_bytes_ += action->MemoryBytes();
       redoables_.emplace_back(std::move(action));
     }
   }
@@ -182,4 +255,44 @@ void UndoManager::SetEnabled(bool enabled) {
   enabled_ = enabled;
   MaybeNotifyUndoRedoStateChanged();
 }
+
+void UndoManager::SetHistoryPolicy(const HistoryPolicy& policy) {
+  policy_ = policy;
+  TrimToPolicy();
+  MaybeNotifyUndoRedoStateChanged();
+}
+
+std::vector<size_t> UndoManager::UndoActionBytes() const {
+  std::vector<size_t> bytes;
+  bytes.reserve(undoables_.size());
+  for (const auto& u : undoables_) bytes.push_back(u->MemoryBytes());
+  return bytes;
+}
+
+void UndoManager::HandOverSharedBytes(const StorageAction& dropped,
+                                      StorageAction* next, size_t* next_total) {
+  auto* dropped_transform = dynamic_cast<const SetTransformAction*>(&dropped);
+  auto* next_transform = dynamic_cast<SetTransformAction*>(next);
+  if (!dropped_transform || !next_transform) return;
+  SubtractBytes(next_transform->MemoryBytes(), next_total);
+  next_transform->TakeOverUUIDsFrom(*dropped_transform);
+  *next_total += next_transform->MemoryBytes();
+}
+
+void UndoManager::TrimToPolicy() {
+  if (policy_.max_bytes == 0) return;
+  size_t n_dropped = 0;
+  while (MemoryBytes() > policy_.max_bytes && undoables_.size() > 1) {
+    SubtractBytes(undoables_.front()->MemoryBytes(), &undo_bytes_);
+    HandOverSharedBytes(*undoables_.front(), undoables_[1].get(),
+                        &undo_bytes_);
+    undoables_.pop_front();
+    ++n_dropped;
+  }
+  if (n_dropped > 0) {
+    SLOG(SLOG_DOCUMENT,
+         "dropped the $0 oldest undoable actions, history is now $1 bytes",
+         n_dropped, MemoryBytes());
+  }
+}
 }  // namespace ink
@@ -17,11 +17,14 @@
 #ifndef INK_PUBLIC_DOCUMENT_STORAGE_UNDO_MANAGER_H_
 #define INK_PUBLIC_DOCUMENT_STORAGE_UNDO_MANAGER_H_
 
+#include <cstddef>
 #include <deque>
+#include <vector>
 
 #include "ink/engine/public/host/ielement_listener.h"
 #include "ink/engine/public/host/imutation_listener.h"
 #include "ink/engine/public/host/ipage_properties_listener.h"
+#include "ink/engine/public/types/interned_uuid.h"
 #include "ink/proto/document_portable_proto.pb.h"
 #include "ink/public/document/idocument_listener.h"
 #include "ink/public/document/storage/document_storage.h"
@@ -32,6 +35,19 @@ namespace ink {
 // A class to manage an undo/redo stack.
 class UndoManager {
  public:
+  // Limits how much memory the undo/redo stack may hold.
+  struct HistoryPolicy {
+    // If nonzero, the oldest undoable actions are dropped whenever the stack
+    // holds more than this many bytes (see StorageAction::MemoryBytes()). The
+    // most recent action is always kept.
+    size_t max_bytes = 0;
+    // If true, a SetTransformAction that continues the transform set by the
+    // previous one (e.g. successive drags of a selection) is merged into it,
+    // so that a single undo reverts both. Either way, successive
+    // SetTransformActions on the same elements share their list of UUIDs.
+    bool coalesce_transforms = false;
+  };
+
   UndoManager(
       std::shared_ptr<EventDispatch<IDocumentListener>> document_dispatch,
       std::shared_ptr<EventDispatch<IElementListener>> element_dispatch,
@@ -47,7 +63,7 @@ class UndoManager {
   bool CanRedo() const;
 
   // See storage_action.h
-  std::vector<UUID> ReferencedElements() const;
+  std::vector<InternedUUID> ReferencedElements() const;
 
   void WriteToProto(ink::proto::Snapshot* snapshot) const;
   void ReadFromProto(const ink::proto::Snapshot& snapshot);
@@ -56,7 +72,32 @@ class UndoManager {
   // do anything.
   void SetEnabled(bool enabled);
 
+  // Trims the undo stack immediately if it exceeds the new limit.
+  void SetHistoryPolicy(const HistoryPolicy& policy);
+  const HistoryPolicy& GetHistoryPolicy() const { return policy_; }
+
+  // The approximate number of bytes held by the undo and redo stacks. This is
+  // a running total, which is kept up to date as actions are pushed, coalesced,
+  // undone, redone and dropped.
+  size_t MemoryBytes() const { return undo_bytes_ + redo_bytes_; }
+
+  // The approximate number of bytes held by each undoable action, from the
+  // oldest to the most recent.
+  std::vector<size_t> UndoActionBytes() const;
+
  private:
+  // Drops the oldest undoable actions until the stacks fit within
+  // policy_.max_bytes.
+  void TrimToPolicy();
+
+  // Called before "dropped" is destroyed, while it is still on a stack. "next"
+  // is the action after it in the history (i.e. pushed after it), or null, and
+  // next_total is the sum for the stack that holds "next". Actions that share
+  // data count it in only one of their sizes; this lets "next" take over
+  // counting what it shares with "dropped".
+  void HandOverSharedBytes(const StorageAction& dropped, StorageAction* next,
+                           size_t* next_total);
+
   void MaybeNotifyUndoRedoStateChanged();
   std::unique_ptr<StorageAction> StorageActionFromProto(
       const ink::proto::StorageAction& proto) const;
@@ -73,6 +114,13 @@ class UndoManager {
   bool last_undo_state_;
   bool last_redo_state_;
   bool enabled_;
+  HistoryPolicy policy_;
+  // The sums of StorageAction::MemoryBytes() over undoables_ and redoables_,
+  // which are kept exact: an action's size only changes when it is coalesced
+  // with the next one, or takes over counting shared UUIDs from a dropped one
+  // (see HandOverSharedBytes()), and it is measured again then.
+  size_t undo_bytes_ = 0;
+  size_t redo_bytes_ = 0;
 
   friend class UndoManagerTest;
 };
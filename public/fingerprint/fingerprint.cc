@@ -56,4 +56,20 @@ void Fingerprinter::Note(const std::string& uuid,
 
 uint64_t Fingerprinter::GetFingerprint() { return hasher_.Hash64(); }
 
+uint64_t IncrementalFingerprint::ElementHash(const ElementBundle& element) {
+  glm::mat4 obj_to_world{1};
+  if (!ink::util::ReadFromProto(element.transform(), &obj_to_world)) {
+    SLOG(SLOG_WARNING, "invalid transform for element $0", element.uuid());
+    return 0;
+  }
+  return ElementHash(element.uuid(), obj_to_world);
+}
+
+uint64_t IncrementalFingerprint::ElementHash(const std::string& uuid,
+                                             const glm::mat4& obj_to_world) {
+  Fingerprinter fingerprinter;
+  fingerprinter.Note(uuid, obj_to_world);
+  return fingerprinter.GetFingerprint();
+}
+
 }  // namespace ink
@@ -53,6 +53,31 @@ class Fingerprinter {
   MD5Hash hasher_;
 };
 
+// An order-independent fingerprint of a set of elements, which can be updated
+// in O(1) as elements are added, removed, or changed.
+//
+// Each element is hashed from the same details as Fingerprinter uses (its uuid
+// and transform), and the fingerprint is the sum of the element hashes, modulo
+// 2^64. Unlike Fingerprinter, the result does not depend on the order of the
+// elements, and is not compatible with the fingerprint stored in a Snapshot.
+class IncrementalFingerprint {
+ public:
+  // Returns the hash of a single element. Elements with invalid transforms
+  // hash to 0, as Fingerprinter ignores them.
+  static uint64_t ElementHash(const ink::proto::ElementBundle& element);
+  static uint64_t ElementHash(const std::string& uuid,
+                              const glm::mat4& obj_to_world);
+
+  void Add(uint64_t element_hash) { value_ += element_hash; }
+  void Remove(uint64_t element_hash) { value_ -= element_hash; }
+  void Clear() { value_ = 0; }
+
+  uint64_t GetFingerprint() const { return value_; }
+
+ private:
+  uint64_t value_ = 0;
+};
+
 }  // namespace ink
 
 #endif  // INK_PUBLIC_FINGERPRINT_FINGERPRINT_H_
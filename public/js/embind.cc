@@ -17,6 +17,7 @@
 
 #include "google/protobuf/message_lite.h"
 #include "third_party/absl/memory/memory.h"
+#include "third_party/absl/strings/str_cat.h"
 #include "third_party/absl/strings/string_view.h"
 #include "third_party/absl/strings/substitute.h"
 #include "third_party/glm/glm/glm.hpp"
@@ -29,6 +30,7 @@
 #include "ink/engine/public/types/input.h"
 #include "ink/engine/public/types/iselection_provider.h"
 #include "ink/engine/public/types/status.h"
+#include "ink/engine/rendering/export/image_exporter.h"
 #include "ink/engine/util/dbg/errors.h"
 #include "ink/proto/brix_portable_proto.pb.h"
 #include "ink/proto/document_portable_proto.pb.h"
@@ -43,6 +45,7 @@
 #include "ink/public/document/document.h"
 #include "ink/public/document/single_user_document.h"
 #include "ink/public/document/storage/in_memory_storage.h"
+#include "ink/public/document/storage/snapshot_reader.h"
 #include "ink/public/fingerprint/fingerprint.h"
 #include "ink/public/mutations/mutation_applier.h"
 
@@ -237,16 +240,24 @@ void LoadFromSerializedSnapshotAndMutations(SEngine* engine,
   std::unique_ptr<ink::Document> doc;
 
   auto snapshot_bytes = CopyToHeap<std::vector<uint8_t>>(serialized_snapshot);
-  ink::proto::Snapshot snapshot;
-  if (!snapshot.ParseFromArray(snapshot_bytes.data(), snapshot_bytes.size())) {
+  // Read the snapshot's elements straight into the document, rather than
+  // parsing them into a proto::Snapshot first, so that large documents are
+  // not held in memory twice.
+  std::unique_ptr<ink::SnapshotReader> reader;
+  if (!ink::SnapshotReader::FromBuffer(
+           absl::string_view(
+               reinterpret_cast<const char*>(snapshot_bytes.data()),
+               snapshot_bytes.size()),
+           &reader)
+           .ok()) {
     SLOG(
         SLOG_ERROR,
         "could not parse given data as Snapshot; starting from empty document");
     doc = absl::make_unique<SingleUserDocument>(
         std::make_shared<ink::InMemoryStorage>());
   } else {
-    auto status = SingleUserDocument::CreateFromSnapshot(
-        std::make_shared<ink::InMemoryStorage>(), snapshot, &doc);
+    auto status = SingleUserDocument::CreateFromSnapshotReader(
+        std::make_shared<ink::InMemoryStorage>(), *reader, &doc);
     if (!status.ok()) {
       SLOG(SLOG_ERROR, "fallback to empty document: $0",
            status.error_message());
@@ -370,8 +381,13 @@ EMSCRIPTEN_BINDINGS(SEngine) {
       .function("setOutlineExportEnabled", &SEngine::setOutlineExportEnabled)
       .function("setHandwritingDataEnabled",
                 &SEngine::setHandwritingDataEnabled)
+      .function("setMeshMemoryBudget", &SEngine::setMeshMemoryBudget)
       .function("assignFlag", &SEngine::assignFlag)
       .function("startImageExport", &SEngine::startImageExport)
+      .function("exportImageTiled", &SEngine::exportImageTiled,
+                allow_raw_pointers())
+      .function("exportTrace", &SEngine::exportTrace)
+      .function("clearTrace", &SEngine::clearTrace)
       .function("setCameraBoundsConfig", &SEngine::setCameraBoundsConfig)
       .function("document", &SEngine::document)
       .function("selectElement", &SEngine::SelectElement)
@@ -402,11 +418,25 @@ EMSCRIPTEN_BINDINGS(SEngine) {
       .function("getPageLocations", &SEngine::GetPageLocations);
 };
 
+namespace embind_document {
+// The fingerprint is returned as a decimal string, as it may not fit in a
+// double.
+std::string GetFingerprint(Document* document) {
+  return absl::StrCat(document->GetFingerprint());
+}
+}  // namespace embind_document
+
 EMSCRIPTEN_BINDINGS(Document) {
+  enum_<Document::FingerprintMode>("FingerprintMode")
+      .value("INCREMENTAL", Document::FingerprintMode::kIncremental)
+      .value("LEGACY", Document::FingerprintMode::kLegacy);
+
   class_<Document>("Document")
       .smart_ptr<std::shared_ptr<Document>>("Document")
       .function("Add", &Document::Add)
       .function("AddBelow", &Document::AddBelow)
+      .function("GetFingerprint", &embind_document::GetFingerprint,
+                allow_raw_pointers())
       .function("GetPageProperties", &Document::GetPageProperties)
       .function("GetSnapshot", &Document::GetSnapshot)
       .function("Remove", &Document::Remove)
@@ -416,6 +446,7 @@ EMSCRIPTEN_BINDINGS(Document) {
       .function("SetBackgroundColor", &Document::SetBackgroundColor)
       .function("SetPageBorder", &Document::SetPageBorder)
       .function("SetElementTransforms", &Document::SetElementTransforms)
+      .function("SetFingerprintMode", &Document::SetFingerprintMode)
       .function("SetUndoEnabled", &Document::SetUndoEnabled);
 }
 
@@ -565,6 +596,32 @@ class ClientBitmapWrapper : public wrapper<ClientBitmap> {
     return reinterpret_cast<void*>(call<uintptr_t>("imageByteData"));
   }
 };
+
+// Wrapper class that allows JavaScript to implement ImageExportSink, to receive
+// the image exported by SEngine.exportImageTiled() one band of rows at a time:
+// var MySink = Module.ImageExportSink.extend('ImageExportSink', {
+//   begin: function(widthPx, heightPx, fingerprint) { ... },
+//   writeRows: function(firstRow, nRows, rgba) { ... },
+// });
+// The fingerprint is passed as a decimal string, as it may not fit in a
+// double. rgba is a Uint8Array view of the heap, which is only valid for the
+// duration of the call.
+class ImageExportSinkWrapper : public wrapper<ImageExportSink> {
+ public:
+  EMSCRIPTEN_WRAPPER(ImageExportSinkWrapper);
+  void Begin(glm::ivec2 size_px, uint64_t fingerprint) override {
+    width_px_ = size_px.x;
+    call<void>("begin", size_px.x, size_px.y, absl::StrCat(fingerprint));
+  }
+  void WriteRows(int first_row, int n_rows, const uint8_t* rgba) override {
+    size_t len = static_cast<size_t>(width_px_) * n_rows * 4;
+    call<void>("writeRows", first_row, n_rows,
+               val(typed_memory_view(len, rgba)));
+  }
+
+ private:
+  int width_px_ = 0;
+};
 }  // namespace internal
 
 // Bindings for the abstract class are also required for implementing in
@@ -594,6 +651,10 @@ EMSCRIPTEN_BINDINGS(classes_implemented_in_js) {
       .function("onBlockingStateChanged", &Host::BlockingStateChanged,
                 pure_virtual())
       .allow_subclass<HostWrapper>("HostWrapper");
+
+  class_<ImageExportSink>("ImageExportSink")
+      .allow_subclass<internal::ImageExportSinkWrapper>(
+          "ImageExportSinkWrapper");
 }
 
 // Bind all the types (protos, enums) required for SEngine method arguments.
@@ -942,7 +1003,14 @@ EMSCRIPTEN_BINDINGS(enums) {
       .value("ENABLE_MOTION_BLUR", ink::proto::Flag::ENABLE_MOTION_BLUR)
       .value("ENABLE_SELECTION_BOX_HANDLES",
              ink::proto::Flag::ENABLE_SELECTION_BOX_HANDLES)
-      .value("ENABLE_PARTIAL_DRAW", ink::proto::Flag::ENABLE_PARTIAL_DRAW);
+      .value("ENABLE_PARTIAL_DRAW", ink::proto::Flag::ENABLE_PARTIAL_DRAW)
+      .value("ENABLE_PARALLEL_TASK_EXECUTION",
+             ink::proto::Flag::ENABLE_PARALLEL_TASK_EXECUTION)
+      .value("KEEP_TEXTURES_IN_CPU_MEMORY",
+             ink::proto::Flag::KEEP_TEXTURES_IN_CPU_MEMORY)
+      .value("ENABLE_TRACING", ink::proto::Flag::ENABLE_TRACING)
+      .value("ENABLE_INCREMENTAL_TESSELLATION",
+             ink::proto::Flag::ENABLE_INCREMENTAL_TESSELLATION);
 
   enum_<ink::Document::SnapshotQuery>("SnapshotQuery")
       .value("INCLUDE_UNDO_STACK",